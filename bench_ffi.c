@@ -0,0 +1,108 @@
+/**
+ * SM2 协同签名 FFI 微基准
+ *
+ * 测量每个 C 接口的单次调用耗时，空指针快速失败一项即为纯 FFI 调用开销。
+ *
+ * 编译运行：
+ *   cargo build --release -p sm2_co_sign_ffi
+ *   gcc -O2 -I. bench_ffi.c target/release/libsm2_co_sign_ffi.a -lpthread -ldl -lm -o bench_ffi
+ *   ./bench_ffi
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sm2_co_sign_ffi.h"
+
+// 每项至少运行的时间（纳秒）
+#define MIN_DURATION_NS 200000000LL
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// 反复执行 stmt 直到超过 MIN_DURATION_NS，输出平均单次耗时
+#define BENCH(name, stmt)                                                        \
+    do {                                                                         \
+        long long start_ = now_ns();                                             \
+        long long iters_ = 0;                                                    \
+        long long elapsed_ = 0;                                                  \
+        do {                                                                     \
+            for (int i_ = 0; i_ < 16; i_++) {                                    \
+                stmt;                                                            \
+            }                                                                    \
+            iters_ += 16;                                                        \
+            elapsed_ = now_ns() - start_;                                        \
+        } while (elapsed_ < MIN_DURATION_NS);                                    \
+        printf("%-40s %12.1f ns/次\n", name, (double)elapsed_ / (double)iters_); \
+    } while (0)
+
+int main(void) {
+    printf("========================================\n");
+    printf("  SM2 协同签名 FFI 微基准\n");
+    printf("========================================\n");
+
+    CoSignContext *ctx = cosign_context_new();
+    if (ctx == NULL) {
+        printf("创建上下文失败\n");
+        return 1;
+    }
+
+    unsigned char d1[32], p1[64], k1[32], q1[64], e[32], t1[64];
+    unsigned char out_r[32], out_s[32];
+    unsigned long len = 0, len2 = 0;
+    cosign_generate_d1(ctx, d1, &len);
+    cosign_calculate_p1(ctx, d1, 32, p1, &len);
+    cosign_sign_prepare(ctx, k1, &len, q1, &len2);
+
+    // 签名补全只做模运算，服务端分片取任意合法标量即可
+    unsigned char r[32], s2[32], s3[32];
+    cosign_generate_d1(ctx, r, &len);
+    cosign_generate_d1(ctx, s2, &len);
+    cosign_generate_d1(ctx, s3, &len);
+
+    printf("\n--- 调用开销 ---\n");
+    BENCH("cosign_sm3_hash(NULL) 快速失败", cosign_sm3_hash(NULL, 0, NULL, NULL));
+    BENCH("cosign_sm3_hash 32B", cosign_sm3_hash(d1, 32, e, &len));
+
+    printf("\n--- 协同签名 ---\n");
+    BENCH("cosign_generate_d1", cosign_generate_d1(ctx, k1, &len));
+    BENCH("cosign_calculate_p1", cosign_calculate_p1(ctx, d1, 32, p1, &len));
+    BENCH("cosign_sign_prepare", cosign_sign_prepare(ctx, k1, &len, q1, &len2));
+    BENCH("cosign_complete_signature",
+          cosign_complete_signature(ctx, k1, 32, d1, 32, r, 32, s2, 32, s3, 32, out_r, &len, out_s, &len2));
+
+    size_t sizes[] = {32, 1024, 65536};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        size_t size = sizes[i];
+        unsigned char *message = malloc(size);
+        char *encoded = malloc(size * 2 + 4);
+        unsigned char *decoded = malloc(size + 4);
+        memset(message, 0x5a, size);
+        char name[64];
+
+        printf("\n--- 消息 %zu 字节 ---\n", size);
+        snprintf(name, sizeof(name), "cosign_hash_message");
+        BENCH(name, cosign_hash_message(ctx, message, size, p1, 64, e, &len));
+        snprintf(name, sizeof(name), "cosign_sm3_hash");
+        BENCH(name, cosign_sm3_hash(message, size, e, &len));
+        snprintf(name, sizeof(name), "cosign_base64_encode");
+        BENCH(name, (len = size * 2 + 4, cosign_base64_encode(message, size, encoded, &len)));
+        snprintf(name, sizeof(name), "cosign_base64_decode");
+        BENCH(name, (len = size + 4, cosign_base64_decode(encoded, decoded, &len)));
+
+        free(message);
+        free(encoded);
+        free(decoded);
+    }
+
+    printf("\n--- 协同解密 ---\n");
+    BENCH("cosign_decrypt_prepare", cosign_decrypt_prepare(ctx, d1, 32, p1, 64, t1, &len));
+
+    cosign_context_free(ctx);
+    return 0;
+}
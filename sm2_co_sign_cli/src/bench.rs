@@ -0,0 +1,546 @@
+//! `bench` 子命令：对协同签名服务端持续压测，用于容量规划
+//!
+//! 两种负载模型：
+//! - 闭环（默认）：`--concurrency` 个任务各自循环发起请求，测的是该并发下的最大吞吐
+//! - 开环（`--qps`）：按固定间隔发起请求，延迟从计划发起时刻算起，服务端变慢时排队时间
+//!   也计入延迟，不会因“慢请求推迟了后续请求”而低估尾延迟
+//!
+//! 客户端的随机数池、预提交、流水线引擎、批量签名都可以通过参数开启，便于对比配置。
+//! CLI 以 `metrics` feature 构建时，另外输出客户端各阶段与网络往返的耗时分解。
+
+use sm2_co_sign_core::{ClientConfig, CoSignClient, CoSignProtocol, EngineConfig, Error, SigningEngine};
+use std::collections::HashMap;
+use std::path::PathBuf;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Arc;
+use std::time::{Duration, Instant, SystemTime, UNIX_EPOCH};
+use tokio::sync::Semaphore;
+use tokio::task::JoinSet;
+
+/// 压测操作
+#[derive(Clone, Copy, PartialEq, Eq, clap::ValueEnum)]
+pub enum BenchOp {
+    /// 协同签名
+    Sign,
+    /// 协同解密
+    Decrypt,
+}
+
+#[derive(clap::Args)]
+pub struct BenchArgs {
+    /// 压测操作
+    #[arg(long, value_enum, default_value = "sign")]
+    op: BenchOp,
+    /// 计时时长（秒）
+    #[arg(short, long, default_value_t = 10)]
+    duration: u64,
+    /// 计时前的预热时长（秒），预热期间的样本不计入结果
+    #[arg(long, default_value_t = 2)]
+    warmup: u64,
+    /// 目标 QPS（开环）；不指定时按 --concurrency 闭环压测
+    #[arg(long)]
+    qps: Option<f64>,
+    /// 闭环模式的并发数；开环模式下为在途请求上限
+    #[arg(short, long, default_value_t = 16)]
+    concurrency: usize,
+    /// 临时注册的压测用户数，请求在用户间轮换；0 表示使用本地已登录的用户
+    #[arg(long, default_value_t = 0)]
+    users: usize,
+    /// 压测用户名前缀（实际用户名为 <前缀>-<时间戳>-<序号>）
+    #[arg(long, default_value = "bench")]
+    user_prefix: String,
+    /// 压测用户密码
+    #[arg(long, default_value = "bench-password")]
+    user_password: String,
+    /// 消息（解密时为明文）字节数，可重复，请求依次轮换
+    #[arg(long = "message-size", default_values_t = [256usize])]
+    message_sizes: Vec<usize>,
+    /// 随机数池容量，0 表示不启用
+    #[arg(long, default_value_t = 0)]
+    nonce_pool: usize,
+    /// 每批预提交的签名随机数数量，0 表示不启用
+    #[arg(long, default_value_t = 0)]
+    precommit: usize,
+    /// 经流水线签名引擎提交（仅 sign；每个用户一个引擎）
+    #[arg(long)]
+    engine: bool,
+    /// 每个请求批量签名的消息数（仅 sign；同一批内为同一用户），1 表示逐条签名
+    #[arg(long, default_value_t = 1)]
+    batch: usize,
+    /// Token 文件路径（--users 0 时使用）
+    #[arg(short, long, default_value = ".token")]
+    token_file: PathBuf,
+    /// D1 文件路径（--users 0 时使用）
+    #[arg(long, default_value = ".d1")]
+    d1_file: PathBuf,
+}
+
+/// 执行压测
+pub async fn run(config: &ClientConfig, args: BenchArgs) -> anyhow::Result<()> {
+    anyhow::ensure!(args.duration > 0, "--duration 必须大于 0");
+    anyhow::ensure!(args.concurrency > 0, "--concurrency 必须大于 0");
+    anyhow::ensure!(args.batch > 0, "--batch 必须大于 0");
+    anyhow::ensure!(args.qps.map_or(true, |qps| qps > 0.0), "--qps 必须大于 0");
+    anyhow::ensure!(!(args.engine && args.batch > 1), "--engine 与 --batch 不能同时使用");
+    anyhow::ensure!(
+        args.op == BenchOp::Sign || (!args.engine && args.batch == 1),
+        "--engine / --batch 只适用于 sign"
+    );
+
+    let config = ClientConfig {
+        nonce_pool_size: args.nonce_pool,
+        precommit_batch: args.precommit,
+        ..config.clone()
+    };
+    let workload = Arc::new(Workload::new(&config, &args).await?);
+
+    if args.warmup > 0 {
+        println!("预热 {} 秒...", args.warmup);
+        drive(&workload, &args, Duration::from_secs(args.warmup)).await;
+    }
+    #[cfg(feature = "metrics")]
+    sm2_co_sign_core::metrics::reset();
+
+    println!("压测 {} 秒...", args.duration);
+    let stats = drive(&workload, &args, Duration::from_secs(args.duration)).await;
+    report(&args, &stats);
+
+    if let Ok(workload) = Arc::try_unwrap(workload) {
+        for engine in workload.engines {
+            engine.shutdown().await;
+        }
+    }
+    Ok(())
+}
+
+/// 压测用户
+struct BenchUser {
+    user_id: String,
+    public_key: Vec<u8>,
+}
+
+/// 压测负载：客户端、用户和预先生成的消息/密文
+struct Workload {
+    client: Arc<CoSignClient>,
+    users: Vec<BenchUser>,
+    /// 用户登记在密钥环中（`--users` > 0），按用户轮换调用 `sign_for` / `decrypt_for`
+    keyring: bool,
+    op: BenchOp,
+    batch: usize,
+    /// 以各用户为默认用户的客户端（与 `users` 一一对应），供引擎与批量签名使用；
+    /// 不需要时只含 `client`
+    signers: Vec<Arc<CoSignClient>>,
+    /// `--engine` 时每个用户一个引擎
+    engines: Vec<SigningEngine>,
+    /// 每种大小一条消息
+    messages: Vec<Vec<u8>>,
+    /// `ciphertexts[用户][大小]`
+    ciphertexts: Vec<Vec<Vec<u8>>>,
+}
+
+impl Workload {
+    async fn new(config: &ClientConfig, args: &BenchArgs) -> anyhow::Result<Self> {
+        // Reason: 引擎与批量签名只能以客户端的默认用户签名，多用户时每个用户单独一个客户端
+        let per_user = args.engine || args.batch > 1;
+        let (client, users, signers) = if args.users == 0 {
+            let client = Arc::new(crate::open_signer(config, &args.token_file, &args.d1_file).await?);
+            let key_pair = client.get_key_pair().await.ok_or_else(|| anyhow::anyhow!("密钥对未加载"))?;
+            let user = BenchUser {
+                user_id: key_pair.user_id.clone(),
+                public_key: key_pair.public_key.clone(),
+            };
+            (Arc::clone(&client), vec![user], vec![client])
+        } else {
+            register_users(config, args, per_user).await?
+        };
+
+        let messages: Vec<Vec<u8>> = args
+            .message_sizes
+            .iter()
+            .map(|&size| (0..size).map(|i| (i * 31 + 7) as u8).collect())
+            .collect();
+        let ciphertexts = if args.op == BenchOp::Decrypt {
+            users
+                .iter()
+                .map(|user| {
+                    messages
+                        .iter()
+                        .map(|message| CoSignProtocol::encrypt(&user.public_key, message))
+                        .collect::<Result<Vec<_>, _>>()
+                })
+                .collect::<Result<Vec<_>, _>>()?
+        } else {
+            Vec::new()
+        };
+
+        let engines = if args.engine {
+            // 在途上限按用户均分，总量与单用户时一致
+            let max_in_flight = args.concurrency.div_ceil(signers.len());
+            signers
+                .iter()
+                .map(|signer| {
+                    SigningEngine::new(
+                        Arc::clone(signer),
+                        EngineConfig {
+                            queue_depth: max_in_flight * 2,
+                            max_in_flight,
+                        },
+                    )
+                })
+                .collect()
+        } else {
+            Vec::new()
+        };
+        if args.precommit > 0 {
+            for signer in &signers {
+                signer.precommit(args.precommit).await?;
+            }
+        }
+
+        Ok(Self {
+            client,
+            users,
+            keyring: args.users > 0,
+            op: args.op,
+            batch: args.batch,
+            signers,
+            engines,
+            messages,
+            ciphertexts,
+        })
+    }
+
+    /// 执行第 `seq` 个请求，返回成功的签名/解密数和（任一项）失败原因
+    async fn run_once(&self, seq: usize) -> (usize, Option<Error>) {
+        let size = seq % self.messages.len();
+        let user_index = (seq / self.messages.len()) % self.users.len();
+        let user = &self.users[user_index];
+        let result = match self.op {
+            BenchOp::Decrypt => {
+                let ciphertext = &self.ciphertexts[user_index][size];
+                if self.keyring {
+                    self.client.decrypt_for(&user.user_id, ciphertext).await.map(drop)
+                } else {
+                    self.client.decrypt(ciphertext).await.map(drop)
+                }
+            }
+            BenchOp::Sign => {
+                let message = &self.messages[size];
+                if let Some(engine) = self.engines.get(user_index) {
+                    match engine.submit(message.clone()).await {
+                        Ok(ticket) => ticket.await.map(drop),
+                        Err(e) => Err(e),
+                    }
+                } else if self.batch > 1 {
+                    let messages = vec![message.as_slice(); self.batch];
+                    let results = self.signers[user_index].sign_batch(&messages).await;
+                    let done = results.iter().filter(|result| result.is_ok()).count();
+                    return (done, results.into_iter().find_map(Result::err));
+                } else if self.keyring {
+                    self.client.sign_for(&user.user_id, message).await.map(drop)
+                } else {
+                    self.client.sign(message).await.map(drop)
+                }
+            }
+        };
+        match result {
+            Ok(()) => (1, None),
+            Err(e) => (0, Some(e)),
+        }
+    }
+}
+
+/// 注册并登录 `--users` 个临时用户，第一个用户同时设为客户端的默认用户
+///
+/// `per_user` 为真时另为每个用户创建一个以其为默认用户的客户端，否则只返回共享客户端。
+async fn register_users(
+    config: &ClientConfig,
+    args: &BenchArgs,
+    per_user: bool,
+) -> anyhow::Result<(Arc<CoSignClient>, Vec<BenchUser>, Vec<Arc<CoSignClient>>)> {
+    let client = Arc::new(CoSignClient::new(config.clone())?);
+    let mut signers = Vec::new();
+    let run_id = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs();
+    let registrar_config = ClientConfig {
+        nonce_pool_size: 0,
+        precommit_batch: 0,
+        ..config.clone()
+    };
+
+    let mut users = Vec::with_capacity(args.users);
+    for i in 0..args.users {
+        let username = format!("{}-{}-{}", args.user_prefix, run_id, i);
+        // Reason: d1 只保存在内存中，压测用户用完即弃，不写本地文件
+        let registrar = CoSignClient::new(registrar_config.clone())?;
+        let key_pair = registrar.register(&username, &args.user_password).await?;
+        let session = registrar.login(&username, &args.user_password).await?;
+        if i == 0 {
+            client.set_session(session.token.clone(), session.user_id.clone()).await?;
+            client
+                .set_key_pair(key_pair.d1.to_vec(), key_pair.public_key.clone(), session.user_id.clone())
+                .await?;
+        }
+        if per_user {
+            signers.push(if i == 0 {
+                Arc::clone(&client)
+            } else {
+                let signer = Arc::new(CoSignClient::new(config.clone())?);
+                signer.set_session(session.token.clone(), session.user_id.clone()).await?;
+                signer
+                    .set_key_pair(key_pair.d1.to_vec(), key_pair.public_key.clone(), session.user_id.clone())
+                    .await?;
+                signer
+            });
+        }
+        users.push(BenchUser {
+            user_id: session.user_id.clone(),
+            public_key: key_pair.public_key.clone(),
+        });
+        client.add_user(session, key_pair.d1.to_vec(), key_pair.public_key)?;
+    }
+    println!("已注册 {} 个压测用户（{}-{}-*）", args.users, args.user_prefix, run_id);
+    if signers.is_empty() {
+        signers.push(Arc::clone(&client));
+    }
+    Ok((client, users, signers))
+}
+
+/// 压测统计
+#[derive(Default)]
+struct Stats {
+    /// 成功请求的延迟（微秒）
+    latencies_us: Vec<u64>,
+    /// 成功的签名/解密数（批量时每个请求计多次）
+    operations: u64,
+    /// 失败的请求数
+    failures: u64,
+    /// 开环模式下因在途请求达到上限而未发出的请求数
+    dropped: u64,
+    /// 失败原因 → 次数
+    errors: HashMap<String, u64>,
+    elapsed: Duration,
+}
+
+impl Stats {
+    fn record(&mut self, latency: Duration, (done, error): (usize, Option<Error>)) {
+        self.operations += done as u64;
+        match error {
+            // 批量请求部分成功时，成功项照常计入吞吐，该请求的延迟仍计入分布
+            Some(e) if done == 0 => {
+                self.failures += 1;
+                *self.errors.entry(e.to_string()).or_default() += 1;
+                return;
+            }
+            Some(e) => *self.errors.entry(e.to_string()).or_default() += 1,
+            None => {}
+        }
+        self.latencies_us.push(u64::try_from(latency.as_micros()).unwrap_or(u64::MAX));
+    }
+
+    fn merge(&mut self, other: Stats) {
+        self.latencies_us.extend(other.latencies_us);
+        self.operations += other.operations;
+        self.failures += other.failures;
+        self.dropped += other.dropped;
+        for (error, n) in other.errors {
+            *self.errors.entry(error).or_default() += n;
+        }
+    }
+}
+
+/// 按配置的负载模型运行 `duration`
+async fn drive(workload: &Arc<Workload>, args: &BenchArgs, duration: Duration) -> Stats {
+    let start = Instant::now();
+    let mut stats = match args.qps {
+        None => closed_loop(workload, args.concurrency, start + duration).await,
+        Some(qps) => open_loop(workload, qps, args.concurrency, start + duration).await,
+    };
+    stats.elapsed = start.elapsed();
+    stats
+}
+
+/// 闭环：固定并发，每个任务上一个请求完成后立即发起下一个
+async fn closed_loop(workload: &Arc<Workload>, concurrency: usize, deadline: Instant) -> Stats {
+    let seq = Arc::new(AtomicUsize::new(0));
+    let mut tasks = JoinSet::new();
+    for _ in 0..concurrency {
+        let workload = Arc::clone(workload);
+        let seq = Arc::clone(&seq);
+        tasks.spawn(async move {
+            let mut stats = Stats::default();
+            while Instant::now() < deadline {
+                let n = seq.fetch_add(1, Ordering::Relaxed);
+                let started = Instant::now();
+                let outcome = workload.run_once(n).await;
+                stats.record(started.elapsed(), outcome);
+            }
+            stats
+        });
+    }
+
+    let mut stats = Stats::default();
+    while let Some(result) = tasks.join_next().await {
+        if let Ok(worker) = result {
+            stats.merge(worker);
+        }
+    }
+    stats
+}
+
+/// 开环：按固定间隔发起请求，在途请求达到上限时该次请求丢弃并计数
+async fn open_loop(workload: &Arc<Workload>, qps: f64, max_in_flight: usize, deadline: Instant) -> Stats {
+    let interval = Duration::from_secs_f64(1.0 / qps);
+    let permits = Arc::new(Semaphore::new(max_in_flight));
+    let mut tasks = JoinSet::new();
+    let mut stats = Stats::default();
+
+    let mut scheduled = Instant::now();
+    let mut n = 0usize;
+    while scheduled < deadline {
+        tokio::time::sleep_until(scheduled.into()).await;
+        match Arc::clone(&permits).try_acquire_owned() {
+            Ok(permit) => {
+                let workload = Arc::clone(workload);
+                tasks.spawn(async move {
+                    let outcome = workload.run_once(n).await;
+                    drop(permit);
+                    // Reason: 从计划时刻而不是实际发起时刻计时，调度落后的时间也计入延迟
+                    (scheduled.elapsed(), outcome)
+                });
+            }
+            Err(_) => stats.dropped += 1,
+        }
+        n += 1;
+        scheduled += interval;
+
+        while let Some(result) = tasks.try_join_next() {
+            if let Ok((latency, outcome)) = result {
+                stats.record(latency, outcome);
+            }
+        }
+    }
+
+    while let Some(result) = tasks.join_next().await {
+        if let Ok((latency, outcome)) = result {
+            stats.record(latency, outcome);
+        }
+    }
+    stats
+}
+
+/// 已排序样本的分位数
+fn percentile(sorted: &[u64], q: f64) -> u64 {
+    if sorted.is_empty() {
+        return 0;
+    }
+    let rank = ((q * sorted.len() as f64).ceil() as usize).clamp(1, sorted.len());
+    sorted[rank - 1]
+}
+
+fn format_us(us: u64) -> String {
+    if us >= 1000 {
+        format!("{:.2} ms", us as f64 / 1000.0)
+    } else {
+        format!("{} µs", us)
+    }
+}
+
+fn report(args: &BenchArgs, stats: &Stats) {
+    let secs = stats.elapsed.as_secs_f64();
+    let requests = stats.latencies_us.len() as u64 + stats.failures;
+    let op = match args.op {
+        BenchOp::Sign => "签名",
+        BenchOp::Decrypt => "解密",
+    };
+    let mode = match args.qps {
+        Some(qps) => format!("开环 {} QPS（在途上限 {}）", qps, args.concurrency),
+        None => format!("闭环并发 {}", args.concurrency),
+    };
+
+    println!();
+    println!("操作: {}，{}，{:.1} 秒", op, mode, secs);
+    println!(
+        "配置: 用户 {}，消息 {:?} 字节，随机数池 {}，预提交 {}，引擎 {}，批量 {}",
+        args.users.max(1),
+        args.message_sizes,
+        args.nonce_pool,
+        args.precommit,
+        if args.engine { "开" } else { "关" },
+        args.batch
+    );
+    print!("请求: {} 次，失败 {} 次", requests, stats.failures);
+    if stats.dropped > 0 {
+        print!("，{} 次因在途请求达到上限未发出（目标 QPS 超出容量）", stats.dropped);
+    }
+    println!();
+    println!("吞吐: {:.1} 次{}/秒（请求 {:.1}/秒）", stats.operations as f64 / secs, op, requests as f64 / secs);
+
+    let mut sorted = stats.latencies_us.clone();
+    sorted.sort_unstable();
+    println!(
+        "延迟: p50 {}  p99 {}  p999 {}  max {}",
+        format_us(percentile(&sorted, 0.5)),
+        format_us(percentile(&sorted, 0.99)),
+        format_us(percentile(&sorted, 0.999)),
+        format_us(sorted.last().copied().unwrap_or(0))
+    );
+
+    if !stats.errors.is_empty() {
+        let mut errors: Vec<_> = stats.errors.iter().collect();
+        errors.sort_by(|a, b| b.1.cmp(a.1));
+        println!("错误:");
+        for (error, n) in errors.into_iter().take(5) {
+            println!("  {:>8}  {}", n, error);
+        }
+    }
+
+    report_phases();
+}
+
+/// 客户端各阶段与网络往返的耗时分解
+#[cfg(feature = "metrics")]
+fn report_phases() {
+    use sm2_co_sign_core::metrics::{self, Counter, Phase};
+
+    let snapshot = metrics::snapshot();
+    let as_us = |d: Duration| u64::try_from(d.as_micros()).unwrap_or(u64::MAX);
+    println!("阶段分解:");
+    println!("  {:<20} {:>10} {:>12} {:>12} {:>12} {:>12}", "阶段", "次数", "平均", "p50", "p99", "p999");
+    let (mut client, mut network) = (Duration::ZERO, Duration::ZERO);
+    for stats in snapshot.phases.iter().filter(|stats| stats.count > 0) {
+        if stats.phase == Phase::Network {
+            network += stats.sum;
+        } else {
+            client += stats.sum;
+        }
+        println!(
+            "  {:<20} {:>10} {:>12} {:>12} {:>12} {:>12}",
+            stats.phase.name(),
+            stats.count,
+            format_us((stats.sum.as_micros() / u128::from(stats.count)) as u64),
+            format_us(as_us(stats.quantile(0.5))),
+            format_us(as_us(stats.quantile(0.99))),
+            format_us(as_us(stats.quantile(0.999)))
+        );
+    }
+    let total = (client + network).as_secs_f64();
+    if total > 0.0 {
+        println!(
+            "  客户端 / 网络耗时占比: {:.1}% / {:.1}%",
+            client.as_secs_f64() / total * 100.0,
+            network.as_secs_f64() / total * 100.0
+        );
+    }
+    println!(
+        "  线上字节: 发送 {}，接收 {}；重发 {} 次，对冲 {} 次",
+        snapshot.counter(Counter::BytesSent),
+        snapshot.counter(Counter::BytesReceived),
+        snapshot.counter(Counter::Retries),
+        snapshot.counter(Counter::Hedges)
+    );
+}
+
+#[cfg(not(feature = "metrics"))]
+fn report_phases() {
+    println!("阶段分解: 以 `--features metrics` 构建 CLI 后输出");
+}
@@ -0,0 +1,477 @@
+//! `daemon` 子命令：常驻进程持有预热好的 `CoSignClient`，经 Unix 域套接字为本机进程签名/解密
+//!
+//! 每次运行 CLI 都要付出进程启动、TLS 握手、恢复会话与加载 D1 的开销；守护进程只做一次，
+//! 连接池、会话、密钥对和随机数池一直保持可用。`sign` / `decrypt` 加 `--daemon <套接字>`
+//! 时只把消息转发给守护进程，其他本地进程也可以按下面的帧格式直接接入。
+//!
+//! 帧格式（整数均为大端序）：
+//! - 请求：`len: u32 | id: u32 | op: u8 | payload`
+//! - 响应：`len: u32 | id: u32 | status: u8 | payload`
+//!
+//! `len` 为其后的字节数（5 + payload 长度），单帧不超过 `MAX_FRAME`。
+//! op：1 = 签名（payload 为消息，返回 64 字节 r||s），2 = 解密（payload 为密文，返回明文）。
+//! status：0 = 成功，1 = 失败（payload 为 UTF-8 错误信息）。
+//!
+//! 同一连接上可以连续发送多个请求而不必等待响应（流水线），守护进程并发处理，
+//! 响应按完成顺序返回，调用方以 id 对应请求。
+//!
+//! 守护进程不持有密码，会话来自 token 文件：文件被重新写入（如另一终端执行 `login`）后，
+//! 定时检查或下一次请求失败时即换用新会话，失败的请求用新会话重试一次，不必重启守护进程。
+
+use sm2_co_sign_core::{ClientConfig, CoSignClient};
+use std::future::Future;
+use std::io;
+use std::os::unix::fs::{FileTypeExt, MetadataExt, PermissionsExt};
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, Mutex, PoisonError};
+use std::time::{Duration, SystemTime};
+use tokio::io::{AsyncRead, AsyncReadExt, AsyncWrite, AsyncWriteExt, BufWriter};
+use tokio::net::unix::OwnedWriteHalf;
+use tokio::net::{UnixListener, UnixStream};
+use tokio::sync::{mpsc, Semaphore};
+
+/// 单帧最大长度（16 MiB），超长帧视为协议错误并断开连接
+pub const MAX_FRAME: usize = 16 * 1024 * 1024;
+
+/// `len` 之后的固定头部：id（4 字节）+ op/status（1 字节）
+const FRAME_HEADER: usize = 5;
+
+/// 响应状态：成功
+const STATUS_OK: u8 = 0;
+
+/// 响应状态：失败，负载为错误信息
+const STATUS_ERR: u8 = 1;
+
+/// 每个连接待回写的响应队列长度
+const RESPONSE_QUEUE: usize = 64;
+
+/// `accept` 失败（如文件描述符耗尽）后暂停接受新连接的时间
+const ACCEPT_BACKOFF: Duration = Duration::from_millis(100);
+
+/// 检查 token 文件是否被重新写入的间隔
+const TOKEN_POLL_INTERVAL: Duration = Duration::from_secs(5);
+
+/// 请求操作
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum Op {
+    /// 协同签名
+    Sign = 1,
+    /// 协同解密
+    Decrypt = 2,
+}
+
+impl Op {
+    fn from_u8(op: u8) -> Option<Self> {
+        match op {
+            1 => Some(Op::Sign),
+            2 => Some(Op::Decrypt),
+            _ => None,
+        }
+    }
+}
+
+#[derive(clap::Args)]
+pub struct DaemonArgs {
+    /// Unix 域套接字路径
+    #[arg(long, default_value = ".cosign.sock")]
+    socket: PathBuf,
+    /// Token 文件路径
+    #[arg(short, long, default_value = ".token")]
+    token_file: PathBuf,
+    /// D1 文件路径
+    #[arg(long, default_value = ".d1")]
+    d1_file: PathBuf,
+    /// 随机数池容量，0 表示不启用
+    #[arg(long, default_value_t = 64)]
+    nonce_pool: usize,
+    /// 每批预提交的签名随机数数量，0 表示不启用
+    #[arg(long, default_value_t = 0)]
+    precommit: usize,
+    /// 所有连接合计同时处理的请求数上限
+    #[arg(long, default_value_t = 256)]
+    max_in_flight: usize,
+}
+
+/// 运行守护进程，直到收到 Ctrl-C
+pub async fn run(config: &ClientConfig, args: DaemonArgs) -> anyhow::Result<()> {
+    anyhow::ensure!(args.max_in_flight > 0, "--max-in-flight 必须大于 0");
+    let config = ClientConfig {
+        nonce_pool_size: args.nonce_pool,
+        precommit_batch: args.precommit,
+        ..config.clone()
+    };
+    let client = Arc::new(crate::open_signer(&config, &args.token_file, &args.d1_file).await?);
+    let token = Arc::new(TokenWatch::new(args.token_file.clone()));
+    let handler = {
+        let client = Arc::clone(&client);
+        let token = Arc::clone(&token);
+        Arc::new(move |op, payload| {
+            let client = Arc::clone(&client);
+            let token = Arc::clone(&token);
+            async move { handle(&client, &token, op, payload).await }
+        })
+    };
+
+    let listener = bind(&args.socket)?;
+    let owner = std::fs::metadata(&args.socket)?.uid();
+    let permits = Arc::new(Semaphore::new(args.max_in_flight));
+    let mut poll = tokio::time::interval(TOKEN_POLL_INTERVAL);
+    println!("守护进程已启动，监听 {:?}", args.socket);
+
+    loop {
+        tokio::select! {
+            accepted = listener.accept() => match accepted {
+                Ok((stream, _)) => {
+                    if peer_allowed(&stream, owner) {
+                        tokio::spawn(serve(stream, Arc::clone(&handler), Arc::clone(&permits)));
+                    } else {
+                        tracing::warn!("Rejected daemon connection from another user");
+                    }
+                }
+                Err(e) => {
+                    // Reason: EMFILE / ECONNABORTED 等错误是暂时的，守护进程不能因一批并发连接而退出
+                    tracing::warn!("Failed to accept daemon connection: {}", e);
+                    tokio::time::sleep(ACCEPT_BACKOFF).await;
+                }
+            },
+            _ = poll.tick() => {
+                token.reload(&client).await;
+            }
+            _ = tokio::signal::ctrl_c() => break,
+        }
+    }
+
+    let _ = std::fs::remove_file(&args.socket);
+    println!("守护进程已退出");
+    Ok(())
+}
+
+/// 经守护进程执行一次请求，返回成功响应的负载
+pub async fn call(socket: &Path, op: Op, payload: &[u8]) -> anyhow::Result<Vec<u8>> {
+    let mut stream = UnixStream::connect(socket)
+        .await
+        .map_err(|e| anyhow::anyhow!("无法连接守护进程 {:?}: {}", socket, e))?;
+    write_frame(&mut stream, 0, op as u8, payload).await?;
+    stream.flush().await?;
+
+    let (_, status, body) = read_frame(&mut stream)
+        .await?
+        .ok_or_else(|| anyhow::anyhow!("守护进程未返回响应即关闭连接"))?;
+    match status {
+        STATUS_OK => Ok(body),
+        _ => Err(anyhow::anyhow!("守护进程: {}", String::from_utf8_lossy(&body))),
+    }
+}
+
+/// 绑定套接字并限制为仅属主可访问
+///
+/// 路径上残留的旧套接字（守护进程异常退出时遗留）会被删除；已有守护进程在监听或路径
+/// 是普通文件时报错，不覆盖。
+fn bind(path: &Path) -> anyhow::Result<UnixListener> {
+    if let Ok(meta) = std::fs::symlink_metadata(path) {
+        anyhow::ensure!(meta.file_type().is_socket(), "{:?} 已存在且不是套接字", path);
+        anyhow::ensure!(
+            std::os::unix::net::UnixStream::connect(path).is_err(),
+            "{:?} 上已有守护进程在运行",
+            path
+        );
+        std::fs::remove_file(path)?;
+    }
+    let listener = UnixListener::bind(path)?;
+    std::fs::set_permissions(path, std::fs::Permissions::from_mode(0o600))?;
+    Ok(listener)
+}
+
+/// 对端是否与套接字属主为同一用户
+///
+/// Reason: 能连上套接字就能以本用户的 D1 签名，文件权限之外再按对端凭据把关
+fn peer_allowed(stream: &UnixStream, owner: u32) -> bool {
+    matches!(stream.peer_cred(), Ok(cred) if cred.uid() == owner)
+}
+
+/// token 文件监视：文件修改时间变化时重新读取会话并装入客户端
+struct TokenWatch {
+    path: PathBuf,
+    /// 上次读取时文件的修改时间
+    modified: Mutex<Option<SystemTime>>,
+}
+
+impl TokenWatch {
+    /// 启动时客户端已从该文件恢复会话，以当前修改时间为起点
+    fn new(path: PathBuf) -> Self {
+        let modified = std::fs::metadata(&path).and_then(|meta| meta.modified()).ok();
+        Self { path, modified: Mutex::new(modified) }
+    }
+
+    /// 文件自上次读取后被修改时换用其中的会话，返回是否换用了新会话
+    async fn reload(&self, client: &CoSignClient) -> bool {
+        let Ok(modified) = std::fs::metadata(&self.path).and_then(|meta| meta.modified()) else {
+            return false;
+        };
+        {
+            let mut seen = self.modified.lock().unwrap_or_else(PoisonError::into_inner);
+            if *seen == Some(modified) {
+                return false;
+            }
+            // Reason: 无论读取成败都记下本次修改时间，损坏或过期的文件不会每次请求都重读
+            *seen = Some(modified);
+        }
+        match crate::read_session_file(&self.path) {
+            Ok(session) => {
+                let user_id = session.user_id.clone();
+                if client.set_session(session.token, session.user_id).await.is_err() {
+                    return false;
+                }
+                tracing::info!("Reloaded session for {} from {:?}", user_id, self.path);
+                true
+            }
+            Err(e) => {
+                tracing::warn!("Ignoring token file {:?}: {}", self.path, e);
+                false
+            }
+        }
+    }
+}
+
+/// 处理一个连接：读循环逐帧解析并派发为独立任务，写任务按完成顺序回写响应
+///
+/// `handler` 按 op 与负载执行请求，守护进程中为 [`handle`]。
+async fn serve<H, F>(stream: UnixStream, handler: Arc<H>, permits: Arc<Semaphore>)
+where
+    H: Fn(u8, Vec<u8>) -> F + Send + Sync + 'static,
+    F: Future<Output = Result<Vec<u8>, String>> + Send + 'static,
+{
+    let (mut reader, writer) = stream.into_split();
+    let (tx, rx) = mpsc::channel(RESPONSE_QUEUE);
+    let writer = tokio::spawn(write_responses(writer, rx));
+
+    loop {
+        let (id, op, payload) = match read_frame(&mut reader).await {
+            Ok(Some(frame)) => frame,
+            Ok(None) => break,
+            Err(e) => {
+                tracing::warn!("Dropping daemon connection: {}", e);
+                break;
+            }
+        };
+        let Ok(permit) = Arc::clone(&permits).acquire_owned().await else {
+            break;
+        };
+        let request = handler(op, payload);
+        let tx = tx.clone();
+        tokio::spawn(async move {
+            let result = request.await;
+            drop(permit);
+            let _ = tx.send((id, result)).await;
+        });
+    }
+
+    // Reason: 读端结束后仍要等在途请求完成并写回，所有发送端释放后写任务自然退出
+    drop(tx);
+    let _ = writer.await;
+}
+
+/// 执行一个请求；失败时若 token 文件已更新（会话过期后重新登录），换用新会话重试一次
+async fn handle(client: &CoSignClient, token: &TokenWatch, op: u8, payload: Vec<u8>) -> Result<Vec<u8>, String> {
+    match execute(client, op, &payload).await {
+        Err(_) if token.reload(client).await => execute(client, op, &payload).await,
+        result => result,
+    }
+}
+
+/// 以客户端执行一个请求
+async fn execute(client: &CoSignClient, op: u8, payload: &[u8]) -> Result<Vec<u8>, String> {
+    match Op::from_u8(op) {
+        Some(Op::Sign) => {
+            let signature = client.sign(payload).await.map_err(|e| e.to_string())?;
+            let mut out = signature.r;
+            out.extend_from_slice(&signature.s);
+            Ok(out)
+        }
+        Some(Op::Decrypt) => client.decrypt(payload).await.map_err(|e| e.to_string()),
+        None => Err(format!("Unknown op {}", op)),
+    }
+}
+
+/// 回写响应；队列中已有多个完成的响应时合并写出，队列空了再 flush
+async fn write_responses(writer: OwnedWriteHalf, mut rx: mpsc::Receiver<(u32, Result<Vec<u8>, String>)>) {
+    let mut writer = BufWriter::new(writer);
+    while let Some(mut next) = rx.recv().await {
+        loop {
+            let (id, result) = next;
+            let (status, body) = match &result {
+                Ok(body) => (STATUS_OK, body.as_slice()),
+                Err(message) => (STATUS_ERR, message.as_bytes()),
+            };
+            if write_frame(&mut writer, id, status, body).await.is_err() {
+                return;
+            }
+            match rx.try_recv() {
+                Ok(more) => next = more,
+                Err(_) => break,
+            }
+        }
+        if writer.flush().await.is_err() {
+            return;
+        }
+    }
+}
+
+/// 写出一帧（不 flush）
+pub async fn write_frame<W: AsyncWrite + Unpin>(writer: &mut W, id: u32, kind: u8, payload: &[u8]) -> io::Result<()> {
+    let len = FRAME_HEADER + payload.len();
+    if len > MAX_FRAME {
+        return Err(io::Error::new(io::ErrorKind::InvalidInput, "Frame exceeds MAX_FRAME"));
+    }
+    let mut header = [0u8; 4 + FRAME_HEADER];
+    header[..4].copy_from_slice(&(len as u32).to_be_bytes());
+    header[4..8].copy_from_slice(&id.to_be_bytes());
+    header[8] = kind;
+    writer.write_all(&header).await?;
+    writer.write_all(payload).await
+}
+
+/// 读取一帧，返回 (id, op/status, payload)；对端在帧边界关闭连接时返回 `None`
+pub async fn read_frame<R: AsyncRead + Unpin>(reader: &mut R) -> io::Result<Option<(u32, u8, Vec<u8>)>> {
+    let mut len = [0u8; 4];
+    match reader.read_exact(&mut len).await {
+        Ok(_) => {}
+        Err(e) if e.kind() == io::ErrorKind::UnexpectedEof => return Ok(None),
+        Err(e) => return Err(e),
+    }
+    let len = u32::from_be_bytes(len) as usize;
+    if !(FRAME_HEADER..=MAX_FRAME).contains(&len) {
+        return Err(io::Error::new(io::ErrorKind::InvalidData, format!("Invalid frame length {}", len)));
+    }
+
+    let mut header = [0u8; FRAME_HEADER];
+    reader.read_exact(&mut header).await?;
+    let mut payload = vec![0u8; len - FRAME_HEADER];
+    reader.read_exact(&mut payload).await?;
+    let id = u32::from_be_bytes(header[..4].try_into().expect("4-byte slice"));
+    Ok(Some((id, header[4], payload)))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use sm2_co_sign_core::Session;
+    use tokio::sync::Notify;
+
+    #[tokio::test]
+    async fn test_frame_round_trip() {
+        let (mut a, mut b) = tokio::io::duplex(1024);
+        write_frame(&mut a, 7, Op::Sign as u8, b"hello").await.unwrap();
+        write_frame(&mut a, 8, Op::Decrypt as u8, b"").await.unwrap();
+        drop(a);
+
+        assert_eq!(read_frame(&mut b).await.unwrap(), Some((7, 1, b"hello".to_vec())));
+        assert_eq!(read_frame(&mut b).await.unwrap(), Some((8, 2, Vec::new())));
+        assert_eq!(read_frame(&mut b).await.unwrap(), None);
+    }
+
+    #[tokio::test]
+    async fn test_invalid_frame_length_rejected() {
+        for len in [0u32, 4, MAX_FRAME as u32 + 1] {
+            let (mut a, mut b) = tokio::io::duplex(64);
+            a.write_all(&len.to_be_bytes()).await.unwrap();
+            let err = read_frame(&mut b).await.unwrap_err();
+            assert_eq!(err.kind(), io::ErrorKind::InvalidData);
+        }
+        let (mut a, _b) = tokio::io::duplex(64);
+        let oversized = vec![0u8; MAX_FRAME];
+        assert!(write_frame(&mut a, 0, 1, &oversized).await.is_err());
+    }
+
+    #[tokio::test]
+    async fn test_truncated_frame_is_error() {
+        let (mut a, mut b) = tokio::io::duplex(64);
+        a.write_all(&10u32.to_be_bytes()).await.unwrap();
+        a.write_all(&[0, 0, 0, 1, 1]).await.unwrap();
+        drop(a);
+        assert!(read_frame(&mut b).await.is_err());
+    }
+
+    #[tokio::test]
+    async fn test_serve_pipelined_out_of_order() {
+        // Reason: "slow" 请求等到 "fast" 的响应被读到后才完成，验证流水线并发与按完成顺序回写
+        let release = Arc::new(Notify::new());
+        let handler = {
+            let release = Arc::clone(&release);
+            Arc::new(move |op: u8, payload: Vec<u8>| {
+                let release = Arc::clone(&release);
+                async move {
+                    match op {
+                        1 if payload == b"slow" => {
+                            release.notified().await;
+                            Ok(payload)
+                        }
+                        1 => Ok(payload),
+                        _ => Err(format!("Unknown op {}", op)),
+                    }
+                }
+            })
+        };
+        let (mut peer, stream) = UnixStream::pair().unwrap();
+        let server = tokio::spawn(serve(stream, handler, Arc::new(Semaphore::new(8))));
+
+        write_frame(&mut peer, 1, Op::Sign as u8, b"slow").await.unwrap();
+        write_frame(&mut peer, 2, Op::Sign as u8, b"fast").await.unwrap();
+        write_frame(&mut peer, 3, 9, b"").await.unwrap();
+        peer.flush().await.unwrap();
+
+        let mut early = vec![
+            read_frame(&mut peer).await.unwrap().unwrap(),
+            read_frame(&mut peer).await.unwrap().unwrap(),
+        ];
+        early.sort_by_key(|(id, _, _)| *id);
+        assert_eq!(early[0], (2, STATUS_OK, b"fast".to_vec()));
+        assert_eq!(early[1].0, 3);
+        assert_eq!(early[1].1, STATUS_ERR);
+        assert_eq!(early[1].2, b"Unknown op 9".to_vec());
+
+        // Reason: 读端关闭后在途请求仍要写回，随后连接才结束
+        peer.shutdown().await.unwrap();
+        release.notify_one();
+        assert_eq!(read_frame(&mut peer).await.unwrap(), Some((1, STATUS_OK, b"slow".to_vec())));
+        assert_eq!(read_frame(&mut peer).await.unwrap(), None);
+        server.await.unwrap();
+    }
+
+    #[tokio::test]
+    async fn test_peer_uid_checked() {
+        let (peer, stream) = UnixStream::pair().unwrap();
+        let uid = peer.peer_cred().unwrap().uid();
+        assert!(peer_allowed(&stream, uid));
+        assert!(!peer_allowed(&stream, uid.wrapping_add(1)));
+    }
+
+    #[tokio::test]
+    async fn test_token_file_reloaded_on_change() {
+        let path = std::env::temp_dir().join(format!("sm2-cosign-daemon-{}.token", std::process::id()));
+        let write = |token: &str, modified: SystemTime| {
+            let session = Session {
+                token: token.to_string(),
+                user_id: "u1".to_string(),
+                expires_at: "4000000000".to_string(),
+            };
+            std::fs::write(&path, serde_json::to_vec(&session).unwrap()).unwrap();
+            // Reason: 显式设置修改时间，不依赖文件系统的时间精度
+            std::fs::File::options().write(true).open(&path).unwrap().set_modified(modified).unwrap();
+        };
+        let client = CoSignClient::with_server_url("http://127.0.0.1:1").unwrap();
+        client.set_session("t1".to_string(), "u1".to_string()).await.unwrap();
+
+        write("t1", SystemTime::UNIX_EPOCH + Duration::from_secs(1_000));
+        let token = TokenWatch::new(path.clone());
+        assert!(!token.reload(&client).await);
+
+        write("t2", SystemTime::UNIX_EPOCH + Duration::from_secs(2_000));
+        assert!(token.reload(&client).await);
+        assert_eq!(client.get_session().await.unwrap().token, "t2");
+        assert!(!token.reload(&client).await);
+
+        let _ = std::fs::remove_file(&path);
+        assert!(!token.reload(&client).await);
+    }
+}
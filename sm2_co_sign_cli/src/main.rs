@@ -1,8 +1,13 @@
 //! SM2 协同签名 CLI 工具
 
+mod bench;
+#[cfg(unix)]
+mod daemon;
+
 use clap::{Parser, Subcommand};
-use sm2_co_sign_core::{CoSignClient, ClientConfig};
+use sm2_co_sign_core::{CoSignClient, ClientConfig, Session, WireFormat};
 use std::path::PathBuf;
+use std::time::SystemTime;
 
 #[derive(Parser)]
 #[command(name = "sm2-co-sign")]
@@ -12,6 +17,43 @@ struct Cli {
     #[arg(short, long, default_value = "http://127.0.0.1:7094")]
     server: String,
 
+    /// 其他服务端副本地址（可重复），与 --server 一起负载均衡并对冲慢请求
+    #[arg(long = "replica")]
+    replicas: Vec<String>,
+
+    /// 每个主机保留的最大空闲连接数
+    #[arg(long, default_value_t = 32)]
+    pool_max_idle: usize,
+
+    /// 空闲连接保留时长（秒），0 表示不主动回收
+    #[arg(long, default_value_t = 90)]
+    pool_idle_timeout: u64,
+
+    /// 直接使用 HTTP/2（prior knowledge），请求在单连接上多路复用
+    #[arg(long)]
+    http2: bool,
+
+    /// HTTP/2 PING 保活间隔（秒），0 表示关闭
+    #[arg(long, default_value_t = 0)]
+    http2_keepalive: u64,
+
+    /// TCP keepalive 间隔（秒），0 表示关闭
+    #[arg(long, default_value_t = 60)]
+    tcp_keepalive: u64,
+
+    /// 关闭 TCP_NODELAY
+    #[arg(long)]
+    no_tcp_nodelay: bool,
+
+    /// 签名/解密请求使用二进制编码（服务端不支持时自动回退为 JSON）
+    #[arg(long)]
+    binary_wire: bool,
+
+    /// sign / decrypt 经该套接字上的守护进程执行（见 daemon 子命令）
+    #[cfg(unix)]
+    #[arg(long, global = true)]
+    daemon: Option<PathBuf>,
+
     #[command(subcommand)]
     command: Commands,
 }
@@ -35,6 +77,9 @@ enum Commands {
         /// 密码
         #[arg(short, long)]
         password: String,
+        /// Token 文件路径（缓存会话，后续命令无需重新登录）
+        #[arg(short, long, default_value = ".token")]
+        token_file: PathBuf,
     },
     /// 用户登出
     Logout {
@@ -74,37 +119,77 @@ enum Commands {
     },
     /// 健康检查
     Health,
+    /// 压测：以目标 QPS 或固定并发持续签名/解密，输出吞吐与延迟分布
+    Bench(bench::BenchArgs),
+    /// 守护进程：保持会话、连接池与随机数池，经 Unix 域套接字为本机进程签名/解密
+    #[cfg(unix)]
+    Daemon(daemon::DaemonArgs),
 }
 
-#[tokio::main]
-async fn main() -> anyhow::Result<()> {
+fn main() -> anyhow::Result<()> {
     let cli = Cli::parse();
-    
+
+    // Reason: 单条命令只是几次顺序请求，current-thread 运行时省去启动整组工作线程的开销；
+    // 压测与守护进程要在多核上并发完成签名，仍使用多线程运行时
+    let mut runtime = match cli.command {
+        Commands::Bench(_) => tokio::runtime::Builder::new_multi_thread(),
+        #[cfg(unix)]
+        Commands::Daemon(_) => tokio::runtime::Builder::new_multi_thread(),
+        _ => tokio::runtime::Builder::new_current_thread(),
+    };
+    runtime.enable_all().build()?.block_on(run(cli))
+}
+
+async fn run(cli: Cli) -> anyhow::Result<()> {
     let config = ClientConfig {
         server_url: cli.server.clone(),
+        replica_urls: cli.replicas.clone(),
         timeout: 30,
         verify_tls: false,
+        pool_max_idle_per_host: cli.pool_max_idle,
+        pool_idle_timeout: cli.pool_idle_timeout,
+        http2_prior_knowledge: cli.http2,
+        http2_keep_alive_interval: cli.http2_keepalive,
+        tcp_keepalive: cli.tcp_keepalive,
+        tcp_nodelay: !cli.no_tcp_nodelay,
+        wire_format: if cli.binary_wire { WireFormat::Binary } else { WireFormat::Json },
+        ..ClientConfig::default()
     };
     
     match cli.command {
         Commands::Register { username, password } => {
             do_register(&config, &username, &password).await?;
         }
-        Commands::Login { username, password } => {
-            do_login(&config, &username, &password).await?;
+        Commands::Login { username, password, token_file } => {
+            do_login(&config, &username, &password, &token_file).await?;
         }
         Commands::Logout { token_file } => {
             do_logout(&config, &token_file).await?;
         }
+        #[cfg(unix)]
+        Commands::Sign { message, output, .. } if cli.daemon.is_some() => {
+            do_sign_via_daemon(cli.daemon.as_ref().unwrap(), &message, output.as_ref()).await?;
+        }
         Commands::Sign { token_file, d1_file, message, output } => {
             do_sign(&config, &token_file, &d1_file, &message, output.as_ref()).await?;
         }
+        #[cfg(unix)]
+        Commands::Decrypt { ciphertext, output, .. } if cli.daemon.is_some() => {
+            do_decrypt_via_daemon(cli.daemon.as_ref().unwrap(), &ciphertext, output.as_ref()).await?;
+        }
         Commands::Decrypt { token_file, d1_file, ciphertext, output } => {
             do_decrypt(&config, &token_file, &d1_file, &ciphertext, output.as_ref()).await?;
         }
         Commands::Health => {
             do_health(&config).await?;
         }
+        Commands::Bench(args) => {
+            bench::run(&config, args).await?;
+        }
+        #[cfg(unix)]
+        Commands::Daemon(args) => {
+            daemon::run(&config, args).await?;
+        }
     }
     
     Ok(())
@@ -135,18 +220,16 @@ async fn do_register(config: &ClientConfig, username: &str, password: &str) -> a
     Ok(())
 }
 
-async fn do_login(config: &ClientConfig, username: &str, password: &str) -> anyhow::Result<()> {
+async fn do_login(config: &ClientConfig, username: &str, password: &str, token_file: &PathBuf) -> anyhow::Result<()> {
     println!("正在登录用户: {}", username);
     
-    let client = CoSignClient::new(config.clone())?;
+    // 会话（token、user_id、过期时间）由客户端写入 token 文件
+    let client = CoSignClient::new(with_token_file(config, token_file))?;
     let session = client.login(username, password).await?;
     
     println!("登录成功!");
     println!("Token: {}", session.token);
-    
-    // 保存 token 到文件
-    std::fs::write(".token", &session.token)?;
-    println!("Token 已保存到 .token 文件");
+    println!("Token 已保存到 {:?}", token_file);
     
     // 保存 user_id 到文件
     std::fs::write(".user_id", &session.user_id)?;
@@ -155,90 +238,178 @@ async fn do_login(config: &ClientConfig, username: &str, password: &str) -> anyh
     Ok(())
 }
 
-async fn do_logout(config: &ClientConfig, _token_file: &PathBuf) -> anyhow::Result<()> {
+async fn do_logout(config: &ClientConfig, token_file: &PathBuf) -> anyhow::Result<()> {
     println!("正在登出...");
     
-    let client = CoSignClient::new(config.clone())?;
+    let client = open_session(config, token_file).await?;
+    // 服务端登出并删除 token 文件
     client.logout().await?;
-    
-    // 删除 token 文件
-    let _ = std::fs::remove_file(".token");
+    let _ = std::fs::remove_file(token_file);
     
     println!("登出成功!");
     
     Ok(())
 }
 
-async fn do_sign(config: &ClientConfig, _token_file: &PathBuf, d1_file: &PathBuf, message_file: &PathBuf, output: Option<&PathBuf>) -> anyhow::Result<()> {
-    // 读取必要的文件
-    let token = std::fs::read_to_string(".token")
-        .map_err(|_| anyhow::anyhow!("请先登录（.token 文件不存在）"))?;
-    let d1 = std::fs::read(d1_file)
-        .map_err(|_| anyhow::anyhow!("请先注册（.d1 文件不存在）"))?;
+/// 在配置中启用 token 文件缓存
+fn with_token_file(config: &ClientConfig, token_file: &PathBuf) -> ClientConfig {
+    ClientConfig {
+        token_file: Some(token_file.clone()),
+        ..config.clone()
+    }
+}
+
+/// 创建客户端并从 token 文件恢复会话
+///
+/// 优先读取客户端缓存的会话（含过期时间）；旧版本写入的纯 token 文件配合 .user_id 恢复。
+async fn open_session(config: &ClientConfig, token_file: &PathBuf) -> anyhow::Result<CoSignClient> {
+    let client = CoSignClient::new(with_token_file(config, token_file))?;
+    if client.get_session().await.is_none() {
+        let session = read_session_file(token_file)?;
+        client.set_session(session.token, session.user_id).await?;
+    }
+    Ok(client)
+}
+
+/// 读取 token 文件中的会话
+///
+/// 文件为客户端缓存的会话（JSON）时检查是否过期；否则按旧版本的纯 token 文件处理，
+/// user_id 取自 .user_id。
+fn read_session_file(token_file: &PathBuf) -> anyhow::Result<Session> {
+    let content = std::fs::read_to_string(token_file)
+        .map_err(|_| anyhow::anyhow!("请先登录（{:?} 不存在）", token_file))?;
+    // Reason: 过期的缓存会话已被客户端丢弃，整段 JSON 不能再当作 token 发给服务端
+    if let Ok(session) = serde_json::from_str::<Session>(&content) {
+        if session.expiry().is_some_and(|expiry| expiry <= SystemTime::now()) {
+            anyhow::bail!("请先登录（会话已过期）");
+        }
+        return Ok(session);
+    }
     let user_id = std::fs::read_to_string(".user_id")
         .map_err(|_| anyhow::anyhow!("请先注册（.user_id 文件不存在）"))?;
+    Ok(Session {
+        token: content.trim().to_string(),
+        user_id: user_id.trim().to_string(),
+        expires_at: String::new(),
+    })
+}
+
+/// 恢复会话并加载本地密钥对
+async fn open_signer(config: &ClientConfig, token_file: &PathBuf, d1_file: &PathBuf) -> anyhow::Result<CoSignClient> {
+    let d1 = std::fs::read(d1_file)
+        .map_err(|_| anyhow::anyhow!("请先注册（.d1 文件不存在）"))?;
     let public_key = std::fs::read(".public_key")
         .map_err(|_| anyhow::anyhow!("请先注册（.public_key 文件不存在）"))?;
-    let message = std::fs::read(message_file)?;
-    
-    println!("正在签名...");
+
+    let client = open_session(config, token_file).await?;
+    let user_id = client
+        .get_session()
+        .await
+        .map(|session| session.user_id)
+        .ok_or_else(|| anyhow::anyhow!("请先登录"))?;
+    client.set_key_pair(d1, public_key, user_id).await?;
+    Ok(client)
+}
+
+async fn do_sign(config: &ClientConfig, token_file: &PathBuf, d1_file: &PathBuf, message_file: &PathBuf, output: Option<&PathBuf>) -> anyhow::Result<()> {
+    // Reason: 流式读取消息文件，多 GB 文件也不会整体载入内存
+    let message = tokio::fs::File::open(message_file)
+        .await
+        .map_err(|e| anyhow::anyhow!("无法打开消息文件 {:?}: {}", message_file, e))?;
     
-    // 创建客户端并设置会话
-    let client = CoSignClient::new(config.clone())?;
+    // 创建客户端，恢复会话和密钥对
+    let client = open_signer(config, token_file, d1_file).await?;
     
-    // 手动设置会话和密钥对
-    client.set_session(token, user_id.clone()).await?;
-    client.set_key_pair(d1, public_key, user_id).await?;
+    println!("正在签名...");
     
     // 执行签名
-    let signature = client.sign(&message).await?;
+    let signature = client.sign_reader(message).await?;
     
     // 组合签名 r || s
     let mut sig_bytes = Vec::with_capacity(64);
     sig_bytes.extend_from_slice(&signature.r);
     sig_bytes.extend_from_slice(&signature.s);
     
+    write_signature(&sig_bytes, output)
+}
+
+/// 经守护进程签名：消息整体发送，不超过单帧上限
+#[cfg(unix)]
+async fn do_sign_via_daemon(socket: &PathBuf, message_file: &PathBuf, output: Option<&PathBuf>) -> anyhow::Result<()> {
+    let message = tokio::fs::read(message_file)
+        .await
+        .map_err(|e| anyhow::anyhow!("无法读取消息文件 {:?}: {}", message_file, e))?;
+    let sig_bytes = daemon::call(socket, daemon::Op::Sign, &message).await?;
+    write_signature(&sig_bytes, output)
+}
+
+/// 输出 64 字节签名 r || s：写入文件或以十六进制打印
+fn write_signature(sig_bytes: &[u8], output: Option<&PathBuf>) -> anyhow::Result<()> {
     if let Some(output_path) = output {
-        std::fs::write(output_path, &sig_bytes)?;
+        std::fs::write(output_path, sig_bytes)?;
         println!("签名已保存到: {:?}", output_path);
     } else {
-        println!("签名: {}", hex::encode(&sig_bytes));
+        println!("签名: {}", hex::encode(sig_bytes));
     }
     
     Ok(())
 }
 
-async fn do_decrypt(config: &ClientConfig, _token_file: &PathBuf, d1_file: &PathBuf, ciphertext_file: &PathBuf, output: Option<&PathBuf>) -> anyhow::Result<()> {
-    // 读取必要的文件
-    let token = std::fs::read_to_string(".token")
-        .map_err(|_| anyhow::anyhow!("请先登录（.token 文件不存在）"))?;
-    let d1 = std::fs::read(d1_file)
-        .map_err(|_| anyhow::anyhow!("请先注册（.d1 文件不存在）"))?;
-    let user_id = std::fs::read_to_string(".user_id")
-        .map_err(|_| anyhow::anyhow!("请先注册（.user_id 文件不存在）"))?;
-    let public_key = std::fs::read(".public_key")
-        .map_err(|_| anyhow::anyhow!("请先注册（.public_key 文件不存在）"))?;
-    let ciphertext = std::fs::read(ciphertext_file)?;
+async fn do_decrypt(config: &ClientConfig, token_file: &PathBuf, d1_file: &PathBuf, ciphertext_file: &PathBuf, output: Option<&PathBuf>) -> anyhow::Result<()> {
+    // Reason: 流式读取密文文件，只有 C1/C3 参与网络往返，C2 分块解密
+    let ciphertext = tokio::io::BufReader::new(
+        tokio::fs::File::open(ciphertext_file)
+            .await
+            .map_err(|e| anyhow::anyhow!("无法打开密文文件 {:?}: {}", ciphertext_file, e))?,
+    );
     
-    println!("正在解密...");
+    // 创建客户端，恢复会话和密钥对
+    let client = open_signer(config, token_file, d1_file).await?;
     
-    // 创建客户端并设置会话
-    let client = CoSignClient::new(config.clone())?;
-    
-    // 手动设置会话和密钥对
-    client.set_session(token, user_id.clone()).await?;
-    client.set_key_pair(d1, public_key, user_id).await?;
+    println!("正在解密...");
     
-    // 执行解密
-    let plaintext = client.decrypt(&ciphertext).await?;
+    if let Some(output_path) = output {
+        // C3 在读完密文后才能校验：先写入临时文件，校验通过再改名，失败时删除
+        let mut partial = output_path.clone().into_os_string();
+        partial.push(".partial");
+        let partial = PathBuf::from(partial);
+        let file = tokio::fs::File::create(&partial).await?;
+        let mut writer = tokio::io::BufWriter::new(file);
+        match client.decrypt_stream(ciphertext, &mut writer).await {
+            Ok(_) => {
+                drop(writer);
+                tokio::fs::rename(&partial, output_path).await?;
+                println!("明文已保存到: {:?}", output_path);
+            }
+            Err(e) => {
+                drop(writer);
+                let _ = tokio::fs::remove_file(&partial).await;
+                return Err(e.into());
+            }
+        }
+    } else {
+        // 输出到终端时先缓存，校验通过后才打印
+        let mut plaintext = Vec::new();
+        client.decrypt_stream(ciphertext, &mut plaintext).await?;
+        println!("明文: {}", String::from_utf8_lossy(&plaintext));
+    }
     
+    Ok(())
+}
+
+/// 经守护进程解密：守护进程校验 C3 后才返回明文，可直接写出
+#[cfg(unix)]
+async fn do_decrypt_via_daemon(socket: &PathBuf, ciphertext_file: &PathBuf, output: Option<&PathBuf>) -> anyhow::Result<()> {
+    let ciphertext = tokio::fs::read(ciphertext_file)
+        .await
+        .map_err(|e| anyhow::anyhow!("无法读取密文文件 {:?}: {}", ciphertext_file, e))?;
+    let plaintext = daemon::call(socket, daemon::Op::Decrypt, &ciphertext).await?;
     if let Some(output_path) = output {
         std::fs::write(output_path, &plaintext)?;
         println!("明文已保存到: {:?}", output_path);
     } else {
         println!("明文: {}", String::from_utf8_lossy(&plaintext));
     }
-    
     Ok(())
 }
 
@@ -254,3 +425,31 @@ async fn do_health(config: &ClientConfig) -> anyhow::Result<()> {
     
     Ok(())
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn write_token_file(name: &str, expires_at: &str) -> PathBuf {
+        let path = std::env::temp_dir().join(format!("sm2-cosign-{}-{}.token", name, std::process::id()));
+        let session = Session {
+            token: "t1".to_string(),
+            user_id: "u1".to_string(),
+            expires_at: expires_at.to_string(),
+        };
+        std::fs::write(&path, serde_json::to_vec(&session).unwrap()).unwrap();
+        path
+    }
+
+    #[test]
+    fn test_expired_session_file_requires_login() {
+        let path = write_token_file("expired", "1000000000");
+        let err = read_session_file(&path).unwrap_err();
+        assert!(err.to_string().contains("会话已过期"), "{}", err);
+
+        let path = write_token_file("valid", "4000000000");
+        let session = read_session_file(&path).unwrap();
+        assert_eq!((session.token.as_str(), session.user_id.as_str()), ("t1", "u1"));
+        let _ = std::fs::remove_file(path);
+    }
+}
@@ -0,0 +1,161 @@
+//! CoSignProtocol 各步骤基准
+//!
+//! 运行：cargo bench -p sm2_co_sign_core --bench protocol
+//! 与消息长度相关的步骤按 `SIZES` 分档测量。
+//!
+//! 点运算后端对比（以 libsm 为基线，输出 native-ecc 的相对变化）：
+//! cargo bench -p sm2_co_sign_core --bench protocol -- --save-baseline libsm
+//! cargo bench -p sm2_co_sign_core --bench protocol --features native-ecc -- --baseline libsm
+
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use sm2_co_sign_core::kdf::kdf;
+use sm2_co_sign_core::protocol::{base64_decode, base64_encode};
+use sm2_co_sign_core::{CoSignProtocol, FixedBase, Scalar, SignShares};
+
+/// 消息长度分档（字节）
+const SIZES: [usize; 4] = [32, 1024, 64 * 1024, 1024 * 1024];
+
+fn random_scalar(protocol: &CoSignProtocol) -> [u8; 32] {
+    protocol.generate_d1_array().unwrap()
+}
+
+fn bench_keygen(c: &mut Criterion) {
+    let protocol = CoSignProtocol::new().unwrap();
+    let generic = CoSignProtocol::with_fixed_base(FixedBase::Generic).unwrap();
+    let d1 = random_scalar(&protocol);
+
+    let mut group = c.benchmark_group("keygen");
+    group.bench_function("generate_d1", |b| b.iter(|| black_box(protocol.generate_d1_array().unwrap())));
+    group.bench_function("calculate_p1/table", |b| {
+        let mut p1 = [0u8; 64];
+        b.iter(|| protocol.calculate_p1_into(black_box(&d1), &mut p1).unwrap())
+    });
+    group.bench_function("calculate_p1/generic", |b| {
+        b.iter(|| black_box(generic.calculate_p1(black_box(&d1)).unwrap()))
+    });
+    group.bench_function("invert_d1", |b| b.iter(|| black_box(protocol.invert_d1_array(black_box(&d1)).unwrap())));
+    group.finish();
+}
+
+fn bench_sign(c: &mut Criterion) {
+    let protocol = CoSignProtocol::new().unwrap();
+    let generic = CoSignProtocol::with_fixed_base(FixedBase::Generic).unwrap();
+    let d1 = random_scalar(&protocol);
+    let d1_inv = protocol.invert_d1_array(&d1).unwrap();
+    let p1 = protocol.calculate_p1_array(&d1).unwrap();
+    let (k1, _) = protocol.sign_prepare_array().unwrap();
+    // 签名补全只做模运算，服务端分片取任意合法标量即可
+    let (r, s2, s3) = (random_scalar(&protocol), random_scalar(&protocol), random_scalar(&protocol));
+
+    let mut group = c.benchmark_group("sign");
+    group.bench_function("sign_prepare/table", |b| {
+        let (mut k1, mut q1) = ([0u8; 32], [0u8; 64]);
+        b.iter(|| protocol.sign_prepare_into(&mut k1, &mut q1).unwrap())
+    });
+    group.bench_function("sign_prepare/generic", |b| b.iter(|| black_box(generic.sign_prepare().unwrap())));
+    group.bench_function("complete_signature", |b| {
+        b.iter(|| black_box(protocol.complete_signature(&k1, &d1, &r, &s2, &s3).unwrap()))
+    });
+    group.bench_function("complete_signature_into", |b| {
+        let mut out = [0u8; 64];
+        b.iter(|| protocol.complete_signature_into(&k1, &d1, &d1_inv, &r, &s2, &s3, &mut out).unwrap())
+    });
+    let shares: Vec<SignShares> = (0..64)
+        .map(|_| SignShares {
+            k1: &k1,
+            r: &r,
+            s2: &s2,
+            s3: &s3,
+        })
+        .collect();
+    group.throughput(Throughput::Elements(shares.len() as u64));
+    group.bench_function("complete_signature_batch/64", |b| {
+        b.iter(|| black_box(protocol.complete_signature_batch(&d1, &shares)))
+    });
+    group.finish();
+
+    let mut group = c.benchmark_group("message_hash");
+    let hasher = protocol.message_hasher(&p1).unwrap();
+    for size in SIZES {
+        let message = vec![0x5au8; size];
+        group.throughput(Throughput::Bytes(size as u64));
+        group.bench_with_input(BenchmarkId::new("calculate_message_hash", size), &message, |b, m| {
+            b.iter(|| black_box(protocol.calculate_message_hash(m, &p1).unwrap()))
+        });
+        group.bench_with_input(BenchmarkId::new("cached_z", size), &message, |b, m| {
+            b.iter(|| {
+                let mut h = hasher.clone();
+                h.update(m);
+                black_box(h.finalize())
+            })
+        });
+    }
+    group.finish();
+}
+
+fn bench_decrypt(c: &mut Criterion) {
+    let protocol = CoSignProtocol::new().unwrap();
+    let d1 = random_scalar(&protocol);
+    // Reason: 取 d2 = 1，则公钥 Pa = (d1 - 1)·G、T2 = T1，不需要服务端即可构造合法密文
+    let d = (Scalar::from_be_array(&d1) - Scalar::ONE).to_bytes_be();
+    let public_key = protocol.calculate_p1_array(&d).unwrap();
+
+    let mut group = c.benchmark_group("decrypt");
+    for size in SIZES {
+        let ciphertext = CoSignProtocol::encrypt(&public_key, &vec![0xa5u8; size]).unwrap();
+        let (c1, rest) = ciphertext[1..].split_at(64);
+        let (c3, c2) = rest.split_at(32);
+        let t2 = protocol.decrypt_prepare_array(&d1, c1).unwrap();
+
+        group.throughput(Throughput::Bytes(size as u64));
+        group.bench_with_input(BenchmarkId::new("decrypt_prepare", size), &c1, |b, c1| {
+            let mut t1 = [0u8; 64];
+            b.iter(|| protocol.decrypt_prepare_into(&d1, c1, &mut t1).unwrap())
+        });
+        group.bench_with_input(BenchmarkId::new("complete_decryption", size), &c2, |b, c2| {
+            let mut out = vec![0u8; c2.len()];
+            b.iter(|| protocol.complete_decryption_into(&t2, c1, c3, c2, &mut out).unwrap())
+        });
+        group.bench_with_input(BenchmarkId::new("kdf", size), &size, |b, &size| {
+            b.iter(|| black_box(kdf(&t2, size)))
+        });
+    }
+    group.finish();
+}
+
+fn bench_ecc(c: &mut Criterion) {
+    let protocol = CoSignProtocol::new().unwrap();
+    let d = random_scalar(&protocol);
+    let public_key = protocol.calculate_p1_array(&d).unwrap();
+    let message = [0x5au8; 32];
+    let ciphertext = CoSignProtocol::encrypt(&public_key, &message).unwrap();
+
+    // 标准加解密各含两次 / 一次任意点乘，用于对比点运算后端
+    let mut group = c.benchmark_group("ecc");
+    group.bench_function("encrypt/32", |b| {
+        let mut out = vec![0u8; ciphertext.len()];
+        b.iter(|| CoSignProtocol::encrypt_into(&public_key, black_box(&message), &mut out).unwrap())
+    });
+    group.bench_function("decrypt/32", |b| {
+        let mut out = [0u8; 32];
+        b.iter(|| assert!(CoSignProtocol::decrypt_into(&d, black_box(&ciphertext), &mut out).unwrap()))
+    });
+    group.finish();
+}
+
+fn bench_base64(c: &mut Criterion) {
+    let mut group = c.benchmark_group("base64");
+    for size in SIZES {
+        let data = vec![0x3cu8; size];
+        let encoded = base64_encode(&data);
+        group.throughput(Throughput::Bytes(size as u64));
+        group.bench_with_input(BenchmarkId::new("encode", size), &data, |b, d| b.iter(|| black_box(base64_encode(d))));
+        group.bench_with_input(BenchmarkId::new("decode", size), &encoded, |b, s| {
+            b.iter(|| black_box(base64_decode(s).unwrap()))
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(benches, bench_keygen, bench_sign, bench_decrypt, bench_ecc, bench_base64);
+criterion_main!(benches);
@@ -0,0 +1,68 @@
+//! 多路 SM3 与逐条 gm_sm3_hash 的对比基准
+//!
+//! 运行：cargo bench -p sm2_co_sign_core --bench sm3
+
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use gm_sdk::sm3::sm3_hash as gm_sm3_hash;
+use sm2_co_sign_core::kdf::kdf;
+use sm2_co_sign_core::sm3_multi::{Backend, MultiSm3};
+
+/// 批量 E 哈希：N 条等长短消息
+fn bench_hash_many(c: &mut Criterion) {
+    for len in [32usize, 256, 4096] {
+        let messages: Vec<Vec<u8>> = (0..64).map(|i| vec![i as u8; len]).collect();
+        let refs: Vec<&[u8]> = messages.iter().map(Vec::as_slice).collect();
+
+        let mut group = c.benchmark_group(format!("sm3_64x{}B", len));
+        group.throughput(Throughput::Bytes((len * refs.len()) as u64));
+        group.bench_function("gm_sm3_hash", |b| {
+            b.iter(|| {
+                for message in &refs {
+                    black_box(gm_sm3_hash(black_box(message)));
+                }
+            })
+        });
+        for backend in [Backend::Scalar, Backend::Avx2] {
+            let engine = MultiSm3::with_backend(backend);
+            if engine.backend() != backend {
+                continue;
+            }
+            let mut out = vec![[0u8; 32]; refs.len()];
+            group.bench_function(BenchmarkId::new("multi", backend.name()), |b| {
+                b.iter(|| engine.hash_into(black_box(&refs), &mut out))
+            });
+        }
+        group.finish();
+    }
+}
+
+/// KDF：按定义逐分组调用 gm_sm3_hash 与流式多路实现
+fn bench_kdf(c: &mut Criterion) {
+    let z = [0x5au8; 64];
+    let mut group = c.benchmark_group("kdf");
+    for klen in [256usize, 4096, 65536] {
+        group.throughput(Throughput::Bytes(klen as u64));
+        group.bench_with_input(BenchmarkId::new("gm_sm3_hash", klen), &klen, |b, &klen| {
+            b.iter(|| {
+                let mut out = Vec::with_capacity(klen + 32);
+                let mut input = [0u8; 68];
+                input[..64].copy_from_slice(&z);
+                let mut ct = 1u32;
+                while out.len() < klen {
+                    input[64..].copy_from_slice(&ct.to_be_bytes());
+                    out.extend_from_slice(&gm_sm3_hash(&input));
+                    ct += 1;
+                }
+                out.truncate(klen);
+                black_box(out)
+            })
+        });
+        group.bench_with_input(BenchmarkId::new("stream", klen), &klen, |b, &klen| {
+            b.iter(|| black_box(kdf(black_box(&z), klen)))
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(benches, bench_hash_many, bench_kdf);
+criterion_main!(benches);
@@ -0,0 +1,51 @@
+//! 冷启动开销基准
+//!
+//! 运行：cargo bench -p sm2_co_sign_core --bench startup
+//!
+//! 曲线上下文、固定基点表与 TLS 配置都是进程内共享的单例，只在首次使用时构建：
+//! `one_time/*` 测量首次创建实例时付出的一次性开销，`warm/*` 测量单例就绪后
+//! 再创建实例的开销，`runtime/*` 对比 CLI 可选的两种 tokio 运行时的启动开销。
+
+use criterion::{black_box, criterion_group, criterion_main, Criterion};
+use libsm::sm2::ecc::EccCtx;
+use sm2_co_sign_core::fixed_base::FixedBaseTable;
+use sm2_co_sign_core::{CoSignClient, CoSignProtocol, ClientConfig, FixedBase};
+
+fn bench_one_time(c: &mut Criterion) {
+    let mut group = c.benchmark_group("one_time");
+    group.bench_function("ecc_ctx", |b| b.iter(|| black_box(EccCtx::new())));
+    let ecc = EccCtx::new();
+    group.bench_function("fixed_base_table/w4", |b| {
+        b.iter(|| black_box(FixedBaseTable::new(&ecc, 4).unwrap()))
+    });
+    group.finish();
+}
+
+fn bench_warm(c: &mut Criterion) {
+    let runtime = tokio::runtime::Builder::new_current_thread().enable_all().build().unwrap();
+    let _guard = runtime.enter();
+
+    let mut group = c.benchmark_group("warm");
+    group.bench_function("protocol_new", |b| b.iter(|| black_box(CoSignProtocol::new().unwrap())));
+    group.bench_function("protocol_new/generic", |b| {
+        b.iter(|| black_box(CoSignProtocol::with_fixed_base(FixedBase::Generic).unwrap()))
+    });
+    group.bench_function("client_new", |b| {
+        b.iter(|| black_box(CoSignClient::new(ClientConfig::default()).unwrap()))
+    });
+    group.finish();
+}
+
+fn bench_runtime(c: &mut Criterion) {
+    let mut group = c.benchmark_group("runtime");
+    group.bench_function("current_thread", |b| {
+        b.iter(|| tokio::runtime::Builder::new_current_thread().enable_all().build().unwrap())
+    });
+    group.bench_function("multi_thread", |b| {
+        b.iter(|| tokio::runtime::Builder::new_multi_thread().enable_all().build().unwrap())
+    });
+    group.finish();
+}
+
+criterion_group!(benches, bench_one_time, bench_warm, bench_runtime);
+criterion_main!(benches);
@@ -0,0 +1,398 @@
+//! Base64 编解码（标准字母表，带填充）
+//!
+//! 每次签名响应要解码 r、s2、s3，每次解密响应要解码 T2，请求侧还要编码 Q1、E、T1。
+//! 这些都是 32/64 字节的定长字段：这里的接口直接写入调用方缓冲区（可以是栈上的定长数组），
+//! 不分配 `String` / `Vec`。
+//!
+//! x86_64 上运行时检测到 AVX2 时，整块数据每 24 字节 ↔ 32 字符用一组向量指令处理
+//! （Muła–Lemire 算法：查表校验与字母映射、乘加合并位段、字节重排），
+//! 不足一块的剩余部分和不支持 AVX2 的机器走查表标量实现，两条路径结果逐字节一致。
+//!
+//! 解码是严格的（与 `base64` crate 的 STANDARD 引擎一致）：长度必须是 4 的倍数，
+//! `=` 只能出现在末尾，最后一个有效字符中未用的低位必须为 0。
+
+use crate::error::{Error, Result};
+
+/// 标准 Base64 字母表
+const ALPHABET: &[u8; 64] = b"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/// 非法字符在解码表中的值（最高位为 1，便于一次性检查整组字符）
+const INVALID: u8 = 0xff;
+
+/// 字符 → 6 位值
+const DECODE: [u8; 256] = {
+    let mut table = [INVALID; 256];
+    let mut i = 0;
+    while i < 64 {
+        table[ALPHABET[i] as usize] = i as u8;
+        i += 1;
+    }
+    table
+};
+
+/// 编码后的长度（含填充）
+pub const fn encoded_len(data_len: usize) -> usize {
+    data_len.div_ceil(3) * 4
+}
+
+/// 根据长度和末尾填充计算解码后的长度，不校验字符本身
+pub fn decoded_len(input: &[u8]) -> Result<usize> {
+    if input.len() % 4 != 0 {
+        return Err(Error::Encoding(format!(
+            "Invalid base64 length {}, expected a multiple of 4",
+            input.len()
+        )));
+    }
+    Ok(input.len() / 4 * 3 - padding(input))
+}
+
+/// 末尾 `=` 的个数（最多 2 个计入；更多的 `=` 由字符校验报错）
+fn padding(input: &[u8]) -> usize {
+    match input {
+        [.., b'=', b'='] => 2,
+        [.., b'='] => 1,
+        _ => 0,
+    }
+}
+
+/// 编码 `data` 写入 `out`，返回写入长度；`out` 至少为 `encoded_len(data.len())` 字节
+pub fn encode_into(data: &[u8], out: &mut [u8]) -> Result<usize> {
+    encode_with(data, out, use_avx2())
+}
+
+/// 解码 `input` 写入 `out`，返回写入长度；`out` 至少为 `decoded_len(input)` 字节
+pub fn decode_into(input: &[u8], out: &mut [u8]) -> Result<usize> {
+    decode_with(input, out, use_avx2())
+}
+
+/// 解码为恰好 `N` 字节的定长数组
+pub fn decode_array<const N: usize>(input: &[u8]) -> Result<[u8; N]> {
+    let len = decoded_len(input)?;
+    if len != N {
+        return Err(Error::Encoding(format!("Expected {} decoded bytes, got {}", N, len)));
+    }
+    let mut out = [0u8; N];
+    decode_into(input, &mut out)?;
+    Ok(out)
+}
+
+/// 解码为不超过 `N` 字节的大端整数，左侧补零到 `N` 字节
+///
+/// 服务端可能省略标量的前导零字节，协议字段按此方式还原为定长。
+pub fn decode_padded<const N: usize>(input: &[u8]) -> Result<[u8; N]> {
+    let len = decoded_len(input)?;
+    if len > N {
+        return Err(Error::Encoding(format!("Expected at most {} decoded bytes, got {}", N, len)));
+    }
+    let mut out = [0u8; N];
+    decode_into(input, &mut out[N - len..])?;
+    Ok(out)
+}
+
+#[cfg(target_arch = "x86_64")]
+fn use_avx2() -> bool {
+    std::arch::is_x86_feature_detected!("avx2")
+}
+
+#[cfg(not(target_arch = "x86_64"))]
+fn use_avx2() -> bool {
+    false
+}
+
+fn encode_with(data: &[u8], out: &mut [u8], avx2: bool) -> Result<usize> {
+    let required = encoded_len(data.len());
+    if out.len() < required {
+        return Err(Error::Encoding(format!(
+            "Base64 output buffer must be at least {} bytes, got {}",
+            required,
+            out.len()
+        )));
+    }
+
+    #[cfg(target_arch = "x86_64")]
+    let done = if avx2 { unsafe { avx2::encode(data, out) } } else { 0 };
+    #[cfg(not(target_arch = "x86_64"))]
+    let done = {
+        let _ = avx2;
+        0
+    };
+
+    let (data, out) = (&data[done..], &mut out[done / 3 * 4..]);
+    let full = data.len() / 3 * 3;
+    for (group, chars) in data[..full].chunks_exact(3).zip(out.chunks_exact_mut(4)) {
+        let n = u32::from(group[0]) << 16 | u32::from(group[1]) << 8 | u32::from(group[2]);
+        chars[0] = ALPHABET[(n >> 18) as usize & 0x3f];
+        chars[1] = ALPHABET[(n >> 12) as usize & 0x3f];
+        chars[2] = ALPHABET[(n >> 6) as usize & 0x3f];
+        chars[3] = ALPHABET[n as usize & 0x3f];
+    }
+
+    let tail = &data[full..];
+    let chars = &mut out[full / 3 * 4..];
+    match *tail {
+        [a] => {
+            chars[0] = ALPHABET[usize::from(a >> 2)];
+            chars[1] = ALPHABET[usize::from((a & 0x03) << 4)];
+            chars[2] = b'=';
+            chars[3] = b'=';
+        }
+        [a, b] => {
+            chars[0] = ALPHABET[usize::from(a >> 2)];
+            chars[1] = ALPHABET[usize::from((a & 0x03) << 4 | b >> 4)];
+            chars[2] = ALPHABET[usize::from((b & 0x0f) << 2)];
+            chars[3] = b'=';
+        }
+        _ => {}
+    }
+    Ok(required)
+}
+
+fn decode_with(input: &[u8], out: &mut [u8], avx2: bool) -> Result<usize> {
+    let len = decoded_len(input)?;
+    if out.len() < len {
+        return Err(Error::Encoding(format!(
+            "Base64 output buffer must be at least {} bytes, got {}",
+            len,
+            out.len()
+        )));
+    }
+    if input.is_empty() {
+        return Ok(0);
+    }
+
+    // 带填充的最后一组单独处理，其余部分都是完整的 4 字符组
+    let pad = padding(input);
+    let body = if pad == 0 { input.len() } else { input.len() - 4 };
+    let (body_input, tail_input) = input.split_at(body);
+
+    #[cfg(target_arch = "x86_64")]
+    let done = if avx2 { unsafe { avx2::decode(body_input, out) } } else { Some(0) };
+    #[cfg(not(target_arch = "x86_64"))]
+    let done = {
+        let _ = avx2;
+        Some(0)
+    };
+    let done = done.ok_or_else(invalid_character)?;
+
+    let mut bad = 0u8;
+    let rest = &body_input[done..];
+    let rest_out = &mut out[done / 4 * 3..];
+    for (chars, group) in rest.chunks_exact(4).zip(rest_out.chunks_exact_mut(3)) {
+        let [a, b, c, d] = [chars[0], chars[1], chars[2], chars[3]].map(|ch| DECODE[usize::from(ch)]);
+        bad |= a | b | c | d;
+        let n = u32::from(a) << 18 | u32::from(b) << 12 | u32::from(c) << 6 | u32::from(d);
+        group[0] = (n >> 16) as u8;
+        group[1] = (n >> 8) as u8;
+        group[2] = n as u8;
+    }
+    // Reason: 合法字符的值不超过 63，任一字符非法时累积值的最高位为 1
+    if bad & 0x80 != 0 {
+        return Err(invalid_character());
+    }
+
+    if pad != 0 {
+        let tail_out = &mut out[body / 4 * 3..len];
+        let a = DECODE[usize::from(tail_input[0])];
+        let b = DECODE[usize::from(tail_input[1])];
+        let c = if pad == 1 { DECODE[usize::from(tail_input[2])] } else { 0 };
+        if (a | b | c) & 0x80 != 0 {
+            return Err(invalid_character());
+        }
+        // 未用的低位必须为 0，否则同一数据会有多种编码
+        let unused = if pad == 2 { b & 0x0f } else { c & 0x03 };
+        if unused != 0 {
+            return Err(Error::Encoding("Invalid base64 trailing bits".to_string()));
+        }
+        tail_out[0] = a << 2 | b >> 4;
+        if pad == 1 {
+            tail_out[1] = b << 4 | c >> 2;
+        }
+    }
+    Ok(len)
+}
+
+fn invalid_character() -> Error {
+    Error::Encoding("Invalid base64 character".to_string())
+}
+
+#[cfg(target_arch = "x86_64")]
+mod avx2 {
+    //! AVX2 编解码：每次 24 字节 ↔ 32 字符
+
+    use std::arch::x86_64::*;
+
+    /// 编码尽可能多的 24 字节块，返回已处理的输入字节数
+    ///
+    /// 每块从两个 128 位通道各读 16 字节（使用前 12 字节），需要块后还有 4 字节可读。
+    #[target_feature(enable = "avx2")]
+    pub(super) unsafe fn encode(data: &[u8], out: &mut [u8]) -> usize {
+        // 每个 32 位通道内排成 b1 b0 b2 b1，便于用 16 位乘法移出四个 6 位段
+        let shuffle = _mm256_set_epi8(
+            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1, //
+            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+        );
+        let lut = _mm256_setr_epi8(
+            65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0, //
+            65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+        );
+
+        let mut done = 0;
+        while data.len() - done >= 28 {
+            let src = data.as_ptr().add(done);
+            let lo = _mm_loadu_si128(src.cast());
+            let hi = _mm_loadu_si128(src.add(12).cast());
+            let input = _mm256_shuffle_epi8(_mm256_inserti128_si256::<1>(_mm256_castsi128_si256(lo), hi), shuffle);
+
+            // 拆出 6 位段：每个 32 位通道得到 c0 c1 c2 c3 四个字节
+            let t0 = _mm256_and_si256(input, _mm256_set1_epi32(0x0fc0_fc00));
+            let t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x0400_0040));
+            let t2 = _mm256_and_si256(input, _mm256_set1_epi32(0x003f_03f0));
+            let t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x0100_0010));
+            let indices = _mm256_or_si256(t1, t3);
+
+            // 6 位值 → 字母：按区间（A-Z、a-z、0-9、+、/）查表取偏移量
+            let mut offsets = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+            let lower = _mm256_cmpgt_epi8(indices, _mm256_set1_epi8(25));
+            offsets = _mm256_sub_epi8(offsets, lower);
+            let chars = _mm256_add_epi8(indices, _mm256_shuffle_epi8(lut, offsets));
+
+            _mm256_storeu_si256(out.as_mut_ptr().add(done / 3 * 4).cast(), chars);
+            done += 24;
+        }
+        done
+    }
+
+    /// 解码尽可能多的 32 字符块，返回已处理的字符数；遇到非法字符返回 None
+    #[target_feature(enable = "avx2")]
+    pub(super) unsafe fn decode(input: &[u8], out: &mut [u8]) -> Option<usize> {
+        // 校验表：高、低半字节查表结果按位与非 0 即为非法字符
+        let lut_lo = _mm256_setr_epi8(
+            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a, //
+            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+        );
+        let lut_hi = _mm256_setr_epi8(
+            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, //
+            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        );
+        // 按高半字节（'/' 单独一档）取字母 → 6 位值的偏移量
+        let lut_roll = _mm256_setr_epi8(
+            0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0, //
+            0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+        );
+        let mask_2f = _mm256_set1_epi8(0x2f);
+        // 每个 32 位通道的 24 位结果按大端取出 3 字节，再把两个通道的 12 字节拼在一起
+        let pack = _mm256_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, //
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        );
+        let compact = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+
+        let mut done = 0;
+        let mut block = [0u8; 32];
+        while input.len() - done >= 32 {
+            let chars = _mm256_loadu_si256(input.as_ptr().add(done).cast());
+            let hi_nibbles = _mm256_and_si256(_mm256_srli_epi32::<4>(chars), mask_2f);
+            let lo_nibbles = _mm256_and_si256(chars, mask_2f);
+            let lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+            let hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+            if _mm256_testz_si256(lo, hi) == 0 {
+                return None;
+            }
+
+            let is_slash = _mm256_cmpeq_epi8(chars, mask_2f);
+            let roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(is_slash, hi_nibbles));
+            let values = _mm256_add_epi8(chars, roll);
+
+            // 合并 6 位段：先两两合成 12 位，再合成 24 位
+            let merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x0140_0140));
+            let merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x0001_1000));
+            let bytes = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(merged, pack), compact);
+
+            _mm256_storeu_si256(block.as_mut_ptr().cast(), bytes);
+            let start = done / 4 * 3;
+            out[start..start + 24].copy_from_slice(&block[..24]);
+            done += 32;
+        }
+        Some(done)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use base64::{engine::general_purpose::STANDARD, Engine};
+
+    fn data(len: usize) -> Vec<u8> {
+        (0..len).map(|i| (i * 167 + len) as u8).collect()
+    }
+
+    fn backends() -> Vec<bool> {
+        if use_avx2() {
+            vec![false, true]
+        } else {
+            vec![false]
+        }
+    }
+
+    #[test]
+    fn test_matches_reference_engine() {
+        for avx2 in backends() {
+            for len in (0..100).chain([255, 256, 1000, 4096 + 7]) {
+                let data = data(len);
+                let expected = STANDARD.encode(&data);
+
+                let mut encoded = vec![0u8; encoded_len(len)];
+                assert_eq!(encode_with(&data, &mut encoded, avx2).unwrap(), expected.len());
+                assert_eq!(encoded, expected.as_bytes(), "avx2={} len={}", avx2, len);
+
+                let mut decoded = vec![0u8; len];
+                assert_eq!(decode_with(&encoded, &mut decoded, avx2).unwrap(), len);
+                assert_eq!(decoded, data, "avx2={} len={}", avx2, len);
+            }
+        }
+    }
+
+    #[test]
+    fn test_rejects_invalid_input() {
+        let valid = STANDARD.encode(data(60));
+        for avx2 in backends() {
+            let mut out = [0u8; 64];
+            // 非法字符出现在向量块内、标量部分和填充组中
+            for position in [0usize, 17, 31, 40, 77] {
+                for bad in [b'-', b'_', b'=', b' ', 0x80, b'.', b':', b'@', b'[', b'`', b'{'] {
+                    let mut input = valid.clone().into_bytes();
+                    input[position] = bad;
+                    assert!(decode_with(&input, &mut out, avx2).is_err(), "avx2={} pos={} byte={:#x}", avx2, position, bad);
+                }
+            }
+            assert!(decode_with(b"QUJD=", &mut out, avx2).is_err());
+            assert!(decode_with(b"QQ=A", &mut out, avx2).is_err());
+            assert!(decode_with(b"Q===", &mut out, avx2).is_err());
+            // 末字符未用位非 0
+            assert!(decode_with(b"QR==", &mut out, avx2).is_err());
+            assert!(decode_with(b"QUJ=", &mut out, avx2).is_err());
+            assert_eq!(decode_with(b"QUI=", &mut out, avx2).unwrap(), 2);
+        }
+    }
+
+    #[test]
+    fn test_fixed_size_decode() {
+        let scalar = data(32);
+        let encoded = STANDARD.encode(&scalar);
+        assert_eq!(decode_array::<32>(encoded.as_bytes()).unwrap().to_vec(), scalar);
+        assert!(decode_array::<64>(encoded.as_bytes()).is_err());
+
+        // 省略前导零的标量左侧补零
+        let short = STANDARD.encode(&scalar[..31]);
+        let padded = decode_padded::<32>(short.as_bytes()).unwrap();
+        assert_eq!(padded[0], 0);
+        assert_eq!(padded[1..], scalar[..31]);
+        assert!(decode_padded::<16>(encoded.as_bytes()).is_err());
+
+        let mut small = [0u8; 31];
+        assert!(decode_into(encoded.as_bytes(), &mut small).is_err());
+        assert!(encode_into(&scalar, &mut [0u8; 43]).is_err());
+        assert_eq!(decoded_len(b"QUI=").unwrap(), 2);
+        assert!(decoded_len(b"QUI").is_err());
+    }
+}
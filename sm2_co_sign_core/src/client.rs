@@ -1,30 +1,114 @@
 //! SM2 协同签名客户端
 
+use crate::endpoints::Endpoints;
 use crate::error::{Error, Result};
-use crate::protocol::{base64_decode, base64_encode, CoSignProtocol};
+use crate::keyring::Keyring;
+use crate::metrics::{self, Counter, Phase};
+use crate::nonce_pool::{NoncePair, NoncePool, NoncePoolStats};
+use crate::precommit::{PrecommittedNonce, Precommits};
+use crate::protocol::{
+    base64_decode, base64_decode_point, base64_decode_scalar, base64_encode, pad_scalar, point_coords, CoSignProtocol,
+};
+use crate::secure::SecretScalar;
+use crate::session::SessionManager;
+use crate::sm3_multi::MultiSm3;
 use crate::types::*;
-use reqwest::Client;
-use std::sync::Arc;
+use crate::wire::{self, WireFormat, BINARY_CONTENT_TYPE};
+use reqwest::header::{ACCEPT, CONTENT_TYPE};
+use reqwest::{Client, RequestBuilder, Response, StatusCode};
+use serde::de::DeserializeOwned;
+use std::path::PathBuf;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Arc, OnceLock};
+use std::time::{Duration, SystemTime};
+use tokio::io::{AsyncRead, AsyncReadExt, AsyncWrite, AsyncWriteExt};
 use tokio::sync::RwLock;
 use tracing::{debug, info, warn};
+use zeroize::{Zeroize, Zeroizing};
+
+/// 流式签名每次读取的块大小
+const SIGN_READ_CHUNK: usize = 64 * 1024;
+
+/// 流式解密每次读取的块大小
+const DECRYPT_READ_CHUNK: usize = 64 * 1024;
+
+/// 密文头部 C1（65 字节，含 04 前缀）|| C3（32 字节）的长度
+const CIPHERTEXT_HEADER: usize = 65 + 32;
+
+/// 服务端签名分量 (r, s2, s3)，每个补齐为 32 字节
+type SignShareBytes = [ScalarBytes; 3];
 
 /// 客户端配置
 #[derive(Debug, Clone)]
 pub struct ClientConfig {
     /// 服务器 URL
     pub server_url: String,
+    /// 同一服务的其他副本地址，与 `server_url` 一起按延迟负载均衡
+    pub replica_urls: Vec<String>,
+    /// 签名请求超过所在端点 p95 延迟仍未返回时，向另一副本发出对冲请求（使用新的 k1）
+    pub hedge_requests: bool,
+    /// 对冲延迟下限（毫秒）
+    pub hedge_min_delay_ms: u64,
+    /// 连续失败该次数后摘除端点
+    pub eject_after_failures: u32,
+    /// 被摘除端点的健康探测间隔（秒）
+    pub probe_interval: u64,
     /// 请求超时（秒）
     pub timeout: u64,
     /// 是否验证 TLS 证书
     pub verify_tls: bool,
+    /// 预生成 (k1, Q1) 随机数池容量，0 表示不启用
+    pub nonce_pool_size: usize,
+    /// 每批向服务端预提交的签名随机数数量（`/api/sign/precommit`），0 表示不启用
+    ///
+    /// 需服务端支持；服务端返回 404 时自动关闭，签名回退为普通流程。
+    pub precommit_batch: usize,
+    /// 连接池中每个主机保留的最大空闲连接数
+    pub pool_max_idle_per_host: usize,
+    /// 空闲连接保留时长（秒），0 表示不主动回收
+    pub pool_idle_timeout: u64,
+    /// 直接以 HTTP/2 连接（prior knowledge），所有请求在同一连接上多路复用
+    ///
+    /// 服务端必须支持 HTTP/2（明文 h2c 或 TLS）。关闭时 TLS 连接仍可经 ALPN 协商到 HTTP/2。
+    pub http2_prior_knowledge: bool,
+    /// HTTP/2 PING 保活间隔（秒），0 表示关闭
+    pub http2_keep_alive_interval: u64,
+    /// TCP keepalive 间隔（秒），0 表示关闭
+    pub tcp_keepalive: u64,
+    /// 是否设置 TCP_NODELAY（关闭 Nagle 算法，小请求不被合并延迟）
+    pub tcp_nodelay: bool,
+    /// 签名/解密接口的线上编码，Binary 不被服务端支持时自动回退为 JSON
+    pub wire_format: WireFormat,
+    /// 会话距过期不足该秒数时在后台重新登录，0（默认）表示不保存凭据、不自动刷新
+    ///
+    /// 非 0 时登录密码会一直保存在内存中（释放时清零），需要长期运行且能重新登录的进程再开启。
+    pub session_refresh_margin: u64,
+    /// 会话缓存文件：登录后写入，创建客户端时读回未过期的会话
+    pub token_file: Option<PathBuf>,
 }
 
 impl Default for ClientConfig {
     fn default() -> Self {
         Self {
             server_url: "http://127.0.0.1:8080".to_string(),
+            replica_urls: Vec::new(),
+            hedge_requests: true,
+            hedge_min_delay_ms: 10,
+            eject_after_failures: 3,
+            probe_interval: 5,
             timeout: 30,
             verify_tls: true,
+            nonce_pool_size: 0,
+            precommit_batch: 0,
+            pool_max_idle_per_host: 32,
+            pool_idle_timeout: 90,
+            http2_prior_knowledge: false,
+            http2_keep_alive_interval: 0,
+            tcp_keepalive: 60,
+            tcp_nodelay: true,
+            wire_format: WireFormat::Json,
+            session_refresh_margin: 0,
+            token_file: None,
         }
     }
 }
@@ -33,31 +117,158 @@ impl Default for ClientConfig {
 pub struct CoSignClient {
     config: ClientConfig,
     http_client: Client,
-    protocol: CoSignProtocol,
-    /// 当前会话
-    session: Arc<RwLock<Option<Session>>>,
+    /// 服务端副本列表（负载均衡、故障摘除）
+    endpoints: Arc<Endpoints>,
+    protocol: Arc<CoSignProtocol>,
+    /// 预生成随机数池（由后台线程补充）
+    nonce_pool: Option<Arc<NoncePool>>,
+    /// 服务端已登记的一次性签名随机数
+    precommits: Arc<Precommits>,
+    /// 当前会话（过期检查、提前刷新与 token 缓存）
+    ///
+    /// Reason: 会话以 Arc 共享，每次签名只增加引用计数，不复制 token 和 d1
+    sessions: Arc<SessionManager>,
     /// 当前密钥对
-    key_pair: Arc<RwLock<Option<KeyPair>>>,
+    key_pair: Arc<RwLock<Option<Arc<KeyPair>>>>,
+    /// 服务端已拒绝过 Binary 编码，之后直接使用 JSON
+    binary_unsupported: AtomicBool,
+    /// 代签用户的会话与密钥（`sign_for` / `decrypt_for`）
+    keyring: Keyring,
+}
+
+/// 进程内共享的 rustls 客户端配置，按是否校验证书各构建一次
+///
+/// reqwest 每次 `build()` 都会重新解析 webpki 内置根证书并创建 TLS 配置，
+/// 多个客户端（如 FFI 多句柄）各付一次；共享后只在首次使用时构建。
+/// 克隆只复制内部 `Arc`，根证书库与会话票据缓存在所有客户端之间共用。
+fn shared_tls_config(verify_tls: bool) -> &'static rustls::ClientConfig {
+    static VERIFIED: OnceLock<rustls::ClientConfig> = OnceLock::new();
+    static UNVERIFIED: OnceLock<rustls::ClientConfig> = OnceLock::new();
+
+    let builder = || rustls::ClientConfig::builder().with_safe_defaults();
+    if verify_tls {
+        VERIFIED.get_or_init(|| {
+            let mut roots = rustls::RootCertStore::empty();
+            roots.add_trust_anchors(webpki_roots::TLS_SERVER_ROOTS.iter().map(|anchor| {
+                rustls::OwnedTrustAnchor::from_subject_spki_name_constraints(
+                    anchor.subject,
+                    anchor.spki,
+                    anchor.name_constraints,
+                )
+            }));
+            builder().with_root_certificates(roots).with_no_client_auth()
+        })
+    } else {
+        UNVERIFIED.get_or_init(|| {
+            builder()
+                .with_custom_certificate_verifier(Arc::new(NoCertVerification))
+                .with_no_client_auth()
+        })
+    }
+}
+
+/// 不校验服务端证书（`verify_tls = false`，仅用于测试环境）
+struct NoCertVerification;
+
+impl rustls::client::ServerCertVerifier for NoCertVerification {
+    fn verify_server_cert(
+        &self,
+        _end_entity: &rustls::Certificate,
+        _intermediates: &[rustls::Certificate],
+        _server_name: &rustls::ServerName,
+        _scts: &mut dyn Iterator<Item = &[u8]>,
+        _ocsp_response: &[u8],
+        _now: SystemTime,
+    ) -> std::result::Result<rustls::client::ServerCertVerified, rustls::Error> {
+        Ok(rustls::client::ServerCertVerified::assertion())
+    }
+}
+
+/// 批量签名中已完成预处理、等待服务端分片的一项
+struct PendingSign {
+    /// 在输入消息中的下标
+    index: usize,
+    nonce: NoncePair,
+    e: [u8; 32],
+}
+
+/// 服务端响应，按 Content-Type 区分编码
+enum WireReply {
+    Json(Vec<u8>),
+    Binary(Vec<u8>),
 }
 
 impl CoSignClient {
     /// 创建新的客户端实例
     pub fn new(config: ClientConfig) -> Result<Self> {
-        let http_client = Client::builder()
-            .timeout(std::time::Duration::from_secs(config.timeout))
-            .danger_accept_invalid_certs(!config.verify_tls)
-            .build()
-            .map_err(|e| Error::Network(e.to_string()))?;
+        let http_client = Self::build_http_client(&config)?;
+
+        let protocol = Arc::new(CoSignProtocol::new()?);
+
+        let nonce_pool = if config.nonce_pool_size > 0 {
+            let pool = Arc::new(NoncePool::new(config.nonce_pool_size));
+            pool.spawn_refiller(Arc::clone(&protocol))?;
+            Some(pool)
+        } else {
+            None
+        };
+
+        let endpoints = Endpoints::new(http_client.clone(), &config);
+        let sessions = SessionManager::new(Arc::clone(&endpoints), &config);
+        let precommits = Precommits::new(Arc::clone(&endpoints), Arc::clone(&protocol), config.precommit_batch);
 
         Ok(Self {
             config,
             http_client,
-            protocol: CoSignProtocol::new()?,
-            session: Arc::new(RwLock::new(None)),
+            endpoints,
+            protocol,
+            nonce_pool,
+            precommits,
+            sessions,
             key_pair: Arc::new(RwLock::new(None)),
+            binary_unsupported: AtomicBool::new(false),
+            keyring: Keyring::new(),
         })
     }
 
+    /// 按配置构建 HTTP 客户端
+    ///
+    /// 同一个 `CoSignClient` 的所有请求共用这一个连接池：连接保持复用，
+    /// TLS 握手只在建连时发生；rustls 默认缓存会话票据，重连时走会话恢复。
+    /// TLS 配置（含根证书库）进程内共享，见 `shared_tls_config`。
+    fn build_http_client(config: &ClientConfig) -> Result<Client> {
+        let seconds = |secs: u64| (secs > 0).then(|| Duration::from_secs(secs));
+
+        // Reason: 预置配置不经过 reqwest 的 ALPN 设置，需按 HTTP 版本偏好自行填写
+        let mut tls = shared_tls_config(config.verify_tls).clone();
+        tls.alpn_protocols = if config.http2_prior_knowledge {
+            vec![b"h2".to_vec()]
+        } else {
+            vec![b"h2".to_vec(), b"http/1.1".to_vec()]
+        };
+
+        let mut builder = Client::builder()
+            .timeout(Duration::from_secs(config.timeout))
+            .use_preconfigured_tls(tls)
+            .pool_max_idle_per_host(config.pool_max_idle_per_host)
+            .pool_idle_timeout(seconds(config.pool_idle_timeout))
+            .tcp_keepalive(seconds(config.tcp_keepalive))
+            .tcp_nodelay(config.tcp_nodelay);
+
+        if config.http2_prior_knowledge {
+            builder = builder.http2_prior_knowledge();
+        }
+        if let Some(interval) = seconds(config.http2_keep_alive_interval) {
+            // Reason: 空闲时也发 PING，避免中间设备回收长连接后首个签名请求才发现断连
+            builder = builder
+                .http2_keep_alive_interval(interval)
+                .http2_keep_alive_timeout(Duration::from_secs(config.timeout))
+                .http2_keep_alive_while_idle(true);
+        }
+
+        builder.build().map_err(|e| Error::Network(e.to_string()))
+    }
+
     /// 使用默认配置创建客户端
     pub fn with_server_url(server_url: &str) -> Result<Self> {
         let mut config = ClientConfig::default();
@@ -69,26 +280,24 @@ impl CoSignClient {
     pub async fn register(&self, username: &str, password: &str) -> Result<KeyPair> {
         info!("Registering user: {}", username);
 
-        // 生成 D1
-        let d1 = self.protocol.generate_d1()?;
+        // 生成 D1（直接在安全内存池中生成）
+        let d1 = self.protocol.generate_d1_secret();
 
         // 计算 P1
         let p1 = self.protocol.calculate_p1(&d1)?;
         let p1_base64 = base64_encode(&p1);
 
         // 发送注册请求
-        let url = format!("{}/api/register", self.config.server_url);
+        let body = serde_json::json!({
+            "username": username,
+            "password": password,
+            "p1": p1_base64,
+        });
         let response = self
-            .http_client
-            .post(&url)
-            .json(&serde_json::json!({
-                "username": username,
-                "password": password,
-                "p1": p1_base64,
-            }))
-            .send()
-            .await
-            .map_err(|e| Error::Network(format!("Failed to connect to {}: {}", url, e)))?;
+            .endpoints
+            .send("/api/register", |url| self.http_client.post(url).json(&body))
+            .await?;
+        let url = response.url().to_string();
 
         // 检查 HTTP 状态码
         let status = response.status();
@@ -116,109 +325,62 @@ impl CoSignClient {
         let public_key = base64_decode(&data.public_key)?;
 
         // 存储密钥对
-        let key_pair = KeyPair {
-            d1: d1.clone(),
-            public_key: public_key.clone(),
-            user_id: data.user_id.clone(),
-        };
+        let key_pair = self.new_key_pair(d1, public_key, data.user_id.clone())?;
 
-        *self.key_pair.write().await = Some(key_pair.clone());
+        *self.key_pair.write().await = Some(Arc::new(key_pair.clone()));
 
         info!("User registered successfully: {}", data.user_id);
         Ok(key_pair)
     }
 
     /// 用户登录
+    ///
+    /// `session_refresh_margin` 非 0 时保存凭据，会话临近过期时自动重新登录。
     pub async fn login(&self, username: &str, password: &str) -> Result<Session> {
-        info!("Logging in user: {}", username);
-
-        let url = format!("{}/api/login", self.config.server_url);
-        let response = self
-            .http_client
-            .post(&url)
-            .json(&serde_json::json!({
-                "username": username,
-                "password": password,
-            }))
-            .send()
-            .await
-            .map_err(|e| Error::Network(e.to_string()))?;
-
-        let api_response: ApiResponse<LoginResponse> = response
-            .json()
-            .await
-            .map_err(|e| Error::Network(e.to_string()))?;
-
-        if api_response.code != 0 {
-            return Err(Error::Api {
-                code: api_response.code,
-                message: api_response.message,
-            });
-        }
-
-        let data = api_response.data.ok_or(Error::InvalidState("No data in response".to_string()))?;
-
-        let session = Session {
-            token: data.token.clone(),
-            user_id: data.user_id.clone(),
-            expires_at: data.expires_at.clone(),
-        };
-
-        *self.session.write().await = Some(session.clone());
-
-        info!("User logged in successfully");
-        Ok(session)
+        let session = self.sessions.login(username, password).await?;
+        Ok((*session).clone())
     }
 
     /// 用户登出
     pub async fn logout(&self) -> Result<()> {
-        let session = self.session.read().await.clone();
-        let session = session.ok_or(Error::NotAuthenticated)?;
+        let session = self.sessions.get().await.ok_or(Error::NotAuthenticated)?;
 
-        let url = format!("{}/api/logout", self.config.server_url);
         let response = self
-            .http_client
-            .post(&url)
-            .bearer_auth(&session.token)
-            .send()
-            .await
-            .map_err(|e| Error::Network(e.to_string()))?;
+            .endpoints
+            .send("/api/logout", |url| self.http_client.post(url).bearer_auth(&session.token))
+            .await?;
 
         if !response.status().is_success() {
             warn!("Logout request failed, but continuing anyway");
         }
 
-        *self.session.write().await = None;
+        self.sessions.clear().await;
+        self.precommits.clear();
         info!("User logged out successfully");
         Ok(())
     }
 
     /// 初始化密钥
     pub async fn init_key(&self) -> Result<KeyPair> {
-        let session = self.session.read().await.clone();
-        let session = session.ok_or(Error::NotAuthenticated)?;
+        let session = self.sessions.current().await?;
 
         info!("Initializing key for user: {}", session.user_id);
 
-        // 生成 D1
-        let d1 = self.protocol.generate_d1()?;
+        // 生成 D1（直接在安全内存池中生成）
+        let d1 = self.protocol.generate_d1_secret();
 
         // 计算 P1
         let p1 = self.protocol.calculate_p1(&d1)?;
         let p1_base64 = base64_encode(&p1);
 
-        let url = format!("{}/api/key/init", self.config.server_url);
+        let body = serde_json::json!({
+            "user_id": session.user_id,
+            "p1": p1_base64,
+        });
         let response = self
-            .http_client
-            .post(&url)
-            .bearer_auth(&session.token)
-            .json(&serde_json::json!({
-                "user_id": session.user_id,
-                "p1": p1_base64,
-            }))
-            .send()
-            .await
-            .map_err(|e| Error::Network(e.to_string()))?;
+            .endpoints
+            .send("/api/key/init", |url| self.http_client.post(url).bearer_auth(&session.token).json(&body))
+            .await?;
 
         let api_response: ApiResponse<KeyInitResponse> = response
             .json()
@@ -236,13 +398,9 @@ impl CoSignClient {
 
         let public_key = base64_decode(&data.public_key)?;
 
-        let key_pair = KeyPair {
-            d1,
-            public_key,
-            user_id: session.user_id,
-        };
+        let key_pair = self.new_key_pair(d1, public_key, session.user_id.clone())?;
 
-        *self.key_pair.write().await = Some(key_pair.clone());
+        *self.key_pair.write().await = Some(Arc::new(key_pair.clone()));
 
         info!("Key initialized successfully");
         Ok(key_pair)
@@ -250,41 +408,480 @@ impl CoSignClient {
 
     /// 协同签名
     pub async fn sign(&self, message: &[u8]) -> Result<Signature> {
-        let session = self.session.read().await.clone();
-        let session = session.ok_or(Error::NotAuthenticated)?;
+        let (session, key_pair) = self.signing_state().await?;
+
+        debug!("Signing message of {} bytes", message.len());
+
+        // 计算消息哈希 E = SM3(Z || M)，Z 已缓存在密钥对上
+        let e = {
+            let _span = metrics::span(Phase::Hash);
+            let mut hasher = key_pair.z_hasher.clone();
+            hasher.update(message);
+            hasher.finalize()
+        };
+        self.sign_hash(&session, &key_pair, &e).await
+    }
+
+    /// 流式协同签名
+    ///
+    /// 从 `reader` 分块读取消息并增量计算哈希，内存占用与消息大小无关，
+    /// 适合签名大文件。签名结果与 `sign` 对同一消息的结果等价。
+    pub async fn sign_reader<R: AsyncRead + Unpin>(&self, mut reader: R) -> Result<Signature> {
+        let (session, key_pair) = self.signing_state().await?;
+
+        let mut hasher = key_pair.z_hasher.clone();
+        let mut buf = vec![0u8; SIGN_READ_CHUNK];
+        let mut total = 0u64;
+        loop {
+            let n = reader.read(&mut buf).await?;
+            if n == 0 {
+                break;
+            }
+            hasher.update(&buf[..n]);
+            total += n as u64;
+        }
+
+        debug!("Signing stream of {} bytes", total);
+        let e = hasher.finalize();
+        self.sign_hash(&session, &key_pair, &e).await
+    }
+
+    /// 以密钥环中某个用户的身份协同签名
+    ///
+    /// 所有用户共用本客户端的连接池与随机数池；用户未登记时返回 `Error::NotAuthenticated`。
+    pub async fn sign_for(&self, user_id: &str, message: &[u8]) -> Result<Signature> {
+        let entry = metrics::track(self.keyring.get(user_id).ok_or(Error::NotAuthenticated))?;
+
+        let e = {
+            let _span = metrics::span(Phase::Hash);
+            let mut hasher = entry.key_pair.z_hasher.clone();
+            hasher.update(message);
+            hasher.finalize()
+        };
+        self.sign_hash(&entry.session, &entry.key_pair, &e).await
+    }
+
+    /// 取出签名（解密）所需的会话与密钥对
+    pub(crate) async fn signing_state(&self) -> Result<(Arc<Session>, Arc<KeyPair>)> {
+        let session = metrics::track(self.sessions.current().await)?;
 
         let key_pair = self.key_pair.read().await.clone();
-        let key_pair = key_pair.ok_or(Error::InvalidState("No key pair available".to_string()))?;
+        let key_pair = metrics::track(key_pair.ok_or(Error::InvalidState("No key pair available".to_string())))?;
+        Ok((session, key_pair))
+    }
 
-        debug!("Signing message of {} bytes", message.len());
+    /// 对已计算好的消息哈希 E 完成一次协同签名，失败时按错误类别计数
+    async fn sign_hash(&self, session: &Arc<Session>, key_pair: &KeyPair, e: &[u8]) -> Result<Signature> {
+        metrics::track(self.sign_hedged(session, key_pair, e).await)
+    }
+
+    /// 完成一次协同签名
+    ///
+    /// 配置了多个副本时，请求超过所选副本的 p95 延迟仍未返回（或连接失败）就向另一副本发出
+    /// 对冲请求，取先成功者，另一请求随即取消。两次请求各自使用新的 k1，nonce 不会复用。
+    async fn sign_hedged(&self, session: &Arc<Session>, key_pair: &KeyPair, e: &[u8]) -> Result<Signature> {
+        let Some(primary) = self.endpoints.pick(&[]) else {
+            return Err(Error::InvalidState("No endpoint available".to_string()));
+        };
+        let first = self.sign_on(primary, session, key_pair, e);
+        let Some(delay) = self.endpoints.hedge_delay(primary) else {
+            return first.await;
+        };
+        tokio::pin!(first);
+
+        let early = tokio::select! {
+            result = &mut first => match result {
+                // 连接失败时立即换副本，其他错误（如 API 拒绝）直接返回
+                Err(Error::Network(err)) => Some(Error::Network(err)),
+                result => return result,
+            },
+            _ = tokio::time::sleep(delay) => None,
+        };
+        let Some(secondary) = self.endpoints.pick(&[primary]) else {
+            return match early {
+                Some(err) => Err(err),
+                None => first.await,
+            };
+        };
+        let second = self.sign_on(secondary, session, key_pair, e);
+        if early.is_some() {
+            return second.await;
+        }
 
-        // 计算消息哈希
-        let e = self.protocol.calculate_message_hash(message, &key_pair.public_key)?;
-        let e_base64 = base64_encode(&e);
+        debug!("Hedging sign request to {}", self.endpoints.url(secondary));
+        metrics::count(Counter::Hedges, 1);
+        tokio::pin!(second);
+        tokio::select! {
+            result = &mut first => match result {
+                Ok(signature) => Ok(signature),
+                Err(_) => second.await,
+            },
+            result = &mut second => match result {
+                Ok(signature) => Ok(signature),
+                Err(_) => first.await,
+            },
+        }
+    }
 
-        // 签名预处理：生成 k1, Q1
-        let (k1, q1) = self.protocol.sign_prepare()?;
-        let q1_base64 = base64_encode(&q1);
+    /// 在指定副本上完成一次协同签名，有该副本预提交的随机数时优先使用
+    async fn sign_on(&self, endpoint: usize, session: &Arc<Session>, key_pair: &KeyPair, e: &[u8]) -> Result<Signature> {
+        if self.precommits.enabled() {
+            let entry = self.precommits.take(endpoint, &key_pair.user_id);
+            self.precommits.refill_in_background(Arc::clone(session), &key_pair.user_id, endpoint);
+            if let Some(entry) = entry {
+                match self.sign_committed(endpoint, session, key_pair, e, entry).await {
+                    // 服务端未签名（编号已用、过期或未知），换新的 k1 走普通流程是安全的
+                    Err(Error::Api { code, message }) => {
+                        warn!("Precommitted nonce rejected ({}: {}), signing without it", code, message);
+                    }
+                    result => return result,
+                }
+            }
+        }
+
+        // 签名预处理：生成 k1, Q1（nonce 在函数结束时清零）
+        let nonce = self.next_nonce()?;
 
         // 发送签名请求
-        let url = format!("{}/api/sign", self.config.server_url);
+        let reply = self
+            .post_wire(
+                Some(endpoint),
+                session,
+                "/api/sign",
+                || wire::encode_fields(&[key_pair.user_id.as_bytes(), nonce.q1(), e]),
+                || {
+                    serde_json::json!({
+                        "user_id": key_pair.user_id,
+                        "q1": base64_encode(nonce.q1()),
+                        "e": base64_encode(e),
+                    })
+                },
+            )
+            .await?;
+
+        let shares = Self::sign_shares(reply)?;
+        self.finish_sign(&nonce, key_pair, shares)
+    }
+
+    /// 使用预提交的随机数签名：请求只携带 (编号, E)，条目用后即丢弃
+    async fn sign_committed(
+        &self,
+        endpoint: usize,
+        session: &Session,
+        key_pair: &KeyPair,
+        e: &[u8],
+        entry: PrecommittedNonce,
+    ) -> Result<Signature> {
+        let reply = self
+            .post_wire(
+                Some(endpoint),
+                session,
+                "/api/sign/commit",
+                || wire::encode_fields(&[key_pair.user_id.as_bytes(), entry.id.as_bytes(), e]),
+                || {
+                    serde_json::json!({
+                        "user_id": key_pair.user_id,
+                        "id": entry.id,
+                        "e": base64_encode(e),
+                    })
+                },
+            )
+            .await?;
+
+        let shares = Self::sign_shares(reply)?;
+        self.finish_sign(&entry.nonce, key_pair, shares)
+    }
+
+    /// 解码服务端返回的签名分量 (r, s2, s3)
+    fn sign_shares(reply: WireReply) -> Result<SignShareBytes> {
+        let _span = metrics::span(Phase::Parse);
+        match reply {
+            WireReply::Binary(body) => {
+                let mut reader = wire::decode_response(&body)?;
+                let shares = [
+                    pad_scalar(reader.next_field()?)?,
+                    pad_scalar(reader.next_field()?)?,
+                    pad_scalar(reader.next_field()?)?,
+                ];
+                reader.finish()?;
+                Ok(shares)
+            }
+            WireReply::Json(body) => {
+                let data: SignResponse = Self::json_data(&body)?;
+                Ok([
+                    base64_decode_scalar(&data.r)?,
+                    base64_decode_scalar(&data.s2)?,
+                    base64_decode_scalar(&data.s3)?,
+                ])
+            }
+        }
+    }
+
+    /// 用服务端分量完成签名计算
+    fn finish_sign(&self, nonce: &NoncePair, key_pair: &KeyPair, [r, s2, s3]: SignShareBytes) -> Result<Signature> {
+        let (r_final, s_final) = self
+            .protocol
+            .complete_signature_with_inverse(nonce.k1(), &key_pair.d1, &key_pair.d1_inv, &r, &s2, &s3)?;
+
+        debug!("Signature generated successfully");
+        Ok(Signature {
+            r: r_final,
+            s: s_final,
+        })
+    }
+
+    /// 向服务端预提交 `count` 个签名随机数，返回新增数量
+    ///
+    /// 配置了 `precommit_batch` 时客户端会在余量不足一半时自动补充，此方法用于预热。
+    pub async fn precommit(&self, count: usize) -> Result<usize> {
+        let (session, key_pair) = self.signing_state().await?;
+        let endpoint = self
+            .endpoints
+            .pick(&[])
+            .ok_or(Error::InvalidState("No endpoint available".to_string()))?;
+        self.precommits.request(&session, &key_pair.user_id, endpoint, count).await
+    }
+
+    /// 批量协同签名
+    ///
+    /// 所有消息通过一次 `/api/sign/batch` 请求发送 (Q1, E) 列表，服务端按相同顺序
+    /// 返回 (r, s2, s3) 列表，客户端再共用一次 d1⁻¹ 批量完成签名。
+    /// 返回值与 `messages` 一一对应，单项失败不影响其他项。
+    pub async fn sign_batch(&self, messages: &[&[u8]]) -> Vec<Result<Signature>> {
+        let session = self.sessions.current().await;
+        let key_pair = self.key_pair.read().await.clone();
+        let (session, key_pair) = match (session, key_pair) {
+            (Ok(session), Some(key_pair)) => (session, key_pair),
+            (Err(err), _) => return messages.iter().map(|_| Err(err.clone())).collect(),
+            (_, None) => {
+                let err = Error::InvalidState("No key pair available".to_string());
+                return messages.iter().map(|_| Err(err.clone())).collect();
+            }
+        };
+
+        debug!("Signing batch of {} messages", messages.len());
+
+        let mut results: Vec<Option<Result<Signature>>> = Vec::with_capacity(messages.len());
+        // 成功完成预处理、需要发往服务端的项
+        let mut pending: Vec<PendingSign> = Vec::with_capacity(messages.len());
+
+        // 各条 E = SM3(Z || M) 共用 Z 中间状态，交给多路 SM3 并行计算
+        let mut hashes = vec![[0u8; 32]; messages.len()];
+        {
+            let _span = metrics::span(Phase::Hash);
+            MultiSm3::new().finalize_into(&key_pair.z_hasher, messages, &mut hashes);
+        }
+
+        for (index, e) in hashes.into_iter().enumerate() {
+            match self.next_nonce() {
+                Ok(nonce) => {
+                    pending.push(PendingSign { index, nonce, e });
+                    results.push(None);
+                }
+                Err(err) => results.push(Some(Err(err))),
+            }
+        }
+
+        if !pending.is_empty() {
+            match self.send_sign_batch(&session, &key_pair.user_id, &pending).await {
+                Ok(shares) => {
+                    self.complete_sign_batch(&key_pair, &pending, shares, &mut results);
+                }
+                Err(err) => {
+                    for item in &pending {
+                        results[item.index] = Some(Err(err.clone()));
+                    }
+                }
+            }
+        }
+
+        results
+            .into_iter()
+            .map(|r| metrics::track(r.unwrap_or_else(|| Err(Error::InvalidState("Batch item not processed".to_string())))))
+            .collect()
+    }
+
+    /// 发送批量签名请求，返回与请求项一一对应的 (r, s2, s3)
+    async fn send_sign_batch(
+        &self,
+        session: &Session,
+        user_id: &str,
+        pending: &[PendingSign],
+    ) -> Result<Vec<Result<SignShareBytes>>> {
+        let reply = self
+            .post_wire(
+                None,
+                session,
+                "/api/sign/batch",
+                || {
+                    let mut body = Vec::with_capacity(4 + user_id.len() + pending.len() * (8 + 64 + 32));
+                    wire::push_field(&mut body, user_id.as_bytes());
+                    for item in pending {
+                        wire::push_field(&mut body, item.nonce.q1());
+                        wire::push_field(&mut body, &item.e);
+                    }
+                    body
+                },
+                || {
+                    let items: Vec<serde_json::Value> = pending
+                        .iter()
+                        .map(|item| {
+                            serde_json::json!({
+                                "q1": base64_encode(item.nonce.q1()),
+                                "e": base64_encode(&item.e),
+                            })
+                        })
+                        .collect();
+                    serde_json::json!({
+                        "user_id": user_id,
+                        "items": items,
+                    })
+                },
+            )
+            .await?;
+
+        let _span = metrics::span(Phase::Parse);
+        let shares = match reply {
+            WireReply::Binary(body) => {
+                let mut reader = wire::decode_response(&body)?;
+                let mut shares = Vec::with_capacity(pending.len());
+                while !reader.is_empty() {
+                    let code = reader.next_i32()?;
+                    if code == 0 {
+                        shares.push(Ok([
+                            pad_scalar(reader.next_field()?)?,
+                            pad_scalar(reader.next_field()?)?,
+                            pad_scalar(reader.next_field()?)?,
+                        ]));
+                    } else {
+                        let message = String::from_utf8_lossy(reader.next_field()?).into_owned();
+                        shares.push(Err(Error::Api { code, message }));
+                    }
+                }
+                shares
+            }
+            WireReply::Json(body) => {
+                let data: SignBatchResponse = Self::json_data(&body)?;
+                data.items.into_iter().map(decode_batch_item).collect()
+            }
+        };
+
+        if shares.len() != pending.len() {
+            return Err(Error::InvalidState(format!(
+                "Batch response has {} items, expected {}",
+                shares.len(),
+                pending.len()
+            )));
+        }
+        Ok(shares)
+    }
+
+    /// 用批量响应完成所有签名
+    fn complete_sign_batch(
+        &self,
+        key_pair: &KeyPair,
+        pending: &[PendingSign],
+        shares: Vec<Result<SignShareBytes>>,
+        results: &mut [Option<Result<Signature>>],
+    ) {
+        // Reason: d1⁻¹ 已缓存在密钥对上，批量完成签名时每项只剩几次定长模乘
+        for (item, share) in pending.iter().zip(shares) {
+            let signature = share.and_then(|[r, s2, s3]| {
+                self.protocol
+                    .complete_signature_with_inverse(item.nonce.k1(), &key_pair.d1, &key_pair.d1_inv, &r, &s2, &s3)
+                    .map(|(r, s)| Signature { r, s })
+            });
+            results[item.index] = Some(signature);
+        }
+    }
+
+    /// 按配置的线上编码发送 POST 请求
+    ///
+    /// `endpoint` 为 None 时自动选择副本（连接失败换副本重发），否则只发往指定副本。
+    /// Binary 模式下服务端返回 415/406 时改用 JSON 重发，本客户端之后的请求直接使用 JSON。
+    async fn post_wire(
+        &self,
+        endpoint: Option<usize>,
+        session: &Session,
+        path: &str,
+        binary: impl FnOnce() -> Vec<u8>,
+        json: impl FnOnce() -> serde_json::Value,
+    ) -> Result<WireReply> {
+        if self.config.wire_format == WireFormat::Binary && !self.binary_unsupported.load(Ordering::Relaxed) {
+            let body = {
+                let _span = metrics::span(Phase::Serialize);
+                binary()
+            };
+            metrics::count(Counter::BytesSent, body.len() as u64);
+            let network = metrics::span(Phase::Network);
+            let response = self
+                .send(endpoint, path, |url| {
+                    self.http_client
+                        .post(url)
+                        .bearer_auth(&session.token)
+                        .header(CONTENT_TYPE, BINARY_CONTENT_TYPE)
+                        .header(ACCEPT, BINARY_CONTENT_TYPE)
+                        .body(body.clone())
+                })
+                .await?;
+
+            let status = response.status();
+            if status != StatusCode::UNSUPPORTED_MEDIA_TYPE && status != StatusCode::NOT_ACCEPTABLE {
+                return Self::wire_reply(response).await;
+            }
+            drop(network);
+            warn!("Server rejected {} ({}), falling back to JSON", BINARY_CONTENT_TYPE, status);
+            self.binary_unsupported.store(true, Ordering::Relaxed);
+            metrics::count(Counter::Retries, 1);
+        }
+
+        // Reason: 先序列化为字节，请求体只编码一次，换副本重发时直接复用
+        let body = {
+            let _span = metrics::span(Phase::Serialize);
+            serde_json::to_vec(&json()).map_err(|e| Error::Encoding(e.to_string()))?
+        };
+        metrics::count(Counter::BytesSent, body.len() as u64);
+        let _network = metrics::span(Phase::Network);
         let response = self
-            .http_client
-            .post(&url)
-            .bearer_auth(&session.token)
-            .json(&serde_json::json!({
-                "user_id": key_pair.user_id,
-                "q1": q1_base64,
-                "e": e_base64,
-            }))
-            .send()
-            .await
-            .map_err(|e| Error::Network(e.to_string()))?;
+            .send(endpoint, path, |url| {
+                self.http_client
+                    .post(url)
+                    .bearer_auth(&session.token)
+                    .header(CONTENT_TYPE, "application/json")
+                    .body(body.clone())
+            })
+            .await?;
+        Self::wire_reply(response).await
+    }
 
-        let api_response: ApiResponse<SignResponse> = response
-            .json()
-            .await
-            .map_err(|e| Error::Network(e.to_string()))?;
+    /// 发往指定副本，或自动选择副本
+    async fn send(&self, endpoint: Option<usize>, path: &str, build: impl Fn(&str) -> RequestBuilder) -> Result<Response> {
+        match endpoint {
+            Some(index) => self.endpoints.send_to(index, path, build).await,
+            None => self.endpoints.send(path, build).await,
+        }
+    }
+
+    /// 读取响应体，按响应的 Content-Type 区分编码
+    async fn wire_reply(response: reqwest::Response) -> Result<WireReply> {
+        let is_binary = response
+            .headers()
+            .get(CONTENT_TYPE)
+            .and_then(|value| value.to_str().ok())
+            .is_some_and(|value| value.starts_with(BINARY_CONTENT_TYPE));
+        let body = response.bytes().await.map_err(|e| Error::Network(e.to_string()))?;
+        metrics::count(Counter::BytesReceived, body.len() as u64);
+        Ok(if is_binary {
+            WireReply::Binary(body.to_vec())
+        } else {
+            WireReply::Json(body.to_vec())
+        })
+    }
+
+    /// 解析 JSON 响应，code 非 0 时返回 API 错误
+    fn json_data<T: DeserializeOwned>(body: &[u8]) -> Result<T> {
+        let api_response: ApiResponse<T> =
+            serde_json::from_slice(body).map_err(|e| Error::Network(e.to_string()))?;
 
         if api_response.code != 0 {
             return Err(Error::Api {
@@ -293,38 +890,41 @@ impl CoSignClient {
             });
         }
 
-        let data = api_response.data.ok_or(Error::InvalidState("No data in response".to_string()))?;
-
-        // 解码服务端返回的签名分量
-        let r = base64_decode(&data.r)?;
-        let s2 = base64_decode(&data.s2)?;
-        let s3 = base64_decode(&data.s3)?;
-
-        // 完成签名计算
-        let (r_final, s_final) = self.protocol.complete_signature(&k1, &key_pair.d1, &r, &s2, &s3)?;
+        api_response.data.ok_or(Error::InvalidState("No data in response".to_string()))
+    }
 
-        debug!("Signature generated successfully");
-        Ok(Signature {
-            r: r_final,
-            s: s_final,
-        })
+    /// 取一对签名随机数：优先从随机数池取，池为空时现场计算
+    fn next_nonce(&self) -> Result<NoncePair> {
+        let _span = metrics::span(Phase::SignPrepare);
+        if let Some(pool) = &self.nonce_pool {
+            if let Some(pair) = pool.take() {
+                return Ok(pair);
+            }
+            warn!("Nonce pool is empty, computing k1/Q1 inline");
+        }
+        NoncePair::generate(&self.protocol)
     }
 
     /// 协同解密
     pub async fn decrypt(&self, ciphertext: &[u8]) -> Result<Vec<u8>> {
-        let session = self.session.read().await.clone();
-        let session = session.ok_or(Error::NotAuthenticated)?;
+        let (session, key_pair) = self.signing_state().await?;
+        metrics::track(self.decrypt_with(&session, &key_pair, ciphertext).await)
+    }
 
-        let key_pair = self.key_pair.read().await.clone();
-        let key_pair = key_pair.ok_or(Error::InvalidState("No key pair available".to_string()))?;
+    /// 以密钥环中某个用户的身份协同解密，用户未登记时返回 `Error::NotAuthenticated`
+    pub async fn decrypt_for(&self, user_id: &str, ciphertext: &[u8]) -> Result<Vec<u8>> {
+        let entry = metrics::track(self.keyring.get(user_id).ok_or(Error::NotAuthenticated))?;
+        metrics::track(self.decrypt_with(&entry.session, &entry.key_pair, ciphertext).await)
+    }
 
+    async fn decrypt_with(&self, session: &Session, key_pair: &KeyPair, ciphertext: &[u8]) -> Result<Vec<u8>> {
         debug!("Decrypting ciphertext of {} bytes", ciphertext.len());
 
         // 解析密文 C1 || C3 || C2
         // C1: 65字节 (04 || x || y)
         // C3: 32字节
         // C2: 剩余字节
-        if ciphertext.len() < 65 + 32 {
+        if ciphertext.len() < CIPHERTEXT_HEADER {
             return Err(Error::InvalidParam("Ciphertext too short".to_string()));
         }
 
@@ -333,51 +933,109 @@ impl CoSignClient {
         let c3 = &ciphertext[65..97];
         let c2 = &ciphertext[97..];
 
-        // 计算预处理 T1
-        let t1 = self.protocol.decrypt_prepare(&key_pair.d1, c1_full)?;
-        let t1_base64 = base64_encode(&t1);
+        let t2 = self.request_t2(session, key_pair, c1_full).await?;
 
-        // 发送解密请求
-        let url = format!("{}/api/decrypt", self.config.server_url);
-        let response = self
-            .http_client
-            .post(&url)
-            .bearer_auth(&session.token)
-            .json(&serde_json::json!({
-                "user_id": key_pair.user_id,
-                "t1": t1_base64,
-            }))
-            .send()
-            .await
-            .map_err(|e| Error::Network(e.to_string()))?;
+        // 完成解密
+        let plaintext = self.protocol.complete_decryption(&t2, c1_coords, c3, c2)?;
 
-        let api_response: ApiResponse<DecryptResponse> = response
-            .json()
-            .await
-            .map_err(|e| Error::Network(e.to_string()))?;
+        debug!("Decryption completed successfully");
+        Ok(plaintext)
+    }
 
-        if api_response.code != 0 {
-            return Err(Error::Api {
-                code: api_response.code,
-                message: api_response.message,
-            });
+    /// 流式协同解密
+    ///
+    /// 只从 `reader` 读取 C1、C3 并完成 `/api/decrypt` 往返，之后把 C2 分块解密写入 `writer`，
+    /// 内存占用与密文大小无关。返回明文字节数。
+    ///
+    /// C3 只能在读完 C2 后校验：本方法返回 `Ok` 之前写入 `writer` 的数据都未经验证，
+    /// 返回 `Err(Error::Crypto)` 时调用方必须丢弃已写出的全部内容（例如先写临时文件，成功后再改名）。
+    pub async fn decrypt_stream<R, W>(&self, reader: R, writer: W) -> Result<u64>
+    where
+        R: AsyncRead + Unpin,
+        W: AsyncWrite + Unpin,
+    {
+        let (session, key_pair) = self.signing_state().await?;
+        metrics::track(self.decrypt_stream_with(&session, &key_pair, reader, writer).await)
+    }
+
+    async fn decrypt_stream_with<R, W>(&self, session: &Session, key_pair: &KeyPair, mut reader: R, mut writer: W) -> Result<u64>
+    where
+        R: AsyncRead + Unpin,
+        W: AsyncWrite + Unpin,
+    {
+        let mut header = [0u8; CIPHERTEXT_HEADER];
+        reader.read_exact(&mut header).await.map_err(|e| match e.kind() {
+            std::io::ErrorKind::UnexpectedEof => Error::InvalidParam("Ciphertext too short".to_string()),
+            _ => Error::Io(e),
+        })?;
+        let t2 = self.request_t2(session, key_pair, &header[0..65]).await?;
+        let mut stream = self.protocol.decrypt_stream(&t2, &header[1..65], &header[65..97])?;
+
+        // Reason: 缓冲区中残留的是明文，出错提前返回时同样需要清零
+        let mut buf = Zeroizing::new(vec![0u8; DECRYPT_READ_CHUNK]);
+        loop {
+            let n = reader.read(&mut buf).await?;
+            if n == 0 {
+                break;
+            }
+            stream.update(&mut buf[..n]);
+            writer.write_all(&buf[..n]).await?;
         }
+        writer.flush().await?;
 
-        let data = api_response.data.ok_or(Error::InvalidState("No data in response".to_string()))?;
+        let total = stream.processed();
+        stream.finalize()?;
+        debug!("Stream decryption of {} bytes completed successfully", total);
+        Ok(total)
+    }
 
-        // 解码 T2
-        let t2 = base64_decode(&data.t2)?;
+    /// 计算 T1 = d1·C1 并向服务端请求 T2
+    async fn request_t2(&self, session: &Session, key_pair: &KeyPair, c1: &[u8]) -> Result<PointBytes> {
+        // 计算预处理 T1
+        let t1 = self.protocol.decrypt_prepare(&key_pair.d1, c1)?;
 
-        // 完成解密
-        let plaintext = self.protocol.complete_decryption(&t2, c1_coords, c3, c2)?;
+        // 发送解密请求
+        let reply = self
+            .post_wire(
+                None,
+                session,
+                "/api/decrypt",
+                || wire::encode_fields(&[key_pair.user_id.as_bytes(), &t1]),
+                || {
+                    serde_json::json!({
+                        "user_id": key_pair.user_id,
+                        "t1": base64_encode(&t1),
+                    })
+                },
+            )
+            .await?;
 
-        debug!("Decryption completed successfully");
-        Ok(plaintext)
+        // 解码 T2
+        let _span = metrics::span(Phase::Parse);
+        match reply {
+            WireReply::Binary(body) => {
+                let mut reader = wire::decode_response(&body)?;
+                let t2: PointBytes = point_coords(reader.next_field()?, "T2")?
+                    .try_into()
+                    .expect("64-byte coordinates");
+                reader.finish()?;
+                Ok(t2)
+            }
+            WireReply::Json(body) => {
+                let data: DecryptResponse = Self::json_data(&body)?;
+                base64_decode_point(&data.t2, "T2")
+            }
+        }
+    }
+
+    /// 随机数池状态（未启用时返回 None），可用于池饥饿告警
+    pub fn nonce_pool_stats(&self) -> Option<NoncePoolStats> {
+        self.nonce_pool.as_ref().map(|pool| pool.stats())
     }
 
     /// 获取当前会话
     pub async fn get_session(&self) -> Option<Session> {
-        self.session.read().await.clone()
+        self.sessions.get().await.as_deref().cloned()
     }
 
     /// 设置会话（从文件恢复）
@@ -387,39 +1045,63 @@ impl CoSignClient {
             user_id,
             expires_at: String::new(),
         };
-        *self.session.write().await = Some(session);
+        self.sessions.set(session).await;
         Ok(())
     }
 
     /// 获取当前密钥对
     pub async fn get_key_pair(&self) -> Option<KeyPair> {
-        self.key_pair.read().await.clone()
+        self.key_pair.read().await.as_deref().cloned()
     }
 
     /// 设置密钥对（从文件恢复）
+    ///
+    /// d1 复制进安全内存池后，传入的 `Vec` 随即清零。
     pub async fn set_key_pair(&self, d1: Vec<u8>, public_key: Vec<u8>, user_id: String) -> Result<()> {
-        let key_pair = KeyPair {
+        let key_pair = self.new_key_pair(Self::secret_d1(d1)?, public_key, user_id)?;
+        *self.key_pair.write().await = Some(Arc::new(key_pair));
+        Ok(())
+    }
+
+    /// 代签用户的密钥环
+    pub fn keyring(&self) -> &Keyring {
+        &self.keyring
+    }
+
+    /// 把一个用户的会话与密钥登记到密钥环，d1⁻¹ 和 Z 值在此预先计算
+    pub fn add_user(&self, session: Session, d1: Vec<u8>, public_key: Vec<u8>) -> Result<()> {
+        let key_pair = self.new_key_pair(Self::secret_d1(d1)?, public_key, session.user_id.clone())?;
+        self.keyring.insert(session, key_pair)
+    }
+
+    /// 把调用方传入的 d1 移入安全内存池，并清零原 `Vec`
+    fn secret_d1(mut d1: Vec<u8>) -> Result<SecretScalar> {
+        let secret = SecretScalar::from_slice(&d1);
+        d1.zeroize();
+        secret
+    }
+
+    /// 构造密钥对，同时缓存 d1⁻¹ 和 Z 值
+    fn new_key_pair(&self, d1: SecretScalar, public_key: Vec<u8>, user_id: String) -> Result<KeyPair> {
+        let d1_inv = self.protocol.invert_d1_secret(&d1)?;
+        let z_hasher = self.protocol.message_hasher(&public_key)?;
+        Ok(KeyPair {
             d1,
+            d1_inv,
             public_key,
             user_id,
-        };
-        *self.key_pair.write().await = Some(key_pair);
-        Ok(())
+            z_hasher,
+        })
     }
 
     /// 获取用户信息
     pub async fn get_user_info(&self) -> Result<UserInfo> {
-        let session = self.session.read().await.clone();
-        let session = session.ok_or(Error::NotAuthenticated)?;
+        let session = self.sessions.current().await?;
 
-        let url = format!("{}/api/user/info", self.config.server_url);
         let response = self
-            .http_client
-            .get(&url)
-            .bearer_auth(&session.token)
-            .send()
-            .await
-            .map_err(|e| Error::Network(e.to_string()))?;
+            .endpoints
+            .send("/api/user/info", |url| self.http_client.get(url).bearer_auth(&session.token))
+            .await?;
 
         let api_response: ApiResponse<UserInfoResponse> = response
             .json()
@@ -445,17 +1127,37 @@ impl CoSignClient {
     }
 
     /// 健康检查
+    ///
+    /// 并发探测所有副本：恢复的副本重新加入负载均衡，失败计入连续失败次数。
+    /// 任一副本健康即返回 true，全部无法连接时返回网络错误。
     pub async fn health_check(&self) -> Result<bool> {
-        let url = format!("{}/mapi/health", self.config.server_url);
-        let response = self
-            .http_client
-            .get(&url)
-            .send()
-            .await
-            .map_err(|e| Error::Network(e.to_string()))?;
+        self.endpoints.probe(false).await
+    }
+}
+
+impl Drop for CoSignClient {
+    fn drop(&mut self) {
+        // 停止后台补充线程，并清零池中剩余的随机数
+        if let Some(pool) = &self.nonce_pool {
+            pool.close();
+        }
+    }
+}
 
-        Ok(response.status().is_success())
+/// 解析 JSON 批量响应中的一项
+fn decode_batch_item(item: SignBatchItem) -> Result<SignShareBytes> {
+    if item.code != 0 {
+        return Err(Error::Api {
+            code: item.code,
+            message: item.message,
+        });
     }
+    let field = |value: Option<String>, name: &str| {
+        value
+            .ok_or_else(|| Error::InvalidState(format!("Missing {} in batch item", name)))
+            .and_then(|v| base64_decode_scalar(&v))
+    };
+    Ok([field(item.r, "r")?, field(item.s2, "s2")?, field(item.s3, "s3")?])
 }
 
 #[cfg(test)]
@@ -468,11 +1170,81 @@ mod tests {
         assert_eq!(config.server_url, "http://127.0.0.1:8080");
         assert_eq!(config.timeout, 30);
         assert!(config.verify_tls);
+        assert_eq!(config.nonce_pool_size, 0);
+        assert_eq!(config.pool_max_idle_per_host, 32);
+        assert!(!config.http2_prior_knowledge);
+        assert!(config.tcp_nodelay);
+        assert_eq!(config.wire_format, WireFormat::Json);
+    }
+
+    #[tokio::test]
+    async fn test_client_transport_tuning() {
+        let config = ClientConfig {
+            pool_max_idle_per_host: 4,
+            pool_idle_timeout: 0,
+            http2_prior_knowledge: true,
+            http2_keep_alive_interval: 15,
+            tcp_keepalive: 0,
+            tcp_nodelay: false,
+            ..ClientConfig::default()
+        };
+        assert!(CoSignClient::new(config).is_ok());
     }
 
     #[tokio::test]
     async fn test_client_creation() {
         let client = CoSignClient::with_server_url("http://localhost:8080");
         assert!(client.is_ok());
+        assert!(client.unwrap().nonce_pool_stats().is_none());
+    }
+
+    #[tokio::test]
+    async fn test_sign_batch_requires_session() {
+        let client = CoSignClient::with_server_url("http://localhost:8080").unwrap();
+        let messages: [&[u8]; 2] = [b"a", b"b"];
+        let results = client.sign_batch(&messages).await;
+        assert_eq!(results.len(), 2);
+        assert!(results.iter().all(|r| matches!(r, Err(Error::NotAuthenticated))));
+    }
+
+    #[tokio::test]
+    async fn test_sign_reader_requires_session() {
+        let client = CoSignClient::with_server_url("http://localhost:8080").unwrap();
+        let result = client.sign_reader(&b"streamed message"[..]).await;
+        assert!(matches!(result, Err(Error::NotAuthenticated)));
+    }
+
+    #[tokio::test]
+    async fn test_keyring_users() {
+        let client = CoSignClient::with_server_url("http://localhost:8080").unwrap();
+        assert!(matches!(client.sign_for("alice", b"msg").await, Err(Error::NotAuthenticated)));
+        assert!(matches!(client.decrypt_for("alice", &[0u8; 120]).await, Err(Error::NotAuthenticated)));
+
+        let protocol = CoSignProtocol::new().unwrap();
+        let d1 = protocol.generate_d1().unwrap();
+        let public_key = protocol.calculate_p1(&d1).unwrap();
+        let session = Session {
+            token: "token".to_string(),
+            user_id: "alice".to_string(),
+            expires_at: String::new(),
+        };
+        client.add_user(session.clone(), d1.clone(), public_key).unwrap();
+        let entry = client.keyring().get("alice").unwrap();
+        assert_eq!(entry.key_pair.d1_inv[..], protocol.invert_d1(&d1).unwrap()[..]);
+        // 全局会话不受影响
+        assert!(client.get_session().await.is_none());
+
+        assert!(client.add_user(session, vec![0u8; 32], vec![0u8; 64]).is_err());
+    }
+
+    #[tokio::test]
+    async fn test_client_nonce_pool() {
+        let config = ClientConfig {
+            nonce_pool_size: 2,
+            ..ClientConfig::default()
+        };
+        let client = CoSignClient::new(config).unwrap();
+        let stats = client.nonce_pool_stats().unwrap();
+        assert_eq!(stats.capacity, 2);
     }
 }
@@ -0,0 +1,409 @@
+//! SM2 曲线点运算（常数时间）
+//!
+//! 基于 `field` 模块的定长模 p 运算，点使用射影坐标 (X : Y : Z)，x = X/Z，y = Y/Z。
+//! 加法与倍点采用 Renes–Costello–Batina 完备公式（a = -3），对无穷远点、相同点、
+//! 互逆点都给出正确结果，运算序列不因输入而改变。
+//!
+//! 点乘的标量按 4 位窗口切分，每个窗口的查表都遍历整张表并用掩码选出目标项，
+//! 访存模式与标量无关：
+//! - 任意点 k·P：现场构建 [0..15]·P，256 次倍点 + 64 次点加
+//! - 生成元 k·G：进程内共享一张 64 行 × 15 点的仿射坐标表（约 60 KB），64 次混合点加
+
+use crate::fixed_base::{window_digit, GX, GY};
+use crate::field::FieldElement;
+use crate::types::PointBytes;
+use std::sync::OnceLock;
+
+/// 窗口宽度（位）
+const WINDOW: usize = 4;
+
+/// 每个 256 位标量的窗口数
+const DIGITS: usize = 256 / WINDOW;
+
+/// 每个窗口表的非零项数
+const TABLE_SIZE: usize = (1 << WINDOW) - 1;
+
+/// 射影坐标点，无穷远点为 (0 : 1 : 0)
+#[derive(Clone, Copy, Debug)]
+pub struct ProjectivePoint {
+    x: FieldElement,
+    y: FieldElement,
+    z: FieldElement,
+}
+
+/// 仿射坐标点，仅用于预计算表；`infinity` 为全 1 掩码时表示无穷远点
+#[derive(Clone, Copy, Debug)]
+struct AffinePoint {
+    x: FieldElement,
+    y: FieldElement,
+    infinity: u64,
+}
+
+impl AffinePoint {
+    const IDENTITY: AffinePoint = AffinePoint {
+        x: FieldElement::ZERO,
+        y: FieldElement::ZERO,
+        infinity: u64::MAX,
+    };
+
+    fn select(a: &Self, b: &Self, choice: u64) -> Self {
+        AffinePoint {
+            x: FieldElement::select(&a.x, &b.x, choice),
+            y: FieldElement::select(&a.y, &b.y, choice),
+            infinity: (a.infinity & !choice) | (b.infinity & choice),
+        }
+    }
+}
+
+impl ProjectivePoint {
+    /// 无穷远点
+    pub const IDENTITY: ProjectivePoint = ProjectivePoint {
+        x: FieldElement::ZERO,
+        y: FieldElement::ONE,
+        z: FieldElement::ZERO,
+    };
+
+    /// 生成元 G
+    pub fn generator() -> Self {
+        // Reason: GX/GY 为常量，必然小于 p 且在曲线上
+        Self::from_affine_bytes(&generator_bytes()).unwrap()
+    }
+
+    /// 从 64 字节仿射坐标 x||y 解析，坐标不小于 p 或点不在曲线上时返回 None
+    pub fn from_affine_bytes(bytes: &PointBytes) -> Option<Self> {
+        let x = FieldElement::from_canonical(bytes[..32].try_into().unwrap())?;
+        let y = FieldElement::from_canonical(bytes[32..].try_into().unwrap())?;
+        // y² = x³ - 3x + b
+        let rhs = x.square() * x - (x.double() + x) + FieldElement::B;
+        if y.square() != rhs {
+            return None;
+        }
+        Some(ProjectivePoint {
+            x,
+            y,
+            z: FieldElement::ONE,
+        })
+    }
+
+    /// 转换为 64 字节仿射坐标 x||y，无穷远点返回 None
+    pub fn to_affine_bytes(&self) -> Option<PointBytes> {
+        if self.is_identity() {
+            return None;
+        }
+        let z_inv = self.z.invert();
+        let mut out = [0u8; 64];
+        out[..32].copy_from_slice(&(self.x * z_inv).to_bytes_be());
+        out[32..].copy_from_slice(&(self.y * z_inv).to_bytes_be());
+        Some(out)
+    }
+
+    /// 是否为无穷远点
+    pub fn is_identity(&self) -> bool {
+        self.z.is_zero()
+    }
+
+    /// 按条件选择：`choice` 为全 1 掩码时返回 b，为 0 时返回 a
+    fn select(a: &Self, b: &Self, choice: u64) -> Self {
+        ProjectivePoint {
+            x: FieldElement::select(&a.x, &b.x, choice),
+            y: FieldElement::select(&a.y, &b.y, choice),
+            z: FieldElement::select(&a.z, &b.z, choice),
+        }
+    }
+
+    /// -P
+    pub fn neg(&self) -> Self {
+        ProjectivePoint {
+            x: self.x,
+            y: -self.y,
+            z: self.z,
+        }
+    }
+
+    /// P + Q（RCB 算法 4，12M + 2m_b）
+    pub fn add(&self, rhs: &Self) -> Self {
+        let b = FieldElement::B;
+        let xx = self.x * rhs.x;
+        let yy = self.y * rhs.y;
+        let zz = self.z * rhs.z;
+        let xy_pairs = (self.x + self.y) * (rhs.x + rhs.y) - (xx + yy);
+        let yz_pairs = (self.y + self.z) * (rhs.y + rhs.z) - (yy + zz);
+        let xz_pairs = (self.x + self.z) * (rhs.x + rhs.z) - (xx + zz);
+
+        let bzz_part = xz_pairs - b * zz;
+        let bzz3_part = bzz_part.double() + bzz_part;
+        let yy_m_bzz3 = yy - bzz3_part;
+        let yy_p_bzz3 = yy + bzz3_part;
+
+        let zz3 = zz.double() + zz;
+        let bxz_part = b * xz_pairs - (zz3 + xx);
+        let bxz3_part = bxz_part.double() + bxz_part;
+        let xx3_m_zz3 = xx.double() + xx - zz3;
+
+        ProjectivePoint {
+            x: yy_p_bzz3 * xy_pairs - yz_pairs * bxz3_part,
+            y: yy_p_bzz3 * yy_m_bzz3 + xx3_m_zz3 * bxz3_part,
+            z: yy_m_bzz3 * yz_pairs + xy_pairs * xx3_m_zz3,
+        }
+    }
+
+    /// P + Q，Q 为仿射坐标（RCB 算法 5，11M + 2m_b）
+    fn add_affine(&self, rhs: &AffinePoint) -> Self {
+        let b = FieldElement::B;
+        let xx = self.x * rhs.x;
+        let yy = self.y * rhs.y;
+        let xy_pairs = (self.x + self.y) * (rhs.x + rhs.y) - (xx + yy);
+        let yz_pairs = rhs.y * self.z + self.y;
+        let xz_pairs = rhs.x * self.z + self.x;
+
+        let bz_part = xz_pairs - b * self.z;
+        let bz3_part = bz_part.double() + bz_part;
+        let yy_m_bzz3 = yy - bz3_part;
+        let yy_p_bzz3 = yy + bz3_part;
+
+        let z3 = self.z.double() + self.z;
+        let bxz_part = b * xz_pairs - (z3 + xx);
+        let bxz3_part = bxz_part.double() + bxz_part;
+        let xx3_m_zz3 = xx.double() + xx - z3;
+
+        let sum = ProjectivePoint {
+            x: yy_p_bzz3 * xy_pairs - yz_pairs * bxz3_part,
+            y: yy_p_bzz3 * yy_m_bzz3 + xx3_m_zz3 * bxz3_part,
+            z: yy_m_bzz3 * yz_pairs + xy_pairs * xx3_m_zz3,
+        };
+        // Reason: 仿射坐标无法表示无穷远点，公式对其不成立，用掩码保留原值
+        Self::select(&sum, self, rhs.infinity)
+    }
+
+    /// 2P（RCB 算法 6，8M + 3S + 2m_b）
+    pub fn double(&self) -> Self {
+        let b = FieldElement::B;
+        let xx = self.x.square();
+        let yy = self.y.square();
+        let zz = self.z.square();
+        let xy2 = (self.x * self.y).double();
+        let xz2 = (self.x * self.z).double();
+
+        let bzz_part = b * zz - xz2;
+        let bzz3_part = bzz_part.double() + bzz_part;
+        let yy_m_bzz3 = yy - bzz3_part;
+        let yy_p_bzz3 = yy + bzz3_part;
+        let y_frag = yy_p_bzz3 * yy_m_bzz3;
+        let x_frag = yy_m_bzz3 * xy2;
+
+        let zz3 = zz.double() + zz;
+        let bxz2_part = b * xz2 - (zz3 + xx);
+        let bxz6_part = bxz2_part.double() + bxz2_part;
+        let xx3_m_zz3 = xx.double() + xx - zz3;
+
+        let yz2 = (self.y * self.z).double();
+        ProjectivePoint {
+            x: x_frag - bxz6_part * yz2,
+            y: y_frag + xx3_m_zz3 * bxz6_part,
+            z: (yz2 * yy).double().double(),
+        }
+    }
+
+    /// k·P（k 为 32 字节大端标量，不要求小于 n），常数时间
+    pub fn mul(&self, k: &[u8; 32]) -> Self {
+        // table[j] = j·P，j = 0..15
+        let mut table = [ProjectivePoint::IDENTITY; TABLE_SIZE + 1];
+        for j in 1..=TABLE_SIZE {
+            table[j] = table[j - 1].add(self);
+        }
+
+        let mut acc = ProjectivePoint::IDENTITY;
+        for i in (0..DIGITS).rev() {
+            for _ in 0..WINDOW {
+                acc = acc.double();
+            }
+            let digit = window_digit(k, i * WINDOW, WINDOW);
+            let mut entry = ProjectivePoint::IDENTITY;
+            for (j, point) in table.iter().enumerate() {
+                entry = Self::select(&entry, point, ct_eq(j, digit));
+            }
+            acc = acc.add(&entry);
+        }
+        acc
+    }
+}
+
+/// 生成元 G 的常数时间预计算表：第 i 行第 j-1 项为 j · 16^i · G
+pub struct BaseTable {
+    rows: Vec<[AffinePoint; TABLE_SIZE]>,
+}
+
+impl BaseTable {
+    fn new() -> Self {
+        let mut projective = Vec::with_capacity(DIGITS * TABLE_SIZE);
+        let mut base = ProjectivePoint::generator();
+        for _ in 0..DIGITS {
+            let row_start = projective.len();
+            projective.push(base);
+            for j in 1..TABLE_SIZE {
+                projective.push(projective[row_start + j - 1].add(&base));
+            }
+            // 下一行基点 16 · base = 15·base + base
+            base = projective[row_start + TABLE_SIZE - 1].add(&base);
+        }
+
+        let affine = batch_to_affine(&projective);
+        let rows = affine
+            .chunks_exact(TABLE_SIZE)
+            .map(|row| row.try_into().unwrap())
+            .collect();
+        Self { rows }
+    }
+
+    /// k·G（k 为 32 字节大端标量，不要求小于 n），常数时间
+    pub fn mul(&self, k: &[u8; 32]) -> ProjectivePoint {
+        let mut acc = ProjectivePoint::IDENTITY;
+        for (i, row) in self.rows.iter().enumerate() {
+            let digit = window_digit(k, i * WINDOW, WINDOW);
+            let mut entry = AffinePoint::IDENTITY;
+            for (j, point) in row.iter().enumerate() {
+                entry = AffinePoint::select(&entry, point, ct_eq(j + 1, digit));
+            }
+            acc = acc.add_affine(&entry);
+        }
+        acc
+    }
+}
+
+/// 进程内共享的生成元预计算表，首次调用时构建
+pub fn base_table() -> &'static BaseTable {
+    static TABLE: OnceLock<BaseTable> = OnceLock::new();
+    TABLE.get_or_init(BaseTable::new)
+}
+
+/// 批量转为仿射坐标（Montgomery 技巧，只做一次求逆），输入不得含无穷远点
+fn batch_to_affine(points: &[ProjectivePoint]) -> Vec<AffinePoint> {
+    // prefix[i] = z[0] · … · z[i]
+    let mut prefix = Vec::with_capacity(points.len());
+    let mut acc = FieldElement::ONE;
+    for point in points {
+        debug_assert!(!point.is_identity());
+        acc = acc * point.z;
+        prefix.push(acc);
+    }
+
+    let mut inv = acc.invert();
+    let mut affine = vec![AffinePoint::IDENTITY; points.len()];
+    for i in (0..points.len()).rev() {
+        let before = if i == 0 { FieldElement::ONE } else { prefix[i - 1] };
+        let z_inv = inv * before;
+        inv = inv * points[i].z;
+        affine[i] = AffinePoint {
+            x: points[i].x * z_inv,
+            y: points[i].y * z_inv,
+            infinity: 0,
+        };
+    }
+    affine
+}
+
+/// a == b 时返回全 1 掩码，否则返回 0（无分支）
+fn ct_eq(a: usize, b: usize) -> u64 {
+    let x = (a ^ b) as u64;
+    ((x | x.wrapping_neg()) >> 63).wrapping_sub(1)
+}
+
+fn generator_bytes() -> PointBytes {
+    let mut out = [0u8; 64];
+    out[..32].copy_from_slice(&GX);
+    out[32..].copy_from_slice(&GY);
+    out
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use libsm::sm2::ecc::{EccCtx, Point};
+    use num_bigint::BigUint;
+
+    fn libsm_bytes(ecc: &EccCtx, p: &Point) -> PointBytes {
+        let (x, y) = ecc.to_affine(p).unwrap();
+        let mut out = [0u8; 64];
+        out[..32].copy_from_slice(&x.to_bytes());
+        out[32..].copy_from_slice(&y.to_bytes());
+        out
+    }
+
+    fn scalar(k: &BigUint) -> [u8; 32] {
+        let bytes = k.to_bytes_be();
+        let mut out = [0u8; 32];
+        out[32 - bytes.len()..].copy_from_slice(&bytes);
+        out
+    }
+
+    #[test]
+    fn test_ct_eq() {
+        assert_eq!(ct_eq(3, 3), u64::MAX);
+        assert_eq!(ct_eq(0, 15), 0);
+        assert_eq!(ct_eq(15, 15), u64::MAX);
+    }
+
+    #[test]
+    fn test_point_encoding() {
+        let g = generator_bytes();
+        assert_eq!(ProjectivePoint::generator().to_affine_bytes().unwrap(), g);
+        let mut off_curve = g;
+        off_curve[63] ^= 1;
+        assert!(ProjectivePoint::from_affine_bytes(&off_curve).is_none());
+        assert!(ProjectivePoint::from_affine_bytes(&[0xff; 64]).is_none());
+        assert!(ProjectivePoint::IDENTITY.to_affine_bytes().is_none());
+    }
+
+    #[test]
+    fn test_add_double_match_libsm() {
+        let ecc = EccCtx::new();
+        let g = ProjectivePoint::generator();
+        let lg = ecc.generator().unwrap();
+        let l2g = ecc.double(&lg).unwrap();
+        let l3g = ecc.add(&l2g, &lg).unwrap();
+
+        assert_eq!(g.double().to_affine_bytes().unwrap(), libsm_bytes(&ecc, &l2g));
+        assert_eq!(g.add(&g).to_affine_bytes().unwrap(), libsm_bytes(&ecc, &l2g));
+        assert_eq!(g.double().add(&g).to_affine_bytes().unwrap(), libsm_bytes(&ecc, &l3g));
+        // 完备公式：P + (-P) = O，O + P = P，2·O = O
+        assert!(g.add(&g.neg()).is_identity());
+        assert_eq!(ProjectivePoint::IDENTITY.add(&g).to_affine_bytes(), g.to_affine_bytes());
+        assert!(ProjectivePoint::IDENTITY.double().is_identity());
+    }
+
+    #[test]
+    fn test_mul_matches_libsm() {
+        let ecc = EccCtx::new();
+        let q_libsm = ecc.g_mul(&ecc.random_uint()).unwrap();
+        let q = ProjectivePoint::from_affine_bytes(&libsm_bytes(&ecc, &q_libsm)).unwrap();
+
+        for _ in 0..4 {
+            let k = ecc.random_uint();
+            let expected = libsm_bytes(&ecc, &ecc.mul(&k, &q_libsm).unwrap());
+            assert_eq!(q.mul(&scalar(&k)).to_affine_bytes().unwrap(), expected);
+
+            let expected = libsm_bytes(&ecc, &ecc.g_mul(&k).unwrap());
+            assert_eq!(base_table().mul(&scalar(&k)).to_affine_bytes().unwrap(), expected);
+            assert_eq!(ProjectivePoint::generator().mul(&scalar(&k)).to_affine_bytes().unwrap(), expected);
+        }
+    }
+
+    #[test]
+    fn test_mul_edge_scalars() {
+        let g = ProjectivePoint::generator();
+        let n = scalar(EccCtx::new().get_n());
+        let mut one = [0u8; 32];
+        one[31] = 1;
+
+        assert!(g.mul(&[0u8; 32]).is_identity());
+        assert!(base_table().mul(&[0u8; 32]).is_identity());
+        assert!(g.mul(&n).is_identity());
+        assert!(base_table().mul(&n).is_identity());
+        assert_eq!(base_table().mul(&one).to_affine_bytes(), g.to_affine_bytes());
+        // n - 1 = -1
+        let mut n_minus_1 = n;
+        n_minus_1[31] -= 1;
+        assert_eq!(base_table().mul(&n_minus_1).to_affine_bytes(), g.neg().to_affine_bytes());
+        assert_eq!(g.mul(&n_minus_1).to_affine_bytes(), g.neg().to_affine_bytes());
+    }
+}
@@ -0,0 +1,574 @@
+//! 多端点负载均衡、对冲请求与故障摘除
+//!
+//! `ClientConfig::server_url` 与 `replica_urls` 组成端点列表，每个端点记录最近的响应延迟
+//! （滑动窗口 + EWMA）、连续失败次数和在途请求数：
+//! - 选择：在未摘除的端点中取 延迟 EWMA ×（在途数 + 1）最小者；尚无样本的端点（新加入或刚恢复）
+//!   优先试探，但同一时刻只放行一个试探请求，拿到首个样本后才参与按延迟选择
+//! - 对冲：签名请求超过所在端点的 p95 延迟仍未返回时，客户端用新的 k1 向另一端点发出副本，取先完成者
+//! - 摘除：连续失败达到 `eject_after_failures`，或延迟远高于最快端点时摘除；
+//!   后台每隔 `probe_interval` 调用 `/mapi/health` 探测，恢复后重新加入
+//!
+//! 请求在连接阶段失败（未到达服务端）时换下一个端点重发，不会造成服务端重复处理。
+
+use crate::client::ClientConfig;
+use crate::error::{Error, Result};
+use crate::metrics::{self, Counter};
+use reqwest::{Client, RequestBuilder, Response};
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex, MutexGuard, PoisonError, Weak};
+use std::time::{Duration, Instant};
+use tokio::task::JoinSet;
+use tracing::{debug, info, warn};
+
+/// 每个端点保留的延迟样本数
+const LATENCY_WINDOW: usize = 64;
+/// 计算百分位与判定慢节点所需的最少样本数
+const MIN_SAMPLES: usize = 16;
+/// 样本不足时的对冲延迟
+const DEFAULT_HEDGE_DELAY: Duration = Duration::from_millis(200);
+/// 延迟 EWMA 超过最快端点该倍数时视为慢节点
+const SLOW_FACTOR: f64 = 4.0;
+/// EWMA 平滑系数
+const EWMA_ALPHA: f64 = 0.2;
+
+/// 最近若干次请求的延迟（微秒）
+struct LatencyWindow {
+    samples: [u32; LATENCY_WINDOW],
+    len: usize,
+    next: usize,
+    ewma_us: f64,
+}
+
+impl LatencyWindow {
+    fn new() -> Self {
+        Self {
+            samples: [0; LATENCY_WINDOW],
+            len: 0,
+            next: 0,
+            ewma_us: 0.0,
+        }
+    }
+
+    fn record(&mut self, elapsed: Duration) {
+        let us = elapsed.as_micros().min(u32::MAX as u128) as u32;
+        self.samples[self.next] = us;
+        self.next = (self.next + 1) % LATENCY_WINDOW;
+        self.ewma_us = if self.len == 0 {
+            us as f64
+        } else {
+            self.ewma_us + EWMA_ALPHA * (us as f64 - self.ewma_us)
+        };
+        self.len = (self.len + 1).min(LATENCY_WINDOW);
+    }
+
+    /// 样本数不足 `MIN_SAMPLES` 时返回 None
+    fn percentile(&self, p: f64) -> Option<Duration> {
+        if self.len < MIN_SAMPLES {
+            return None;
+        }
+        let mut sorted = [0u32; LATENCY_WINDOW];
+        sorted[..self.len].copy_from_slice(&self.samples[..self.len]);
+        sorted[..self.len].sort_unstable();
+        let rank = ((self.len - 1) as f64 * p).round() as usize;
+        Some(Duration::from_micros(sorted[rank] as u64))
+    }
+}
+
+struct EndpointState {
+    latency: LatencyWindow,
+    /// 连续失败次数
+    failures: u32,
+    /// 被摘除的时刻
+    ejected_at: Option<Instant>,
+}
+
+/// 一个服务端副本
+struct Endpoint {
+    base_url: String,
+    in_flight: AtomicUsize,
+    state: Mutex<EndpointState>,
+}
+
+impl Endpoint {
+    fn state(&self) -> MutexGuard<'_, EndpointState> {
+        self.state.lock().unwrap_or_else(PoisonError::into_inner)
+    }
+}
+
+/// 一次请求的结果
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum Outcome {
+    Success,
+    Failure,
+    /// 请求被放弃（对冲落败）：耗时只是实际延迟的下界，仍计入样本
+    Cancelled,
+}
+
+/// 在途请求：结束或被丢弃时记录延迟与结果
+struct Attempt<'a> {
+    endpoints: &'a Endpoints,
+    index: usize,
+    start: Instant,
+    outcome: Outcome,
+}
+
+impl Attempt<'_> {
+    fn finish(mut self, outcome: Outcome) {
+        self.outcome = outcome;
+    }
+}
+
+impl Drop for Attempt<'_> {
+    fn drop(&mut self) {
+        self.endpoints.list[self.index].in_flight.fetch_sub(1, Ordering::Relaxed);
+        self.endpoints.record(self.index, self.start.elapsed(), self.outcome);
+    }
+}
+
+/// 端点列表
+pub(crate) struct Endpoints {
+    http_client: Client,
+    list: Box<[Endpoint]>,
+    hedge: bool,
+    hedge_min_delay: Duration,
+    eject_after_failures: u32,
+    probe_interval: Duration,
+    /// 后台探测任务是否在运行（只在有端点被摘除时运行）
+    prober_running: AtomicBool,
+    this: Weak<Endpoints>,
+}
+
+impl Endpoints {
+    pub(crate) fn new(http_client: Client, config: &ClientConfig) -> Arc<Self> {
+        let list = std::iter::once(&config.server_url)
+            .chain(&config.replica_urls)
+            .map(|url| Endpoint {
+                base_url: url.clone(),
+                in_flight: AtomicUsize::new(0),
+                state: Mutex::new(EndpointState {
+                    latency: LatencyWindow::new(),
+                    failures: 0,
+                    ejected_at: None,
+                }),
+            })
+            .collect();
+
+        Arc::new_cyclic(|this| Self {
+            http_client,
+            list,
+            hedge: config.hedge_requests,
+            hedge_min_delay: Duration::from_millis(config.hedge_min_delay_ms),
+            eject_after_failures: config.eject_after_failures.max(1),
+            probe_interval: Duration::from_secs(config.probe_interval.max(1)),
+            prober_running: AtomicBool::new(false),
+            this: this.clone(),
+        })
+    }
+
+    /// 所有端点共用的 HTTP 客户端
+    pub(crate) fn http_client(&self) -> &Client {
+        &self.http_client
+    }
+
+    /// 端点地址
+    pub(crate) fn url(&self, index: usize) -> &str {
+        &self.list[index].base_url
+    }
+
+    /// 选择端点：跳过 `tried` 中已用过的端点，全部用过时返回 None
+    ///
+    /// 未摘除的端点按 延迟 EWMA ×（在途数 + 1）取最小；尚无样本的端点空闲时作为试探优先选中，
+    /// 已有试探在途时暂不参与（否则其 EWMA 为 0，并发请求会全部涌向它）。
+    /// 没有可选端点时依次退而选择在途最少的无样本端点、最早被摘除的端点。
+    pub(crate) fn pick(&self, tried: &[usize]) -> Option<usize> {
+        let mut best: Option<(usize, f64)> = None;
+        let mut warming: Option<(usize, usize)> = None;
+        let mut fallback: Option<(usize, Instant)> = None;
+        for (index, endpoint) in self.list.iter().enumerate() {
+            if tried.contains(&index) {
+                continue;
+            }
+            let state = endpoint.state();
+            match state.ejected_at {
+                None => {
+                    let in_flight = endpoint.in_flight.load(Ordering::Relaxed);
+                    let score = if state.latency.len > 0 {
+                        state.latency.ewma_us * (in_flight + 1) as f64
+                    } else if in_flight == 0 {
+                        0.0
+                    } else {
+                        if warming.map_or(true, |(_, n)| in_flight < n) {
+                            warming = Some((index, in_flight));
+                        }
+                        continue;
+                    };
+                    if best.map_or(true, |(_, s)| score < s) {
+                        best = Some((index, score));
+                    }
+                }
+                Some(at) => {
+                    if fallback.map_or(true, |(_, t)| at < t) {
+                        fallback = Some((index, at));
+                    }
+                }
+            }
+        }
+        best.or(warming.map(|(index, n)| (index, n as f64)))
+            .map(|(index, _)| index)
+            .or(fallback.map(|(index, _)| index))
+    }
+
+    /// 向 `index` 端点发出的请求等待多久未返回时发出对冲副本；不可对冲时返回 None
+    ///
+    /// 延迟取该端点最近请求的 p95（样本不足时为 200ms），不低于 `hedge_min_delay_ms`。
+    pub(crate) fn hedge_delay(&self, index: usize) -> Option<Duration> {
+        if !self.hedge {
+            return None;
+        }
+        let has_peer = self
+            .list
+            .iter()
+            .enumerate()
+            .any(|(i, endpoint)| i != index && endpoint.state().ejected_at.is_none());
+        if !has_peer {
+            return None;
+        }
+        let p95 = self.list[index].state().latency.percentile(0.95).unwrap_or(DEFAULT_HEDGE_DELAY);
+        Some(p95.max(self.hedge_min_delay))
+    }
+
+    /// 选择端点发送请求；连接失败时依次换其他端点重发
+    pub(crate) async fn send(&self, path: &str, build: impl Fn(&str) -> RequestBuilder) -> Result<Response> {
+        let mut tried = Vec::with_capacity(self.list.len());
+        loop {
+            let index = self.pick(&tried).expect("endpoint list is never empty");
+            tried.push(index);
+            match self.try_send(index, path, &build).await {
+                Ok(response) => return Ok(response),
+                Err((err, true)) if tried.len() < self.list.len() => {
+                    debug!("Failing over from {}: {}", self.url(index), err);
+                    metrics::count(Counter::Retries, 1);
+                }
+                Err((err, _)) => return Err(err),
+            }
+        }
+    }
+
+    /// 向指定端点发送请求，不做故障转移
+    pub(crate) async fn send_to(
+        &self,
+        index: usize,
+        path: &str,
+        build: impl Fn(&str) -> RequestBuilder,
+    ) -> Result<Response> {
+        self.try_send(index, path, &build).await.map_err(|(err, _)| err)
+    }
+
+    /// 发送一次请求并记录结果；错误附带是否可安全换端点重发（连接未建立）
+    async fn try_send(
+        &self,
+        index: usize,
+        path: &str,
+        build: &impl Fn(&str) -> RequestBuilder,
+    ) -> std::result::Result<Response, (Error, bool)> {
+        let url = format!("{}{}", self.list[index].base_url, path);
+        let attempt = self.begin(index);
+        match build(&url).send().await {
+            Ok(response) => {
+                // 5xx 计为端点故障，但仍把响应交给调用方按原逻辑处理
+                let outcome = if response.status().is_server_error() {
+                    Outcome::Failure
+                } else {
+                    Outcome::Success
+                };
+                attempt.finish(outcome);
+                Ok(response)
+            }
+            Err(e) => {
+                attempt.finish(Outcome::Failure);
+                let retryable = e.is_connect();
+                Err((Error::Network(format!("Failed to connect to {}: {}", url, e)), retryable))
+            }
+        }
+    }
+
+    fn begin(&self, index: usize) -> Attempt<'_> {
+        self.list[index].in_flight.fetch_add(1, Ordering::Relaxed);
+        Attempt {
+            endpoints: self,
+            index,
+            start: Instant::now(),
+            outcome: Outcome::Cancelled,
+        }
+    }
+
+    /// 记录一次请求，必要时摘除端点
+    fn record(&self, index: usize, elapsed: Duration, outcome: Outcome) {
+        let (failures, ewma_us, samples) = {
+            let mut state = self.list[index].state();
+            match outcome {
+                Outcome::Success => {
+                    state.latency.record(elapsed);
+                    state.failures = 0;
+                }
+                Outcome::Cancelled => state.latency.record(elapsed),
+                // Reason: 失败（如连接被拒）往往很快返回，计入延迟会让故障端点显得更快
+                Outcome::Failure => state.failures += 1,
+            }
+            if state.ejected_at.is_some() || self.list.len() == 1 {
+                return;
+            }
+            (state.failures, state.latency.ewma_us, state.latency.len)
+        };
+
+        if failures >= self.eject_after_failures {
+            self.eject(index, &format!("{} consecutive failures", failures));
+        } else if samples >= MIN_SAMPLES && ewma_us > self.hedge_min_delay.as_micros() as f64 {
+            // 逐个加锁比较，避免同时持有两个端点的锁
+            let fastest = self
+                .list
+                .iter()
+                .enumerate()
+                .filter(|&(i, _)| i != index)
+                .filter_map(|(_, endpoint)| {
+                    let state = endpoint.state();
+                    (state.ejected_at.is_none() && state.latency.len >= MIN_SAMPLES).then_some(state.latency.ewma_us)
+                })
+                .fold(f64::INFINITY, f64::min);
+            if ewma_us > SLOW_FACTOR * fastest {
+                self.eject(index, &format!("latency {:.1}ms vs {:.1}ms", ewma_us / 1000.0, fastest / 1000.0));
+            }
+        }
+    }
+
+    fn eject(&self, index: usize, reason: &str) {
+        {
+            let mut state = self.list[index].state();
+            if state.ejected_at.is_some() {
+                return;
+            }
+            state.ejected_at = Some(Instant::now());
+        }
+        warn!("Ejecting endpoint {}: {}", self.url(index), reason);
+        self.start_prober();
+    }
+
+    fn readmit(&self, index: usize) {
+        let mut state = self.list[index].state();
+        if state.ejected_at.take().is_some() {
+            // 旧样本反映的是故障期间的延迟，重新加入后从头统计
+            state.latency = LatencyWindow::new();
+            state.failures = 0;
+            drop(state);
+            info!("Endpoint {} is healthy again", self.url(index));
+        }
+    }
+
+    /// 端点当前是否被摘除
+    pub(crate) fn is_ejected(&self, index: usize) -> bool {
+        self.list[index].state().ejected_at.is_some()
+    }
+
+    fn any_ejected(&self) -> bool {
+        self.list.iter().any(|endpoint| endpoint.state().ejected_at.is_some())
+    }
+
+    /// 探测端点健康状态：恢复的端点重新加入，失败计入连续失败次数
+    ///
+    /// 所有端点并发探测。任一端点健康即返回 true；全部无法连接时返回最后一个网络错误。
+    pub(crate) async fn probe(&self, only_ejected: bool) -> Result<bool> {
+        let mut probes = JoinSet::new();
+        for (index, endpoint) in self.list.iter().enumerate() {
+            if only_ejected && endpoint.state().ejected_at.is_none() {
+                continue;
+            }
+            let request = self.http_client.get(format!("{}/mapi/health", endpoint.base_url));
+            probes.spawn(async move { (index, request.send().await) });
+        }
+
+        let mut healthy = false;
+        let mut answered = false;
+        let mut last_error = None;
+        while let Some(joined) = probes.join_next().await {
+            let Ok((index, result)) = joined else {
+                continue;
+            };
+            match result {
+                Ok(response) if response.status().is_success() => {
+                    healthy = true;
+                    answered = true;
+                    self.readmit(index);
+                }
+                Ok(_) => {
+                    answered = true;
+                    self.record(index, Duration::ZERO, Outcome::Failure);
+                }
+                Err(e) => {
+                    self.record(index, Duration::ZERO, Outcome::Failure);
+                    last_error = Some(Error::Network(e.to_string()));
+                }
+            }
+        }
+
+        match last_error {
+            Some(err) if !answered => Err(err),
+            _ => Ok(healthy),
+        }
+    }
+
+    /// 有端点被摘除时启动后台探测，全部恢复后任务退出
+    ///
+    /// 任务只持有弱引用，客户端释放后自动结束。
+    fn start_prober(&self) {
+        if self.prober_running.swap(true, Ordering::AcqRel) {
+            return;
+        }
+        let Ok(handle) = tokio::runtime::Handle::try_current() else {
+            self.prober_running.store(false, Ordering::Release);
+            return;
+        };
+        let endpoints = self.this.clone();
+        let interval = self.probe_interval;
+        handle.spawn(async move {
+            loop {
+                tokio::time::sleep(interval).await;
+                let Some(endpoints) = endpoints.upgrade() else {
+                    return;
+                };
+                if let Err(e) = endpoints.probe(true).await {
+                    debug!("Endpoint probe failed: {}", e);
+                }
+                if !endpoints.any_ejected() {
+                    endpoints.prober_running.store(false, Ordering::Release);
+                    // 清除标志后又有端点被摘除时由本任务继续探测
+                    if !endpoints.any_ejected() || endpoints.prober_running.swap(true, Ordering::AcqRel) {
+                        return;
+                    }
+                }
+            }
+        });
+    }
+}
+
+impl std::fmt::Debug for Endpoints {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_list().entries(self.list.iter().map(|endpoint| &endpoint.base_url)).finish()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn endpoints(replicas: usize) -> Arc<Endpoints> {
+        let config = ClientConfig {
+            server_url: "http://127.0.0.1:1".to_string(),
+            replica_urls: (0..replicas).map(|i| format!("http://127.0.0.1:{}", 2 + i)).collect(),
+            ..ClientConfig::default()
+        };
+        Endpoints::new(Client::new(), &config)
+    }
+
+    fn record_n(endpoints: &Endpoints, index: usize, ms: u64, n: usize) {
+        for _ in 0..n {
+            endpoints.record(index, Duration::from_millis(ms), Outcome::Success);
+        }
+    }
+
+    #[test]
+    fn test_latency_percentile() {
+        let mut window = LatencyWindow::new();
+        for ms in 1..MIN_SAMPLES as u64 {
+            window.record(Duration::from_millis(ms));
+        }
+        assert!(window.percentile(0.95).is_none());
+        for ms in MIN_SAMPLES as u64..=100 {
+            window.record(Duration::from_millis(ms));
+        }
+        // 窗口只保留最近 64 个样本：37..=100
+        assert_eq!(window.len, LATENCY_WINDOW);
+        assert_eq!(window.percentile(0.95), Some(Duration::from_millis(97)));
+        assert_eq!(window.percentile(0.0), Some(Duration::from_millis(37)));
+    }
+
+    #[test]
+    fn test_pick_prefers_fast_and_idle() {
+        let endpoints = endpoints(2);
+        record_n(&endpoints, 0, 10, 4);
+        record_n(&endpoints, 1, 5, 4);
+        record_n(&endpoints, 2, 8, 4);
+        assert_eq!(endpoints.pick(&[]), Some(1));
+        assert_eq!(endpoints.pick(&[1]), Some(2));
+
+        // 在途请求多的端点让位
+        let _busy = [endpoints.begin(1), endpoints.begin(1)];
+        assert_eq!(endpoints.pick(&[]), Some(2));
+        assert_eq!(endpoints.pick(&[0, 1, 2]), None);
+    }
+
+    #[test]
+    fn test_pick_sends_single_probe_to_unsampled() {
+        let endpoints = endpoints(2);
+        record_n(&endpoints, 0, 10, 4);
+        record_n(&endpoints, 1, 5, 4);
+
+        // 无样本端点只放行一个试探请求，其余请求仍按延迟分配
+        assert_eq!(endpoints.pick(&[]), Some(2));
+        let probe = endpoints.begin(2);
+        assert_eq!(endpoints.pick(&[]), Some(1));
+        let _busy = [endpoints.begin(1), endpoints.begin(1)];
+        assert_eq!(endpoints.pick(&[]), Some(0));
+        assert_eq!(endpoints.pick(&[0, 1]), Some(2));
+        drop(probe);
+
+        // 试探返回后按实际延迟参与选择
+        assert_eq!(endpoints.list[2].state().latency.len, 1);
+        assert_eq!(endpoints.pick(&[]), Some(2));
+
+        // 全部无样本（刚启动）时按在途数分摊
+        let fresh = self::endpoints(1);
+        let _first = fresh.begin(fresh.pick(&[]).unwrap());
+        assert_eq!(fresh.pick(&[]), Some(1));
+        let _second = fresh.begin(1);
+        assert!(fresh.pick(&[]).is_some());
+    }
+
+    #[test]
+    fn test_eject_on_failures_and_slowness() {
+        let endpoints = endpoints(2);
+        for _ in 0..3 {
+            endpoints.record(0, Duration::ZERO, Outcome::Failure);
+        }
+        assert!(endpoints.list[0].state().ejected_at.is_some());
+        assert_ne!(endpoints.pick(&[]), Some(0));
+
+        record_n(&endpoints, 1, 5, MIN_SAMPLES);
+        record_n(&endpoints, 2, 100, MIN_SAMPLES);
+        assert!(endpoints.list[2].state().ejected_at.is_some());
+        assert_eq!(endpoints.pick(&[]), Some(1));
+        assert!(endpoints.hedge_delay(1).is_none());
+
+        // 全部摘除时仍选出最早被摘除的端点
+        for _ in 0..3 {
+            endpoints.record(1, Duration::ZERO, Outcome::Failure);
+        }
+        assert_eq!(endpoints.pick(&[]), Some(0));
+
+        endpoints.readmit(2);
+        assert!(endpoints.list[2].state().ejected_at.is_none());
+        assert_eq!(endpoints.list[2].state().latency.len, 0);
+    }
+
+    #[test]
+    fn test_hedge_delay() {
+        let endpoints = endpoints(1);
+        assert_eq!(endpoints.hedge_delay(0), Some(DEFAULT_HEDGE_DELAY));
+        record_n(&endpoints, 0, 30, MIN_SAMPLES);
+        assert_eq!(endpoints.hedge_delay(0), Some(Duration::from_millis(30)));
+        record_n(&endpoints, 1, 1, MIN_SAMPLES);
+        assert_eq!(endpoints.hedge_delay(1), Some(Duration::from_millis(ClientConfig::default().hedge_min_delay_ms)));
+
+        // 单端点不对冲
+        assert!(self::endpoints(0).hedge_delay(0).is_none());
+    }
+}
@@ -0,0 +1,278 @@
+//! 流水线签名引擎
+//!
+//! `CoSignClient::sign` 一次只处理一条消息，调用方逐条 `await` 时本地计算与网络
+//! 往返完全串行。`SigningEngine` 在客户端之上提供：
+//! - 有界提交队列：队列满时 `submit` 等待（背压），`try_submit` 立即返回 `Error::QueueFull`
+//! - 在途请求上限：最多 `max_in_flight` 个签名同时等待服务端响应
+//! - 完成通知：`SignTicket`（Future）或回调
+//!
+//! 每个签名在独立任务中完成哈希、取随机数、请求服务端和补全签名，
+//! 本地计算与其他在途请求的网络等待相互重叠。会话和密钥对以 `Arc` 共享，不按请求复制。
+
+use crate::client::CoSignClient;
+use crate::error::{Error, Result};
+use crate::types::Signature;
+use std::future::Future;
+use std::pin::Pin;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Arc;
+use std::task::{Context, Poll};
+use tokio::sync::{mpsc, oneshot, Semaphore};
+use tokio::task::JoinHandle;
+use tracing::debug;
+
+/// 签名引擎配置
+#[derive(Debug, Clone)]
+pub struct EngineConfig {
+    /// 提交队列容量（尚未开始处理的消息数上限）
+    pub queue_depth: usize,
+    /// 同时在途的签名请求上限
+    pub max_in_flight: usize,
+}
+
+impl Default for EngineConfig {
+    fn default() -> Self {
+        Self {
+            queue_depth: 256,
+            max_in_flight: 32,
+        }
+    }
+}
+
+/// 签名完成回调
+pub type SignCallback = Box<dyn FnOnce(Result<Signature>) + Send + 'static>;
+
+enum Reply {
+    Ticket(oneshot::Sender<Result<Signature>>),
+    Callback(SignCallback),
+}
+
+impl Reply {
+    fn send(self, result: Result<Signature>) {
+        match self {
+            // 调用方已丢弃 SignTicket 时结果直接丢弃
+            Reply::Ticket(tx) => {
+                let _ = tx.send(result);
+            }
+            Reply::Callback(callback) => callback(result),
+        }
+    }
+}
+
+struct Job {
+    message: Vec<u8>,
+    reply: Reply,
+}
+
+/// 一次提交的签名结果
+#[derive(Debug)]
+pub struct SignTicket {
+    rx: oneshot::Receiver<Result<Signature>>,
+}
+
+impl Future for SignTicket {
+    type Output = Result<Signature>;
+
+    fn poll(mut self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        Pin::new(&mut self.rx)
+            .poll(cx)
+            .map(|r| r.unwrap_or_else(|_| Err(Error::InvalidState("Signing task dropped".to_string()))))
+    }
+}
+
+/// 流水线签名引擎
+pub struct SigningEngine {
+    tx: mpsc::Sender<Job>,
+    /// 已出队、尚未完成的签名数
+    in_flight: Arc<AtomicUsize>,
+    config: EngineConfig,
+    dispatcher: JoinHandle<()>,
+}
+
+impl SigningEngine {
+    /// 在当前 tokio 运行时上启动引擎
+    pub fn new(client: Arc<CoSignClient>, config: EngineConfig) -> Self {
+        let config = EngineConfig {
+            queue_depth: config.queue_depth.max(1),
+            max_in_flight: config.max_in_flight.max(1),
+        };
+        let (tx, rx) = mpsc::channel(config.queue_depth);
+        let in_flight = Arc::new(AtomicUsize::new(0));
+        let dispatcher = tokio::spawn(dispatch(client, rx, Arc::clone(&in_flight), config.max_in_flight));
+
+        Self {
+            tx,
+            in_flight,
+            config,
+            dispatcher,
+        }
+    }
+
+    /// 提交一条消息，队列满时等待
+    pub async fn submit(&self, message: impl Into<Vec<u8>>) -> Result<SignTicket> {
+        let (tx, rx) = oneshot::channel();
+        self.enqueue(message.into(), Reply::Ticket(tx)).await?;
+        Ok(SignTicket { rx })
+    }
+
+    /// 提交一条消息，队列满时立即返回 `Error::QueueFull`
+    pub fn try_submit(&self, message: impl Into<Vec<u8>>) -> Result<SignTicket> {
+        let (tx, rx) = oneshot::channel();
+        let job = Job {
+            message: message.into(),
+            reply: Reply::Ticket(tx),
+        };
+        self.tx.try_send(job).map_err(|e| match e {
+            mpsc::error::TrySendError::Full(_) => Error::QueueFull,
+            mpsc::error::TrySendError::Closed(_) => engine_closed(),
+        })?;
+        Ok(SignTicket { rx })
+    }
+
+    /// 提交一条消息，完成后在工作任务中调用 `callback`；队列满时等待
+    pub async fn submit_with_callback<F>(&self, message: impl Into<Vec<u8>>, callback: F) -> Result<()>
+    where
+        F: FnOnce(Result<Signature>) + Send + 'static,
+    {
+        self.enqueue(message.into(), Reply::Callback(Box::new(callback))).await
+    }
+
+    async fn enqueue(&self, message: Vec<u8>, reply: Reply) -> Result<()> {
+        self.tx
+            .send(Job { message, reply })
+            .await
+            .map_err(|_| engine_closed())
+    }
+
+    /// 队列中尚未开始处理的消息数
+    pub fn queued(&self) -> usize {
+        self.config.queue_depth - self.tx.capacity()
+    }
+
+    /// 正在处理的签名数
+    pub fn in_flight(&self) -> usize {
+        self.in_flight.load(Ordering::Acquire)
+    }
+
+    /// 引擎配置
+    pub fn config(&self) -> &EngineConfig {
+        &self.config
+    }
+
+    /// 停止接收新消息，等待已提交的消息全部完成
+    pub async fn shutdown(self) {
+        drop(self.tx);
+        // 调度任务只会因运行时关闭而取消，此时无需再等待
+        let _ = self.dispatcher.await;
+    }
+}
+
+impl std::fmt::Debug for SigningEngine {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("SigningEngine")
+            .field("config", &self.config)
+            .field("queued", &self.queued())
+            .field("in_flight", &self.in_flight())
+            .finish()
+    }
+}
+
+fn engine_closed() -> Error {
+    Error::InvalidState("Signing engine is shut down".to_string())
+}
+
+/// 调度循环：按在途上限逐个取出消息并派发到独立任务
+async fn dispatch(client: Arc<CoSignClient>, mut rx: mpsc::Receiver<Job>, in_flight: Arc<AtomicUsize>, max_in_flight: usize) {
+    let permits = Arc::new(Semaphore::new(max_in_flight));
+    loop {
+        // Reason: 先拿许可再出队下一条，在途已满时消息留在有界队列中，对提交方形成背压，
+        // 队列之外不会再多压一条，`try_submit` 恰在 queue_depth 条排队时返回 QueueFull
+        let permit = match Arc::clone(&permits).acquire_owned().await {
+            Ok(permit) => permit,
+            Err(_) => break,
+        };
+        let Some(job) = rx.recv().await else {
+            break;
+        };
+        in_flight.fetch_add(1, Ordering::AcqRel);
+        let client = Arc::clone(&client);
+        let in_flight = Arc::clone(&in_flight);
+        tokio::spawn(async move {
+            let result = client.sign(&job.message).await;
+            // 先通知再归还许可：shutdown 返回时所有回调都已执行
+            job.reply.send(result);
+            in_flight.fetch_sub(1, Ordering::AcqRel);
+            drop(permit);
+        });
+    }
+
+    // 队列已关闭：等待所有在途签名完成
+    let _ = permits.acquire_many(max_in_flight as u32).await;
+    debug!("Signing engine drained");
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn engine(queue_depth: usize, max_in_flight: usize) -> SigningEngine {
+        let client = Arc::new(CoSignClient::with_server_url("http://localhost:8080").unwrap());
+        SigningEngine::new(
+            client,
+            EngineConfig {
+                queue_depth,
+                max_in_flight,
+            },
+        )
+    }
+
+    #[tokio::test]
+    async fn test_submit_requires_session() {
+        let engine = engine(4, 2);
+        let tickets: Vec<SignTicket> = submit_many(&engine, 6).await;
+        for ticket in tickets {
+            assert!(matches!(ticket.await, Err(Error::NotAuthenticated)));
+        }
+        engine.shutdown().await;
+    }
+
+    async fn submit_many(engine: &SigningEngine, count: usize) -> Vec<SignTicket> {
+        let mut tickets = Vec::with_capacity(count);
+        for i in 0..count {
+            tickets.push(engine.submit(vec![i as u8; 16]).await.unwrap());
+        }
+        tickets
+    }
+
+    #[tokio::test]
+    async fn test_callback_and_shutdown_drains() {
+        let engine = engine(2, 1);
+        // 调度任务空闲时持有的许可不计入在途
+        tokio::task::yield_now().await;
+        assert_eq!(engine.in_flight(), 0);
+        let done = Arc::new(AtomicUsize::new(0));
+        for _ in 0..5 {
+            let done = Arc::clone(&done);
+            engine
+                .submit_with_callback(b"message".to_vec(), move |result| {
+                    assert!(result.is_err());
+                    done.fetch_add(1, Ordering::SeqCst);
+                })
+                .await
+                .unwrap();
+        }
+        engine.shutdown().await;
+        assert_eq!(done.load(Ordering::SeqCst), 5);
+    }
+
+    #[tokio::test(flavor = "current_thread")]
+    async fn test_try_submit_reports_full_queue() {
+        let engine = engine(1, 1);
+        // 单线程运行时中调度任务尚未运行，队列容量 1 即满
+        let first = engine.try_submit(b"a".to_vec()).unwrap();
+        assert!(matches!(engine.try_submit(b"b".to_vec()), Err(Error::QueueFull)));
+        assert_eq!(engine.queued(), 1);
+        assert!(first.await.is_err());
+        engine.shutdown().await;
+    }
+}
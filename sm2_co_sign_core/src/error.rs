@@ -33,10 +33,34 @@ pub enum Error {
     #[error("Not authenticated")]
     NotAuthenticated,
 
+    /// 提交队列已满
+    #[error("Queue is full")]
+    QueueFull,
+
     /// IO 错误
     #[error("IO error: {0}")]
     Io(#[from] std::io::Error),
 }
 
+impl Clone for Error {
+    fn clone(&self) -> Self {
+        match self {
+            Error::Crypto(msg) => Error::Crypto(msg.clone()),
+            Error::Network(msg) => Error::Network(msg.clone()),
+            Error::Api { code, message } => Error::Api {
+                code: *code,
+                message: message.clone(),
+            },
+            Error::InvalidParam(msg) => Error::InvalidParam(msg.clone()),
+            Error::InvalidState(msg) => Error::InvalidState(msg.clone()),
+            Error::Encoding(msg) => Error::Encoding(msg.clone()),
+            Error::NotAuthenticated => Error::NotAuthenticated,
+            Error::QueueFull => Error::QueueFull,
+            // Reason: std::io::Error 不可克隆，保留错误类别和描述
+            Error::Io(e) => Error::Io(std::io::Error::new(e.kind(), e.to_string())),
+        }
+    }
+}
+
 /// 结果类型
 pub type Result<T> = std::result::Result<T, Error>;
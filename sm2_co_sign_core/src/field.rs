@@ -0,0 +1,327 @@
+//! 定长 256 位模 p 运算（SM2 素域）
+//!
+//! 与 `scalar` 模块相同，用 4 个 64 位字（小端序）保存 Montgomery 形式 `a·R mod p`，
+//! 乘法用 CIOS 约减，全程不分配内存，也没有依赖数据的分支或查表。
+//!
+//! SM2 素数 p ≡ -1 (mod 2^64)，约减常数 -p⁻¹ mod 2^64 = 1，每轮约减的乘数就是当前最低字。
+//!
+//! 以 `-C target-feature=+bmi2,+adx`（或 `-C target-cpu=native`）编译到 x86_64 时，
+//! 乘加改用 MULX/ADCX/ADOX 指令：MULX 不影响标志位，两条进位链可以交错执行。
+
+use std::ops::{Add, Mul, Neg, Sub};
+use zeroize::Zeroize;
+
+/// SM2 素数 p（小端序 64 位字）
+const P: [u64; 4] = [0xffff_ffff_ffff_ffff, 0xffff_ffff_0000_0000, 0xffff_ffff_ffff_ffff, 0xffff_fffe_ffff_ffff];
+
+/// R mod p，即 Montgomery 形式的 1
+const R: [u64; 4] = [0x0000_0000_0000_0001, 0x0000_0000_ffff_ffff, 0x0000_0000_0000_0000, 0x0000_0001_0000_0000];
+
+/// R² mod p，用于转入 Montgomery 形式
+const R2: [u64; 4] = [0x0000_0002_0000_0003, 0x0000_0002_ffff_ffff, 0x0000_0001_0000_0001, 0x0000_0004_0000_0002];
+
+/// 曲线参数 b 的 Montgomery 形式
+const B: [u64; 4] = [0x90d2_3063_2bc0_dd42, 0x71cf_379a_e9b5_37ab, 0x5279_8150_5ea5_1c3c, 0x240f_e188_ba20_e2c8];
+
+/// 模 p 域元素（内部为 Montgomery 形式）
+#[derive(Clone, Copy, PartialEq, Eq)]
+pub struct FieldElement([u64; 4]);
+
+impl FieldElement {
+    /// 0
+    pub const ZERO: FieldElement = FieldElement([0; 4]);
+
+    /// 1
+    pub const ONE: FieldElement = FieldElement(R);
+
+    /// 曲线参数 b
+    pub const B: FieldElement = FieldElement(B);
+
+    /// 从 32 字节大端数组解析，值不小于 p 时返回 None
+    pub fn from_canonical(bytes: &[u8; 32]) -> Option<Self> {
+        let limbs = load_be(bytes);
+        let (_, borrow) = sub_limbs(&limbs, &P);
+        if borrow == 0 {
+            return None;
+        }
+        Some(FieldElement(mont_mul(&limbs, &R2)))
+    }
+
+    /// 输出 32 字节大端表示
+    pub fn to_bytes_be(&self) -> [u8; 32] {
+        let limbs = mont_mul(&self.0, &[1, 0, 0, 0]);
+        let mut out = [0u8; 32];
+        for (i, limb) in limbs.iter().enumerate() {
+            let start = 32 - (i + 1) * 8;
+            out[start..start + 8].copy_from_slice(&limb.to_be_bytes());
+        }
+        out
+    }
+
+    /// 是否为 0（无分支）
+    pub fn is_zero(&self) -> bool {
+        self.0.iter().fold(0, |acc, limb| acc | limb) == 0
+    }
+
+    /// 平方
+    pub fn square(&self) -> Self {
+        FieldElement(mont_mul(&self.0, &self.0))
+    }
+
+    /// 2a
+    pub fn double(&self) -> Self {
+        *self + *self
+    }
+
+    /// 模逆 a⁻¹ = a^(p-2)，固定的平方-乘序列；a = 0 时结果为 0
+    pub fn invert(&self) -> Self {
+        // p - 2 的小端序 64 位字
+        const EXP: [u64; 4] = [P[0] - 2, P[1], P[2], P[3]];
+        let mut result = FieldElement::ONE;
+        for limb in EXP.iter().rev() {
+            for bit in (0..64).rev() {
+                result = result.square();
+                if (limb >> bit) & 1 == 1 {
+                    result = result * *self;
+                }
+            }
+        }
+        result
+    }
+
+    /// 按条件选择：`choice` 为全 1 掩码时返回 b，为 0 时返回 a
+    pub fn select(a: &Self, b: &Self, choice: u64) -> Self {
+        let mut out = [0u64; 4];
+        for i in 0..4 {
+            out[i] = (a.0[i] & !choice) | (b.0[i] & choice);
+        }
+        FieldElement(out)
+    }
+}
+
+impl Add for FieldElement {
+    type Output = FieldElement;
+
+    fn add(self, rhs: FieldElement) -> FieldElement {
+        let (sum, carry) = add_limbs(&self.0, &rhs.0);
+        let (reduced, borrow) = sub_limbs(&sum, &P);
+        // 有进位（和 ≥ 2^256 > p）或未借位（和 ≥ p）时取约减结果
+        FieldElement(select(carry | (borrow ^ 1), &reduced, &sum))
+    }
+}
+
+impl Sub for FieldElement {
+    type Output = FieldElement;
+
+    fn sub(self, rhs: FieldElement) -> FieldElement {
+        let (diff, borrow) = sub_limbs(&self.0, &rhs.0);
+        let (wrapped, _) = add_limbs(&diff, &P);
+        FieldElement(select(borrow, &wrapped, &diff))
+    }
+}
+
+impl Neg for FieldElement {
+    type Output = FieldElement;
+
+    fn neg(self) -> FieldElement {
+        FieldElement::ZERO - self
+    }
+}
+
+impl Mul for FieldElement {
+    type Output = FieldElement;
+
+    fn mul(self, rhs: FieldElement) -> FieldElement {
+        FieldElement(mont_mul(&self.0, &rhs.0))
+    }
+}
+
+impl Zeroize for FieldElement {
+    fn zeroize(&mut self) {
+        self.0.zeroize();
+    }
+}
+
+impl std::fmt::Debug for FieldElement {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        // Reason: 共享点坐标等中间值同样敏感，调试输出中不打印具体值
+        f.write_str("FieldElement(..)")
+    }
+}
+
+fn load_be(bytes: &[u8; 32]) -> [u64; 4] {
+    let mut limbs = [0u64; 4];
+    for (i, limb) in limbs.iter_mut().enumerate() {
+        let start = 32 - (i + 1) * 8;
+        *limb = u64::from_be_bytes(bytes[start..start + 8].try_into().unwrap());
+    }
+    limbs
+}
+
+fn add_limbs(a: &[u64; 4], b: &[u64; 4]) -> ([u64; 4], u64) {
+    let mut out = [0u64; 4];
+    let mut carry = 0u64;
+    for i in 0..4 {
+        let t = a[i] as u128 + b[i] as u128 + carry as u128;
+        out[i] = t as u64;
+        carry = (t >> 64) as u64;
+    }
+    (out, carry)
+}
+
+fn sub_limbs(a: &[u64; 4], b: &[u64; 4]) -> ([u64; 4], u64) {
+    let mut out = [0u64; 4];
+    let mut borrow = 0u64;
+    for i in 0..4 {
+        let t = (a[i] as u128).wrapping_sub(b[i] as u128 + borrow as u128);
+        out[i] = t as u64;
+        borrow = ((t >> 64) as u64) & 1;
+    }
+    (out, borrow)
+}
+
+/// 按条件选择：`choose_a` 为 1 时返回 a，为 0 时返回 b（掩码实现，无分支）
+fn select(choose_a: u64, a: &[u64; 4], b: &[u64; 4]) -> [u64; 4] {
+    let mask = choose_a.wrapping_neg();
+    let mut out = [0u64; 4];
+    for i in 0..4 {
+        out[i] = (a[i] & mask) | (b[i] & !mask);
+    }
+    out
+}
+
+/// Montgomery 乘法（CIOS）：返回 a·b·R⁻¹ mod p
+fn mont_mul(a: &[u64; 4], b: &[u64; 4]) -> [u64; 4] {
+    let mut t = [0u64; 6];
+    for &b_i in b {
+        // t += a · b[i]
+        mul_add_row(&mut t, a, b_i);
+        // t = (t + m·p) / 2^64，-p⁻¹ ≡ 1 (mod 2^64)，m 取最低字即可使其归零
+        let m = t[0];
+        mul_add_row(&mut t, &P, m);
+        t = [t[1], t[2], t[3], t[4], t[5], 0];
+    }
+
+    // 结果 < 2p，最多再减一次 p
+    let value = [t[0], t[1], t[2], t[3]];
+    let (reduced, borrow) = sub_limbs(&value, &P);
+    select(t[4] | (borrow ^ 1), &reduced, &value)
+}
+
+/// t += a · b（t 的高位字留有足够余量，不会溢出）
+#[cfg(not(all(target_arch = "x86_64", target_feature = "bmi2", target_feature = "adx")))]
+#[inline(always)]
+fn mul_add_row(t: &mut [u64; 6], a: &[u64; 4], b: u64) {
+    let mut carry = 0u64;
+    for j in 0..4 {
+        let uv = t[j] as u128 + a[j] as u128 * b as u128 + carry as u128;
+        t[j] = uv as u64;
+        carry = (uv >> 64) as u64;
+    }
+    let uv = t[4] as u128 + carry as u128;
+    t[4] = uv as u64;
+    t[5] += (uv >> 64) as u64;
+}
+
+/// t += a · b，MULX 求四个部分积，低半部分与高半部分分别走 CF / OF 两条进位链
+#[cfg(all(target_arch = "x86_64", target_feature = "bmi2", target_feature = "adx"))]
+#[inline(always)]
+fn mul_add_row(t: &mut [u64; 6], a: &[u64; 4], b: u64) {
+    use std::arch::x86_64::{_addcarryx_u64, _mulx_u64};
+
+    let mut lo = [0u64; 4];
+    let mut hi = [0u64; 4];
+    // SAFETY: 仅在编译目标启用了 bmi2 与 adx 时编译此实现
+    unsafe {
+        for j in 0..4 {
+            lo[j] = _mulx_u64(a[j], b, &mut hi[j]);
+        }
+        let mut cf = 0u8;
+        for j in 0..4 {
+            cf = _addcarryx_u64(cf, t[j], lo[j], &mut t[j]);
+        }
+        cf = _addcarryx_u64(cf, t[4], 0, &mut t[4]);
+        t[5] += cf as u64;
+        let mut of = 0u8;
+        for j in 0..4 {
+            of = _addcarryx_u64(of, t[j + 1], hi[j], &mut t[j + 1]);
+        }
+        t[5] += of as u64;
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn fe(hex_str: &str) -> FieldElement {
+        let bytes: [u8; 32] = hex::decode(hex_str).unwrap().try_into().unwrap();
+        FieldElement::from_canonical(&bytes).unwrap()
+    }
+
+    fn p_bytes() -> [u8; 32] {
+        let mut out = [0u8; 32];
+        for (i, limb) in P.iter().enumerate() {
+            out[32 - (i + 1) * 8..32 - i * 8].copy_from_slice(&limb.to_be_bytes());
+        }
+        out
+    }
+
+    #[test]
+    fn test_constants() {
+        // -p⁻¹ ≡ 1 (mod 2^64) 等价于 p 的最低字为 2^64 - 1
+        assert_eq!(P[0], u64::MAX);
+        assert_eq!(FieldElement::ONE.to_bytes_be()[31], 1);
+        let mut one = [0u8; 32];
+        one[31] = 1;
+        assert_eq!(FieldElement::from_canonical(&one), Some(FieldElement::ONE));
+        assert_eq!(
+            hex::encode(FieldElement::B.to_bytes_be()),
+            "28e9fa9e9d9f5e344d5a9e4bcf6509a7f39789f515ab8f92ddbcbd414d940e93"
+        );
+    }
+
+    #[test]
+    fn test_canonical_encoding() {
+        let hex_str = "3945208f7b2144b13f36e38ac6d39f95889393692860b51a42fb81ef4df7c5b8";
+        assert_eq!(hex::encode(fe(hex_str).to_bytes_be()), hex_str);
+        assert!(FieldElement::from_canonical(&p_bytes()).is_none());
+        assert!(FieldElement::from_canonical(&[0xff; 32]).is_none());
+        let mut p_minus_1 = p_bytes();
+        p_minus_1[31] -= 1;
+        assert_eq!(FieldElement::from_canonical(&p_minus_1), Some(-FieldElement::ONE));
+    }
+
+    #[test]
+    fn test_arithmetic() {
+        let a = fe("3945208f7b2144b13f36e38ac6d39f95889393692860b51a42fb81ef4df7c5b8");
+        let b = fe("fffffffeffffffffffffffffffffffffffffffff00000000fffffffffffffffe");
+
+        // b = p - 1 ≡ -1
+        assert_eq!(b, -FieldElement::ONE);
+        assert_eq!(a + b, a - FieldElement::ONE);
+        assert_eq!(a * b, -a);
+        assert_eq!(b * b, FieldElement::ONE);
+        assert_eq!(a - a, FieldElement::ZERO);
+        assert_eq!(a.double(), a + a);
+
+        // a² 与 a⁻¹ mod p 的参考值
+        assert_eq!(
+            hex::encode(a.square().to_bytes_be()),
+            "7d59fb1e891dbb73fb1f0ebcf3eaa75e9d268063abfd4a076f20a62f79f78e74"
+        );
+        assert_eq!(
+            hex::encode(a.invert().to_bytes_be()),
+            "58976fedc2c1cf901f57e188e7a4327c6f06b93d0b0b915e43fd09f69d11ea4e"
+        );
+        assert_eq!(a * a.invert(), FieldElement::ONE);
+        assert!(FieldElement::ZERO.invert().is_zero());
+    }
+
+    #[test]
+    fn test_select() {
+        let a = fe("3945208f7b2144b13f36e38ac6d39f95889393692860b51a42fb81ef4df7c5b8");
+        assert_eq!(FieldElement::select(&a, &FieldElement::ONE, 0), a);
+        assert_eq!(FieldElement::select(&a, &FieldElement::ONE, u64::MAX), FieldElement::ONE);
+    }
+}
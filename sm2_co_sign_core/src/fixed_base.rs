@@ -0,0 +1,247 @@
+//! 固定基点预计算表
+//!
+//! 生成元 G 固定不变，可在创建协议实例时一次性预计算
+//! `table[i][j-1] = j · 2^(w·i) · G`（i = 0..⌈256/w⌉，j = 1..2^w），
+//! 之后 k·G 只需把 k 按 w 位切分成若干窗口、逐窗口查表相加，
+//! 共 ⌈256/w⌉ 次点加，完全省去倍点运算。
+//!
+//! 窗口宽度决定内存与速度的取舍：
+//! - w = 4：64 行 × 15 点，约 90 KB，64 次点加
+//! - w = 8：32 行 × 255 点，约 780 KB，32 次点加
+//!
+//! 注意：查表下标取决于标量的窗口值，与 libsm 通用点乘一样不是常数时间实现。
+
+use crate::error::{Error, Result};
+use libsm::sm2::ecc::{EccCtx, Point};
+use libsm::sm2::field::FieldElem;
+use num_bigint::BigUint;
+use std::sync::OnceLock;
+
+/// SM2 推荐曲线生成元 G 的 x 坐标
+pub(crate) const GX: [u8; 32] = [
+    0x32, 0xc4, 0xae, 0x2c, 0x1f, 0x19, 0x81, 0x19, 0x5f, 0x99, 0x04, 0x46, 0x6a, 0x39, 0xc9, 0x94,
+    0x8f, 0xe3, 0x0b, 0xbf, 0xf2, 0x66, 0x0b, 0xe1, 0x71, 0x5a, 0x45, 0x89, 0x33, 0x4c, 0x74, 0xc7,
+];
+
+/// SM2 推荐曲线生成元 G 的 y 坐标
+pub(crate) const GY: [u8; 32] = [
+    0xbc, 0x37, 0x36, 0xa2, 0xf4, 0xf6, 0x77, 0x9c, 0x59, 0xbd, 0xce, 0xe3, 0x6b, 0x69, 0x21, 0x53,
+    0xd0, 0xa9, 0x87, 0x7c, 0xc6, 0x2a, 0x47, 0x40, 0x02, 0xdf, 0x32, 0xe5, 0x21, 0x39, 0xf0, 0xa0,
+];
+
+/// 标量位数
+const SCALAR_BITS: usize = 256;
+
+/// 允许的最大窗口宽度（w = 8 时表约 780 KB）
+pub const MAX_WINDOW_BITS: u8 = 8;
+
+/// 进程内共享的 libsm 曲线上下文，首次使用时创建
+pub(crate) fn ecc_ctx() -> &'static EccCtx {
+    static ECC: OnceLock<EccCtx> = OnceLock::new();
+    ECC.get_or_init(EccCtx::new)
+}
+
+/// 固定基点乘法策略，在创建协议上下文时选择
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum FixedBase {
+    /// 使用 libsm 通用 g_mul，不占用额外内存
+    Generic,
+    /// 使用 w 位窗口预计算表（1 ≤ w ≤ 8）
+    Window(u8),
+}
+
+impl Default for FixedBase {
+    fn default() -> Self {
+        FixedBase::Window(4)
+    }
+}
+
+/// 生成元 G 的窗口预计算表
+pub struct FixedBaseTable {
+    window: usize,
+    /// 按行展开存储，第 i 行第 j-1 列为 j · 2^(w·i) · G
+    points: Vec<Point>,
+}
+
+impl FixedBaseTable {
+    /// 构建窗口宽度为 `window` 位的预计算表
+    pub fn new(ecc: &EccCtx, window: u8) -> Result<Self> {
+        check_window(window)?;
+        let window = window as usize;
+        let rows = (SCALAR_BITS + window - 1) / window;
+        let cols = (1usize << window) - 1;
+
+        let gx = FieldElem::from_bytes(&GX).map_err(|e| Error::Crypto(e.to_string()))?;
+        let gy = FieldElem::from_bytes(&GY).map_err(|e| Error::Crypto(e.to_string()))?;
+        let mut base = ecc.new_point(&gx, &gy).map_err(|e| Error::Crypto(e.to_string()))?;
+
+        let mut points = Vec::with_capacity(rows * cols);
+        for _ in 0..rows {
+            let row_start = points.len();
+            points.push(base.clone());
+            for j in 1..cols {
+                // Reason: 第二列是 2·base，用 double 避免依赖点加对相同点的特殊处理
+                let next = if j == 1 {
+                    ecc.double(&base)
+                } else {
+                    ecc.add(&points[row_start + j - 1], &base)
+                }
+                .map_err(|e| Error::Crypto(e.to_string()))?;
+                points.push(next);
+            }
+            // 下一行基点 2^w · base = (2^w - 1)·base + base
+            base = if cols == 1 {
+                ecc.double(&base)
+            } else {
+                ecc.add(&points[row_start + cols - 1], &base)
+            }
+            .map_err(|e| Error::Crypto(e.to_string()))?;
+        }
+
+        Ok(Self { window, points })
+    }
+
+    /// 进程内共享的 w 位窗口表，每种窗口宽度只在首次使用时构建一次
+    ///
+    /// 表只依赖生成元 G，所有协议实例可以共用，创建实例不再重复预计算。
+    pub fn shared(window: u8) -> Result<&'static Self> {
+        const EMPTY: OnceLock<FixedBaseTable> = OnceLock::new();
+        static TABLES: [OnceLock<FixedBaseTable>; MAX_WINDOW_BITS as usize] = [EMPTY; MAX_WINDOW_BITS as usize];
+
+        check_window(window)?;
+        let slot = &TABLES[window as usize - 1];
+        if let Some(table) = slot.get() {
+            return Ok(table);
+        }
+        // Reason: 并发首次调用可能各自构建一份，只有先写入的那份被保留，结果相同
+        let table = Self::new(ecc_ctx(), window)?;
+        Ok(slot.get_or_init(|| table))
+    }
+
+    /// 窗口宽度（位）
+    pub fn window_bits(&self) -> u8 {
+        self.window as u8
+    }
+
+    /// 预计算点的数量
+    pub fn len(&self) -> usize {
+        self.points.len()
+    }
+
+    /// 计算 k · G（k 需小于 n）
+    pub fn mul(&self, ecc: &EccCtx, k: &BigUint) -> Result<Point> {
+        let k_bytes = k.to_bytes_be();
+        if k_bytes.len() > 32 {
+            return Err(Error::InvalidParam("Scalar longer than 32 bytes".to_string()));
+        }
+        let mut scalar = [0u8; 32];
+        scalar[32 - k_bytes.len()..].copy_from_slice(&k_bytes);
+        self.mul_bytes(ecc, &scalar)
+    }
+
+    /// 计算 k · G，k 为 32 字节大端序标量（需小于 n）
+    pub fn mul_bytes(&self, ecc: &EccCtx, scalar: &[u8; 32]) -> Result<Point> {
+        let cols = (1usize << self.window) - 1;
+        let rows = self.points.len() / cols;
+        let mut acc: Option<Point> = None;
+        for row in 0..rows {
+            let digit = window_digit(scalar, row * self.window, self.window);
+            if digit == 0 {
+                continue;
+            }
+            let entry = &self.points[row * cols + digit - 1];
+            acc = Some(match acc {
+                None => entry.clone(),
+                Some(p) => ecc.add(&p, entry).map_err(|e| Error::Crypto(e.to_string()))?,
+            });
+        }
+
+        acc.ok_or_else(|| Error::InvalidParam("Scalar must not be zero".to_string()))
+    }
+}
+
+/// 校验窗口宽度在 1..=MAX_WINDOW_BITS 内
+pub(crate) fn check_window(window: u8) -> Result<()> {
+    if window == 0 || window > MAX_WINDOW_BITS {
+        return Err(Error::InvalidParam(format!(
+            "Fixed-base window must be in 1..={}, got {}",
+            MAX_WINDOW_BITS, window
+        )));
+    }
+    Ok(())
+}
+
+/// 取大端 32 字节标量中从第 `start` 位（最低位为 0）起的 `width` 位
+pub(crate) fn window_digit(scalar: &[u8; 32], start: usize, width: usize) -> usize {
+    let mut digit = 0usize;
+    for t in 0..width {
+        let bit = start + t;
+        if bit >= SCALAR_BITS {
+            break;
+        }
+        let byte = scalar[31 - bit / 8];
+        digit |= (((byte >> (bit % 8)) & 1) as usize) << t;
+    }
+    digit
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn affine_bytes(ecc: &EccCtx, p: &Point) -> Vec<u8> {
+        let (x, y) = ecc.to_affine(p).unwrap();
+        let mut out = x.to_bytes();
+        out.extend_from_slice(&y.to_bytes());
+        out
+    }
+
+    #[test]
+    fn test_window_digit() {
+        let mut scalar = [0u8; 32];
+        scalar[31] = 0b1011_0110;
+        scalar[30] = 0b0000_0001;
+        assert_eq!(window_digit(&scalar, 0, 4), 0b0110);
+        assert_eq!(window_digit(&scalar, 4, 4), 0b1011);
+        assert_eq!(window_digit(&scalar, 6, 3), 0b110);
+        assert_eq!(window_digit(&scalar, 252, 8), 0);
+    }
+
+    #[test]
+    fn test_table_matches_generic_g_mul() {
+        let ecc = EccCtx::new();
+        for window in [1u8, 4, 5] {
+            let table = FixedBaseTable::new(&ecc, window).unwrap();
+            for _ in 0..4 {
+                let k = ecc.random_uint();
+                let expected = ecc.g_mul(&k).unwrap();
+                let actual = table.mul(&ecc, &k).unwrap();
+                assert_eq!(affine_bytes(&ecc, &actual), affine_bytes(&ecc, &expected));
+            }
+        }
+    }
+
+    #[test]
+    fn test_invalid_window() {
+        let ecc = EccCtx::new();
+        assert!(FixedBaseTable::new(&ecc, 0).is_err());
+        assert!(FixedBaseTable::new(&ecc, MAX_WINDOW_BITS + 1).is_err());
+    }
+
+    #[test]
+    fn test_shared_table_built_once() {
+        let a = FixedBaseTable::shared(4).unwrap();
+        let b = FixedBaseTable::shared(4).unwrap();
+        assert!(std::ptr::eq(a, b));
+        assert_eq!(a.window_bits(), 4);
+        assert!(FixedBaseTable::shared(0).is_err());
+        assert!(FixedBaseTable::shared(MAX_WINDOW_BITS + 1).is_err());
+    }
+
+    #[test]
+    fn test_zero_scalar_rejected() {
+        let ecc = EccCtx::new();
+        let table = FixedBaseTable::new(&ecc, 4).unwrap();
+        assert!(table.mul(&ecc, &BigUint::from(0u32)).is_err());
+    }
+}
@@ -0,0 +1,195 @@
+//! SM2 密钥派生函数 KDF 的流式实现
+//!
+//! KDF(Z, klen) = SM3(Z || ct=1) || SM3(Z || ct=2) || …，截取前 klen 字节。
+//! Z 固定不变，先把 Z 吸收进 SM3 上下文，之后每个计数器分组都从这份中间状态
+//! 克隆继续。SM2 中 Z 为 64 字节的共享点坐标，恰好一个分组，每 32 字节密钥流
+//! 只需一次压缩。
+//!
+//! 密钥流按需生成并直接异或进调用方缓冲区，不分配与数据等长的密钥流。
+//! 各计数器分组互不依赖，每次最多 `LANES` 个分组交给多路 SM3 一起压缩；
+//! 大块数据可用 `apply_parallel` 按计数器偏移切分，在 rayon 线程池上并行生成。
+
+use crate::sm3::{Sm3, DIGEST_SIZE};
+use crate::sm3_multi::{MultiSm3, LANES};
+use rayon::prelude::*;
+use zeroize::Zeroize;
+
+/// `apply_parallel` 每个任务处理的字节数（分组长度的整数倍）
+pub const PARALLEL_CHUNK: usize = 256 * 1024;
+
+/// 流式 KDF 密钥流
+pub struct KdfStream {
+    /// 已吸收 Z 的 SM3 中间状态
+    base: Sm3,
+    engine: MultiSm3,
+    /// 下一个分组的计数器
+    counter: u32,
+    /// 当前分组的密钥流
+    block: [u8; DIGEST_SIZE],
+    /// 当前分组已消耗的字节数
+    used: usize,
+}
+
+impl KdfStream {
+    /// 以共享秘密 Z 初始化密钥流
+    pub fn new(z: &[u8]) -> Self {
+        let mut base = Sm3::new();
+        base.update(z);
+        Self {
+            base,
+            engine: MultiSm3::new(),
+            counter: 1,
+            block: [0u8; DIGEST_SIZE],
+            used: DIGEST_SIZE,
+        }
+    }
+
+    /// 从密钥流第 `offset` 字节处开始，等价于 `new(z)` 后先消耗 `offset` 字节
+    pub fn with_offset(z: &[u8], offset: usize) -> Self {
+        let mut stream = Self::new(z);
+        // Reason: 计数器按 GB/T 32918 为 32 位，截断与 next_blocks 的回绕一致
+        stream.counter = 1u32.wrapping_add((offset / DIGEST_SIZE) as u32);
+        let skip = offset % DIGEST_SIZE;
+        if skip != 0 {
+            let mut block = [[0u8; DIGEST_SIZE]; 1];
+            stream.next_blocks(&mut block);
+            stream.block = block[0];
+            stream.used = skip;
+            block.zeroize();
+        }
+        stream
+    }
+
+    /// 用后续密钥流原地异或 `data`，可多次调用，密钥流连续
+    pub fn apply(&mut self, data: &mut [u8]) {
+        let mut data = data;
+
+        // 先用完上一次剩下的分组
+        if self.used < DIGEST_SIZE {
+            let take = (DIGEST_SIZE - self.used).min(data.len());
+            xor_in_place(&mut data[..take], &self.block[self.used..self.used + take]);
+            self.used += take;
+            data = &mut data[take..];
+        }
+
+        let mut keys = [[0u8; DIGEST_SIZE]; LANES];
+        for group in data.chunks_mut(DIGEST_SIZE * LANES) {
+            let count = group.len().div_ceil(DIGEST_SIZE);
+            self.next_blocks(&mut keys[..count]);
+            for (chunk, key) in group.chunks_mut(DIGEST_SIZE).zip(&keys) {
+                xor_in_place(chunk, key);
+            }
+            // 只有最后一组可能不满一个分组，剩余密钥流留给下一次调用
+            let tail = group.len() % DIGEST_SIZE;
+            if tail != 0 {
+                self.block = keys[count - 1];
+                self.used = tail;
+            }
+        }
+        keys.zeroize();
+    }
+
+    /// 生成接下来 `out.len()` 个分组的密钥流
+    fn next_blocks(&mut self, out: &mut [[u8; DIGEST_SIZE]]) {
+        let counters: [[u8; 4]; LANES] =
+            std::array::from_fn(|i| self.counter.wrapping_add(i as u32).to_be_bytes());
+        let inputs: [&[u8]; LANES] = std::array::from_fn(|i| &counters[i][..]);
+        self.engine.finalize_into(&self.base, &inputs[..out.len()], out);
+        // Reason: 计数器按 GB/T 32918 为 32 位，klen 上限 (2^32-1)·32 字节，实际不会溢出
+        self.counter = self.counter.wrapping_add(out.len() as u32);
+    }
+}
+
+impl Drop for KdfStream {
+    fn drop(&mut self) {
+        self.block.zeroize();
+    }
+}
+
+/// 一次性计算 KDF(z, klen)
+pub fn kdf(z: &[u8], klen: usize) -> Vec<u8> {
+    let mut out = vec![0u8; klen];
+    KdfStream::new(z).apply(&mut out);
+    out
+}
+
+/// 用 KDF(z) 从第 `offset` 字节起的密钥流原地异或 `data`
+///
+/// 按 `PARALLEL_CHUNK` 切分，每块从自己的计数器偏移独立生成密钥流，在 rayon 线程池上并行；
+/// 结果与 `KdfStream::with_offset(z, offset).apply(data)` 相同。
+pub fn apply_parallel(z: &[u8], offset: usize, data: &mut [u8]) {
+    data.par_chunks_mut(PARALLEL_CHUNK).enumerate().for_each(|(i, chunk)| {
+        KdfStream::with_offset(z, offset + i * PARALLEL_CHUNK).apply(chunk);
+    });
+}
+
+fn xor_in_place(data: &mut [u8], key: &[u8]) {
+    for (b, k) in data.iter_mut().zip(key) {
+        *b ^= k;
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use gm_sdk::sm3::sm3_hash;
+
+    /// 按定义逐分组拼接计算的参考实现
+    fn reference_kdf(z: &[u8], klen: usize) -> Vec<u8> {
+        let mut out = Vec::new();
+        let mut ct = 1u32;
+        while out.len() < klen {
+            let mut input = z.to_vec();
+            input.extend_from_slice(&ct.to_be_bytes());
+            out.extend_from_slice(&sm3_hash(&input));
+            ct += 1;
+        }
+        out.truncate(klen);
+        out
+    }
+
+    #[test]
+    fn test_matches_reference() {
+        let z: Vec<u8> = (0..64u8).collect();
+        for klen in [0usize, 1, 31, 32, 33, 64, 100, 1000] {
+            assert_eq!(kdf(&z, klen), reference_kdf(&z, klen), "klen={}", klen);
+        }
+        // Z 不是整分组时同样成立
+        assert_eq!(kdf(&z[..20], 77), reference_kdf(&z[..20], 77));
+    }
+
+    #[test]
+    fn test_apply_in_pieces() {
+        let z = [0x5au8; 64];
+        let expected = reference_kdf(&z, 500);
+        for piece in [1usize, 13, 32, 45, 200] {
+            let mut data = vec![0u8; 500];
+            let mut stream = KdfStream::new(&z);
+            for chunk in data.chunks_mut(piece) {
+                stream.apply(chunk);
+            }
+            assert_eq!(data, expected, "piece={}", piece);
+        }
+    }
+
+    #[test]
+    fn test_with_offset() {
+        let z = [0x3cu8; 64];
+        let expected = reference_kdf(&z, 300);
+        for offset in [0usize, 1, 31, 32, 33, 100] {
+            let mut data = vec![0u8; 300 - offset];
+            KdfStream::with_offset(&z, offset).apply(&mut data);
+            assert_eq!(data, expected[offset..], "offset={}", offset);
+        }
+    }
+
+    #[test]
+    fn test_apply_parallel() {
+        let z = [0x77u8; 64];
+        let len = PARALLEL_CHUNK * 2 + 1000;
+        let expected = reference_kdf(&z, len + 5);
+        let mut data = vec![0u8; len];
+        apply_parallel(&z, 5, &mut data);
+        assert_eq!(data, expected[5..]);
+    }
+}
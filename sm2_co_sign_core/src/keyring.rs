@@ -0,0 +1,208 @@
+//! 多用户密钥环
+//!
+//! 网关代大量用户签名时，各用户的会话 token 与密钥材料（D1、d1⁻¹、Z 中间状态）
+//! 登记在同一个 `CoSignClient` 的密钥环中，所有用户共用一个连接池和运行时。
+//!
+//! 密钥环按 user_id 哈希分片，每片一把读写锁。查找只在片内持读锁并克隆两个 `Arc`，
+//! 不跨 await 持锁；不同分片互不影响，同一分片的并发查找也只共享读锁。
+
+use crate::error::{Error, Result};
+use crate::types::{KeyPair, Session};
+use std::collections::hash_map::RandomState;
+use std::collections::HashMap;
+use std::hash::BuildHasher;
+use std::sync::{Arc, PoisonError, RwLock};
+
+/// 密钥环中一个用户的会话与密钥
+#[derive(Debug, Clone)]
+pub struct KeyringEntry {
+    pub session: Arc<Session>,
+    pub key_pair: Arc<KeyPair>,
+}
+
+/// 按 user_id 分片的并发密钥环
+pub struct Keyring {
+    shards: Box<[RwLock<HashMap<String, KeyringEntry>>]>,
+    hasher: RandomState,
+}
+
+impl Keyring {
+    /// 默认分片数
+    pub const DEFAULT_SHARDS: usize = 64;
+
+    /// 使用默认分片数创建空密钥环
+    pub fn new() -> Self {
+        Self::with_shards(Self::DEFAULT_SHARDS)
+    }
+
+    /// 指定分片数创建空密钥环（向上取整到 2 的幂）
+    pub fn with_shards(shards: usize) -> Self {
+        let shards = shards.max(1).next_power_of_two();
+        Self {
+            shards: (0..shards).map(|_| RwLock::new(HashMap::new())).collect(),
+            hasher: RandomState::new(),
+        }
+    }
+
+    fn shard(&self, user_id: &str) -> &RwLock<HashMap<String, KeyringEntry>> {
+        let index = self.hasher.hash_one(user_id) as usize & (self.shards.len() - 1);
+        &self.shards[index]
+    }
+
+    /// 登记（或替换）一个用户，会话与密钥对必须属于同一用户
+    pub fn insert(&self, session: Session, key_pair: KeyPair) -> Result<()> {
+        if session.user_id != key_pair.user_id {
+            return Err(Error::InvalidParam(format!(
+                "Session user {} does not match key pair user {}",
+                session.user_id, key_pair.user_id
+            )));
+        }
+        let entry = KeyringEntry {
+            session: Arc::new(session),
+            key_pair: Arc::new(key_pair),
+        };
+        let user_id = entry.session.user_id.clone();
+        self.shard(&user_id)
+            .write()
+            .unwrap_or_else(PoisonError::into_inner)
+            .insert(user_id, entry);
+        Ok(())
+    }
+
+    /// 查找用户
+    pub fn get(&self, user_id: &str) -> Option<KeyringEntry> {
+        self.shard(user_id)
+            .read()
+            .unwrap_or_else(PoisonError::into_inner)
+            .get(user_id)
+            .cloned()
+    }
+
+    /// 替换已登记用户的会话（如刷新 token），用户不存在时返回 false
+    pub fn update_session(&self, session: Session) -> bool {
+        let mut shard = self.shard(&session.user_id).write().unwrap_or_else(PoisonError::into_inner);
+        match shard.get_mut(&session.user_id) {
+            Some(entry) => {
+                entry.session = Arc::new(session);
+                true
+            }
+            None => false,
+        }
+    }
+
+    /// 移除用户
+    pub fn remove(&self, user_id: &str) -> Option<KeyringEntry> {
+        self.shard(user_id)
+            .write()
+            .unwrap_or_else(PoisonError::into_inner)
+            .remove(user_id)
+    }
+
+    /// 已登记的用户数
+    pub fn len(&self) -> usize {
+        self.shards
+            .iter()
+            .map(|shard| shard.read().unwrap_or_else(PoisonError::into_inner).len())
+            .sum()
+    }
+
+    /// 是否为空
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+}
+
+impl Default for Keyring {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl std::fmt::Debug for Keyring {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        // 不输出会话与密钥内容
+        f.debug_struct("Keyring")
+            .field("shards", &self.shards.len())
+            .field("users", &self.len())
+            .finish()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::protocol::CoSignProtocol;
+    use crate::secure::SecretScalar;
+
+    fn entry(user_id: &str) -> (Session, KeyPair) {
+        let protocol = CoSignProtocol::new().unwrap();
+        let d1 = protocol.generate_d1().unwrap();
+        let public_key = protocol.calculate_p1(&d1).unwrap();
+        let session = Session {
+            token: format!("token-{}", user_id),
+            user_id: user_id.to_string(),
+            expires_at: String::new(),
+        };
+        let key_pair = KeyPair {
+            d1_inv: protocol.invert_d1_secret(&d1).unwrap(),
+            z_hasher: protocol.message_hasher(&public_key).unwrap(),
+            d1: SecretScalar::from_slice(&d1).unwrap(),
+            public_key,
+            user_id: user_id.to_string(),
+        };
+        (session, key_pair)
+    }
+
+    #[test]
+    fn test_insert_get_remove() {
+        let keyring = Keyring::with_shards(3);
+        assert_eq!(keyring.shards.len(), 4);
+        assert!(keyring.is_empty());
+
+        for i in 0..10 {
+            let (session, key_pair) = entry(&format!("user-{}", i));
+            keyring.insert(session, key_pair).unwrap();
+        }
+        assert_eq!(keyring.len(), 10);
+        assert_eq!(keyring.get("user-3").unwrap().session.token, "token-user-3");
+        assert!(keyring.get("user-10").is_none());
+
+        let (mut session, _) = entry("user-3");
+        session.token = "refreshed".to_string();
+        assert!(keyring.update_session(session));
+        assert_eq!(keyring.get("user-3").unwrap().session.token, "refreshed");
+
+        assert!(keyring.remove("user-3").is_some());
+        assert!(keyring.get("user-3").is_none());
+        assert_eq!(keyring.len(), 9);
+    }
+
+    #[test]
+    fn test_insert_rejects_mismatched_user() {
+        let keyring = Keyring::new();
+        let (session, _) = entry("alice");
+        let (_, key_pair) = entry("bob");
+        assert!(matches!(keyring.insert(session, key_pair), Err(Error::InvalidParam(_))));
+        assert!(keyring.is_empty());
+    }
+
+    #[test]
+    fn test_concurrent_lookup() {
+        let keyring = Keyring::new();
+        for i in 0..16 {
+            let (session, key_pair) = entry(&format!("user-{}", i));
+            keyring.insert(session, key_pair).unwrap();
+        }
+        std::thread::scope(|scope| {
+            for t in 0..4 {
+                let keyring = &keyring;
+                scope.spawn(move || {
+                    for i in 0..1000 {
+                        let user_id = format!("user-{}", (i + t) % 16);
+                        assert_eq!(keyring.get(&user_id).unwrap().key_pair.user_id, user_id);
+                    }
+                });
+            }
+        });
+    }
+}
@@ -5,12 +5,41 @@
 //! - 协同签名
 //! - 协同解密
 
+pub mod base64_codec;
 pub mod client;
+#[cfg(feature = "native-ecc")]
+pub mod curve;
+mod endpoints;
+pub mod engine;
 pub mod error;
+#[cfg(feature = "native-ecc")]
+pub mod field;
+pub mod fixed_base;
+pub mod kdf;
+pub mod keyring;
+pub mod metrics;
+pub mod nonce_pool;
+mod precommit;
 pub mod protocol;
+pub mod scalar;
+pub mod secure;
+pub mod session;
+pub mod sm3;
+pub mod sm3_multi;
 pub mod types;
+pub mod verify;
+pub mod wire;
 
 pub use client::{CoSignClient, ClientConfig};
+pub use engine::{EngineConfig, SignTicket, SigningEngine};
 pub use error::{Error, Result};
-pub use protocol::CoSignProtocol;
+pub use fixed_base::FixedBase;
+pub use keyring::{Keyring, KeyringEntry};
+pub use nonce_pool::{NoncePair, NoncePool, NoncePoolStats};
+pub use protocol::{CoSignProtocol, DecryptStream, SignShares, VerifyItem, DEFAULT_USER_ID};
+pub use scalar::Scalar;
+pub use secure::SecretScalar;
+pub use sm3::Sm3;
+pub use sm3_multi::MultiSm3;
 pub use types::*;
+pub use wire::WireFormat;
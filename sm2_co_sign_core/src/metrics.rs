@@ -0,0 +1,582 @@
+//! 热路径埋点：分阶段延迟直方图与计数器（`metrics` feature）
+//!
+//! 一次协同签名的耗时拆为哈希、随机数（sign_prepare）、请求序列化、网络往返（含读取响应体）、
+//! 响应解析、完成签名几个阶段，解密另有 T1 预处理与完成解密两个阶段。每个阶段记入一个
+//! HDR 风格的对数分桶直方图：每个 2 的幂区间再均分 32 个子桶，分位数相对误差不超过 1/32。
+//! 计数器记录线上字节数、重试与对冲请求次数，以及按 `Error` 变体统计的错误数。
+//!
+//! 指标记入进程内的全局注册表：`snapshot()` 读取快照，`MetricsSnapshot::to_prometheus` 导出为
+//! Prometheus 文本格式，`serve_prometheus` 提供最小的抓取端点；`set_recorder` 可另外把每个事件
+//! 转发给调用方自己的监控系统。
+//!
+//! 未开启 `metrics` feature 时，埋点函数都是空的内联函数，计时守卫是零大小类型，
+//! 不读时钟、不做原子操作，编译后不留痕迹。
+
+use crate::error::Result;
+#[cfg(feature = "metrics")]
+use crate::error::Error;
+#[cfg(feature = "metrics")]
+use std::sync::atomic::{AtomicU64, Ordering};
+#[cfg(feature = "metrics")]
+use std::sync::OnceLock;
+#[cfg(feature = "metrics")]
+use std::time::{Duration, Instant};
+
+/// 计时阶段
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub enum Phase {
+    /// 消息哈希 E = SM3(Z || M)
+    Hash,
+    /// 取签名随机数 (k1, Q1)：随机数池命中时接近 0
+    SignPrepare,
+    /// 请求体序列化（JSON 或二进制编码）
+    Serialize,
+    /// 发送请求到读完响应体
+    Network,
+    /// 响应解析与字段解码
+    Parse,
+    /// 用服务端分量完成签名
+    CompleteSignature,
+    /// 解密预处理 T1 = d1·C1
+    DecryptPrepare,
+    /// 完成解密（KDF 与 C3 校验）
+    CompleteDecryption,
+}
+
+impl Phase {
+    /// 全部阶段，顺序与快照一致
+    pub const ALL: [Phase; 8] = [
+        Phase::Hash,
+        Phase::SignPrepare,
+        Phase::Serialize,
+        Phase::Network,
+        Phase::Parse,
+        Phase::CompleteSignature,
+        Phase::DecryptPrepare,
+        Phase::CompleteDecryption,
+    ];
+
+    /// 指标标签名
+    pub fn name(self) -> &'static str {
+        match self {
+            Phase::Hash => "hash",
+            Phase::SignPrepare => "sign_prepare",
+            Phase::Serialize => "serialize",
+            Phase::Network => "network",
+            Phase::Parse => "parse",
+            Phase::CompleteSignature => "complete_signature",
+            Phase::DecryptPrepare => "decrypt_prepare",
+            Phase::CompleteDecryption => "complete_decryption",
+        }
+    }
+}
+
+/// 计数器
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub enum Counter {
+    /// 发出的请求体字节数
+    BytesSent,
+    /// 收到的响应体字节数
+    BytesReceived,
+    /// 重发次数（连接失败换副本、二进制编码被拒后改用 JSON）
+    Retries,
+    /// 对冲请求次数
+    Hedges,
+}
+
+impl Counter {
+    /// 全部计数器，顺序与快照一致
+    pub const ALL: [Counter; 4] = [Counter::BytesSent, Counter::BytesReceived, Counter::Retries, Counter::Hedges];
+}
+
+/// 阶段计时守卫，离开作用域时记录耗时（包括 `?` 提前返回）
+pub(crate) struct Span {
+    #[cfg(feature = "metrics")]
+    phase: Phase,
+    #[cfg(feature = "metrics")]
+    start: Instant,
+}
+
+/// 开始计时一个阶段
+#[inline(always)]
+pub(crate) fn span(phase: Phase) -> Span {
+    #[cfg(feature = "metrics")]
+    {
+        Span {
+            phase,
+            start: Instant::now(),
+        }
+    }
+    #[cfg(not(feature = "metrics"))]
+    {
+        let _ = phase;
+        Span {}
+    }
+}
+
+#[cfg(feature = "metrics")]
+impl Drop for Span {
+    fn drop(&mut self) {
+        record_phase(self.phase, self.start.elapsed());
+    }
+}
+
+/// 累加计数器
+#[inline(always)]
+pub(crate) fn count(counter: Counter, value: u64) {
+    #[cfg(feature = "metrics")]
+    {
+        REGISTRY.counters[counter as usize].fetch_add(value, Ordering::Relaxed);
+        if let Some(recorder) = RECORDER.get() {
+            recorder.add(counter, value);
+        }
+    }
+    #[cfg(not(feature = "metrics"))]
+    let _ = (counter, value);
+}
+
+/// 原样返回结果，失败时按错误变体计数
+#[inline(always)]
+pub(crate) fn track<T>(result: Result<T>) -> Result<T> {
+    #[cfg(feature = "metrics")]
+    if let Err(error) = &result {
+        let kind = ErrorKind::of(error);
+        REGISTRY.errors[kind as usize].fetch_add(1, Ordering::Relaxed);
+        if let Some(recorder) = RECORDER.get() {
+            recorder.record_error(kind);
+        }
+    }
+    result
+}
+
+#[cfg(feature = "metrics")]
+fn record_phase(phase: Phase, elapsed: Duration) {
+    REGISTRY.phases[phase as usize].record(u64::try_from(elapsed.as_nanos()).unwrap_or(u64::MAX));
+    if let Some(recorder) = RECORDER.get() {
+        recorder.record_phase(phase, elapsed);
+    }
+}
+
+/// 错误类别，对应 `Error` 的各个变体
+#[cfg(feature = "metrics")]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub enum ErrorKind {
+    Crypto,
+    Network,
+    Api,
+    InvalidParam,
+    InvalidState,
+    Encoding,
+    NotAuthenticated,
+    QueueFull,
+    Io,
+}
+
+#[cfg(feature = "metrics")]
+impl ErrorKind {
+    /// 全部类别，顺序与快照一致
+    pub const ALL: [ErrorKind; 9] = [
+        ErrorKind::Crypto,
+        ErrorKind::Network,
+        ErrorKind::Api,
+        ErrorKind::InvalidParam,
+        ErrorKind::InvalidState,
+        ErrorKind::Encoding,
+        ErrorKind::NotAuthenticated,
+        ErrorKind::QueueFull,
+        ErrorKind::Io,
+    ];
+
+    /// 错误所属类别
+    pub fn of(error: &Error) -> Self {
+        match error {
+            Error::Crypto(_) => ErrorKind::Crypto,
+            Error::Network(_) => ErrorKind::Network,
+            Error::Api { .. } => ErrorKind::Api,
+            Error::InvalidParam(_) => ErrorKind::InvalidParam,
+            Error::InvalidState(_) => ErrorKind::InvalidState,
+            Error::Encoding(_) => ErrorKind::Encoding,
+            Error::NotAuthenticated => ErrorKind::NotAuthenticated,
+            Error::QueueFull => ErrorKind::QueueFull,
+            Error::Io(_) => ErrorKind::Io,
+        }
+    }
+
+    /// 指标标签名
+    pub fn name(self) -> &'static str {
+        match self {
+            ErrorKind::Crypto => "crypto",
+            ErrorKind::Network => "network",
+            ErrorKind::Api => "api",
+            ErrorKind::InvalidParam => "invalid_param",
+            ErrorKind::InvalidState => "invalid_state",
+            ErrorKind::Encoding => "encoding",
+            ErrorKind::NotAuthenticated => "not_authenticated",
+            ErrorKind::QueueFull => "queue_full",
+            ErrorKind::Io => "io",
+        }
+    }
+}
+
+/// 指标事件接收方，用于把埋点接入调用方自己的监控系统
+///
+/// 回调在热路径上同步执行，实现应只做原子累加或无锁入队之类的轻量操作。
+#[cfg(feature = "metrics")]
+pub trait MetricsRecorder: Send + Sync {
+    /// 一个阶段结束
+    fn record_phase(&self, phase: Phase, elapsed: Duration) {
+        let _ = (phase, elapsed);
+    }
+
+    /// 计数器累加
+    fn add(&self, counter: Counter, value: u64) {
+        let _ = (counter, value);
+    }
+
+    /// 公开接口返回错误
+    fn record_error(&self, kind: ErrorKind) {
+        let _ = kind;
+    }
+}
+
+#[cfg(feature = "metrics")]
+static RECORDER: OnceLock<Box<dyn MetricsRecorder>> = OnceLock::new();
+
+/// 安装事件接收方（进程内只能安装一次），内置注册表照常记录
+#[cfg(feature = "metrics")]
+pub fn set_recorder(recorder: impl MetricsRecorder + 'static) -> Result<()> {
+    RECORDER
+        .set(Box::new(recorder))
+        .map_err(|_| Error::InvalidState("Metrics recorder already set".to_string()))
+}
+
+/// 每个 2 的幂区间的子桶数（2^5）
+#[cfg(feature = "metrics")]
+const SUB_BITS: u32 = 5;
+#[cfg(feature = "metrics")]
+const SUB_BUCKETS: usize = 1 << SUB_BITS;
+
+/// 可分辨的最大耗时 2^36 ns ≈ 68.7 s，更长的记入最后一个桶
+#[cfg(feature = "metrics")]
+const MAX_BITS: u32 = 36;
+#[cfg(feature = "metrics")]
+const BUCKETS: usize = SUB_BUCKETS * (MAX_BITS - SUB_BITS + 1) as usize;
+
+/// 纳秒值所在的桶：小于 32 的值每个值一个桶，之后每个 2 的幂区间 32 个桶
+#[cfg(feature = "metrics")]
+fn bucket_index(nanos: u64) -> usize {
+    let value = nanos.min((1 << MAX_BITS) - 1);
+    if value < SUB_BUCKETS as u64 {
+        return value as usize;
+    }
+    let shift = 63 - value.leading_zeros() - SUB_BITS;
+    SUB_BUCKETS * (shift as usize + 1) + ((value >> shift) as usize - SUB_BUCKETS)
+}
+
+/// 桶内最大值（与 HDR 直方图一样，分位数按桶上界报告）
+#[cfg(feature = "metrics")]
+fn bucket_upper(index: usize) -> u64 {
+    if index < SUB_BUCKETS {
+        return index as u64;
+    }
+    let shift = (index / SUB_BUCKETS - 1) as u32;
+    let sub = (index % SUB_BUCKETS + SUB_BUCKETS) as u64;
+    (sub << shift) + ((1 << shift) - 1)
+}
+
+#[cfg(feature = "metrics")]
+#[allow(clippy::declare_interior_mutable_const)]
+const ZERO: AtomicU64 = AtomicU64::new(0);
+
+/// 无锁直方图：记录一次为一次原子加
+#[cfg(feature = "metrics")]
+struct Histogram {
+    buckets: [AtomicU64; BUCKETS],
+    sum: AtomicU64,
+    max: AtomicU64,
+}
+
+#[cfg(feature = "metrics")]
+impl Histogram {
+    #[allow(clippy::declare_interior_mutable_const)]
+    const EMPTY: Histogram = Histogram {
+        buckets: [ZERO; BUCKETS],
+        sum: ZERO,
+        max: ZERO,
+    };
+
+    fn record(&self, nanos: u64) {
+        self.buckets[bucket_index(nanos)].fetch_add(1, Ordering::Relaxed);
+        self.sum.fetch_add(nanos, Ordering::Relaxed);
+        self.max.fetch_max(nanos, Ordering::Relaxed);
+    }
+
+    fn snapshot(&self, phase: Phase) -> PhaseStats {
+        let buckets: Vec<(u64, u64)> = self
+            .buckets
+            .iter()
+            .enumerate()
+            .filter_map(|(index, bucket)| match bucket.load(Ordering::Relaxed) {
+                0 => None,
+                n => Some((bucket_upper(index), n)),
+            })
+            .collect();
+        PhaseStats {
+            phase,
+            count: buckets.iter().map(|&(_, n)| n).sum(),
+            sum: Duration::from_nanos(self.sum.load(Ordering::Relaxed)),
+            max: Duration::from_nanos(self.max.load(Ordering::Relaxed)),
+            buckets,
+        }
+    }
+
+    fn reset(&self) {
+        for bucket in &self.buckets {
+            bucket.store(0, Ordering::Relaxed);
+        }
+        self.sum.store(0, Ordering::Relaxed);
+        self.max.store(0, Ordering::Relaxed);
+    }
+}
+
+#[cfg(feature = "metrics")]
+struct Registry {
+    phases: [Histogram; Phase::ALL.len()],
+    counters: [AtomicU64; Counter::ALL.len()],
+    errors: [AtomicU64; ErrorKind::ALL.len()],
+}
+
+#[cfg(feature = "metrics")]
+static REGISTRY: Registry = Registry {
+    phases: [Histogram::EMPTY; Phase::ALL.len()],
+    counters: [ZERO; Counter::ALL.len()],
+    errors: [ZERO; ErrorKind::ALL.len()],
+};
+
+/// 单个阶段的延迟统计
+#[cfg(feature = "metrics")]
+#[derive(Debug, Clone)]
+pub struct PhaseStats {
+    pub phase: Phase,
+    /// 样本数
+    pub count: u64,
+    /// 总耗时
+    pub sum: Duration,
+    /// 最大耗时
+    pub max: Duration,
+    /// 非空桶 (桶上界纳秒, 样本数)，按上界递增
+    buckets: Vec<(u64, u64)>,
+}
+
+#[cfg(feature = "metrics")]
+impl PhaseStats {
+    /// 分位数（q 取 0..=1），无样本时为 0
+    pub fn quantile(&self, q: f64) -> Duration {
+        let rank = ((q.clamp(0.0, 1.0) * self.count as f64).ceil() as u64).max(1);
+        let mut seen = 0;
+        for &(upper, n) in &self.buckets {
+            seen += n;
+            if seen >= rank {
+                // Reason: 桶上界可能超过实际最大值，报告值不超过 max
+                return Duration::from_nanos(upper).min(self.max);
+            }
+        }
+        Duration::ZERO
+    }
+}
+
+/// 指标快照
+#[cfg(feature = "metrics")]
+#[derive(Debug, Clone)]
+pub struct MetricsSnapshot {
+    /// 按 `Phase::ALL` 顺序排列
+    pub phases: Vec<PhaseStats>,
+    counters: [u64; Counter::ALL.len()],
+    errors: [u64; ErrorKind::ALL.len()],
+}
+
+#[cfg(feature = "metrics")]
+impl MetricsSnapshot {
+    /// 某阶段的统计
+    pub fn phase(&self, phase: Phase) -> &PhaseStats {
+        &self.phases[phase as usize]
+    }
+
+    /// 计数器当前值
+    pub fn counter(&self, counter: Counter) -> u64 {
+        self.counters[counter as usize]
+    }
+
+    /// 某类错误的次数
+    pub fn errors(&self, kind: ErrorKind) -> u64 {
+        self.errors[kind as usize]
+    }
+
+    /// 导出为 Prometheus 文本格式（0.0.4）
+    pub fn to_prometheus(&self) -> String {
+        use std::fmt::Write;
+
+        let mut out = String::with_capacity(4096);
+        out.push_str("# HELP sm2_cosign_phase_seconds Latency of co-sign client phases.\n");
+        out.push_str("# TYPE sm2_cosign_phase_seconds summary\n");
+        for stats in &self.phases {
+            let name = stats.phase.name();
+            for q in [0.5, 0.9, 0.99, 0.999] {
+                let _ = writeln!(
+                    out,
+                    "sm2_cosign_phase_seconds{{phase=\"{}\",quantile=\"{}\"}} {}",
+                    name,
+                    q,
+                    stats.quantile(q).as_secs_f64()
+                );
+            }
+            let _ = writeln!(out, "sm2_cosign_phase_seconds_sum{{phase=\"{}\"}} {}", name, stats.sum.as_secs_f64());
+            let _ = writeln!(out, "sm2_cosign_phase_seconds_count{{phase=\"{}\"}} {}", name, stats.count);
+        }
+
+        out.push_str("# HELP sm2_cosign_wire_bytes_total Request and response body bytes.\n");
+        out.push_str("# TYPE sm2_cosign_wire_bytes_total counter\n");
+        let _ = writeln!(out, "sm2_cosign_wire_bytes_total{{direction=\"sent\"}} {}", self.counter(Counter::BytesSent));
+        let _ = writeln!(
+            out,
+            "sm2_cosign_wire_bytes_total{{direction=\"received\"}} {}",
+            self.counter(Counter::BytesReceived)
+        );
+        out.push_str("# HELP sm2_cosign_retries_total Requests resent after failover or wire format fallback.\n");
+        out.push_str("# TYPE sm2_cosign_retries_total counter\n");
+        let _ = writeln!(out, "sm2_cosign_retries_total {}", self.counter(Counter::Retries));
+        out.push_str("# HELP sm2_cosign_hedged_requests_total Hedged sign requests.\n");
+        out.push_str("# TYPE sm2_cosign_hedged_requests_total counter\n");
+        let _ = writeln!(out, "sm2_cosign_hedged_requests_total {}", self.counter(Counter::Hedges));
+
+        out.push_str("# HELP sm2_cosign_errors_total Errors returned by client operations.\n");
+        out.push_str("# TYPE sm2_cosign_errors_total counter\n");
+        for kind in ErrorKind::ALL {
+            let _ = writeln!(out, "sm2_cosign_errors_total{{kind=\"{}\"}} {}", kind.name(), self.errors(kind));
+        }
+        out
+    }
+}
+
+/// 读取全局注册表的快照
+///
+/// 各项分别读取，与并发记录之间不保证原子一致，用于监控足够。
+#[cfg(feature = "metrics")]
+pub fn snapshot() -> MetricsSnapshot {
+    MetricsSnapshot {
+        phases: Phase::ALL
+            .iter()
+            .map(|&phase| REGISTRY.phases[phase as usize].snapshot(phase))
+            .collect(),
+        counters: std::array::from_fn(|i| REGISTRY.counters[i].load(Ordering::Relaxed)),
+        errors: std::array::from_fn(|i| REGISTRY.errors[i].load(Ordering::Relaxed)),
+    }
+}
+
+/// 清零全局注册表
+#[cfg(feature = "metrics")]
+pub fn reset() {
+    for histogram in &REGISTRY.phases {
+        histogram.reset();
+    }
+    for value in REGISTRY.counters.iter().chain(&REGISTRY.errors) {
+        value.store(0, Ordering::Relaxed);
+    }
+}
+
+/// 在 `listener` 上提供 Prometheus 抓取端点
+///
+/// 每个连接读完请求头后返回当前快照并关闭连接，不区分路径。通常放到独立任务中运行：
+/// `tokio::spawn(metrics::serve_prometheus(TcpListener::bind("127.0.0.1:9464").await?))`。
+#[cfg(feature = "metrics")]
+pub async fn serve_prometheus(listener: tokio::net::TcpListener) -> Result<()> {
+    use tokio::io::{AsyncReadExt, AsyncWriteExt};
+
+    /// 请求头的最大长度，抓取请求远小于此
+    const MAX_REQUEST: usize = 8192;
+
+    loop {
+        let (mut stream, _) = listener.accept().await?;
+        tokio::spawn(async move {
+            let mut request = Vec::with_capacity(1024);
+            let mut buf = [0u8; 1024];
+            let read_head = async {
+                while !request.windows(4).any(|w| w == b"\r\n\r\n") && request.len() < MAX_REQUEST {
+                    match stream.read(&mut buf).await {
+                        Ok(0) | Err(_) => return false,
+                        Ok(n) => request.extend_from_slice(&buf[..n]),
+                    }
+                }
+                true
+            };
+            if !matches!(tokio::time::timeout(Duration::from_secs(5), read_head).await, Ok(true)) {
+                return;
+            }
+
+            let body = snapshot().to_prometheus();
+            let response = format!(
+                "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: {}\r\nConnection: close\r\n\r\n{}",
+                body.len(),
+                body
+            );
+            let _ = stream.write_all(response.as_bytes()).await;
+            let _ = stream.shutdown().await;
+        });
+    }
+}
+
+#[cfg(all(test, feature = "metrics"))]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_bucket_bounds() {
+        let mut previous = 0;
+        for index in 0..BUCKETS {
+            let upper = bucket_upper(index);
+            assert!(index == 0 || upper > previous);
+            assert_eq!(bucket_index(upper), index);
+            previous = upper;
+        }
+        for value in [0u64, 31, 32, 33, 1000, 123_456, 999_999_999, 1 << 40] {
+            let upper = bucket_upper(bucket_index(value));
+            let value = value.min((1 << MAX_BITS) - 1);
+            assert!(upper >= value);
+            // 相对误差不超过 1/32
+            assert!((upper - value) * SUB_BUCKETS as u64 <= value.max(1));
+        }
+    }
+
+    #[test]
+    fn test_quantiles() {
+        let histogram = Histogram::EMPTY;
+        for micros in 1..=1000u64 {
+            histogram.record(micros * 1000);
+        }
+        let stats = histogram.snapshot(Phase::Network);
+        assert_eq!(stats.count, 1000);
+        assert_eq!(stats.max, Duration::from_millis(1));
+        for (q, expected) in [(0.5, 500_000u64), (0.99, 990_000), (1.0, 1_000_000)] {
+            let actual = stats.quantile(q).as_nanos() as u64;
+            assert!(actual >= expected && actual - expected <= expected / 32, "q={} actual={}", q, actual);
+        }
+        assert_eq!(Histogram::EMPTY.snapshot(Phase::Hash).quantile(0.5), Duration::ZERO);
+    }
+
+    #[test]
+    fn test_snapshot_and_export() {
+        drop(span(Phase::Hash));
+        count(Counter::BytesSent, 100);
+        let _ = track::<()>(Err(Error::QueueFull));
+
+        let snapshot = snapshot();
+        assert!(snapshot.phase(Phase::Hash).count >= 1);
+        assert!(snapshot.counter(Counter::BytesSent) >= 100);
+        assert!(snapshot.errors(ErrorKind::QueueFull) >= 1);
+
+        let text = snapshot.to_prometheus();
+        assert!(text.contains("# TYPE sm2_cosign_phase_seconds summary\n"));
+        assert!(text.contains("sm2_cosign_phase_seconds_count{phase=\"hash\"}"));
+        assert!(text.contains("sm2_cosign_errors_total{kind=\"queue_full\"}"));
+    }
+}
@@ -0,0 +1,300 @@
+//! 签名随机数预生成池
+//!
+//! Q1 = k1·G 与消息无关，可以离线批量预先计算。签名时直接从池中取出一对
+//! (k1, Q1)，关键路径上只剩哈希和网络往返。
+//!
+//! 安全约束：
+//! - 每一对 (k1, Q1) 只能被取出一次：`take` 按值移出，`NoncePair` 不可克隆
+//! - 随机数 k1 存放在安全内存池中（见 `secure`），被丢弃（包括池销毁时残留的条目）时清零
+
+use crate::error::Result;
+use crate::protocol::CoSignProtocol;
+use crate::secure::SecretScalar;
+use crate::types::{PointBytes, ScalarBytes};
+use std::collections::VecDeque;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Condvar, Mutex, MutexGuard, PoisonError};
+use std::thread::JoinHandle;
+use tracing::{debug, warn};
+
+/// 预生成的签名随机数对
+pub struct NoncePair {
+    k1: SecretScalar,
+    q1: PointBytes,
+}
+
+impl NoncePair {
+    /// 现场生成一对随机数（不经过池）
+    pub fn generate(protocol: &CoSignProtocol) -> Result<Self> {
+        let mut pair = Self {
+            k1: SecretScalar::zero(),
+            q1: [0u8; 64],
+        };
+        protocol.sign_prepare_into(pair.k1.as_mut_array(), &mut pair.q1)?;
+        Ok(pair)
+    }
+
+    /// 随机数 k1（32 字节）
+    pub fn k1(&self) -> &ScalarBytes {
+        self.k1.as_array()
+    }
+
+    /// Q1 = k1 * G（64 字节，x||y）
+    pub fn q1(&self) -> &PointBytes {
+        &self.q1
+    }
+}
+
+impl std::fmt::Debug for NoncePair {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        // Reason: k1 泄露即可由签名反推私钥，调试输出中不打印
+        f.debug_struct("NoncePair").field("q1", &self.q1).finish_non_exhaustive()
+    }
+}
+
+/// 随机数池状态快照
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct NoncePoolStats {
+    /// 当前可用数量
+    pub available: usize,
+    /// 池容量
+    pub capacity: usize,
+    /// 从池中成功取出的次数
+    pub taken: u64,
+    /// 取用时池为空的次数（池饥饿）
+    pub misses: u64,
+}
+
+struct PoolState {
+    pairs: VecDeque<NoncePair>,
+    closed: bool,
+}
+
+/// 有界的 (k1, Q1) 预生成池
+pub struct NoncePool {
+    state: Mutex<PoolState>,
+    refill: Condvar,
+    capacity: usize,
+    low_watermark: usize,
+    taken: AtomicU64,
+    misses: AtomicU64,
+}
+
+impl NoncePool {
+    /// 创建容量为 `capacity` 的空池，低水位默认为容量的一半
+    pub fn new(capacity: usize) -> Self {
+        Self::with_low_watermark(capacity, capacity / 2)
+    }
+
+    /// 创建空池，并指定触发后台补充的低水位
+    pub fn with_low_watermark(capacity: usize, low_watermark: usize) -> Self {
+        Self {
+            state: Mutex::new(PoolState {
+                pairs: VecDeque::with_capacity(capacity),
+                closed: false,
+            }),
+            refill: Condvar::new(),
+            capacity,
+            low_watermark: low_watermark.min(capacity.saturating_sub(1)),
+            taken: AtomicU64::new(0),
+            misses: AtomicU64::new(0),
+        }
+    }
+
+    fn lock(&self) -> MutexGuard<'_, PoolState> {
+        self.state.lock().unwrap_or_else(PoisonError::into_inner)
+    }
+
+    /// 池容量
+    pub fn capacity(&self) -> usize {
+        self.capacity
+    }
+
+    /// 当前可用数量
+    pub fn len(&self) -> usize {
+        self.lock().pairs.len()
+    }
+
+    /// 池是否为空
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// 取出一对随机数，池为空时返回 None
+    ///
+    /// 剩余数量降到低水位时唤醒后台补充线程。
+    pub fn take(&self) -> Option<NoncePair> {
+        let mut state = self.lock();
+        let pair = state.pairs.pop_front();
+        let remaining = state.pairs.len();
+        drop(state);
+
+        if remaining <= self.low_watermark {
+            self.refill.notify_one();
+        }
+        if pair.is_some() {
+            self.taken.fetch_add(1, Ordering::Relaxed);
+        } else {
+            self.misses.fetch_add(1, Ordering::Relaxed);
+        }
+        pair
+    }
+
+    /// 在当前线程中把池补满，返回新增数量
+    pub fn fill(&self, protocol: &CoSignProtocol) -> Result<usize> {
+        let mut filled = 0;
+        loop {
+            {
+                let state = self.lock();
+                if state.closed || state.pairs.len() >= self.capacity {
+                    break;
+                }
+            }
+
+            // 点乘在锁外完成，不阻塞并发的 take
+            let pair = NoncePair::generate(protocol)?;
+
+            let mut state = self.lock();
+            if state.closed || state.pairs.len() >= self.capacity {
+                break;
+            }
+            state.pairs.push_back(pair);
+            filled += 1;
+        }
+        Ok(filled)
+    }
+
+    /// 状态快照，可用于池饥饿告警
+    pub fn stats(&self) -> NoncePoolStats {
+        NoncePoolStats {
+            available: self.len(),
+            capacity: self.capacity,
+            taken: self.taken.load(Ordering::Relaxed),
+            misses: self.misses.load(Ordering::Relaxed),
+        }
+    }
+
+    /// 启动后台补充线程：低于低水位时补满，直到 `close` 被调用
+    ///
+    /// 容量为 0 的池无需补充，线程启动后立即退出。
+    pub fn spawn_refiller(self: &Arc<Self>, protocol: Arc<CoSignProtocol>) -> std::io::Result<JoinHandle<()>> {
+        let pool = Arc::clone(self);
+        std::thread::Builder::new()
+            .name("cosign-nonce-refill".to_string())
+            .spawn(move || pool.refill_loop(&protocol))
+    }
+
+    fn refill_loop(&self, protocol: &CoSignProtocol) {
+        // Reason: 容量为 0 时低水位也为 0，等待条件永不成立，不退出会空转占满一个核
+        if self.capacity == 0 {
+            return;
+        }
+        loop {
+            {
+                let mut state = self.lock();
+                while !state.closed && state.pairs.len() > self.low_watermark {
+                    state = self.refill.wait(state).unwrap_or_else(PoisonError::into_inner);
+                }
+                if state.closed {
+                    return;
+                }
+            }
+
+            match self.fill(protocol) {
+                Ok(filled) => debug!("Nonce pool refilled with {} pairs", filled),
+                Err(e) => {
+                    warn!("Nonce pool refill failed: {}", e);
+                    std::thread::sleep(std::time::Duration::from_millis(100));
+                }
+            }
+        }
+    }
+
+    /// 关闭池：清零并丢弃剩余随机数，停止后台补充线程
+    pub fn close(&self) {
+        let mut state = self.lock();
+        state.closed = true;
+        state.pairs.clear();
+        drop(state);
+        self.refill.notify_all();
+    }
+}
+
+impl std::fmt::Debug for NoncePool {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("NoncePool").field("stats", &self.stats()).finish()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_fill_and_take() {
+        let protocol = CoSignProtocol::new().unwrap();
+        let pool = NoncePool::new(4);
+        assert!(pool.is_empty());
+
+        assert_eq!(pool.fill(&protocol).unwrap(), 4);
+        assert_eq!(pool.len(), 4);
+        assert_eq!(pool.fill(&protocol).unwrap(), 0);
+
+        let pair = pool.take().unwrap();
+        assert!(pair.k1().iter().any(|&b| b != 0));
+        assert_eq!(pair.q1().len(), 64);
+
+        let stats = pool.stats();
+        assert_eq!(stats.available, 3);
+        assert_eq!(stats.capacity, 4);
+        assert_eq!(stats.taken, 1);
+        assert_eq!(stats.misses, 0);
+    }
+
+    #[test]
+    fn test_pairs_are_unique() {
+        let protocol = CoSignProtocol::new().unwrap();
+        let pool = NoncePool::new(8);
+        pool.fill(&protocol).unwrap();
+
+        let mut seen = std::collections::HashSet::new();
+        while let Some(pair) = pool.take() {
+            assert!(seen.insert(pair.q1().to_vec()));
+        }
+        assert_eq!(seen.len(), 8);
+        assert_eq!(pool.stats().misses, 1);
+    }
+
+    #[test]
+    fn test_background_refill() {
+        let protocol = Arc::new(CoSignProtocol::new().unwrap());
+        let pool = Arc::new(NoncePool::new(4));
+        let handle = pool.spawn_refiller(protocol).unwrap();
+
+        let deadline = std::time::Instant::now() + std::time::Duration::from_secs(10);
+        while pool.len() < 4 && std::time::Instant::now() < deadline {
+            std::thread::sleep(std::time::Duration::from_millis(5));
+        }
+        assert_eq!(pool.len(), 4);
+
+        pool.close();
+        handle.join().unwrap();
+        assert!(pool.is_empty());
+        assert!(pool.take().is_none());
+    }
+
+    #[test]
+    fn test_zero_capacity_refiller_exits() {
+        let protocol = Arc::new(CoSignProtocol::new().unwrap());
+        let pool = Arc::new(NoncePool::new(0));
+        let handle = pool.spawn_refiller(protocol).unwrap();
+
+        let deadline = std::time::Instant::now() + std::time::Duration::from_secs(10);
+        while !handle.is_finished() && std::time::Instant::now() < deadline {
+            std::thread::sleep(std::time::Duration::from_millis(5));
+        }
+        assert!(handle.is_finished());
+        handle.join().unwrap();
+        assert!(pool.take().is_none());
+    }
+}
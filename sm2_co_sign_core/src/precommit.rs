@@ -0,0 +1,324 @@
+//! 预提交签名随机数（需服务端支持 `/api/sign/precommit`）
+//!
+//! 客户端提前把一批 Q1 发给服务端，服务端为每个 Q1 生成并保存自己的随机数，返回一次性的提交编号。
+//! 签名时只发送 (编号, E)，服务端用保存的随机数算出 (r, s2, s3)，客户端补全签名的公式不变。
+//! 关键路径上的请求不再携带 Q1，服务端也不必在收到请求后再生成随机数、计算点乘。
+//!
+//! 单次使用约束：
+//! - 客户端：`take` 按值移出条目，条目不可克隆；取出后无论签名成功与否都不会再用，k1 随条目清零
+//! - 条目绑定 user_id 与发放它的服务端副本，按 (副本, user_id) 分组存放与补充；
+//!   过期条目、已被摘除副本的条目在取用时丢弃
+//! - 服务端：编号必须原子地“查找并删除”，同一编号第二次出现时拒绝（见 docs/TECH_NOTES.md）
+
+use crate::endpoints::Endpoints;
+use crate::error::{Error, Result};
+use crate::nonce_pool::NoncePair;
+use crate::protocol::{base64_encode, CoSignProtocol};
+use crate::session::parse_timestamp;
+use crate::types::{ApiResponse, PrecommitResponse, Session};
+use reqwest::StatusCode;
+use std::collections::{HashMap, VecDeque};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Arc, Mutex, MutexGuard, PoisonError};
+use std::time::SystemTime;
+use tracing::{debug, warn};
+
+/// 一个服务端已登记、尚未使用的随机数
+pub(crate) struct PrecommittedNonce {
+    /// 服务端发放的一次性编号
+    pub(crate) id: String,
+    pub(crate) nonce: NoncePair,
+    expiry: Option<SystemTime>,
+}
+
+/// 条目分组键：(发放条目的副本, user_id)
+type BucketKey = (usize, String);
+
+/// 同一副本发放给同一用户的条目
+#[derive(Default)]
+struct Bucket {
+    entries: VecDeque<PrecommittedNonce>,
+    /// 该分组的后台补充是否在途
+    refilling: bool,
+}
+
+/// 预提交随机数池
+pub(crate) struct Precommits {
+    endpoints: Arc<Endpoints>,
+    protocol: Arc<CoSignProtocol>,
+    buckets: Mutex<HashMap<BucketKey, Bucket>>,
+    /// 每次补充的数量，0 表示不启用
+    batch: usize,
+    /// 服务端不支持预提交（返回 404），之后不再尝试
+    unsupported: AtomicBool,
+}
+
+impl Precommits {
+    pub(crate) fn new(endpoints: Arc<Endpoints>, protocol: Arc<CoSignProtocol>, batch: usize) -> Arc<Self> {
+        Arc::new(Self {
+            endpoints,
+            protocol,
+            buckets: Mutex::new(HashMap::new()),
+            batch,
+            unsupported: AtomicBool::new(false),
+        })
+    }
+
+    fn lock(&self) -> MutexGuard<'_, HashMap<BucketKey, Bucket>> {
+        self.buckets.lock().unwrap_or_else(PoisonError::into_inner)
+    }
+
+    /// 是否启用（配置了批量且服务端未拒绝）
+    pub(crate) fn enabled(&self) -> bool {
+        self.batch > 0 && !self.unsupported.load(Ordering::Relaxed)
+    }
+
+    /// 可用条目数（所有分组合计）
+    pub(crate) fn len(&self) -> usize {
+        self.lock().values().map(|bucket| bucket.entries.len()).sum()
+    }
+
+    /// 取出一个由 `endpoint` 发放给 `user_id` 的条目
+    ///
+    /// 顺带丢弃该分组中已过期的条目，以及已被摘除副本上的全部条目（没有补充在途的分组）。
+    pub(crate) fn take(&self, endpoint: usize, user_id: &str) -> Option<PrecommittedNonce> {
+        let now = SystemTime::now();
+        let mut buckets = self.lock();
+        buckets.retain(|(index, _), bucket| bucket.refilling || !self.endpoints.is_ejected(*index));
+        let bucket = buckets.get_mut(&(endpoint, user_id.to_string()))?;
+        while let Some(entry) = bucket.entries.pop_front() {
+            if entry.expiry.map_or(true, |expiry| expiry > now) {
+                return Some(entry);
+            }
+        }
+        None
+    }
+
+    /// 丢弃全部条目（切换密钥对、登出时）
+    pub(crate) fn clear(&self) {
+        self.lock().clear();
+    }
+
+    /// 向 `endpoint` 申请 `count` 个预提交随机数，返回新增数量
+    pub(crate) async fn request(&self, session: &Session, user_id: &str, endpoint: usize, count: usize) -> Result<usize> {
+        let nonces = (0..count)
+            .map(|_| NoncePair::generate(&self.protocol))
+            .collect::<Result<Vec<_>>>()?;
+        let body = serde_json::json!({
+            "user_id": user_id,
+            "q1": nonces.iter().map(|nonce| base64_encode(nonce.q1())).collect::<Vec<_>>(),
+        });
+
+        let http_client = self.endpoints.http_client();
+        let response = self
+            .endpoints
+            .send_to(endpoint, "/api/sign/precommit", |url| {
+                http_client.post(url).bearer_auth(&session.token).json(&body)
+            })
+            .await?;
+        if response.status() == StatusCode::NOT_FOUND {
+            warn!("Server does not support sign precommit, disabling");
+            self.unsupported.store(true, Ordering::Relaxed);
+            return Err(Error::InvalidState("Server does not support sign precommit".to_string()));
+        }
+
+        let api_response: ApiResponse<PrecommitResponse> =
+            response.json().await.map_err(|e| Error::Network(e.to_string()))?;
+        if api_response.code != 0 {
+            return Err(Error::Api {
+                code: api_response.code,
+                message: api_response.message,
+            });
+        }
+        let data = api_response.data.ok_or(Error::InvalidState("No data in response".to_string()))?;
+        if data.items.len() != nonces.len() {
+            return Err(Error::InvalidState(format!(
+                "Precommit response has {} items, expected {}",
+                data.items.len(),
+                nonces.len()
+            )));
+        }
+
+        let added = nonces.len();
+        let mut buckets = self.lock();
+        let bucket = buckets.entry((endpoint, user_id.to_string())).or_default();
+        for (nonce, item) in nonces.into_iter().zip(data.items) {
+            bucket.entries.push_back(PrecommittedNonce {
+                id: item.id,
+                nonce,
+                expiry: parse_timestamp(&item.expires_at),
+            });
+        }
+        debug!("Precommitted {} nonces on {}", added, self.endpoints.url(endpoint));
+        Ok(added)
+    }
+
+    /// (`endpoint`, `user_id`) 分组的可用条目不足一半时在后台补充一批，该分组已有补充在途时不再重复发起
+    pub(crate) fn refill_in_background(self: &Arc<Self>, session: Arc<Session>, user_id: &str, endpoint: usize) {
+        if !self.enabled() || self.endpoints.is_ejected(endpoint) {
+            return;
+        }
+        let Ok(handle) = tokio::runtime::Handle::try_current() else {
+            return;
+        };
+        let key = (endpoint, user_id.to_string());
+        {
+            let mut buckets = self.lock();
+            let bucket = buckets.entry(key.clone()).or_default();
+            if bucket.refilling || bucket.entries.len() > self.batch / 2 {
+                return;
+            }
+            bucket.refilling = true;
+        }
+        let this = Arc::clone(self);
+        handle.spawn(async move {
+            if let Err(e) = this.request(&session, &key.1, key.0, this.batch).await {
+                debug!("Precommit refill failed: {}", e);
+            }
+            if let Some(bucket) = this.lock().get_mut(&key) {
+                bucket.refilling = false;
+            }
+        });
+    }
+}
+
+impl std::fmt::Debug for Precommits {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        // 不输出随机数
+        f.debug_struct("Precommits")
+            .field("available", &self.len())
+            .field("batch", &self.batch)
+            .field("enabled", &self.enabled())
+            .finish()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::client::ClientConfig;
+    use std::time::Duration;
+
+    fn precommits() -> Arc<Precommits> {
+        let config = ClientConfig {
+            server_url: "http://127.0.0.1:1".to_string(),
+            replica_urls: vec!["http://127.0.0.1:2".to_string()],
+            ..ClientConfig::default()
+        };
+        let endpoints = Endpoints::new(reqwest::Client::new(), &config);
+        Precommits::new(endpoints, Arc::new(CoSignProtocol::new().unwrap()), 4)
+    }
+
+    fn entry(precommits: &Precommits, id: &str, endpoint: usize, user_id: &str, expiry: Option<SystemTime>) {
+        precommits
+            .lock()
+            .entry((endpoint, user_id.to_string()))
+            .or_default()
+            .entries
+            .push_back(PrecommittedNonce {
+                id: id.to_string(),
+                nonce: NoncePair::generate(&precommits.protocol).unwrap(),
+                expiry,
+            });
+    }
+
+    #[test]
+    fn test_take_is_single_use() {
+        let precommits = precommits();
+        entry(&precommits, "a", 0, "alice", None);
+        entry(&precommits, "b", 1, "alice", None);
+        entry(&precommits, "c", 0, "alice", None);
+
+        assert_eq!(precommits.take(0, "alice").unwrap().id, "a");
+        assert_eq!(precommits.take(0, "alice").unwrap().id, "c");
+        assert!(precommits.take(0, "alice").is_none());
+        assert_eq!(precommits.take(1, "alice").unwrap().id, "b");
+        assert_eq!(precommits.len(), 0);
+    }
+
+    #[test]
+    fn test_take_matches_user_and_discards_expired() {
+        let precommits = precommits();
+        let past = SystemTime::now() - Duration::from_secs(1);
+        let future = SystemTime::now() + Duration::from_secs(60);
+        entry(&precommits, "expired", 0, "alice", Some(past));
+        entry(&precommits, "bob", 0, "bob", None);
+        entry(&precommits, "fresh", 0, "alice", Some(future));
+
+        assert_eq!(precommits.take(0, "alice").unwrap().id, "fresh");
+        assert!(precommits.take(0, "alice").is_none());
+        assert_eq!(precommits.take(0, "bob").unwrap().id, "bob");
+        assert_eq!(precommits.len(), 0);
+    }
+
+    fn session() -> Arc<Session> {
+        Arc::new(Session {
+            token: "t".to_string(),
+            user_id: "alice".to_string(),
+            expires_at: String::new(),
+        })
+    }
+
+    fn refilling(precommits: &Precommits, endpoint: usize, user_id: &str) -> bool {
+        precommits
+            .lock()
+            .get(&(endpoint, user_id.to_string()))
+            .is_some_and(|bucket| bucket.refilling)
+    }
+
+    #[tokio::test(flavor = "current_thread")]
+    async fn test_refill_tracked_per_user_and_endpoint() {
+        let precommits = precommits();
+        for id in ["a", "b", "c", "d"] {
+            entry(&precommits, id, 0, "alice", None);
+        }
+
+        // alice 在副本 0 上余量充足，不影响 bob 或副本 1 的补充
+        precommits.refill_in_background(session(), "alice", 0);
+        assert!(!refilling(&precommits, 0, "alice"));
+        precommits.refill_in_background(session(), "bob", 0);
+        assert!(refilling(&precommits, 0, "bob"));
+        precommits.refill_in_background(session(), "alice", 1);
+        assert!(refilling(&precommits, 1, "alice"));
+
+        // 补充失败后清除在途标志，下次可以重试
+        while refilling(&precommits, 0, "bob") || refilling(&precommits, 1, "alice") {
+            tokio::task::yield_now().await;
+        }
+        assert_eq!(precommits.len(), 4);
+    }
+
+    #[tokio::test]
+    async fn test_take_purges_ejected_endpoint() {
+        let precommits = precommits();
+        entry(&precommits, "a", 0, "alice", None);
+        entry(&precommits, "b", 1, "alice", None);
+        entry(&precommits, "c", 1, "bob", None);
+
+        let http_client = precommits.endpoints.http_client().clone();
+        while !precommits.endpoints.is_ejected(1) {
+            let _ = precommits.endpoints.send_to(1, "/mapi/health", |url| http_client.get(url)).await;
+        }
+        assert_eq!(precommits.take(0, "alice").unwrap().id, "a");
+        assert!(precommits.take(1, "alice").is_none());
+        assert_eq!(precommits.len(), 0);
+    }
+
+    #[tokio::test]
+    async fn test_unsupported_server_disables() {
+        let precommits = precommits();
+        assert!(precommits.enabled());
+        let session = Session {
+            token: "t".to_string(),
+            user_id: "alice".to_string(),
+            expires_at: String::new(),
+        };
+        // 连接失败不会关闭功能，只有服务端返回 404 才会
+        assert!(matches!(
+            precommits.request(&session, "alice", 0, 2).await,
+            Err(Error::Network(_))
+        ));
+        assert!(precommits.enabled());
+        assert_eq!(precommits.len(), 0);
+    }
+}
@@ -9,24 +9,211 @@
 //! - libsm: 用于协同签名特有的椭圆曲线操作（点乘、点加、点坐标转换等）
 //! - gm-sdk-rs: 用于标准 SM2 签名验签、SM3 哈希（API 更简洁，开箱即用）
 
+use crate::base64_codec;
+#[cfg(feature = "native-ecc")]
+use crate::curve::{self, BaseTable, ProjectivePoint};
 use crate::error::{Error, Result};
-use base64::{engine::general_purpose::STANDARD as BASE64, Engine};
+use crate::fixed_base::{ecc_ctx, FixedBase, GX, GY};
+#[cfg(not(feature = "native-ecc"))]
+use crate::fixed_base::FixedBaseTable;
+#[cfg(feature = "native-ecc")]
+use crate::fixed_base::check_window;
+use crate::kdf::{self, KdfStream};
+use crate::metrics::{self, Phase};
+use crate::scalar::Scalar;
+use crate::secure::SecretScalar;
+use crate::sm3::Sm3;
+use crate::types::{PointBytes, ScalarBytes};
+use crate::verify::{double_scalar_mul, WindowTable};
 use gm_sdk::sm2::{sm2_sign, sm2_verify};
 use gm_sdk::sm3::sm3_hash as gm_sm3_hash;
-use libsm::sm2::ecc::EccCtx;
+use libsm::sm2::ecc::{EccCtx, Point};
+use libsm::sm2::field::FieldElem;
+#[cfg(not(feature = "native-ecc"))]
 use num_bigint::BigUint;
 use rand::RngCore;
+use rayon::prelude::*;
+use std::collections::HashMap;
+use std::sync::OnceLock;
+use zeroize::Zeroize;
+
+/// SM2 默认用户标识（GB/T 35276 推荐值，与 gm-sdk-rs 标准签名一致）
+pub const DEFAULT_USER_ID: &[u8] = b"1234567812345678";
+
+/// SM2 推荐曲线参数 a
+const CURVE_A: [u8; 32] = [
+    0xff, 0xff, 0xff, 0xfe, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfc,
+];
+
+/// SM2 推荐曲线参数 b
+const CURVE_B: [u8; 32] = [
+    0x28, 0xe9, 0xfa, 0x9e, 0x9d, 0x9f, 0x5e, 0x34, 0x4d, 0x5a, 0x9e, 0x4b, 0xcf, 0x65, 0x09, 0xa7,
+    0xf3, 0x97, 0x89, 0xf5, 0x15, 0xab, 0x8f, 0x92, 0xdd, 0xbc, 0xbd, 0x41, 0x4d, 0x94, 0x0e, 0x93,
+];
+
+/// 单个签名的服务端分量及对应的 k1，用于批量完成签名
+#[derive(Debug, Clone, Copy)]
+pub struct SignShares<'a> {
+    pub k1: &'a [u8],
+    pub r: &'a [u8],
+    pub s2: &'a [u8],
+    pub s3: &'a [u8],
+}
+
+/// 批量验签中的一项
+#[derive(Debug, Clone, Copy)]
+pub struct VerifyItem<'a> {
+    /// 64 字节 x||y 或 65 字节 04||x||y
+    pub public_key: &'a [u8],
+    pub message: &'a [u8],
+    /// 64 字节 r||s
+    pub signature: &'a [u8],
+}
 
 /// 协同签名协议
 pub struct CoSignProtocol {
-    ecc: EccCtx,
+    /// 进程内共享的曲线上下文
+    ecc: &'static EccCtx,
+    /// 生成元 G 的预计算表，进程内共享（`FixedBase::Generic` 时为空）
+    #[cfg(not(feature = "native-ecc"))]
+    g_table: Option<&'static FixedBaseTable>,
+    /// 生成元 G 的常数时间预计算表，进程内共享（`FixedBase::Generic` 时为空）
+    #[cfg(feature = "native-ecc")]
+    g_table: Option<&'static BaseTable>,
+    /// 创建时指定的固定基点策略
+    #[cfg(feature = "native-ecc")]
+    fixed_base: FixedBase,
 }
 
 impl CoSignProtocol {
-    /// 创建协议实例
+    /// 创建协议实例（使用默认的固定基点预计算表）
     pub fn new() -> Result<Self> {
-        let ecc = EccCtx::new();
-        Ok(Self { ecc })
+        Self::with_fixed_base(FixedBase::default())
+    }
+
+    /// 创建协议实例，并指定 k·G 的计算策略
+    ///
+    /// 窗口越宽，预计算表占用内存越多，点乘越快。
+    #[cfg(not(feature = "native-ecc"))]
+    pub fn with_fixed_base(fixed_base: FixedBase) -> Result<Self> {
+        let g_table = match fixed_base {
+            FixedBase::Generic => None,
+            FixedBase::Window(window) => Some(FixedBaseTable::shared(window)?),
+        };
+        Ok(Self { ecc: ecc_ctx(), g_table })
+    }
+
+    /// 创建协议实例，并指定 k·G 的计算策略
+    ///
+    /// `native-ecc` 后端的常数时间查表要遍历整行，窗口固定为 4 位，
+    /// `FixedBase::Window(w)` 只表示启用预计算表，w 仍按 1..=8 校验。
+    #[cfg(feature = "native-ecc")]
+    pub fn with_fixed_base(fixed_base: FixedBase) -> Result<Self> {
+        let g_table = match fixed_base {
+            FixedBase::Generic => None,
+            FixedBase::Window(window) => {
+                check_window(window)?;
+                Some(curve::base_table())
+            }
+        };
+        Ok(Self {
+            ecc: ecc_ctx(),
+            g_table,
+            fixed_base,
+        })
+    }
+
+    /// 当前使用的固定基点策略
+    #[cfg(not(feature = "native-ecc"))]
+    pub fn fixed_base(&self) -> FixedBase {
+        match self.g_table {
+            Some(table) => FixedBase::Window(table.window_bits()),
+            None => FixedBase::Generic,
+        }
+    }
+
+    /// 当前使用的固定基点策略
+    #[cfg(feature = "native-ecc")]
+    pub fn fixed_base(&self) -> FixedBase {
+        self.fixed_base
+    }
+
+    /// 计算 k * G 并写出仿射坐标，有预计算表时走查表路径
+    #[cfg(not(feature = "native-ecc"))]
+    fn g_mul_into(&self, k: &ScalarBytes, out: &mut PointBytes) -> Result<()> {
+        let point = match self.g_table {
+            Some(table) => table.mul_bytes(self.ecc, k),
+            None => self
+                .ecc
+                .g_mul(&BigUint::from_bytes_be(k))
+                .map_err(|e| Error::Crypto(e.to_string())),
+        }?;
+        self.point_to_bytes(&point, out)
+    }
+
+    /// 计算 k * G 并写出仿射坐标，有预计算表时走查表路径
+    #[cfg(feature = "native-ecc")]
+    fn g_mul_into(&self, k: &ScalarBytes, out: &mut PointBytes) -> Result<()> {
+        let point = match self.g_table {
+            Some(table) => table.mul(k),
+            None => ProjectivePoint::generator().mul(k),
+        };
+        native_affine(&point, out)
+    }
+
+    /// 计算 k * P 并写出仿射坐标（P 为 64 字节 x||y 或 65 字节 04||x||y）
+    #[cfg(not(feature = "native-ecc"))]
+    fn point_mul_into(&self, k: &[u8], point: &[u8], name: &str, out: &mut PointBytes) -> Result<()> {
+        let point = self.point_from_bytes(point, name)?;
+        let product = self
+            .ecc
+            .mul(&BigUint::from_bytes_be(k), &point)
+            .map_err(|e| Error::Crypto(e.to_string()))?;
+        self.point_to_bytes(&product, out)
+    }
+
+    /// 计算 k * P 并写出仿射坐标（P 为 64 字节 x||y 或 65 字节 04||x||y）
+    #[cfg(feature = "native-ecc")]
+    fn point_mul_into(&self, k: &[u8], point: &[u8], name: &str, out: &mut PointBytes) -> Result<()> {
+        native_point_mul(k, point, name, out)
+    }
+
+    /// 把点转换为 64 字节仿射坐标 x||y（各补零到 32 字节）
+    #[cfg_attr(feature = "native-ecc", allow(dead_code))]
+    fn point_to_bytes(&self, point: &Point, out: &mut PointBytes) -> Result<()> {
+        encode_point(self.ecc, point, out)
+    }
+
+    /// 从 64 字节 x||y 或 65 字节 04||x||y 解析曲线点
+    fn point_from_bytes(&self, bytes: &[u8], name: &str) -> Result<Point> {
+        let coords = point_coords(bytes, name)?;
+        let x = FieldElem::from_bytes(&coords[0..32]).map_err(|e| Error::Crypto(e.to_string()))?;
+        let y = FieldElem::from_bytes(&coords[32..64]).map_err(|e| Error::Crypto(e.to_string()))?;
+        self.ecc.new_point(&x, &y).map_err(|e| Error::Crypto(e.to_string()))
+    }
+
+    /// 生成 [1, n-1] 内均匀分布的随机标量
+    fn random_scalar() -> ScalarBytes {
+        let mut bytes = [0u8; 32];
+        Self::random_scalar_into(&mut bytes);
+        bytes
+    }
+
+    /// 生成 [1, n-1] 内均匀分布的随机标量，直接写入调用方缓冲区（如安全内存槽位）
+    fn random_scalar_into(out: &mut ScalarBytes) {
+        let mut rng = rand::thread_rng();
+        loop {
+            rng.fill_bytes(out);
+            // Reason: 拒绝采样而非取模，避免随机数 k1 产生可被格攻击利用的偏差
+            if let Some(mut k) = Scalar::from_canonical(out) {
+                let nonzero = !k.is_zero();
+                k.zeroize();
+                if nonzero {
+                    return;
+                }
+            }
+        }
     }
 
     /// 生成随机数
@@ -44,55 +231,114 @@ impl CoSignProtocol {
     }
 
     /// 生成客户端私钥分量 D1
-    /// 注意：此功能需要 libsm 的椭圆曲线随机数生成，gm-sdk-rs 不支持
     pub fn generate_d1(&self) -> Result<Vec<u8>> {
-        let d1 = self.ecc.random_uint();
-        Ok(d1.to_bytes_be())
+        Ok(self.generate_d1_array()?.to_vec())
+    }
+
+    /// 生成客户端私钥分量 D1（32 字节定长）
+    pub fn generate_d1_array(&self) -> Result<ScalarBytes> {
+        Ok(Self::random_scalar())
+    }
+
+    /// 在安全内存池中生成客户端私钥分量 D1，不经过栈或堆上的临时副本
+    pub fn generate_d1_secret(&self) -> SecretScalar {
+        let mut d1 = SecretScalar::zero();
+        Self::random_scalar_into(d1.as_mut_array());
+        d1
     }
 
     /// 计算 P1 = d1 * G
     /// 注意：此功能需要 libsm 的椭圆曲线点乘运算，gm-sdk-rs 不支持
     pub fn calculate_p1(&self, d1: &[u8]) -> Result<Vec<u8>> {
-        let d1_big = BigUint::from_bytes_be(d1);
-        
-        let p1 = self.ecc.g_mul(&d1_big).map_err(|e| Error::Crypto(e.to_string()))?;
-        
-        let (x, y) = self.ecc.to_affine(&p1).map_err(|e| Error::Crypto(e.to_string()))?;
-        let x_bytes = x.to_bytes();
-        let y_bytes = y.to_bytes();
-        
-        let mut p1_bytes = vec![0u8; 64];
-        let x_len = x_bytes.len();
-        let y_len = y_bytes.len();
-        p1_bytes[32 - x_len..32].copy_from_slice(&x_bytes);
-        p1_bytes[64 - y_len..64].copy_from_slice(&y_bytes);
-        
-        Ok(p1_bytes)
+        Ok(self.calculate_p1_array(d1)?.to_vec())
+    }
+
+    /// 计算 P1 = d1 * G（64 字节定长）
+    pub fn calculate_p1_array(&self, d1: &[u8]) -> Result<PointBytes> {
+        let mut p1 = [0u8; 64];
+        self.calculate_p1_into(d1, &mut p1)?;
+        Ok(p1)
+    }
+
+    /// 计算 P1 = d1 * G，写入调用方缓冲区
+    pub fn calculate_p1_into(&self, d1: &[u8], out: &mut PointBytes) -> Result<()> {
+        let mut d1 = pad_scalar(d1)?;
+        let result = self.g_mul_into(&d1, out);
+        d1.zeroize();
+        result
     }
 
     /// 签名预处理：生成 k1，计算 Q1 = k1 * G
     /// 注意：此功能需要 libsm 的椭圆曲线点乘运算，gm-sdk-rs 不支持
     pub fn sign_prepare(&self) -> Result<(Vec<u8>, Vec<u8>)> {
-        let k1 = self.ecc.random_uint();
-        
-        let q1 = self.ecc.g_mul(&k1).map_err(|e| Error::Crypto(e.to_string()))?;
-        
-        let (x, y) = self.ecc.to_affine(&q1).map_err(|e| Error::Crypto(e.to_string()))?;
-        let x_bytes = x.to_bytes();
-        let y_bytes = y.to_bytes();
-        
-        let mut q1_bytes = vec![0u8; 64];
-        let x_len = x_bytes.len();
-        let y_len = y_bytes.len();
-        q1_bytes[32 - x_len..32].copy_from_slice(&x_bytes);
-        q1_bytes[64 - y_len..64].copy_from_slice(&y_bytes);
-        
-        Ok((k1.to_bytes_be(), q1_bytes))
+        let (mut k1, q1) = self.sign_prepare_array()?;
+        let k1_vec = k1.to_vec();
+        k1.zeroize();
+        Ok((k1_vec, q1.to_vec()))
+    }
+
+    /// 签名预处理（定长）：返回 32 字节 k1 和 64 字节 Q1
+    pub fn sign_prepare_array(&self) -> Result<(ScalarBytes, PointBytes)> {
+        let mut k1 = [0u8; 32];
+        let mut q1 = [0u8; 64];
+        self.sign_prepare_into(&mut k1, &mut q1)?;
+        Ok((k1, q1))
+    }
+
+    /// 签名预处理，k1 和 Q1 写入调用方缓冲区
+    pub fn sign_prepare_into(&self, k1: &mut ScalarBytes, q1: &mut PointBytes) -> Result<()> {
+        Self::random_scalar_into(k1);
+        self.g_mul_into(k1, q1)
+    }
+
+    /// 计算消息哈希 E = SM3(Z || M)
+    ///
+    /// Z 由默认用户标识和公钥计算（见 `compute_z`），结果与标准 SM2 签名的摘要一致。
+    /// 未提供公钥（空切片）时退化为 SM3(M)。
+    pub fn calculate_message_hash(&self, message: &[u8], public_key: &[u8]) -> Result<Vec<u8>> {
+        let mut hasher = self.message_hasher(public_key)?;
+        hasher.update(message);
+        Ok(hasher.finalize().to_vec())
+    }
+
+    /// 创建消息哈希 E 的增量上下文（已吸收 Z）
+    ///
+    /// 依次 `update` 消息分块，`finalize` 的结果与 `calculate_message_hash` 相同，
+    /// 适合无法一次性读入内存的大文件。Z 对同一公钥不变，返回的上下文可缓存并
+    /// 每次签名 `clone` 一份，签名时只需哈希消息本身。
+    pub fn message_hasher(&self, public_key: &[u8]) -> Result<Sm3> {
+        self.message_hasher_with_id(public_key, DEFAULT_USER_ID)
     }
 
-    /// 计算消息哈希 E
-    pub fn calculate_message_hash(&self, message: &[u8], _public_key: &[u8]) -> Result<Vec<u8>> {
-        Ok(Self::sm3_hash(message))
+    /// 创建消息哈希 E 的增量上下文，使用指定的用户标识计算 Z
+    pub fn message_hasher_with_id(&self, public_key: &[u8], user_id: &[u8]) -> Result<Sm3> {
+        let mut hasher = Sm3::new();
+        if !public_key.is_empty() {
+            hasher.update(&Self::compute_z(public_key, user_id)?);
+        }
+        Ok(hasher)
+    }
+
+    /// 计算 Z = SM3(ENTL || ID || a || b || Gx || Gy || Px || Py)
+    ///
+    /// 公钥为 64 字节 x||y 或带 04 前缀的 65 字节，ENTL 为 ID 的比特长度（2 字节大端）。
+    pub fn compute_z(public_key: &[u8], user_id: &[u8]) -> Result<[u8; 32]> {
+        let coords = point_coords(public_key, "public key")?;
+        let entl = user_id
+            .len()
+            .checked_mul(8)
+            .and_then(|bits| u16::try_from(bits).ok())
+            .ok_or_else(|| Error::InvalidParam("User ID too long".to_string()))?;
+
+        let mut hasher = Sm3::new();
+        hasher.update(&entl.to_be_bytes());
+        hasher.update(user_id);
+        hasher.update(&CURVE_A);
+        hasher.update(&CURVE_B);
+        hasher.update(&GX);
+        hasher.update(&GY);
+        hasher.update(coords);
+        Ok(hasher.finalize())
     }
 
     /// 完成签名计算
@@ -111,61 +357,184 @@ impl CoSignProtocol {
         s2: &[u8],
         s3: &[u8],
     ) -> Result<(Vec<u8>, Vec<u8>)> {
-        let n = self.ecc.get_n();
+        let d1_inv = self.invert_d1_array(d1)?;
+        self.complete_signature_with_inverse(k1, d1, &d1_inv, r, s2, s3)
+    }
 
-        let k1_big = BigUint::from_bytes_be(k1);
-        let d1_big = BigUint::from_bytes_be(d1);
-        let r_big = BigUint::from_bytes_be(r);
-        let s2_big = BigUint::from_bytes_be(s2);
-        let s3_big = BigUint::from_bytes_be(s3);
+    /// 完成签名计算，使用预先计算好的 d1⁻¹（见 `invert_d1`）
+    ///
+    /// d1 在密钥生命周期内不变，缓存其逆元后每次签名只剩几次定长模乘。
+    pub fn complete_signature_with_inverse(
+        &self,
+        k1: &[u8],
+        d1: &[u8],
+        d1_inv: &[u8],
+        r: &[u8],
+        s2: &[u8],
+        s3: &[u8],
+    ) -> Result<(Vec<u8>, Vec<u8>)> {
+        let signature = self.complete_signature_array(k1, d1, d1_inv, r, s2, s3)?;
+        Ok((signature[..32].to_vec(), signature[32..].to_vec()))
+    }
 
-        // s = (k1·s2 + s3 - r·d1) · d1⁻¹ mod n
-        // Reason: 服务端用 d2 计算 s2/s3，客户端需乘 d1⁻¹ 来抵消 d1，还原标准 SM2 签名
-        let k1_s2 = (&k1_big * &s2_big) % n;
-        let r_d1 = (&r_big * &d1_big) % n;
-        // 加 n 避免下溢（BigUint 无符号）
-        let inner = (k1_s2 + s3_big + n - r_d1) % n;
+    /// 完成签名计算（定长），返回 64 字节 r||s
+    pub fn complete_signature_array(
+        &self,
+        k1: &[u8],
+        d1: &[u8],
+        d1_inv: &[u8],
+        r: &[u8],
+        s2: &[u8],
+        s3: &[u8],
+    ) -> Result<[u8; 64]> {
+        let mut signature = [0u8; 64];
+        self.complete_signature_into(k1, d1, d1_inv, r, s2, s3, &mut signature)?;
+        Ok(signature)
+    }
 
-        // 用费马小定理求 d1 模逆：d1⁻¹ = d1^(n-2) mod n（n 为素数）
-        let n_minus_2 = n - BigUint::from(2u32);
-        let d1_inv = d1_big.modpow(&n_minus_2, n);
+    /// 完成签名计算，r||s 写入调用方缓冲区，全程不分配内存
+    #[allow(clippy::too_many_arguments)]
+    pub fn complete_signature_into(
+        &self,
+        k1: &[u8],
+        d1: &[u8],
+        d1_inv: &[u8],
+        r: &[u8],
+        s2: &[u8],
+        s3: &[u8],
+        out: &mut [u8; 64],
+    ) -> Result<()> {
+        let _span = metrics::span(Phase::CompleteSignature);
+        let mut d1 = Scalar::from_bytes_be(d1)?;
+        let mut d1_inv = match Scalar::from_bytes_be(d1_inv) {
+            Ok(d1_inv) => d1_inv,
+            Err(e) => {
+                d1.zeroize();
+                return Err(e);
+            }
+        };
+        let result = Self::finish_signature(k1, &d1, &d1_inv, r, s2, s3, out);
+        d1.zeroize();
+        d1_inv.zeroize();
+        result
+    }
 
-        let s = (inner * d1_inv) % n;
+    /// 批量完成签名计算
+    ///
+    /// 同一密钥下的所有签名共用一次 d1⁻¹ 求逆；每一项独立返回结果。
+    pub fn complete_signature_batch(&self, d1: &[u8], shares: &[SignShares<'_>]) -> Vec<Result<(Vec<u8>, Vec<u8>)>> {
+        let keys = Scalar::from_bytes_be(d1).and_then(|mut d1| match Self::invert_scalar(&d1) {
+            Ok(d1_inv) => Ok((d1, d1_inv)),
+            Err(e) => {
+                d1.zeroize();
+                Err(e)
+            }
+        });
+        match keys {
+            Ok((mut d1, mut d1_inv)) => {
+                let results = shares
+                    .iter()
+                    .map(|item| {
+                        let mut signature = [0u8; 64];
+                        Self::finish_signature(item.k1, &d1, &d1_inv, item.r, item.s2, item.s3, &mut signature)?;
+                        Ok((signature[..32].to_vec(), signature[32..].to_vec()))
+                    })
+                    .collect();
+                d1.zeroize();
+                d1_inv.zeroize();
+                results
+            }
+            Err(e) => shares.iter().map(|_| Err(e.clone())).collect(),
+        }
+    }
 
-        Ok((r.to_vec(), s.to_bytes_be()))
+    /// 计算 d1⁻¹ mod n（32 字节），供 `complete_signature_with_inverse` 使用
+    pub fn invert_d1(&self, d1: &[u8]) -> Result<Vec<u8>> {
+        Ok(self.invert_d1_array(d1)?.to_vec())
+    }
+
+    /// 计算 d1⁻¹ mod n（32 字节定长）
+    pub fn invert_d1_array(&self, d1: &[u8]) -> Result<ScalarBytes> {
+        let mut d1 = Scalar::from_bytes_be(d1)?;
+        let result = Self::invert_scalar(&d1).map(|mut d1_inv| {
+            let bytes = d1_inv.to_bytes_be();
+            d1_inv.zeroize();
+            bytes
+        });
+        d1.zeroize();
+        result
+    }
+
+    /// 计算 d1⁻¹ mod n，结果直接写入安全内存池
+    pub fn invert_d1_secret(&self, d1: &[u8]) -> Result<SecretScalar> {
+        let mut d1_inv = SecretScalar::zero();
+        let mut d1 = Scalar::from_bytes_be(d1)?;
+        let result = Self::invert_scalar(&d1).map(|mut inverse| {
+            inverse.write_be(d1_inv.as_mut_array());
+            inverse.zeroize();
+        });
+        d1.zeroize();
+        result.map(|_| d1_inv)
+    }
+
+    /// 批量计算多个 d1 的逆元，N 个密钥只做一次求逆（Montgomery 技巧）
+    pub fn invert_d1_batch(&self, d1s: &[&[u8]]) -> Result<Vec<Vec<u8>>> {
+        let mut values = d1s.iter().map(|d1| Scalar::from_bytes_be(d1)).collect::<Result<Vec<_>>>()?;
+        if values.iter().any(Scalar::is_zero) {
+            return Err(Error::InvalidParam("D1 must not be zero".to_string()));
+        }
+        Scalar::batch_invert(&mut values);
+        Ok(values.iter().map(|v| v.to_bytes_be().to_vec()).collect())
+    }
+
+    fn invert_scalar(d1: &Scalar) -> Result<Scalar> {
+        d1.invert().ok_or_else(|| Error::InvalidParam("D1 must not be zero".to_string()))
+    }
+
+    fn finish_signature(
+        k1: &[u8],
+        d1: &Scalar,
+        d1_inv: &Scalar,
+        r: &[u8],
+        s2: &[u8],
+        s3: &[u8],
+        out: &mut [u8; 64],
+    ) -> Result<()> {
+        let mut k1_s = Scalar::from_bytes_be(k1)?;
+        let r_s = Scalar::from_bytes_be(r)?;
+        let s2_s = Scalar::from_bytes_be(s2)?;
+        let s3_s = Scalar::from_bytes_be(s3)?;
+
+        // s = (k1·s2 + s3 - r·d1) · d1⁻¹ mod n
+        // Reason: 服务端用 d2 计算 s2/s3，客户端需乘 d1⁻¹ 来抵消 d1，还原标准 SM2 签名
+        let s = (k1_s * s2_s + s3_s - r_s * *d1) * *d1_inv;
+        k1_s.zeroize();
+
+        out[..32].fill(0);
+        out[32 - r.len()..32].copy_from_slice(r);
+        out[32..].copy_from_slice(&s.to_bytes_be());
+        Ok(())
     }
 
     /// 解密预处理：计算 T1 = d1 * C1
     /// 注意：此功能需要 libsm 的椭圆曲线点乘运算，gm-sdk-rs 不支持
+    ///
+    /// C1 可以是 64 字节 x||y，也可以带 04 前缀（65 字节）。
     pub fn decrypt_prepare(&self, d1: &[u8], c1: &[u8]) -> Result<Vec<u8>> {
-        if c1.len() != 64 {
-            return Err(Error::Crypto("Invalid C1 length, expected 64 bytes".to_string()));
-        }
-        
-        let x_bytes = &c1[0..32];
-        let y_bytes = &c1[32..64];
-        
-        let x = libsm::sm2::field::FieldElem::from_bytes(x_bytes)
-            .map_err(|e| Error::Crypto(e.to_string()))?;
-        let y = libsm::sm2::field::FieldElem::from_bytes(y_bytes)
-            .map_err(|e| Error::Crypto(e.to_string()))?;
-        
-        let c1_point = self.ecc.new_point(&x, &y).map_err(|e| Error::Crypto(e.to_string()))?;
-        
-        let d1_big = BigUint::from_bytes_be(d1);
-        let t1_point = self.ecc.mul(&d1_big, &c1_point).map_err(|e| Error::Crypto(e.to_string()))?;
-        
-        let (x, y) = self.ecc.to_affine(&t1_point).map_err(|e| Error::Crypto(e.to_string()))?;
-        let x_bytes = x.to_bytes();
-        let y_bytes = y.to_bytes();
-        
-        let mut t1_bytes = vec![0u8; 64];
-        let x_len = x_bytes.len();
-        let y_len = y_bytes.len();
-        t1_bytes[32 - x_len..32].copy_from_slice(&x_bytes);
-        t1_bytes[64 - y_len..64].copy_from_slice(&y_bytes);
-        
-        Ok(t1_bytes)
+        Ok(self.decrypt_prepare_array(d1, c1)?.to_vec())
+    }
+
+    /// 解密预处理（定长）：返回 64 字节 T1
+    pub fn decrypt_prepare_array(&self, d1: &[u8], c1: &[u8]) -> Result<PointBytes> {
+        let mut t1 = [0u8; 64];
+        self.decrypt_prepare_into(d1, c1, &mut t1)?;
+        Ok(t1)
+    }
+
+    /// 解密预处理，T1 写入调用方缓冲区
+    pub fn decrypt_prepare_into(&self, d1: &[u8], c1: &[u8], out: &mut PointBytes) -> Result<()> {
+        let _span = metrics::span(Phase::DecryptPrepare);
+        self.point_mul_into(d1, c1, "C1", out)
     }
 
     /// 完成解密计算
@@ -177,7 +546,7 @@ impl CoSignProtocol {
     ///
     /// 参数：
     ///   t2:  服务端返回的 T2 = d2Inv * T1（64字节，x||y）
-    ///   c1:  密文中的 C1 坐标（64字节，无04前缀，x||y）
+    ///   c1:  密文中的 C1 坐标（64字节 x||y，或带 04 前缀的 65 字节）
     ///   c3:  完整性校验哈希（32字节）
     ///   c2:  加密后的密文数据
     pub fn complete_decryption(
@@ -187,27 +556,66 @@ impl CoSignProtocol {
         c3: &[u8],
         c2: &[u8],
     ) -> Result<Vec<u8>> {
+        let mut plaintext = vec![0u8; c2.len()];
+        self.complete_decryption_into(t2, c1, c3, c2, &mut plaintext)?;
+        Ok(plaintext)
+    }
+
+    /// 完成解密计算，明文写入调用方缓冲区（长度必须等于 C2）
+    ///
+    /// C3 校验失败时缓冲区被清零。
+    pub fn complete_decryption_into(
+        &self,
+        t2: &[u8],
+        c1: &[u8],
+        c3: &[u8],
+        c2: &[u8],
+        out: &mut [u8],
+    ) -> Result<()> {
+        let _span = metrics::span(Phase::CompleteDecryption);
         if t2.len() != 64 {
             return Err(Error::Crypto("Invalid T2 length, expected 64 bytes".to_string()));
         }
-        if c1.len() != 64 {
-            return Err(Error::Crypto("Invalid C1 length, expected 64 bytes".to_string()));
+        if out.len() != c2.len() {
+            return Err(Error::InvalidParam(format!(
+                "Plaintext buffer must be {} bytes, got {}",
+                c2.len(),
+                out.len()
+            )));
         }
 
-        // 解析 T2 和 C1 为椭圆曲线点
-        let t2_x = libsm::sm2::field::FieldElem::from_bytes(&t2[0..32])
-            .map_err(|e| Error::Crypto(e.to_string()))?;
-        let t2_y = libsm::sm2::field::FieldElem::from_bytes(&t2[32..64])
-            .map_err(|e| Error::Crypto(e.to_string()))?;
-        let t2_point = self.ecc.new_point(&t2_x, &t2_y)
-            .map_err(|e| Error::Crypto(e.to_string()))?;
+        let mut shared_coord = self.decryption_shared_point(t2, c1)?;
 
-        let c1_x = libsm::sm2::field::FieldElem::from_bytes(&c1[0..32])
-            .map_err(|e| Error::Crypto(e.to_string()))?;
-        let c1_y = libsm::sm2::field::FieldElem::from_bytes(&c1[32..64])
-            .map_err(|e| Error::Crypto(e.to_string()))?;
-        let c1_point = self.ecc.new_point(&c1_x, &c1_y)
-            .map_err(|e| Error::Crypto(e.to_string()))?;
+        // 用 KDF 派生密钥流解密 C2，同一遍内校验 C3 = SM3(shared_x || shared_y || plaintext)
+        let valid = kdf_decrypt(&shared_coord, c2, c3, out);
+        shared_coord.zeroize();
+        if !valid {
+            return Err(Error::Crypto("Decryption integrity check failed (C3 mismatch)".to_string()));
+        }
+
+        Ok(())
+    }
+
+    /// 开始流式完成解密：C2 可分块送入返回的 `DecryptStream`，不必一次性读入内存
+    ///
+    /// 各分块解密后即可输出，但 C3 只能在全部 C2 处理完后由 `finalize` 校验，
+    /// 校验通过之前输出的明文都未经验证。
+    pub fn decrypt_stream(&self, t2: &[u8], c1: &[u8], c3: &[u8]) -> Result<DecryptStream> {
+        let c3: [u8; 32] = c3
+            .try_into()
+            .map_err(|_| Error::InvalidParam(format!("C3 must be 32 bytes, got {}", c3.len())))?;
+        let mut shared_coord = self.decryption_shared_point(t2, c1)?;
+        let stream = DecryptStream::new(&shared_coord, c3);
+        shared_coord.zeroize();
+        Ok(stream)
+    }
+
+    /// 计算协同解密的共享点 T2 - C1（64 字节 x||y）
+    #[cfg(not(feature = "native-ecc"))]
+    fn decryption_shared_point(&self, t2: &[u8], c1: &[u8]) -> Result<PointBytes> {
+        // 解析 T2 和 C1 为椭圆曲线点
+        let t2_point = self.point_from_bytes(t2, "T2")?;
+        let c1_point = self.point_from_bytes(c1, "C1")?;
 
         // 计算共享点 = T2 - C1（即 T2 + (-C1)）
         // Reason: d·C1 = (d1·d2⁻¹-1)·C1 = T2 - C1，需减去 C1 才能得到正确的共享点
@@ -216,29 +624,20 @@ impl CoSignProtocol {
         let shared_point = self.ecc.add(&t2_point, &neg_c1)
             .map_err(|e| Error::Crypto(e.to_string()))?;
 
-        let (sx, sy) = self.ecc.to_affine(&shared_point)
-            .map_err(|e| Error::Crypto(e.to_string()))?;
-        let sx_bytes = sx.to_bytes();
-        let sy_bytes = sy.to_bytes();
-
-        // 拼接完整的共享点坐标（各补零到32字节）
-        let mut shared_coord = vec![0u8; 64];
-        shared_coord[32 - sx_bytes.len()..32].copy_from_slice(&sx_bytes);
-        shared_coord[64 - sy_bytes.len()..64].copy_from_slice(&sy_bytes);
-
-        // 用 KDF 派生密钥流，解密 C2
-        let key_stream = Self::kdf(&shared_coord, c2.len());
-        let plaintext: Vec<u8> = c2.iter().zip(key_stream.iter()).map(|(c, k)| c ^ k).collect();
-
-        // 校验 C3 完整性：C3 = SM3(shared_x || shared_y || plaintext)
-        let mut c3_input = shared_coord.to_vec();
-        c3_input.extend_from_slice(&plaintext);
-        let c3_check = Self::sm3_hash(&c3_input);
-        if c3_check != c3 {
-            return Err(Error::Crypto("Decryption integrity check failed (C3 mismatch)".to_string()));
-        }
+        let mut shared_coord = [0u8; 64];
+        self.point_to_bytes(&shared_point, &mut shared_coord)?;
+        Ok(shared_coord)
+    }
 
-        Ok(plaintext)
+    /// 计算协同解密的共享点 T2 - C1（64 字节 x||y）
+    #[cfg(feature = "native-ecc")]
+    fn decryption_shared_point(&self, t2: &[u8], c1: &[u8]) -> Result<PointBytes> {
+        let t2_point = native_point(t2, "T2")?;
+        let c1_point = native_point(c1, "C1")?;
+        // Reason: d·C1 = (d1·d2⁻¹-1)·C1 = T2 - C1，需减去 C1 才能得到正确的共享点
+        let mut shared_coord = [0u8; 64];
+        native_affine(&t2_point.add(&c1_point.neg()), &mut shared_coord)?;
+        Ok(shared_coord)
     }
 
     /// SM2 签名（标准签名，非协同）
@@ -277,118 +676,409 @@ impl CoSignProtocol {
         Ok(sm2_verify(&pk65, message, &sig))
     }
 
+    /// 批量 SM2 验签（标准验签，非协同），返回每一项是否有效
+    ///
+    /// 每个签名用交错双标量点乘一次算出 s·G + t·PA；批内重复出现的公钥只解析一次，
+    /// 共用同一张窗口表和 Z 中间状态。各项在 rayon 线程池上并行验证，
+    /// 公钥、签名格式错误的项视为无效，不影响其余项。结果与逐项调用 `verify` 一致。
+    pub fn verify_batch(&self, items: &[VerifyItem<'_>]) -> Vec<bool> {
+        let g = match self.g_window() {
+            Ok(g) => g,
+            Err(_) => return vec![false; items.len()],
+        };
+
+        // 按公钥坐标去重，signer[i] 是第 i 项所用公钥在 keys 中的下标
+        let mut index: HashMap<&[u8], usize> = HashMap::new();
+        let mut distinct: Vec<&[u8]> = Vec::new();
+        let signer: Vec<Option<usize>> = items
+            .iter()
+            .map(|item| {
+                let coords = point_coords(item.public_key, "public key").ok()?;
+                Some(*index.entry(coords).or_insert_with(|| {
+                    distinct.push(coords);
+                    distinct.len() - 1
+                }))
+            })
+            .collect();
+        let keys: Vec<Option<(WindowTable, Sm3)>> = distinct
+            .par_iter()
+            .map(|coords| {
+                let point = self.point_from_bytes(coords, "public key").ok()?;
+                let table = WindowTable::new(self.ecc, &point).ok()?;
+                Some((table, self.message_hasher(coords).ok()?))
+            })
+            .collect();
+
+        items
+            .par_iter()
+            .zip(signer.par_iter())
+            .map(|(item, signer)| match signer.and_then(|i| keys[i].as_ref()) {
+                Some((table, z_hasher)) => self.verify_one(g, table, z_hasher, item).unwrap_or(false),
+                None => false,
+            })
+            .collect()
+    }
+
+    /// 批量验签用的 G 窗口表，进程内共享，首次批量验签时构建
+    fn g_window(&self) -> Result<&'static WindowTable> {
+        static G_WINDOW: OnceLock<WindowTable> = OnceLock::new();
+        if let Some(table) = G_WINDOW.get() {
+            return Ok(table);
+        }
+        let gx = FieldElem::from_bytes(&GX).map_err(|e| Error::Crypto(e.to_string()))?;
+        let gy = FieldElem::from_bytes(&GY).map_err(|e| Error::Crypto(e.to_string()))?;
+        let g = self.ecc.new_point(&gx, &gy).map_err(|e| Error::Crypto(e.to_string()))?;
+        let table = WindowTable::new(self.ecc, &g)?;
+        Ok(G_WINDOW.get_or_init(|| table))
+    }
+
+    /// 验证一项：r, s ∈ [1, n-1]，t = r + s ≠ 0，(e + x1) mod n == r，(x1, y1) = s·G + t·PA
+    fn verify_one(&self, g: &WindowTable, pa: &WindowTable, z_hasher: &Sm3, item: &VerifyItem<'_>) -> Result<bool> {
+        if item.signature.len() != 64 {
+            return Ok(false);
+        }
+        let r_bytes: ScalarBytes = item.signature[..32].try_into().expect("32-byte slice");
+        let s_bytes: ScalarBytes = item.signature[32..].try_into().expect("32-byte slice");
+        let (r, s) = match (Scalar::from_canonical(&r_bytes), Scalar::from_canonical(&s_bytes)) {
+            (Some(r), Some(s)) if !r.is_zero() && !s.is_zero() => (r, s),
+            _ => return Ok(false),
+        };
+        let t = r + s;
+        if t.is_zero() {
+            return Ok(false);
+        }
+
+        let mut hasher = z_hasher.clone();
+        hasher.update(item.message);
+        let e = Scalar::from_be_array(&hasher.finalize());
+
+        let Some(point) = double_scalar_mul(self.ecc, g, pa, &s_bytes, &t.to_bytes_be())? else {
+            return Ok(false);
+        };
+        let (x1, _) = self.ecc.to_affine(&point).map_err(|e| Error::Crypto(e.to_string()))?;
+        let x1 = Scalar::from_bytes_be(&x1.to_bytes())?;
+        Ok(e + x1 == r)
+    }
+
     /// SM2 加密（标准加密，非协同）
     /// 注意：gm-sdk-rs 未提供加密功能，使用 libsm 实现
     pub fn encrypt(public_key: &[u8], message: &[u8]) -> Result<Vec<u8>> {
+        let mut ciphertext = vec![0u8; ciphertext_len(message.len())];
+        Self::encrypt_into(public_key, message, &mut ciphertext)?;
+        Ok(ciphertext)
+    }
+
+    /// SM2 加密，密文直接写入调用方缓冲区（长度必须等于 `ciphertext_len(message.len())`）
+    pub fn encrypt_into(public_key: &[u8], message: &[u8], out: &mut [u8]) -> Result<()> {
         if public_key.len() != 64 {
             return Err(Error::Crypto("Invalid public key length".to_string()));
         }
+        if out.len() != ciphertext_len(message.len()) {
+            return Err(Error::InvalidParam(format!(
+                "Ciphertext buffer must be {} bytes, got {}",
+                ciphertext_len(message.len()),
+                out.len()
+            )));
+        }
         
-        let ecc = EccCtx::new();
-        
-        let x = libsm::sm2::field::FieldElem::from_bytes(&public_key[0..32])
-            .map_err(|e| Error::Crypto(e.to_string()))?;
-        let y = libsm::sm2::field::FieldElem::from_bytes(&public_key[32..64])
-            .map_err(|e| Error::Crypto(e.to_string()))?;
-        let pub_point = ecc.new_point(&x, &y).map_err(|e| Error::Crypto(e.to_string()))?;
-        
-        let k = ecc.random_uint();
-        
-        let c1 = ecc.g_mul(&k).map_err(|e| Error::Crypto(e.to_string()))?;
-        let (c1_x, c1_y) = ecc.to_affine(&c1).map_err(|e| Error::Crypto(e.to_string()))?;
-        
-        let k_pa = ecc.mul(&k, &pub_point).map_err(|e| Error::Crypto(e.to_string()))?;
-        let (k_pa_x, k_pa_y) = ecc.to_affine(&k_pa).map_err(|e| Error::Crypto(e.to_string()))?;
-        
-        let mut kdf_input = Vec::new();
-        kdf_input.extend_from_slice(&k_pa_x.to_bytes());
-        kdf_input.extend_from_slice(&k_pa_y.to_bytes());
-        
-        let kdf_output = Self::kdf(&kdf_input, message.len());
-        let c2: Vec<u8> = message.iter().zip(kdf_output.iter()).map(|(m, k)| m ^ k).collect();
-        
-        let mut c3_input = Vec::new();
-        c3_input.extend_from_slice(&k_pa_x.to_bytes());
-        c3_input.extend_from_slice(&k_pa_y.to_bytes());
-        c3_input.extend_from_slice(message);
-        let c3 = Self::sm3_hash(&c3_input);
-        
-        let mut ciphertext = Vec::new();
-        ciphertext.push(0x04);
-        let c1_x_bytes = c1_x.to_bytes();
-        let c1_y_bytes = c1_y.to_bytes();
-        ciphertext.extend_from_slice(&vec![0u8; 32 - c1_x_bytes.len()]);
-        ciphertext.extend_from_slice(&c1_x_bytes);
-        ciphertext.extend_from_slice(&vec![0u8; 32 - c1_y_bytes.len()]);
-        ciphertext.extend_from_slice(&c1_y_bytes);
-        ciphertext.extend_from_slice(&c3);
-        ciphertext.extend_from_slice(&c2);
-        
-        Ok(ciphertext)
+        // 密文布局：04 || C1 || C3 || C2，C2 直接写入密文缓冲区
+        let mut shared_coord = [0u8; 64];
+        out[0] = 0x04;
+        let c1_out: &mut PointBytes = (&mut out[1..65]).try_into().unwrap();
+        encrypt_points(public_key, c1_out, &mut shared_coord)?;
+        let (c3_out, c2_out) = out[65..].split_at_mut(32);
+        c3_out.copy_from_slice(&kdf_encrypt(&shared_coord, message, c2_out));
+        shared_coord.zeroize();
+
+        Ok(())
     }
 
     /// SM2 解密（标准解密，非协同）
     /// 注意：gm-sdk-rs 未提供解密功能，使用 libsm 实现
     pub fn decrypt(private_key: &[u8], ciphertext: &[u8]) -> Result<Option<Vec<u8>>> {
-        if ciphertext.len() < 97 {
+        let len = match plaintext_len(ciphertext.len()) {
+            Some(len) => len,
+            None => return Ok(None),
+        };
+        let mut plaintext = vec![0u8; len];
+        if !Self::decrypt_into(private_key, ciphertext, &mut plaintext)? {
             return Ok(None);
         }
-        
-        let ecc = EccCtx::new();
+        Ok(Some(plaintext))
+    }
+
+    /// SM2 解密，明文直接写入调用方缓冲区（长度必须等于 `plaintext_len(ciphertext.len())`）
+    ///
+    /// 密文格式或 C3 校验失败时返回 `Ok(false)`，缓冲区被清零。
+    pub fn decrypt_into(private_key: &[u8], ciphertext: &[u8], out: &mut [u8]) -> Result<bool> {
+        let len = match plaintext_len(ciphertext.len()) {
+            Some(len) => len,
+            None => return Ok(false),
+        };
+        if out.len() != len {
+            return Err(Error::InvalidParam(format!(
+                "Plaintext buffer must be {} bytes, got {}",
+                len,
+                out.len()
+            )));
+        }
         
         if ciphertext[0] != 0x04 {
-            return Ok(None);
+            return Ok(false);
         }
-        
-        let c1_x = libsm::sm2::field::FieldElem::from_bytes(&ciphertext[1..33])
-            .map_err(|_| Error::Crypto("Invalid C1 x coordinate".to_string()))?;
-        let c1_y = libsm::sm2::field::FieldElem::from_bytes(&ciphertext[33..65])
-            .map_err(|_| Error::Crypto("Invalid C1 y coordinate".to_string()))?;
-        let c1 = ecc.new_point(&c1_x, &c1_y).map_err(|e| Error::Crypto(e.to_string()))?;
-        
+
+        let c1 = &ciphertext[1..65];
         let c3 = &ciphertext[65..97];
         let c2 = &ciphertext[97..];
-        
-        let d = BigUint::from_bytes_be(private_key);
-        let d_c1 = ecc.mul(&d, &c1).map_err(|e| Error::Crypto(e.to_string()))?;
-        let (d_c1_x, d_c1_y) = ecc.to_affine(&d_c1).map_err(|e| Error::Crypto(e.to_string()))?;
-        
-        let mut kdf_input = Vec::new();
-        kdf_input.extend_from_slice(&d_c1_x.to_bytes());
-        kdf_input.extend_from_slice(&d_c1_y.to_bytes());
-        
-        let kdf_output = Self::kdf(&kdf_input, c2.len());
-        let plaintext: Vec<u8> = c2.iter().zip(kdf_output.iter()).map(|(c, k)| c ^ k).collect();
-        
-        let mut c3_input = Vec::new();
-        c3_input.extend_from_slice(&d_c1_x.to_bytes());
-        c3_input.extend_from_slice(&d_c1_y.to_bytes());
-        c3_input.extend_from_slice(&plaintext);
-        let c3_check = Self::sm3_hash(&c3_input);
-        
-        if c3_check != c3 {
-            return Ok(None);
+
+        let mut shared_coord = [0u8; 64];
+        decrypt_point(private_key, c1, &mut shared_coord)?;
+
+        let valid = kdf_decrypt(&shared_coord, c2, c3, out);
+        shared_coord.zeroize();
+        Ok(valid)
+    }
+}
+
+/// 密文固定开销：04 || C1(64) || C3(32)
+pub const CIPHERTEXT_OVERHEAD: usize = 97;
+
+/// 明文长度为 `message_len` 时的密文长度（04 || C1 || C3 || C2）
+pub const fn ciphertext_len(message_len: usize) -> usize {
+    CIPHERTEXT_OVERHEAD + message_len
+}
+
+/// 同 `ciphertext_len`，用于调用方传入的长度：结果溢出或超过 `isize::MAX`（无法构成切片）时返回 `None`
+pub const fn ciphertext_len_checked(message_len: usize) -> Option<usize> {
+    match CIPHERTEXT_OVERHEAD.checked_add(message_len) {
+        Some(len) if len <= isize::MAX as usize => Some(len),
+        _ => None,
+    }
+}
+
+/// 密文长度对应的明文长度，密文过短时返回 `None`
+pub const fn plaintext_len(ciphertext_len: usize) -> Option<usize> {
+    ciphertext_len.checked_sub(CIPHERTEXT_OVERHEAD)
+}
+
+/// 加密的点运算：C1 = k·G，共享点 k·PA（k 为随机数）
+#[cfg(not(feature = "native-ecc"))]
+fn encrypt_points(public_key: &[u8], c1: &mut PointBytes, shared: &mut PointBytes) -> Result<()> {
+    let ecc = ecc_ctx();
+
+    let x = FieldElem::from_bytes(&public_key[0..32]).map_err(|e| Error::Crypto(e.to_string()))?;
+    let y = FieldElem::from_bytes(&public_key[32..64]).map_err(|e| Error::Crypto(e.to_string()))?;
+    let pub_point = ecc.new_point(&x, &y).map_err(|e| Error::Crypto(e.to_string()))?;
+
+    let k = ecc.random_uint();
+    let c1_point = ecc.g_mul(&k).map_err(|e| Error::Crypto(e.to_string()))?;
+    let k_pa = ecc.mul(&k, &pub_point).map_err(|e| Error::Crypto(e.to_string()))?;
+    encode_point(ecc, &k_pa, shared)?;
+    encode_point(ecc, &c1_point, c1)
+}
+
+/// 加密的点运算：C1 = k·G，共享点 k·PA（k 为随机数）
+#[cfg(feature = "native-ecc")]
+fn encrypt_points(public_key: &[u8], c1: &mut PointBytes, shared: &mut PointBytes) -> Result<()> {
+    let pub_point = native_point(public_key, "public key")?;
+    let mut k = CoSignProtocol::random_scalar();
+    let result = native_affine(&pub_point.mul(&k), shared)
+        .and_then(|_| native_affine(&curve::base_table().mul(&k), c1));
+    k.zeroize();
+    result
+}
+
+/// 解密的点运算：共享点 d·C1
+#[cfg(not(feature = "native-ecc"))]
+fn decrypt_point(private_key: &[u8], c1: &[u8], shared: &mut PointBytes) -> Result<()> {
+    let ecc = ecc_ctx();
+    let c1_x = FieldElem::from_bytes(&c1[0..32]).map_err(|_| Error::Crypto("Invalid C1 x coordinate".to_string()))?;
+    let c1_y = FieldElem::from_bytes(&c1[32..64]).map_err(|_| Error::Crypto("Invalid C1 y coordinate".to_string()))?;
+    let c1 = ecc.new_point(&c1_x, &c1_y).map_err(|e| Error::Crypto(e.to_string()))?;
+
+    let d = BigUint::from_bytes_be(private_key);
+    let d_c1 = ecc.mul(&d, &c1).map_err(|e| Error::Crypto(e.to_string()))?;
+    encode_point(ecc, &d_c1, shared)
+}
+
+/// 解密的点运算：共享点 d·C1
+#[cfg(feature = "native-ecc")]
+fn decrypt_point(private_key: &[u8], c1: &[u8], shared: &mut PointBytes) -> Result<()> {
+    native_point_mul(private_key, c1, "C1", shared)
+}
+
+/// 解析 64 字节 x||y 或 65 字节 04||x||y 为曲线点
+#[cfg(feature = "native-ecc")]
+fn native_point(bytes: &[u8], name: &str) -> Result<ProjectivePoint> {
+    let coords: &PointBytes = point_coords(bytes, name)?.try_into().unwrap();
+    ProjectivePoint::from_affine_bytes(coords)
+        .ok_or_else(|| Error::Crypto(format!("{} is not a valid curve point", name)))
+}
+
+/// 把点写成 64 字节仿射坐标 x||y，无穷远点报错
+#[cfg(feature = "native-ecc")]
+fn native_affine(point: &ProjectivePoint, out: &mut PointBytes) -> Result<()> {
+    *out = point
+        .to_affine_bytes()
+        .ok_or_else(|| Error::Crypto("Result is the point at infinity".to_string()))?;
+    Ok(())
+}
+
+/// k·P（常数时间），k 不超过 32 字节
+#[cfg(feature = "native-ecc")]
+fn native_point_mul(k: &[u8], point: &[u8], name: &str, out: &mut PointBytes) -> Result<()> {
+    let point = native_point(point, name)?;
+    let mut k = pad_scalar(k)?;
+    let product = point.mul(&k);
+    k.zeroize();
+    native_affine(&product, out)
+}
+
+/// 把点转换为 64 字节仿射坐标 x||y（各补零到 32 字节）
+#[cfg_attr(feature = "native-ecc", allow(dead_code))]
+fn encode_point(ecc: &EccCtx, point: &Point, out: &mut PointBytes) -> Result<()> {
+    let (x, y) = ecc.to_affine(point).map_err(|e| Error::Crypto(e.to_string()))?;
+    let x_bytes = x.to_bytes();
+    let y_bytes = y.to_bytes();
+    out.fill(0);
+    out[32 - x_bytes.len()..32].copy_from_slice(&x_bytes);
+    out[64 - y_bytes.len()..64].copy_from_slice(&y_bytes);
+    Ok(())
+}
+
+/// 加解密单遍处理的分块大小：KDF 异或与 C3 哈希在同一块数据仍在缓存中时完成
+const CIPHER_CHUNK: usize = 4096;
+
+/// C2 不短于该长度时走并行路径（更短的数据调度开销大于收益）
+const PARALLEL_THRESHOLD: usize = 1024 * 1024;
+
+/// 并行路径的流水线段长：一段的密钥流在线程池上并行异或的同时，哈希上一段
+const PIPELINE_SEGMENT: usize = 4 * 1024 * 1024;
+
+/// 加密：C2 = M ⊕ KDF(shared)，返回 C3 = SM3(shared || M)
+fn kdf_encrypt(shared: &PointBytes, message: &[u8], c2_out: &mut [u8]) -> [u8; 32] {
+    let mut c3 = Sm3::new();
+    c3.update(shared);
+    if message.len() >= PARALLEL_THRESHOLD {
+        // Reason: C3 只依赖明文，哈希与并行异或可整体重叠
+        c2_out.copy_from_slice(message);
+        rayon::join(|| c3.update(message), || kdf::apply_parallel(shared, 0, c2_out));
+        return c3.finalize();
+    }
+
+    let mut keystream = KdfStream::new(shared);
+    for (m, c) in message.chunks(CIPHER_CHUNK).zip(c2_out.chunks_mut(CIPHER_CHUNK)) {
+        c3.update(m);
+        c.copy_from_slice(m);
+        keystream.apply(c);
+    }
+    c3.finalize()
+}
+
+/// 解密：M = C2 ⊕ KDF(shared)，同时校验 C3；校验失败时清零输出并返回 false
+fn kdf_decrypt(shared: &PointBytes, c2: &[u8], c3: &[u8], out: &mut [u8]) -> bool {
+    let mut c3_check = Sm3::new();
+    c3_check.update(shared);
+    if c2.len() >= PARALLEL_THRESHOLD {
+        // C3 依赖明文，按段流水：第 i 段并行异或的同时串行哈希第 i-1 段
+        let mut previous: &[u8] = &[];
+        for (i, (c, m)) in c2.chunks(PIPELINE_SEGMENT).zip(out.chunks_mut(PIPELINE_SEGMENT)).enumerate() {
+            m.copy_from_slice(c);
+            rayon::join(
+                || c3_check.update(previous),
+                || kdf::apply_parallel(shared, i * PIPELINE_SEGMENT, m),
+            );
+            previous = m;
         }
-        
-        Ok(Some(plaintext))
+        c3_check.update(previous);
+    } else {
+        let mut keystream = KdfStream::new(shared);
+        for (c, m) in c2.chunks(CIPHER_CHUNK).zip(out.chunks_mut(CIPHER_CHUNK)) {
+            m.copy_from_slice(c);
+            keystream.apply(m);
+            c3_check.update(m);
+        }
+    }
+    if c3_check.finalize()[..] != *c3 {
+        out.zeroize();
+        return false;
     }
+    true
+}
 
-    /// KDF 密钥派生函数
-    /// 注意：gm-sdk-rs 未提供 KDF 功能
-    fn kdf(z: &[u8], klen: usize) -> Vec<u8> {
-        let mut result = Vec::new();
-        let mut ct = 1u32;
-        
-        while result.len() < klen {
-            let mut input = z.to_vec();
-            input.extend_from_slice(&ct.to_be_bytes());
-            let hash = Self::sm3_hash(&input);
-            result.extend_from_slice(&hash);
-            ct += 1;
+/// 取出 64 字节 x||y 或 65 字节 04||x||y 中的坐标部分
+pub(crate) fn point_coords<'a>(bytes: &'a [u8], name: &str) -> Result<&'a [u8]> {
+    match bytes.len() {
+        64 => Ok(bytes),
+        65 if bytes[0] == 0x04 => Ok(&bytes[1..]),
+        _ => Err(Error::Crypto(format!(
+            "Invalid {} length, expected 64 bytes (or 65 with 0x04 prefix)",
+            name
+        ))),
+    }
+}
+
+/// 把不超过 32 字节的大端标量左侧补零到 32 字节
+pub(crate) fn pad_scalar(bytes: &[u8]) -> Result<ScalarBytes> {
+    if bytes.len() > 32 {
+        return Err(Error::InvalidParam(format!(
+            "Scalar must be at most 32 bytes, got {}",
+            bytes.len()
+        )));
+    }
+    let mut out = [0u8; 32];
+    out[32 - bytes.len()..].copy_from_slice(bytes);
+    Ok(out)
+}
+
+/// 流式解密上下文（见 `CoSignProtocol::decrypt_stream`）
+pub struct DecryptStream {
+    keystream: KdfStream,
+    /// SM3(shared || 已解密明文)
+    c3_check: Sm3,
+    c3: [u8; 32],
+    processed: u64,
+}
+
+impl DecryptStream {
+    fn new(shared: &PointBytes, c3: [u8; 32]) -> Self {
+        let mut c3_check = Sm3::new();
+        c3_check.update(shared);
+        Self {
+            keystream: KdfStream::new(shared),
+            c3_check,
+            c3,
+            processed: 0,
         }
-        
-        result.truncate(klen);
-        result
+    }
+
+    /// 原地解密下一段 C2，密文分块可任意切分
+    pub fn update(&mut self, data: &mut [u8]) {
+        for chunk in data.chunks_mut(CIPHER_CHUNK) {
+            self.keystream.apply(chunk);
+            self.c3_check.update(chunk);
+        }
+        self.processed += data.len() as u64;
+    }
+
+    /// 已解密的字节数
+    pub fn processed(&self) -> u64 {
+        self.processed
+    }
+
+    /// C2 全部送入后校验 C3，失败时返回 `Error::Crypto`，此前输出的明文必须丢弃
+    pub fn finalize(self) -> Result<()> {
+        if self.c3_check.finalize() != self.c3 {
+            return Err(Error::Crypto("Decryption integrity check failed (C3 mismatch)".to_string()));
+        }
+        Ok(())
+    }
+}
+
+impl std::fmt::Debug for DecryptStream {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        // 不输出密钥流状态
+        f.debug_struct("DecryptStream").field("processed", &self.processed).finish()
     }
 }
 
@@ -400,17 +1090,64 @@ impl Default for CoSignProtocol {
 
 /// Base64 编码
 pub fn base64_encode(data: &[u8]) -> String {
-    BASE64.encode(data)
+    let mut out = vec![0u8; base64_encoded_len(data.len())];
+    base64_codec::encode_into(data, &mut out).expect("buffer sized by encoded_len");
+    // Reason: 输出只含 Base64 字母表与 '='，必为 ASCII
+    String::from_utf8(out).expect("base64 output is ASCII")
+}
+
+/// Base64 编码后的长度（含填充，不含结尾 NUL）
+pub const fn base64_encoded_len(data_len: usize) -> usize {
+    base64_codec::encoded_len(data_len)
+}
+
+/// Base64 编码，直接写入调用方缓冲区，返回写入长度
+///
+/// 缓冲区至少为 `base64_encoded_len(data.len())` 字节。
+pub fn base64_encode_into(data: &[u8], out: &mut [u8]) -> Result<usize> {
+    base64_codec::encode_into(data, out)
 }
 
 /// Base64 解码
 pub fn base64_decode(data: &str) -> Result<Vec<u8>> {
-    BASE64.decode(data).map_err(|e| Error::Encoding(e.to_string()))
+    let mut out = vec![0u8; base64_decoded_len(data)?];
+    base64_codec::decode_into(data.as_bytes(), &mut out)?;
+    Ok(out)
+}
+
+/// Base64 解码后的长度（只检查长度与填充）
+pub fn base64_decoded_len(data: &str) -> Result<usize> {
+    base64_codec::decoded_len(data.as_bytes())
+}
+
+/// Base64 解码，直接写入调用方缓冲区，返回写入长度
+///
+/// 缓冲区至少为 `base64_decoded_len(data)` 字节。
+pub fn base64_decode_into(data: &str, out: &mut [u8]) -> Result<usize> {
+    base64_codec::decode_into(data.as_bytes(), out)
+}
+
+/// 解码 Base64 标量字段，省略的前导零补齐到 32 字节
+pub(crate) fn base64_decode_scalar(data: &str) -> Result<ScalarBytes> {
+    base64_codec::decode_padded(data.as_bytes())
+}
+
+/// 解码 Base64 点字段（64 字节 x||y 或 65 字节 04||x||y），返回坐标部分
+pub(crate) fn base64_decode_point(data: &str, name: &str) -> Result<PointBytes> {
+    let mut buf = [0u8; 65];
+    let len = base64_decoded_len(data)?;
+    let decoded = buf
+        .get_mut(..len)
+        .ok_or_else(|| Error::Crypto(format!("Invalid {} length, expected 64 bytes (or 65 with 0x04 prefix)", name)))?;
+    base64_decode_into(data, decoded)?;
+    let coords = point_coords(decoded, name)?;
+    Ok(coords.try_into().expect("64-byte coordinates"))
 }
 
 #[cfg(test)]
 mod tests {
     use super::*;
+    use num_bigint::BigUint;
 
     #[test]
     fn test_generate_d1() {
@@ -428,6 +1165,17 @@ mod tests {
         assert_eq!(p1.len(), 64);
     }
 
+    #[test]
+    fn test_fixed_base_matches_generic() {
+        let generic = CoSignProtocol::with_fixed_base(FixedBase::Generic).unwrap();
+        let windowed = CoSignProtocol::with_fixed_base(FixedBase::Window(6)).unwrap();
+        assert_eq!(generic.fixed_base(), FixedBase::Generic);
+        assert_eq!(windowed.fixed_base(), FixedBase::Window(6));
+
+        let d1 = generic.generate_d1().unwrap();
+        assert_eq!(generic.calculate_p1(&d1).unwrap(), windowed.calculate_p1(&d1).unwrap());
+    }
+
     #[test]
     fn test_sm3_hash() {
         let data = b"hello world";
@@ -435,6 +1183,50 @@ mod tests {
         assert_eq!(hash.len(), 32);
     }
 
+    #[test]
+    fn test_message_hasher_matches_oneshot() {
+        let protocol = CoSignProtocol::new().unwrap();
+        let message = vec![0x5au8; 4096 + 17];
+        let expected = protocol.calculate_message_hash(&message, &[]).unwrap();
+
+        let mut hasher = protocol.message_hasher(&[]).unwrap();
+        for chunk in message.chunks(1000) {
+            hasher.update(chunk);
+        }
+        assert_eq!(hasher.finalize().to_vec(), expected);
+    }
+
+    #[test]
+    fn test_message_hash_matches_standard_sm2() {
+        use gm_sdk::sm2::sm2_generate_keypair;
+
+        // 用标准 SM2 签名，再用我们计算的 E 验证 r = (e + x1) mod n
+        let protocol = CoSignProtocol::new().unwrap();
+        let (private_key, public_key) = sm2_generate_keypair();
+        let message = b"transaction payload";
+        let signature = CoSignProtocol::sign(&private_key, message).unwrap();
+
+        let e = protocol.calculate_message_hash(message, &public_key).unwrap();
+        let n = protocol.ecc.get_n();
+        let r = BigUint::from_bytes_be(&signature[..32]);
+        let s = BigUint::from_bytes_be(&signature[32..]);
+        let t = (&r + &s) % n;
+        let pk = protocol.point_from_bytes(&public_key, "public key").unwrap();
+        let point = protocol
+            .ecc
+            .add(&protocol.ecc.g_mul(&s).unwrap(), &protocol.ecc.mul(&t, &pk).unwrap())
+            .unwrap();
+        let (x1, _) = protocol.ecc.to_affine(&point).unwrap();
+        assert_eq!((BigUint::from_bytes_be(&e) + BigUint::from_bytes_be(&x1.to_bytes())) % n, r);
+
+        // 64 字节与 65 字节公钥得到相同的 Z
+        assert_eq!(
+            CoSignProtocol::compute_z(&public_key, DEFAULT_USER_ID).unwrap(),
+            CoSignProtocol::compute_z(&public_key[1..], DEFAULT_USER_ID).unwrap()
+        );
+        assert!(protocol.calculate_message_hash(message, &public_key[..10]).is_err());
+    }
+
     #[test]
     fn test_sign_prepare() {
         let protocol = CoSignProtocol::new().unwrap();
@@ -455,7 +1247,145 @@ mod tests {
         
         let (r_out, s) = protocol.complete_signature(&k1, &d1, &r, &s2, &s3).unwrap();
         assert_eq!(r_out.len(), 32);
-        assert!(s.len() <= 32);
+        assert_eq!(s.len(), 32);
+
+        let d1_inv = protocol.invert_d1(&d1).unwrap();
+        let cached = protocol.complete_signature_with_inverse(&k1, &d1, &d1_inv, &r, &s2, &s3).unwrap();
+        assert_eq!(cached, (r_out, s));
+    }
+
+    #[test]
+    fn test_fixed_width_api() {
+        let protocol = CoSignProtocol::new().unwrap();
+        let d1 = protocol.generate_d1_array().unwrap();
+
+        let mut p1 = [0u8; 64];
+        protocol.calculate_p1_into(&d1, &mut p1).unwrap();
+        assert_eq!(protocol.calculate_p1(&d1).unwrap(), p1.to_vec());
+        // 去掉前导零字节后结果不变
+        let trimmed: Vec<u8> = d1.iter().copied().skip_while(|&b| b == 0).collect();
+        assert_eq!(protocol.calculate_p1_array(&trimmed).unwrap(), p1);
+
+        let (k1, q1) = protocol.sign_prepare_array().unwrap();
+        assert_eq!(protocol.calculate_p1_array(&k1).unwrap(), q1);
+
+        // C1 带或不带 04 前缀结果相同
+        let mut c1_prefixed = vec![0x04];
+        c1_prefixed.extend_from_slice(&q1);
+        let t1 = protocol.decrypt_prepare_array(&d1, &q1).unwrap();
+        assert_eq!(protocol.decrypt_prepare(&d1, &c1_prefixed).unwrap(), t1.to_vec());
+        assert!(protocol.decrypt_prepare(&d1, &q1[..63]).is_err());
+
+        let d1_inv = protocol.invert_d1_array(&d1).unwrap();
+        let (r, s2, s3) = ([0x11u8; 32], [0x22u8; 32], [0x33u8; 32]);
+        let mut signature = [0u8; 64];
+        protocol.complete_signature_into(&k1, &d1, &d1_inv, &r, &s2, &s3, &mut signature).unwrap();
+        let (r_out, s_out) = protocol.complete_signature(&k1, &d1, &r, &s2, &s3).unwrap();
+        assert_eq!(&signature[..32], r_out.as_slice());
+        assert_eq!(&signature[32..], s_out.as_slice());
+    }
+
+    #[test]
+    fn test_complete_signature_matches_biguint() {
+        let protocol = CoSignProtocol::new().unwrap();
+        let n = protocol.ecc.get_n();
+        let d1 = protocol.generate_d1().unwrap();
+        let (k1, _q1) = protocol.sign_prepare().unwrap();
+        let r = CoSignProtocol::generate_random(32);
+        let s2 = CoSignProtocol::generate_random(32);
+        let s3 = CoSignProtocol::generate_random(32);
+
+        // 通用大整数实现作为参照
+        let big = |b: &[u8]| BigUint::from_bytes_be(b);
+        let d1_inv = big(&d1).modpow(&(n - BigUint::from(2u32)), n);
+        let inner = (big(&k1) * big(&s2) + big(&s3) + n - (big(&r) * big(&d1)) % n) % n;
+        let expected = (inner * &d1_inv) % n;
+
+        let (_, s) = protocol.complete_signature(&k1, &d1, &r, &s2, &s3).unwrap();
+        assert_eq!(BigUint::from_bytes_be(&s), expected);
+        assert_eq!(BigUint::from_bytes_be(&protocol.invert_d1(&d1).unwrap()), d1_inv);
+    }
+
+    #[test]
+    fn test_invert_d1_batch() {
+        let protocol = CoSignProtocol::new().unwrap();
+        let d1s: Vec<Vec<u8>> = (0..4).map(|_| protocol.generate_d1().unwrap()).collect();
+        let refs: Vec<&[u8]> = d1s.iter().map(Vec::as_slice).collect();
+
+        let batch = protocol.invert_d1_batch(&refs).unwrap();
+        for (d1, inv) in d1s.iter().zip(&batch) {
+            assert_eq!(inv, &protocol.invert_d1(d1).unwrap());
+        }
+        assert!(protocol.invert_d1(&[0u8; 32]).is_err());
+        assert!(protocol.invert_d1_batch(&[&d1s[0], &[0u8]]).is_err());
+    }
+
+    #[test]
+    fn test_complete_signature_batch() {
+        let protocol = CoSignProtocol::new().unwrap();
+        let d1 = protocol.generate_d1().unwrap();
+
+        let inputs: Vec<[Vec<u8>; 4]> = (0..3)
+            .map(|_| {
+                let (k1, _q1) = protocol.sign_prepare().unwrap();
+                [k1, CoSignProtocol::generate_random(32), CoSignProtocol::generate_random(32), CoSignProtocol::generate_random(32)]
+            })
+            .collect();
+        let shares: Vec<SignShares> = inputs
+            .iter()
+            .map(|[k1, r, s2, s3]| SignShares { k1, r, s2, s3 })
+            .collect();
+
+        let batch = protocol.complete_signature_batch(&d1, &shares);
+        assert_eq!(batch.len(), 3);
+        for ([k1, r, s2, s3], result) in inputs.iter().zip(batch) {
+            let single = protocol.complete_signature(k1, &d1, r, s2, s3).unwrap();
+            assert_eq!(result.unwrap(), single);
+        }
+    }
+
+    #[test]
+    fn test_precommit_signature_verifies() {
+        // 按预提交方案模拟服务端：随机数与 R 在预提交时算好，签名时只做模 n 运算，结果须能被标准 SM2 验签
+        let protocol = CoSignProtocol::new().unwrap();
+        let ecc = &protocol.ecc;
+        let n = ecc.get_n();
+        let big = |b: &[u8]| BigUint::from_bytes_be(b) % n;
+        let random = || big(&CoSignProtocol::generate_random(32));
+        let encode = |point: &Point| {
+            let mut out = [0u8; 64];
+            protocol.point_to_bytes(point, &mut out).unwrap();
+            out
+        };
+
+        let d1 = protocol.generate_d1().unwrap();
+        let d2 = random();
+        let d2_inv = d2.modpow(&(n - BigUint::from(2u32)), n);
+        let d = (big(&d1) * &d2_inv + n - BigUint::from(1u32)) % n;
+        let pa = encode(&ecc.g_mul(&d).unwrap());
+
+        // 预提交阶段
+        let (k1, q1) = protocol.sign_prepare_array().unwrap();
+        let q1_point = protocol.point_from_bytes(&q1, "Q1").unwrap();
+        let (k2, k3) = (random(), random());
+        let point = ecc.add(&ecc.mul(&k3, &q1_point).unwrap(), &ecc.g_mul(&k2).unwrap()).unwrap();
+        let x1 = big(&encode(&point)[..32]);
+
+        // 签名阶段
+        let message = b"precommit";
+        let e = protocol.calculate_message_hash(message, &pa).unwrap();
+        let r = (big(&e) + x1) % n;
+        let s2 = (&d2 * &k3) % n;
+        let s3 = (&d2 * (&k2 + &r)) % n;
+        let pad = |v: &BigUint| {
+            let bytes = v.to_bytes_be();
+            let mut out = vec![0u8; 32 - bytes.len()];
+            out.extend_from_slice(&bytes);
+            out
+        };
+        let (r, s) = protocol.complete_signature(&k1, &d1, &pad(&r), &pad(&s2), &pad(&s3)).unwrap();
+        let signature = [r, s].concat();
+        assert!(CoSignProtocol::verify(&pa, message, &signature).unwrap());
     }
 
     #[test]
@@ -473,6 +1403,68 @@ mod tests {
         assert!(valid);
     }
 
+    #[test]
+    fn test_verify_batch() {
+        use gm_sdk::sm2::sm2_generate_keypair;
+
+        let protocol = CoSignProtocol::new().unwrap();
+        let keys: Vec<_> = (0..2).map(|_| sm2_generate_keypair()).collect();
+        let messages: Vec<Vec<u8>> = (0..6).map(|i| format!("message {}", i).into_bytes()).collect();
+        // 前 4 条由第一个密钥签名（重复签名者），后 2 条由第二个密钥签名
+        let signer = |i: usize| &keys[usize::from(i >= 4)];
+        let mut signatures: Vec<Vec<u8>> = messages
+            .iter()
+            .enumerate()
+            .map(|(i, message)| CoSignProtocol::sign(&signer(i).0, message).unwrap())
+            .collect();
+        signatures[1][40] ^= 1;
+        signatures[5][..32].fill(0);
+        let public_keys: Vec<&[u8]> = (0..6).map(|i| signer(i).1.as_ref()).collect();
+
+        let mut items: Vec<VerifyItem> = (0..6)
+            .map(|i| VerifyItem {
+                public_key: public_keys[i],
+                message: &messages[i],
+                signature: &signatures[i],
+            })
+            .collect();
+        items[2].message = b"other message";
+        let short_key = [0u8; 10];
+        items.push(VerifyItem {
+            public_key: &short_key,
+            ..items[0]
+        });
+
+        let results = protocol.verify_batch(&items);
+        assert_eq!(results, [true, false, false, true, true, false, false]);
+        for (item, valid) in items.iter().zip(&results).take(6) {
+            assert_eq!(CoSignProtocol::verify(item.public_key, item.message, item.signature).unwrap(), *valid);
+        }
+        assert!(protocol.verify_batch(&[]).is_empty());
+    }
+
+    #[test]
+    fn test_parallel_kdf_matches_serial() {
+        let mut shared = [0u8; 64];
+        shared.copy_from_slice(&CoSignProtocol::generate_random(64));
+        // 超过一个流水线段，且末段不满分块
+        let message: Vec<u8> = (0..PIPELINE_SEGMENT + 1000).map(|i| i as u8).collect();
+
+        let mut c2 = vec![0u8; message.len()];
+        let c3 = kdf_encrypt(&shared, &message, &mut c2);
+        let keystream = kdf::kdf(&shared, message.len());
+        assert!(c2.iter().zip(&message).zip(&keystream).all(|((c, m), k)| *c == m ^ k));
+        assert_eq!(c3[..], gm_sm3_hash(&[&shared[..], &message].concat())[..]);
+
+        let mut out = vec![0u8; c2.len()];
+        assert!(kdf_decrypt(&shared, &c2, &c3, &mut out));
+        assert_eq!(out, message);
+
+        c2[PIPELINE_SEGMENT + 10] ^= 1;
+        assert!(!kdf_decrypt(&shared, &c2, &c3, &mut out));
+        assert!(out.iter().all(|&b| b == 0));
+    }
+
     #[test]
     fn test_sm2_encrypt_decrypt() {
         let protocol = CoSignProtocol::new().unwrap();
@@ -493,11 +1485,112 @@ mod tests {
         assert_eq!(plaintext.unwrap().as_slice(), message);
     }
 
+    #[test]
+    fn test_encrypt_decrypt_into() {
+        let protocol = CoSignProtocol::new().unwrap();
+        let d1 = protocol.generate_d1_array().unwrap();
+        let p1 = protocol.calculate_p1_array(&d1).unwrap();
+        let message = vec![0xa5u8; 5000];
+
+        let mut ciphertext = vec![0u8; ciphertext_len(message.len())];
+        CoSignProtocol::encrypt_into(&p1, &message, &mut ciphertext).unwrap();
+        assert!(CoSignProtocol::encrypt_into(&p1, &message, &mut ciphertext[1..]).is_err());
+
+        let mut plaintext = vec![0u8; plaintext_len(ciphertext.len()).unwrap()];
+        assert!(CoSignProtocol::decrypt_into(&d1, &ciphertext, &mut plaintext).unwrap());
+        assert_eq!(plaintext, message);
+        assert!(CoSignProtocol::decrypt_into(&d1, &ciphertext, &mut plaintext[1..]).is_err());
+
+        // 篡改 C2 时校验失败且输出被清零
+        ciphertext[200] ^= 1;
+        assert!(!CoSignProtocol::decrypt_into(&d1, &ciphertext, &mut plaintext).unwrap());
+        assert!(plaintext.iter().all(|&b| b == 0));
+        assert_eq!(plaintext_len(96), None);
+        assert_eq!(ciphertext_len_checked(3), Some(100));
+        assert_eq!(ciphertext_len_checked(usize::MAX), None);
+        assert_eq!(ciphertext_len_checked(isize::MAX as usize), None);
+    }
+
+    #[test]
+    fn test_decrypt_reference_ciphertext() {
+        // 按定义逐步构造密文（拼接 Z||ct 求 KDF、整体求 C3），校验单遍流式解密结果一致
+        let protocol = CoSignProtocol::new().unwrap();
+        let d = protocol.generate_d1_array().unwrap();
+        let p = protocol.calculate_p1_array(&d).unwrap();
+        let k = protocol.generate_d1_array().unwrap();
+        let c1 = protocol.calculate_p1_array(&k).unwrap();
+        let shared = protocol.decrypt_prepare_array(&k, &p).unwrap();
+        let message: Vec<u8> = (0..10_000u32).map(|i| (i % 251) as u8).collect();
+
+        let mut keystream = Vec::new();
+        for ct in 1u32.. {
+            if keystream.len() >= message.len() {
+                break;
+            }
+            let mut input = shared.to_vec();
+            input.extend_from_slice(&ct.to_be_bytes());
+            keystream.extend_from_slice(&gm_sm3_hash(&input));
+        }
+        let c2: Vec<u8> = message.iter().zip(&keystream).map(|(m, k)| m ^ k).collect();
+        let mut c3_input = shared.to_vec();
+        c3_input.extend_from_slice(&message);
+        let c3 = gm_sm3_hash(&c3_input);
+
+        let mut ciphertext = vec![0x04];
+        ciphertext.extend_from_slice(&c1);
+        ciphertext.extend_from_slice(&c3);
+        ciphertext.extend_from_slice(&c2);
+        assert_eq!(CoSignProtocol::decrypt(&d, &ciphertext).unwrap().unwrap(), message);
+
+        let mut tampered = ciphertext.clone();
+        *tampered.last_mut().unwrap() ^= 1;
+        assert!(CoSignProtocol::decrypt(&d, &tampered).unwrap().is_none());
+    }
+
+    #[test]
+    fn test_decrypt_stream() {
+        let protocol = CoSignProtocol::new().unwrap();
+        let d1 = protocol.generate_d1_array().unwrap();
+        // Reason: 取 d2 = 1，则公钥 Pa = (d1 - 1)·G、T2 = T1，不需要服务端即可构造协同解密的输入
+        let d = (Scalar::from_be_array(&d1) - Scalar::ONE).to_bytes_be();
+        let public_key = protocol.calculate_p1_array(&d).unwrap();
+        let message: Vec<u8> = (0..20_000u32).map(|i| (i % 253) as u8).collect();
+        let ciphertext = CoSignProtocol::encrypt(&public_key, &message).unwrap();
+        let (c1, rest) = ciphertext[1..].split_at(64);
+        let (c3, c2) = rest.split_at(32);
+        let t2 = protocol.decrypt_prepare_array(&d1, c1).unwrap();
+
+        for piece in [1usize, 31, 4096, 7000, 20_000] {
+            let mut stream = protocol.decrypt_stream(&t2, c1, c3).unwrap();
+            let mut out = c2.to_vec();
+            for chunk in out.chunks_mut(piece) {
+                stream.update(chunk);
+            }
+            assert_eq!(stream.processed(), message.len() as u64);
+            stream.finalize().unwrap();
+            assert_eq!(out, message, "piece={}", piece);
+        }
+
+        let mut tampered = c2.to_vec();
+        tampered[12_345] ^= 1;
+        let mut stream = protocol.decrypt_stream(&t2, c1, c3).unwrap();
+        stream.update(&mut tampered);
+        assert!(matches!(stream.finalize(), Err(Error::Crypto(_))));
+        assert!(protocol.decrypt_stream(&t2, c1, &c3[1..]).is_err());
+    }
+
     #[test]
     fn test_base64() {
         let data = b"hello world";
         let encoded = base64_encode(data);
         let decoded = base64_decode(&encoded).unwrap();
         assert_eq!(data.to_vec(), decoded);
+
+        for len in 0..8 {
+            let data = vec![0x3cu8; len];
+            let mut out = vec![0u8; base64_encoded_len(len)];
+            assert_eq!(base64_encode_into(&data, &mut out).unwrap(), out.len());
+            assert_eq!(out, base64_encode(&data).as_bytes());
+        }
     }
 }
@@ -0,0 +1,362 @@
+//! 定长 256 位模 n 运算
+//!
+//! 协同签名在客户端只需要少量模 n 运算（乘、加、减、求逆），用 `BigUint`
+//! 每一步都要堆分配和通用除法取模。这里用 4 个 64 位字（小端序）表示标量，
+//! 内部保存 Montgomery 形式 `a·R mod n`（R = 2^256），乘法用 CIOS 约减，
+//! 全程不分配内存。
+//!
+//! 求逆使用费马小定理 `a⁻¹ = a^(n-2)`，指数固定，运算序列与输入无关；
+//! 批量求逆使用 Montgomery 技巧，N 个元素只做一次求逆。
+
+use crate::error::{Error, Result};
+use std::ops::{Add, Mul, Neg, Sub};
+use zeroize::Zeroize;
+
+/// SM2 曲线阶 n（小端序 64 位字）
+const N: [u64; 4] = [0x53bb_f409_39d5_4123, 0x7203_df6b_21c6_052b, 0xffff_ffff_ffff_ffff, 0xffff_fffe_ffff_ffff];
+
+/// -n⁻¹ mod 2^64，Montgomery 约减常数
+const N_INV: u64 = 0x327f_9e88_7235_0975;
+
+/// R mod n，即 Montgomery 形式的 1
+const R: [u64; 4] = [0xac44_0bf6_c62a_bedd, 0x8dfc_2094_de39_fad4, 0x0000_0000_0000_0000, 0x0000_0001_0000_0000];
+
+/// R² mod n，用于转入 Montgomery 形式
+const R2: [u64; 4] = [0x9011_92af_7c11_4f20, 0x3464_504a_de6f_a2fa, 0x620f_c84c_3aff_e0d4, 0x1eb5_e412_a22b_3d3b];
+
+/// 模 n 标量（内部为 Montgomery 形式）
+#[derive(Clone, Copy, PartialEq, Eq)]
+pub struct Scalar([u64; 4]);
+
+impl Scalar {
+    /// 0
+    pub const ZERO: Scalar = Scalar([0; 4]);
+
+    /// 1
+    pub const ONE: Scalar = Scalar(R);
+
+    /// 从大端字节解析（不超过 32 字节，不足左侧补零），值不小于 n 时约减
+    pub fn from_bytes_be(bytes: &[u8]) -> Result<Self> {
+        if bytes.len() > 32 {
+            return Err(Error::InvalidParam(format!(
+                "Scalar must be at most 32 bytes, got {}",
+                bytes.len()
+            )));
+        }
+        let mut buf = [0u8; 32];
+        buf[32 - bytes.len()..].copy_from_slice(bytes);
+        let scalar = Self::from_be_array(&buf);
+        buf.zeroize();
+        Ok(scalar)
+    }
+
+    /// 从 32 字节大端数组解析，值不小于 n 时返回 None（不约减）
+    pub fn from_canonical(bytes: &[u8; 32]) -> Option<Self> {
+        let mut limbs = [0u64; 4];
+        load_be(bytes, &mut limbs);
+        let (_, borrow) = sub_limbs(&limbs, &N);
+        if borrow == 0 {
+            return None;
+        }
+        Some(Scalar(mont_mul(&limbs, &R2)))
+    }
+
+    /// 从 32 字节大端数组解析，值不小于 n 时约减
+    pub fn from_be_array(bytes: &[u8; 32]) -> Self {
+        let mut limbs = [0u64; 4];
+        load_be(bytes, &mut limbs);
+        // Reason: n > 2^255，任何 256 位整数减一次 n 即落入 [0, n)
+        let (reduced, borrow) = sub_limbs(&limbs, &N);
+        let limbs = select(borrow == 0, &reduced, &limbs);
+        Scalar(mont_mul(&limbs, &R2))
+    }
+
+    /// 输出 32 字节大端表示
+    pub fn to_bytes_be(&self) -> [u8; 32] {
+        let mut out = [0u8; 32];
+        self.write_be(&mut out);
+        out
+    }
+
+    /// 把值写成 32 字节大端序到调用方缓冲区（如安全内存槽位），不留栈上副本
+    pub fn write_be(&self, out: &mut [u8; 32]) {
+        let mut limbs = mont_mul(&self.0, &[1, 0, 0, 0]);
+        for (i, limb) in limbs.iter().enumerate() {
+            let start = 32 - (i + 1) * 8;
+            out[start..start + 8].copy_from_slice(&limb.to_be_bytes());
+        }
+        limbs.zeroize();
+    }
+
+    /// 是否为 0
+    pub fn is_zero(&self) -> bool {
+        self.0.iter().fold(0, |acc, limb| acc | limb) == 0
+    }
+
+    /// 平方
+    pub fn square(&self) -> Self {
+        Scalar(mont_mul(&self.0, &self.0))
+    }
+
+    /// 模逆 a⁻¹ mod n，a = 0 时返回 None
+    pub fn invert(&self) -> Option<Self> {
+        if self.is_zero() {
+            return None;
+        }
+        Some(self.pow_n_minus_2())
+    }
+
+    /// 批量求逆（Montgomery 技巧）：3(N-1) 次乘法 + 1 次求逆
+    ///
+    /// 原地把每个元素替换为其逆元，值为 0 的元素保持为 0。
+    pub fn batch_invert(values: &mut [Scalar]) {
+        // prefix[i] = values[0] · … · values[i]（跳过 0）
+        let mut prefix = Vec::with_capacity(values.len());
+        let mut acc = Scalar::ONE;
+        for value in values.iter() {
+            if !value.is_zero() {
+                acc = acc * *value;
+            }
+            prefix.push(acc);
+        }
+
+        let mut inv = acc.pow_n_minus_2();
+        for i in (0..values.len()).rev() {
+            if values[i].is_zero() {
+                continue;
+            }
+            let before = if i == 0 { Scalar::ONE } else { prefix[i - 1] };
+            let value_inv = inv * before;
+            inv = inv * values[i];
+            values[i] = value_inv;
+        }
+        prefix.zeroize();
+    }
+
+    /// a^(n-2)，固定的平方-乘序列
+    fn pow_n_minus_2(&self) -> Self {
+        // n - 2 的小端序 64 位字
+        const EXP: [u64; 4] = [N[0] - 2, N[1], N[2], N[3]];
+        let mut result = Scalar::ONE;
+        for limb in EXP.iter().rev() {
+            for bit in (0..64).rev() {
+                result = result.square();
+                if (limb >> bit) & 1 == 1 {
+                    result = result * *self;
+                }
+            }
+        }
+        result
+    }
+}
+
+impl Add for Scalar {
+    type Output = Scalar;
+
+    fn add(self, rhs: Scalar) -> Scalar {
+        let (sum, carry) = add_limbs(&self.0, &rhs.0);
+        let (reduced, borrow) = sub_limbs(&sum, &N);
+        // 有进位（和 ≥ 2^256 > n）或未借位（和 ≥ n）时取约减结果
+        Scalar(select(carry == 1 || borrow == 0, &reduced, &sum))
+    }
+}
+
+impl Sub for Scalar {
+    type Output = Scalar;
+
+    fn sub(self, rhs: Scalar) -> Scalar {
+        let (diff, borrow) = sub_limbs(&self.0, &rhs.0);
+        let (wrapped, _) = add_limbs(&diff, &N);
+        Scalar(select(borrow == 1, &wrapped, &diff))
+    }
+}
+
+impl Neg for Scalar {
+    type Output = Scalar;
+
+    fn neg(self) -> Scalar {
+        Scalar::ZERO - self
+    }
+}
+
+impl Mul for Scalar {
+    type Output = Scalar;
+
+    fn mul(self, rhs: Scalar) -> Scalar {
+        Scalar(mont_mul(&self.0, &rhs.0))
+    }
+}
+
+impl Zeroize for Scalar {
+    fn zeroize(&mut self) {
+        self.0.zeroize();
+    }
+}
+
+impl std::fmt::Debug for Scalar {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        // Reason: 标量多为私钥分量或随机数，调试输出中不打印具体值
+        f.write_str("Scalar(..)")
+    }
+}
+
+fn load_be(bytes: &[u8; 32], limbs: &mut [u64; 4]) {
+    for (i, limb) in limbs.iter_mut().enumerate() {
+        let start = 32 - (i + 1) * 8;
+        *limb = u64::from_be_bytes(bytes[start..start + 8].try_into().unwrap());
+    }
+}
+
+fn add_limbs(a: &[u64; 4], b: &[u64; 4]) -> ([u64; 4], u64) {
+    let mut out = [0u64; 4];
+    let mut carry = 0u64;
+    for i in 0..4 {
+        let t = a[i] as u128 + b[i] as u128 + carry as u128;
+        out[i] = t as u64;
+        carry = (t >> 64) as u64;
+    }
+    (out, carry)
+}
+
+fn sub_limbs(a: &[u64; 4], b: &[u64; 4]) -> ([u64; 4], u64) {
+    let mut out = [0u64; 4];
+    let mut borrow = 0u64;
+    for i in 0..4 {
+        let t = (a[i] as u128).wrapping_sub(b[i] as u128 + borrow as u128);
+        out[i] = t as u64;
+        borrow = ((t >> 64) as u64) & 1;
+    }
+    (out, borrow)
+}
+
+/// 按条件选择：`choose_a` 为真时返回 a，否则返回 b（掩码实现，无分支）
+fn select(choose_a: bool, a: &[u64; 4], b: &[u64; 4]) -> [u64; 4] {
+    let mask = (choose_a as u64).wrapping_neg();
+    let mut out = [0u64; 4];
+    for i in 0..4 {
+        out[i] = (a[i] & mask) | (b[i] & !mask);
+    }
+    out
+}
+
+/// Montgomery 乘法（CIOS）：返回 a·b·R⁻¹ mod n
+fn mont_mul(a: &[u64; 4], b: &[u64; 4]) -> [u64; 4] {
+    let mut t = [0u64; 6];
+    for i in 0..4 {
+        // t += a · b[i]
+        let mut carry = 0u64;
+        for j in 0..4 {
+            let uv = t[j] as u128 + a[j] as u128 * b[i] as u128 + carry as u128;
+            t[j] = uv as u64;
+            carry = (uv >> 64) as u64;
+        }
+        let uv = t[4] as u128 + carry as u128;
+        t[4] = uv as u64;
+        t[5] = (uv >> 64) as u64;
+
+        // t = (t + m·n) / 2^64，m 使最低字为 0
+        let m = t[0].wrapping_mul(N_INV);
+        let uv = t[0] as u128 + m as u128 * N[0] as u128;
+        let mut carry = (uv >> 64) as u64;
+        for j in 1..4 {
+            let uv = t[j] as u128 + m as u128 * N[j] as u128 + carry as u128;
+            t[j - 1] = uv as u64;
+            carry = (uv >> 64) as u64;
+        }
+        let uv = t[4] as u128 + carry as u128;
+        t[3] = uv as u64;
+        t[4] = t[5] + (uv >> 64) as u64;
+    }
+
+    // 结果 < 2n，最多再减一次 n
+    let value = [t[0], t[1], t[2], t[3]];
+    let (reduced, borrow) = sub_limbs(&value, &N);
+    select(t[4] == 1 || borrow == 0, &reduced, &value)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn scalar(hex_str: &str) -> Scalar {
+        Scalar::from_bytes_be(&hex::decode(hex_str).unwrap()).unwrap()
+    }
+
+    fn n_bytes() -> [u8; 32] {
+        let mut out = [0u8; 32];
+        for (i, limb) in N.iter().enumerate() {
+            out[32 - (i + 1) * 8..32 - i * 8].copy_from_slice(&limb.to_be_bytes());
+        }
+        out
+    }
+
+    #[test]
+    fn test_constants() {
+        assert_eq!(N[0].wrapping_mul(N_INV), u64::MAX);
+        assert_eq!(Scalar::ONE.to_bytes_be()[31], 1);
+        assert_eq!(Scalar::from_bytes_be(&[1]).unwrap(), Scalar::ONE);
+    }
+
+    #[test]
+    fn test_bytes_roundtrip_and_reduction() {
+        let hex_str = "3945208f7b2144b13f36e38ac6d39f95889393692860b51a42fb81ef4df7c5b8";
+        assert_eq!(hex::encode(scalar(hex_str).to_bytes_be()), hex_str);
+
+        // n ≡ 0，n + 1 ≡ 1，2^256 - 1 ≡ 2^256 - 1 - n
+        assert!(Scalar::from_be_array(&n_bytes()).is_zero());
+        let mut n_plus_1 = n_bytes();
+        n_plus_1[31] += 1;
+        assert_eq!(Scalar::from_be_array(&n_plus_1), Scalar::ONE);
+        assert_eq!(
+            hex::encode(Scalar::from_be_array(&[0xff; 32]).to_bytes_be()),
+            "000000010000000000000000000000008dfc2094de39fad4ac440bf6c62abedc"
+        );
+        assert!(Scalar::from_bytes_be(&[0u8; 33]).is_err());
+
+        assert!(Scalar::from_canonical(&n_bytes()).is_none());
+        let mut n_minus_1 = n_bytes();
+        n_minus_1[31] -= 1;
+        assert_eq!(Scalar::from_canonical(&n_minus_1), Some(-Scalar::ONE));
+    }
+
+    #[test]
+    fn test_arithmetic() {
+        let a = scalar("3945208f7b2144b13f36e38ac6d39f95889393692860b51a42fb81ef4df7c5b8");
+        let b = scalar("fffffffeffffffffffffffffffffffff7203df6b21c6052b53bbf40939d54122");
+
+        // b = n - 1 ≡ -1
+        assert_eq!(b, -Scalar::ONE);
+        assert_eq!(a + b, a - Scalar::ONE);
+        assert_eq!(a * b, -a);
+        assert_eq!(b * b, Scalar::ONE);
+        assert_eq!(a - a, Scalar::ZERO);
+        assert_eq!((a + a) * scalar("02").invert().unwrap(), a);
+
+        // a² mod n 的参考值
+        assert_eq!(
+            hex::encode(a.square().to_bytes_be()),
+            "54a1d2c7183743f7273b5df2387cb61d59e8c94fd80260192c303eb05a8caf19"
+        );
+    }
+
+    #[test]
+    fn test_invert() {
+        let a = scalar("3945208f7b2144b13f36e38ac6d39f95889393692860b51a42fb81ef4df7c5b8");
+        assert_eq!(a * a.invert().unwrap(), Scalar::ONE);
+        assert_eq!(Scalar::ONE.invert().unwrap(), Scalar::ONE);
+        assert!(Scalar::ZERO.invert().is_none());
+    }
+
+    #[test]
+    fn test_batch_invert() {
+        let mut values: Vec<Scalar> = (1u8..=5).map(|i| scalar(&format!("{:02x}", i * 37))).collect();
+        values.insert(2, Scalar::ZERO);
+        let expected: Vec<Scalar> = values.iter().map(|v| v.invert().unwrap_or(Scalar::ZERO)).collect();
+
+        Scalar::batch_invert(&mut values);
+        assert_eq!(values, expected);
+
+        let mut empty: Vec<Scalar> = Vec::new();
+        Scalar::batch_invert(&mut empty);
+    }
+}
@@ -0,0 +1,345 @@
+//! 敏感标量的安全内存池
+//!
+//! D1、d1⁻¹、签名随机数 k1 等 32 字节秘密统一存放在进程内共享的内存池中：
+//! - 内存按块向系统申请（`mmap`），`mlock` 锁定不被换出到交换分区，
+//!   Linux 上另以 `MADV_DONTDUMP` 排除出 core dump
+//! - 按 32 字节定长槽位分发，空闲槽位放回空闲表复用。每个线程在本地缓存至多
+//!   `LOCAL_CACHE` 个空闲槽位，热路径上取、还槽位只是本线程的出栈 / 入栈，不加锁、
+//!   不经过全局分配器；本地缓存取空或溢出时才加锁与全局空闲表成批搬运，线程退出时归还
+//! - 槽位句柄 `SecretScalar` 释放时先清零再归还；`Clone` 会另占一个槽位，
+//!   秘密不会以 `Vec<u8>` 的形式散落在堆上
+//!
+//! 锁定失败（如超出 `RLIMIT_MEMLOCK`）时照常分配和清零，只是不再保证不被换出，
+//! 可通过 `stats().locked` 查看。非 Unix 平台只清零、不锁定。
+//! 池中的块在进程结束前不归还系统，容量只随同时存活的秘密数量增长。
+
+use crate::error::{Error, Result};
+use crate::types::ScalarBytes;
+use std::alloc::Layout;
+use std::cell::RefCell;
+use std::ptr::NonNull;
+use std::sync::{Mutex, PoisonError};
+use tracing::warn;
+use zeroize::Zeroize;
+
+/// 单个槽位大小（字节）
+const SLOT_SIZE: usize = 32;
+
+/// 每次向系统申请的块大小（4 页）
+const CHUNK_BYTES: usize = 16 * 1024;
+
+/// 每块的槽位数
+const SLOTS_PER_CHUNK: usize = CHUNK_BYTES / SLOT_SIZE;
+
+/// 每个线程本地缓存的空闲槽位上限
+const LOCAL_CACHE: usize = 64;
+
+/// 本地缓存与全局空闲表之间一次搬运的槽位数
+const BATCH: usize = LOCAL_CACHE / 2;
+
+/// 内存池使用情况
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct ArenaStats {
+    /// 已申请的槽位总数
+    pub capacity: usize,
+    /// 已分发的槽位数：正在使用的，加上各线程本地缓存的（每线程至多 `LOCAL_CACHE` 个）
+    pub in_use: usize,
+    /// 所有块都已锁定在物理内存中
+    pub locked: bool,
+}
+
+struct ArenaState {
+    /// 全局空闲槽位（均已清零）
+    free: Vec<NonNull<ScalarBytes>>,
+    capacity: usize,
+    locked: bool,
+}
+
+// Reason: 空闲表里的指针只在持锁时读写，每个槽位同一时刻至多归一个 SecretScalar 所有
+unsafe impl Send for ArenaState {}
+
+static ARENA: Mutex<ArenaState> = Mutex::new(ArenaState {
+    free: Vec::new(),
+    capacity: 0,
+    locked: true,
+});
+
+impl ArenaState {
+    /// 从全局空闲表取出至多 `count` 个槽位放入 `out`，空闲表为空时向系统申请新块
+    fn take(&mut self, out: &mut Vec<NonNull<ScalarBytes>>, count: usize) {
+        if self.free.is_empty() {
+            self.grow();
+        }
+        let start = self.free.len() - count.min(self.free.len());
+        out.extend(self.free.drain(start..));
+    }
+
+    fn grow(&mut self) {
+        let (chunk, locked) = map_chunk();
+        if !locked && self.locked {
+            warn!("mlock failed, secret scalars may be swapped out (check RLIMIT_MEMLOCK)");
+        }
+        self.locked &= locked;
+        self.capacity += SLOTS_PER_CHUNK;
+        self.free.reserve(SLOTS_PER_CHUNK);
+        // Reason: 逆序压栈，先分发低地址槽位，便于调试时观察
+        for i in (0..SLOTS_PER_CHUNK).rev() {
+            // SAFETY: i * SLOT_SIZE < CHUNK_BYTES，偏移后仍在块内且按 32 字节对齐
+            let slot = unsafe { chunk.as_ptr().add(i * SLOT_SIZE) } as *mut ScalarBytes;
+            self.free.push(NonNull::new(slot).expect("chunk pointer is non-null"));
+        }
+    }
+}
+
+fn arena() -> std::sync::MutexGuard<'static, ArenaState> {
+    ARENA.lock().unwrap_or_else(PoisonError::into_inner)
+}
+
+/// 线程本地的空闲槽位缓存，线程退出时全部归还全局空闲表
+struct LocalCache {
+    free: Vec<NonNull<ScalarBytes>>,
+}
+
+impl Drop for LocalCache {
+    fn drop(&mut self) {
+        if !self.free.is_empty() {
+            arena().free.append(&mut self.free);
+        }
+    }
+}
+
+thread_local! {
+    static CACHE: RefCell<LocalCache> = const { RefCell::new(LocalCache { free: Vec::new() }) };
+}
+
+/// 当前内存池使用情况
+pub fn stats() -> ArenaStats {
+    let state = arena();
+    ArenaStats {
+        capacity: state.capacity,
+        in_use: state.capacity - state.free.len(),
+        locked: state.locked,
+    }
+}
+
+/// 取一个已清零的槽位：先取本线程缓存，缓存空时从全局空闲表成批补充
+fn acquire() -> NonNull<ScalarBytes> {
+    let cached = CACHE.try_with(|cache| {
+        let mut cache = cache.borrow_mut();
+        if cache.free.is_empty() {
+            arena().take(&mut cache.free, BATCH);
+        }
+        cache.free.pop().expect("local cache refilled above")
+    });
+    // Reason: 线程退出、本地缓存已销毁后（如其他线程局部变量析构时）直接走全局空闲表
+    cached.unwrap_or_else(|_| {
+        let mut slot = Vec::with_capacity(1);
+        arena().take(&mut slot, 1);
+        slot.pop().expect("free list refilled above")
+    })
+}
+
+/// 归还槽位，调用方需已清零；本线程缓存超过上限时把较早归还的一批还给全局空闲表
+fn release(slot: NonNull<ScalarBytes>) {
+    let cached = CACHE.try_with(|cache| {
+        let mut cache = cache.borrow_mut();
+        cache.free.push(slot);
+        if cache.free.len() > LOCAL_CACHE {
+            arena().free.extend(cache.free.drain(..BATCH));
+        }
+    });
+    if cached.is_err() {
+        arena().free.push(slot);
+    }
+}
+
+/// 向系统申请一块清零内存并尝试锁定，返回（块首地址，是否锁定）
+#[cfg(unix)]
+fn map_chunk() -> (NonNull<u8>, bool) {
+    // SAFETY: 匿名私有映射不涉及已有内存；失败时按分配失败处理
+    unsafe {
+        let ptr = libc::mmap(
+            std::ptr::null_mut(),
+            CHUNK_BYTES,
+            libc::PROT_READ | libc::PROT_WRITE,
+            libc::MAP_PRIVATE | libc::MAP_ANON,
+            -1,
+            0,
+        );
+        if ptr == libc::MAP_FAILED {
+            std::alloc::handle_alloc_error(chunk_layout());
+        }
+        let locked = libc::mlock(ptr, CHUNK_BYTES) == 0;
+        #[cfg(any(target_os = "linux", target_os = "android"))]
+        libc::madvise(ptr, CHUNK_BYTES, libc::MADV_DONTDUMP);
+        (NonNull::new_unchecked(ptr as *mut u8), locked)
+    }
+}
+
+/// 向系统申请一块清零内存（非 Unix 平台不锁定）
+#[cfg(not(unix))]
+fn map_chunk() -> (NonNull<u8>, bool) {
+    let layout = chunk_layout();
+    // SAFETY: layout 大小非零
+    let ptr = unsafe { std::alloc::alloc_zeroed(layout) };
+    match NonNull::new(ptr) {
+        Some(ptr) => (ptr, false),
+        None => std::alloc::handle_alloc_error(layout),
+    }
+}
+
+fn chunk_layout() -> Layout {
+    Layout::from_size_align(CHUNK_BYTES, 4096).expect("valid chunk layout")
+}
+
+/// 安全内存池中的 32 字节秘密标量（大端序）
+///
+/// 独占一个槽位，释放时清零并归还内存池。按切片解引用，可直接传给
+/// 接受 `&[u8]` 的协议接口；`Debug` 不输出内容。
+pub struct SecretScalar {
+    slot: NonNull<ScalarBytes>,
+}
+
+// Reason: 槽位由句柄独占，与 Box<[u8; 32]> 的所有权语义相同
+unsafe impl Send for SecretScalar {}
+unsafe impl Sync for SecretScalar {}
+
+impl SecretScalar {
+    /// 分配一个全零的槽位
+    pub fn zero() -> Self {
+        Self { slot: acquire() }
+    }
+
+    /// 把 32 字节标量复制进安全内存
+    pub fn from_array(bytes: &ScalarBytes) -> Self {
+        let mut secret = Self::zero();
+        secret.as_mut_array().copy_from_slice(bytes);
+        secret
+    }
+
+    /// 把不超过 32 字节的大端标量复制进安全内存，不足时左侧补零
+    pub fn from_slice(bytes: &[u8]) -> Result<Self> {
+        if bytes.len() > SLOT_SIZE {
+            return Err(Error::InvalidParam(format!(
+                "Scalar must be at most 32 bytes, got {}",
+                bytes.len()
+            )));
+        }
+        let mut secret = Self::zero();
+        secret.as_mut_array()[SLOT_SIZE - bytes.len()..].copy_from_slice(bytes);
+        Ok(secret)
+    }
+
+    /// 32 字节定长视图
+    pub fn as_array(&self) -> &ScalarBytes {
+        // SAFETY: 槽位在句柄存活期间有效且由其独占
+        unsafe { self.slot.as_ref() }
+    }
+
+    /// 32 字节定长可写视图，可作为输出缓冲区直接写入秘密
+    pub fn as_mut_array(&mut self) -> &mut ScalarBytes {
+        // SAFETY: 同上，&mut self 保证唯一访问
+        unsafe { self.slot.as_mut() }
+    }
+}
+
+impl Drop for SecretScalar {
+    fn drop(&mut self) {
+        self.as_mut_array().zeroize();
+        release(self.slot);
+    }
+}
+
+impl Clone for SecretScalar {
+    fn clone(&self) -> Self {
+        Self::from_array(self.as_array())
+    }
+}
+
+impl std::ops::Deref for SecretScalar {
+    type Target = [u8];
+
+    fn deref(&self) -> &[u8] {
+        self.as_array()
+    }
+}
+
+impl AsRef<[u8]> for SecretScalar {
+    fn as_ref(&self) -> &[u8] {
+        self.as_array()
+    }
+}
+
+impl std::fmt::Debug for SecretScalar {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.write_str("SecretScalar(..)")
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_from_slice_pads_and_rejects_long() {
+        let secret = SecretScalar::from_slice(&[1, 2, 3]).unwrap();
+        let mut expected = [0u8; 32];
+        expected[29..].copy_from_slice(&[1, 2, 3]);
+        assert_eq!(secret.as_array(), &expected);
+        assert_eq!(&secret[..], &expected[..]);
+        assert!(SecretScalar::from_slice(&[0u8; 33]).is_err());
+    }
+
+    #[test]
+    fn test_slot_zeroized_and_reused() {
+        let mut secret = SecretScalar::zero();
+        secret.as_mut_array().fill(0xa5);
+        let slot = secret.slot;
+        drop(secret);
+
+        // Reason: 其他测试线程可能同时取用槽位，只在拿回同一槽位时检查其内容
+        let reused: Vec<SecretScalar> = (0..SLOTS_PER_CHUNK + 1).map(|_| SecretScalar::zero()).collect();
+        for secret in &reused {
+            if secret.slot == slot {
+                assert_eq!(secret.as_array(), &[0u8; 32]);
+            }
+        }
+    }
+
+    #[test]
+    fn test_clone_takes_separate_slot() {
+        let a = SecretScalar::from_array(&[7u8; 32]);
+        let b = a.clone();
+        assert_ne!(a.slot, b.slot);
+        assert_eq!(a.as_array(), b.as_array());
+        assert_eq!(format!("{:?}", b), "SecretScalar(..)");
+    }
+
+    #[test]
+    fn test_grows_past_one_chunk() {
+        let held: Vec<SecretScalar> = (0..SLOTS_PER_CHUNK * 2).map(|_| SecretScalar::zero()).collect();
+        let current = stats();
+        assert!(current.capacity >= SLOTS_PER_CHUNK * 2);
+        assert!(current.in_use >= held.len());
+    }
+
+    #[test]
+    fn test_local_cache_bounded() {
+        let held: Vec<SecretScalar> = (0..LOCAL_CACHE * 3).map(|_| SecretScalar::zero()).collect();
+        drop(held);
+        assert!(CACHE.with(|cache| cache.borrow().free.len()) <= LOCAL_CACHE);
+    }
+
+    #[test]
+    fn test_release_on_other_thread() {
+        let secrets: Vec<SecretScalar> = (0..BATCH * 3).map(|i| SecretScalar::from_array(&[i as u8; 32])).collect();
+        let slots: Vec<_> = secrets.iter().map(|secret| secret.slot).collect();
+        std::thread::spawn(move || drop(secrets)).join().unwrap();
+
+        // Reason: 退出线程的本地缓存已归还全局空闲表，其中的槽位可被分发且已清零
+        let state = arena();
+        for slot in slots.iter().filter(|slot| state.free.contains(slot)) {
+            assert_eq!(unsafe { slot.as_ref() }, &[0u8; 32]);
+        }
+    }
+}
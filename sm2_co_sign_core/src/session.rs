@@ -0,0 +1,461 @@
+//! 会话管理：过期解析、提前刷新与 token 缓存
+//!
+//! - 登录响应中的 `expires_at` 在写入会话时解析一次，签名热路径只比较时间
+//! - 启用 `session_refresh_margin`（默认关闭）时，距过期不足该秒数即在后台重新登录，本次请求仍使用旧 token；
+//!   已过期时调用方等待重新登录完成
+//! - 并发调用方共享同一次登录（single-flight），等锁期间会话已被他人刷新时直接复用
+//! - 配置了 `token_file` 时登录结果写入文件，下次创建客户端时读回，短生命周期进程不必每次登录
+
+use crate::client::ClientConfig;
+use crate::endpoints::Endpoints;
+use crate::error::{Error, Result};
+use crate::types::{ApiResponse, LoginResponse, Session};
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, Mutex, PoisonError, Weak};
+use std::time::{Duration, SystemTime, UNIX_EPOCH};
+use tokio::sync::RwLock;
+use tracing::{debug, info, warn};
+use zeroize::Zeroizing;
+
+impl Session {
+    /// 解析 `expires_at`，无法识别（或为空）时返回 `None`，视为不过期
+    pub fn expiry(&self) -> Option<SystemTime> {
+        parse_timestamp(&self.expires_at)
+    }
+}
+
+/// 解析时间戳：Unix 秒 / 毫秒，或 RFC 3339（`2026-01-01T08:00:00+08:00`，允许空格分隔、小数秒）
+///
+/// 不带时区的日期时间按 UTC 处理。
+pub fn parse_timestamp(value: &str) -> Option<SystemTime> {
+    let value = value.trim();
+    if value.is_empty() {
+        return None;
+    }
+    if value.bytes().all(|b| b.is_ascii_digit()) {
+        let n: u64 = value.parse().ok()?;
+        // Reason: 12 位及以上按毫秒处理（秒级时间戳要到公元 5000 年后才有 12 位）
+        let secs = if n >= 100_000_000_000 { n / 1000 } else { n };
+        return Some(UNIX_EPOCH + Duration::from_secs(secs));
+    }
+    parse_rfc3339(value)
+}
+
+fn parse_rfc3339(s: &str) -> Option<SystemTime> {
+    let b = s.as_bytes();
+    if b.len() < 19
+        || b[4] != b'-'
+        || b[7] != b'-'
+        || !matches!(b[10], b'T' | b't' | b' ')
+        || b[13] != b':'
+        || b[16] != b':'
+    {
+        return None;
+    }
+    let digits = |range: std::ops::Range<usize>| -> Option<i64> {
+        let part = s.get(range)?;
+        if !part.bytes().all(|c| c.is_ascii_digit()) {
+            return None;
+        }
+        part.parse().ok()
+    };
+    let (year, month, day) = (digits(0..4)?, digits(5..7)?, digits(8..10)?);
+    let (hour, minute, second) = (digits(11..13)?, digits(14..16)?, digits(17..19)?);
+    if !(1..=12).contains(&month) || !(1..=31).contains(&day) || hour > 23 || minute > 59 || second > 60 {
+        return None;
+    }
+
+    // 跳过小数秒
+    let mut rest = &s[19..];
+    if let Some(frac) = rest.strip_prefix('.') {
+        let end = frac.bytes().position(|c| !c.is_ascii_digit()).unwrap_or(frac.len());
+        if end == 0 {
+            return None;
+        }
+        rest = &frac[end..];
+    }
+
+    let offset = match rest {
+        "" | "Z" | "z" => 0,
+        _ => {
+            let sign = match rest.as_bytes()[0] {
+                b'+' => 1,
+                b'-' => -1,
+                _ => return None,
+            };
+            let tz = rest[1..].replace(':', "");
+            if tz.len() != 4 || !tz.bytes().all(|c| c.is_ascii_digit()) {
+                return None;
+            }
+            let hours: i64 = tz[..2].parse().ok()?;
+            let minutes: i64 = tz[2..].parse().ok()?;
+            sign * (hours * 3600 + minutes * 60)
+        }
+    };
+
+    let secs = days_from_civil(year, month, day) * 86_400 + hour * 3600 + minute * 60 + second - offset;
+    u64::try_from(secs).ok().map(|secs| UNIX_EPOCH + Duration::from_secs(secs))
+}
+
+/// 公历日期到 1970-01-01 起的天数
+fn days_from_civil(year: i64, month: i64, day: i64) -> i64 {
+    let year = if month <= 2 { year - 1 } else { year };
+    let era = year.div_euclid(400);
+    let yoe = year - era * 400;
+    let mp = (month + 9) % 12;
+    let doy = (153 * mp + 2) / 5 + day - 1;
+    let doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    era * 146_097 + doe - 719_468
+}
+
+/// 当前会话及其解析后的过期时间
+#[derive(Clone)]
+struct SessionSlot {
+    session: Arc<Session>,
+    expiry: Option<SystemTime>,
+}
+
+impl SessionSlot {
+    fn new(session: Session) -> Self {
+        let expiry = session.expiry();
+        Self {
+            session: Arc::new(session),
+            expiry,
+        }
+    }
+
+    /// 在 `now + margin` 之前过期
+    fn expires_within(&self, now: SystemTime, margin: Duration) -> bool {
+        self.expiry.is_some_and(|expiry| expiry <= now + margin)
+    }
+}
+
+/// 用于自动重新登录的凭据，释放时清零密码
+struct Credentials {
+    username: String,
+    password: Zeroizing<String>,
+}
+
+/// 客户端会话管理
+pub(crate) struct SessionManager {
+    endpoints: Arc<Endpoints>,
+    /// 提前刷新的时间窗口，为零时不保存凭据、不自动重新登录
+    refresh_margin: Duration,
+    token_file: Option<PathBuf>,
+    current: RwLock<Option<SessionSlot>>,
+    credentials: Mutex<Option<Credentials>>,
+    /// 登录互斥锁：同一时刻只有一次登录请求在途
+    login_flight: tokio::sync::Mutex<()>,
+}
+
+impl SessionManager {
+    /// 创建会话管理器，配置了 `token_file` 时读回其中未过期的会话
+    pub(crate) fn new(endpoints: Arc<Endpoints>, config: &ClientConfig) -> Arc<Self> {
+        let loaded = config.token_file.as_deref().and_then(load_token_file).map(SessionSlot::new);
+        let loaded = loaded.filter(|slot| !slot.expires_within(SystemTime::now(), Duration::ZERO));
+        if loaded.is_some() {
+            debug!("Loaded cached session from token file");
+        }
+
+        Arc::new(Self {
+            endpoints,
+            refresh_margin: Duration::from_secs(config.session_refresh_margin),
+            token_file: config.token_file.clone(),
+            current: RwLock::new(loaded),
+            credentials: Mutex::new(None),
+            login_flight: tokio::sync::Mutex::new(()),
+        })
+    }
+
+    /// 登录并保存会话；启用自动刷新时同时保存凭据
+    pub(crate) async fn login(self: &Arc<Self>, username: &str, password: &str) -> Result<Arc<Session>> {
+        let _flight = self.login_flight.lock().await;
+        let session = self.request_login(username, password).await?;
+        if !self.refresh_margin.is_zero() {
+            *self.credentials.lock().unwrap_or_else(PoisonError::into_inner) = Some(Credentials {
+                username: username.to_string(),
+                password: Zeroizing::new(password.to_string()),
+            });
+        }
+        Ok(self.install(session).await)
+    }
+
+    /// 发送登录请求
+    async fn request_login(&self, username: &str, password: &str) -> Result<Session> {
+        info!("Logging in user: {}", username);
+
+        let body = serde_json::json!({
+            "username": username,
+            "password": password,
+        });
+        let response = self
+            .endpoints
+            .send("/api/login", |url| self.endpoints.http_client().post(url).json(&body))
+            .await?;
+
+        let api_response: ApiResponse<LoginResponse> = response
+            .json()
+            .await
+            .map_err(|e| Error::Network(e.to_string()))?;
+
+        if api_response.code != 0 {
+            return Err(Error::Api {
+                code: api_response.code,
+                message: api_response.message,
+            });
+        }
+
+        let data = api_response.data.ok_or(Error::InvalidState("No data in response".to_string()))?;
+
+        info!("User logged in successfully");
+        Ok(Session {
+            token: data.token,
+            user_id: data.user_id,
+            expires_at: data.expires_at,
+        })
+    }
+
+    /// 写入新会话：更新内存、持久化到 token 文件、安排下一次提前刷新
+    async fn install(self: &Arc<Self>, session: Session) -> Arc<Session> {
+        let slot = SessionSlot::new(session);
+        if let Some(path) = &self.token_file {
+            if let Err(e) = save_token_file(path, &slot.session) {
+                warn!("Failed to write token file {:?}: {}", path, e);
+            }
+        }
+        *self.current.write().await = Some(slot.clone());
+        self.schedule_refresh(&slot);
+        slot.session
+    }
+
+    /// 直接设置会话（从外部恢复），不保存凭据
+    pub(crate) async fn set(&self, session: Session) {
+        *self.current.write().await = Some(SessionSlot::new(session));
+    }
+
+    /// 当前会话（不检查过期）
+    pub(crate) async fn get(&self) -> Option<Arc<Session>> {
+        self.current.read().await.as_ref().map(|slot| Arc::clone(&slot.session))
+    }
+
+    /// 清除会话、凭据和 token 文件
+    pub(crate) async fn clear(&self) {
+        *self.current.write().await = None;
+        *self.credentials.lock().unwrap_or_else(PoisonError::into_inner) = None;
+        if let Some(path) = &self.token_file {
+            let _ = std::fs::remove_file(path);
+        }
+    }
+
+    fn has_credentials(&self) -> bool {
+        self.credentials.lock().unwrap_or_else(PoisonError::into_inner).is_some()
+    }
+
+    /// 取可用的会话
+    ///
+    /// 即将过期时触发后台刷新并返回旧会话；已过期（或尚无会话）且持有凭据时等待重新登录。
+    pub(crate) async fn current(self: &Arc<Self>) -> Result<Arc<Session>> {
+        let slot = self.current.read().await.clone();
+        let now = SystemTime::now();
+        match slot {
+            Some(slot) if !slot.expires_within(now, self.refresh_margin) => Ok(slot.session),
+            Some(slot) if !slot.expires_within(now, Duration::ZERO) => {
+                self.refresh_in_background(&slot.session);
+                Ok(slot.session)
+            }
+            stale => {
+                if !self.has_credentials() {
+                    // Reason: 没有凭据无法刷新，交给服务端判断（可能存在时钟偏差）
+                    return stale.map(|slot| slot.session).ok_or(Error::NotAuthenticated);
+                }
+                self.refresh(stale.map(|slot| slot.session)).await
+            }
+        }
+    }
+
+    /// 用保存的凭据重新登录（single-flight）
+    ///
+    /// `stale` 为调用方看到的旧会话；等锁期间会话已被替换且仍有效时直接返回新会话。
+    async fn refresh(self: &Arc<Self>, stale: Option<Arc<Session>>) -> Result<Arc<Session>> {
+        let _flight = self.login_flight.lock().await;
+
+        if let Some(slot) = self.current.read().await.clone() {
+            let replaced = stale.as_ref().map_or(true, |stale| !Arc::ptr_eq(stale, &slot.session));
+            if replaced && !slot.expires_within(SystemTime::now(), self.refresh_margin) {
+                return Ok(slot.session);
+            }
+        }
+
+        let (username, password) = {
+            let credentials = self.credentials.lock().unwrap_or_else(PoisonError::into_inner);
+            let credentials = credentials.as_ref().ok_or(Error::NotAuthenticated)?;
+            (credentials.username.clone(), credentials.password.clone())
+        };
+        debug!("Refreshing session for {}", username);
+        let session = self.request_login(&username, &password).await?;
+        Ok(self.install(session).await)
+    }
+
+    /// 在后台刷新会话，已有登录在途时不再重复发起
+    fn refresh_in_background(self: &Arc<Self>, stale: &Arc<Session>) {
+        if self.login_flight.try_lock().is_err() {
+            return;
+        }
+        let Ok(handle) = tokio::runtime::Handle::try_current() else {
+            return;
+        };
+        let this = Arc::clone(self);
+        let stale = Arc::clone(stale);
+        handle.spawn(async move {
+            if let Err(e) = this.refresh(Some(stale)).await {
+                warn!("Background session refresh failed: {}", e);
+            }
+        });
+    }
+
+    /// 在进入刷新窗口时主动刷新，无需等到下一次请求
+    ///
+    /// 任务只持有管理器的弱引用，客户端释放后自动结束；会话被替换（重新登录或登出）时不再刷新。
+    fn schedule_refresh(self: &Arc<Self>, slot: &SessionSlot) {
+        let Some(expiry) = slot.expiry else {
+            return;
+        };
+        if self.refresh_margin.is_zero() || !self.has_credentials() {
+            return;
+        }
+        let Ok(handle) = tokio::runtime::Handle::try_current() else {
+            return;
+        };
+
+        let due = expiry.checked_sub(self.refresh_margin).unwrap_or(UNIX_EPOCH);
+        let delay = due.duration_since(SystemTime::now()).unwrap_or(Duration::ZERO);
+        let manager: Weak<Self> = Arc::downgrade(self);
+        let session = Arc::clone(&slot.session);
+        handle.spawn(async move {
+            tokio::time::sleep(delay).await;
+            let Some(manager) = manager.upgrade() else {
+                return;
+            };
+            let still_current = manager
+                .current
+                .read()
+                .await
+                .as_ref()
+                .is_some_and(|slot| Arc::ptr_eq(&slot.session, &session));
+            if still_current {
+                if let Err(e) = manager.refresh(Some(session)).await {
+                    warn!("Scheduled session refresh failed: {}", e);
+                }
+            }
+        });
+    }
+}
+
+/// 读取 token 文件（JSON：token / user_id / expires_at），格式不符时返回 None
+fn load_token_file(path: &Path) -> Option<Session> {
+    let content = std::fs::read_to_string(path).ok()?;
+    match serde_json::from_str(&content) {
+        Ok(session) => Some(session),
+        Err(_) => {
+            debug!("Token file {:?} is not a cached session, ignoring", path);
+            None
+        }
+    }
+}
+
+/// 写入 token 文件：先写临时文件再改名，Unix 下权限为 0600
+fn save_token_file(path: &Path, session: &Session) -> std::io::Result<()> {
+    use std::io::Write;
+
+    let json = serde_json::to_vec(session).map_err(std::io::Error::other)?;
+    let mut tmp = path.as_os_str().to_owned();
+    tmp.push(".tmp");
+    let tmp = PathBuf::from(tmp);
+
+    let mut options = std::fs::OpenOptions::new();
+    options.write(true).create(true).truncate(true);
+    #[cfg(unix)]
+    {
+        use std::os::unix::fs::OpenOptionsExt;
+        options.mode(0o600);
+    }
+    let mut file = options.open(&tmp)?;
+    file.write_all(&json)?;
+    file.sync_all()?;
+    std::fs::rename(&tmp, path)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn unix(secs: u64) -> Option<SystemTime> {
+        Some(UNIX_EPOCH + Duration::from_secs(secs))
+    }
+
+    #[test]
+    fn test_parse_timestamp() {
+        assert_eq!(parse_timestamp("1700000000"), unix(1_700_000_000));
+        assert_eq!(parse_timestamp("1700000000123"), unix(1_700_000_000));
+        assert_eq!(parse_timestamp("1970-01-01T00:00:00Z"), unix(0));
+        assert_eq!(parse_timestamp("2023-11-14T22:13:20Z"), unix(1_700_000_000));
+        assert_eq!(parse_timestamp("2023-11-15T06:13:20+08:00"), unix(1_700_000_000));
+        assert_eq!(parse_timestamp("2023-11-14 22:13:20.456"), unix(1_700_000_000));
+        assert_eq!(parse_timestamp("2024-02-29T00:00:00-0130"), unix(1_709_170_200));
+
+        for invalid in ["", "tomorrow", "2023-13-01T00:00:00Z", "2023-11-14T22:13:20+8", "2023-11-14T22:13:20."] {
+            assert_eq!(parse_timestamp(invalid), None, "{}", invalid);
+        }
+    }
+
+    fn manager(config: ClientConfig) -> Arc<SessionManager> {
+        SessionManager::new(Endpoints::new(reqwest::Client::new(), &config), &config)
+    }
+
+    fn session(expires_at: &str) -> Session {
+        Session {
+            token: "token".to_string(),
+            user_id: "u1".to_string(),
+            expires_at: expires_at.to_string(),
+        }
+    }
+
+    #[tokio::test]
+    async fn test_current_without_credentials() {
+        let manager = manager(ClientConfig::default());
+        assert!(matches!(manager.current().await, Err(Error::NotAuthenticated)));
+
+        // 无法解析的过期时间视为不过期；已过期且无凭据时仍交给服务端判断
+        manager.set(session("")).await;
+        assert_eq!(manager.current().await.unwrap().token, "token");
+        manager.set(session("1")).await;
+        assert_eq!(manager.current().await.unwrap().token, "token");
+
+        manager.clear().await;
+        assert!(manager.get().await.is_none());
+    }
+
+    #[tokio::test]
+    async fn test_token_file_roundtrip() {
+        let path = std::env::temp_dir().join(format!("sm2-cosign-token-{}", std::process::id()));
+        let config = ClientConfig {
+            token_file: Some(path.clone()),
+            ..ClientConfig::default()
+        };
+
+        let first = manager(config.clone());
+        first.install(session("2099-01-01T00:00:00Z")).await;
+
+        let second = manager(config.clone());
+        let loaded = second.get().await.unwrap();
+        assert_eq!(loaded.token, "token");
+        assert_eq!(loaded.expiry(), parse_timestamp("2099-01-01T00:00:00Z"));
+
+        // 已过期的缓存会话不被读回
+        first.install(session("2000-01-01T00:00:00Z")).await;
+        assert!(manager(config.clone()).get().await.is_none());
+
+        first.clear().await;
+        assert!(!path.exists());
+    }
+}
@@ -0,0 +1,213 @@
+//! 增量 SM3 哈希（GB/T 32905-2016）
+//!
+//! gm-sdk-rs 只提供一次性的 `sm3_hash(&[u8])`，要求整条消息连续驻留内存。
+//! 这里提供 init/update/final 形式的上下文，大文件可以分块喂入，内存占用恒定。
+
+/// 初始向量 IV
+pub(crate) const IV: [u32; 8] = [
+    0x7380_166f, 0x4914_b2b9, 0x1724_42d7, 0xda8a_0600, 0xa96f_30bc, 0x1631_38aa, 0xe38d_ee4d, 0xb0fb_0e4e,
+];
+
+/// 分组长度（字节）
+pub const BLOCK_SIZE: usize = 64;
+
+/// 摘要长度（字节）
+pub const DIGEST_SIZE: usize = 32;
+
+/// 增量 SM3 上下文
+#[derive(Clone)]
+pub struct Sm3 {
+    state: [u32; 8],
+    buffer: [u8; BLOCK_SIZE],
+    buffer_len: usize,
+    /// 已处理的消息总长度（字节）
+    total_len: u64,
+}
+
+impl Sm3 {
+    /// 创建新的哈希上下文
+    pub fn new() -> Self {
+        Self {
+            state: IV,
+            buffer: [0u8; BLOCK_SIZE],
+            buffer_len: 0,
+            total_len: 0,
+        }
+    }
+
+    /// 追加数据
+    pub fn update(&mut self, mut data: &[u8]) {
+        self.total_len = self.total_len.wrapping_add(data.len() as u64);
+
+        // 先补齐缓冲区中未满的分组
+        if self.buffer_len > 0 {
+            let take = (BLOCK_SIZE - self.buffer_len).min(data.len());
+            self.buffer[self.buffer_len..self.buffer_len + take].copy_from_slice(&data[..take]);
+            self.buffer_len += take;
+            data = &data[take..];
+            if self.buffer_len < BLOCK_SIZE {
+                return;
+            }
+            let block = self.buffer;
+            compress(&mut self.state, &block);
+            self.buffer_len = 0;
+        }
+
+        // Reason: 整块直接从输入压缩，避免大消息逐字节拷入缓冲区
+        let mut blocks = data.chunks_exact(BLOCK_SIZE);
+        for block in &mut blocks {
+            compress(&mut self.state, block.try_into().unwrap());
+        }
+        let rest = blocks.remainder();
+        self.buffer[..rest.len()].copy_from_slice(rest);
+        self.buffer_len = rest.len();
+    }
+
+    /// 完成计算并返回摘要，上下文随之消耗
+    pub fn finalize(mut self) -> [u8; DIGEST_SIZE] {
+        self.finalize_reset()
+    }
+
+    /// 完成计算并返回摘要，之后上下文恢复为初始状态可继续使用
+    pub fn finalize_reset(&mut self) -> [u8; DIGEST_SIZE] {
+        let bit_len = self.total_len.wrapping_mul(8);
+
+        // 填充：0x80，补零到 56 mod 64，再附加 64 位大端长度
+        let mut pad = [0u8; BLOCK_SIZE * 2];
+        pad[0] = 0x80;
+        let pad_len = if self.buffer_len < 56 { 56 - self.buffer_len } else { 120 - self.buffer_len };
+        pad[pad_len..pad_len + 8].copy_from_slice(&bit_len.to_be_bytes());
+        self.update(&pad[..pad_len + 8]);
+        debug_assert_eq!(self.buffer_len, 0);
+
+        let mut out = [0u8; DIGEST_SIZE];
+        for (chunk, word) in out.chunks_exact_mut(4).zip(self.state.iter()) {
+            chunk.copy_from_slice(&word.to_be_bytes());
+        }
+        self.reset();
+        out
+    }
+
+    /// 恢复为初始状态
+    pub fn reset(&mut self) {
+        *self = Self::new();
+    }
+
+    /// 中间状态：(压缩状态, 已压缩的字节数, 缓冲区中尚未压缩的字节)
+    pub(crate) fn midstate(&self) -> ([u32; 8], u64, &[u8]) {
+        let buffered = &self.buffer[..self.buffer_len];
+        (self.state, self.total_len - self.buffer_len as u64, buffered)
+    }
+
+    /// 一次性计算摘要
+    pub fn digest(data: &[u8]) -> [u8; DIGEST_SIZE] {
+        let mut hasher = Self::new();
+        hasher.update(data);
+        hasher.finalize()
+    }
+}
+
+impl Default for Sm3 {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl std::fmt::Debug for Sm3 {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("Sm3").field("total_len", &self.total_len).finish_non_exhaustive()
+    }
+}
+
+#[inline(always)]
+fn p0(x: u32) -> u32 {
+    x ^ x.rotate_left(9) ^ x.rotate_left(17)
+}
+
+#[inline(always)]
+fn p1(x: u32) -> u32 {
+    x ^ x.rotate_left(15) ^ x.rotate_left(23)
+}
+
+/// 压缩函数 CF
+pub(crate) fn compress(state: &mut [u32; 8], block: &[u8; BLOCK_SIZE]) {
+    let mut w = [0u32; 68];
+    for (i, word) in block.chunks_exact(4).enumerate() {
+        w[i] = u32::from_be_bytes(word.try_into().unwrap());
+    }
+    for j in 16..68 {
+        w[j] = p1(w[j - 16] ^ w[j - 9] ^ w[j - 3].rotate_left(15)) ^ w[j - 13].rotate_left(7) ^ w[j - 6];
+    }
+
+    let [mut a, mut b, mut c, mut d, mut e, mut f, mut g, mut h] = *state;
+    for j in 0..64 {
+        let t: u32 = if j < 16 { 0x79cc_4519 } else { 0x7a87_9d8a };
+        let ss1 = a
+            .rotate_left(12)
+            .wrapping_add(e)
+            .wrapping_add(t.rotate_left(j as u32 % 32))
+            .rotate_left(7);
+        let ss2 = ss1 ^ a.rotate_left(12);
+        let (ff, gg) = if j < 16 {
+            (a ^ b ^ c, e ^ f ^ g)
+        } else {
+            ((a & b) | (a & c) | (b & c), (e & f) | (!e & g))
+        };
+        let tt1 = ff.wrapping_add(d).wrapping_add(ss2).wrapping_add(w[j] ^ w[j + 4]);
+        let tt2 = gg.wrapping_add(h).wrapping_add(ss1).wrapping_add(w[j]);
+        d = c;
+        c = b.rotate_left(9);
+        b = a;
+        a = tt1;
+        h = g;
+        g = f.rotate_left(19);
+        f = e;
+        e = p0(tt2);
+    }
+
+    for (s, v) in state.iter_mut().zip([a, b, c, d, e, f, g, h]) {
+        *s ^= v;
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use gm_sdk::sm3::sm3_hash;
+
+    #[test]
+    fn test_standard_vectors() {
+        assert_eq!(
+            hex::encode(Sm3::digest(b"abc")),
+            "66c7f0f462eeedd9d1f2d46bdc10e4e24167c4875cf2f7a2297da02b8f4ba8e0"
+        );
+        assert_eq!(
+            hex::encode(Sm3::digest(&b"abcd".repeat(16))),
+            "debe9ff92275b8a138604889c18e5a4d6fdb70e5387e5765293dcba39c0c5732"
+        );
+    }
+
+    #[test]
+    fn test_incremental_matches_oneshot() {
+        let data: Vec<u8> = (0..1000u32).map(|i| (i * 31 + 7) as u8).collect();
+        for len in [0usize, 1, 55, 56, 63, 64, 65, 119, 120, 128, 1000] {
+            let expected = sm3_hash(&data[..len]);
+            for chunk in [1usize, 7, 64, 100] {
+                let mut hasher = Sm3::new();
+                for part in data[..len].chunks(chunk) {
+                    hasher.update(part);
+                }
+                assert_eq!(hasher.finalize(), expected, "len={} chunk={}", len, chunk);
+            }
+        }
+    }
+
+    #[test]
+    fn test_finalize_reset() {
+        let mut hasher = Sm3::new();
+        hasher.update(b"first");
+        assert_eq!(hasher.finalize_reset(), sm3_hash(b"first"));
+        hasher.update(b"abc");
+        assert_eq!(hasher.finalize_reset(), sm3_hash(b"abc"));
+    }
+}
@@ -0,0 +1,465 @@
+//! 多路 SM3：一次压缩多条相互独立的消息
+//!
+//! KDF 的各计数器分组、批量签名中的各条 E 互不依赖，可以让每条消息占一个
+//! SIMD 通道并行压缩。x86_64 上运行时检测到 AVX2 时使用 8 路 256 位实现，
+//! 否则回退为逐条调用标量压缩函数，两条路径结果逐字节一致。
+//!
+//! 各消息长度可以不同：某个通道的消息处理完后立即换入下一条，
+//! 通道空闲只出现在队列末尾。
+
+use crate::sm3::{compress, Sm3, BLOCK_SIZE, DIGEST_SIZE, IV};
+
+/// 并行通道数
+pub const LANES: usize = 8;
+
+/// 压缩函数实现
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Backend {
+    /// 8 路 AVX2
+    Avx2,
+    /// 标量逐条压缩
+    Scalar,
+}
+
+impl Backend {
+    /// 按运行时 CPU 特性选择最快的实现
+    pub fn detect() -> Self {
+        #[cfg(target_arch = "x86_64")]
+        {
+            if std::arch::is_x86_feature_detected!("avx2") {
+                return Backend::Avx2;
+            }
+        }
+        Backend::Scalar
+    }
+
+    /// 实现名称，用于日志和基准测试输出
+    pub fn name(self) -> &'static str {
+        match self {
+            Backend::Avx2 => "avx2",
+            Backend::Scalar => "scalar",
+        }
+    }
+}
+
+/// 多路 SM3 引擎
+#[derive(Debug, Clone, Copy)]
+pub struct MultiSm3 {
+    backend: Backend,
+}
+
+impl MultiSm3 {
+    /// 使用运行时检测到的实现
+    pub fn new() -> Self {
+        Self {
+            backend: Backend::detect(),
+        }
+    }
+
+    /// 指定实现；当前 CPU 不支持时回退为标量实现
+    pub fn with_backend(backend: Backend) -> Self {
+        let backend = match backend {
+            Backend::Avx2 if Backend::detect() != Backend::Avx2 => Backend::Scalar,
+            other => other,
+        };
+        Self { backend }
+    }
+
+    /// 实际使用的实现
+    pub fn backend(&self) -> Backend {
+        self.backend
+    }
+
+    /// 分别计算每条消息的 SM3 摘要，`out` 长度须与 `messages` 相同
+    pub fn hash_into(&self, messages: &[&[u8]], out: &mut [[u8; DIGEST_SIZE]]) {
+        assert_eq!(messages.len(), out.len(), "output length mismatch");
+        self.run(out, |i| Job {
+            state: IV,
+            offset: 0,
+            head: &[],
+            body: messages[i],
+        });
+    }
+
+    /// 分别计算每条消息的 SM3 摘要
+    pub fn hash(&self, messages: &[&[u8]]) -> Vec<[u8; DIGEST_SIZE]> {
+        let mut out = vec![[0u8; DIGEST_SIZE]; messages.len()];
+        self.hash_into(messages, &mut out);
+        out
+    }
+
+    /// 从同一个中间状态 `base` 出发，分别追加每条消息并输出摘要
+    ///
+    /// 结果等价于对每条消息执行 `base.clone()` → `update` → `finalize`，
+    /// `base` 本身不变。
+    pub fn finalize_into(&self, base: &Sm3, messages: &[&[u8]], out: &mut [[u8; DIGEST_SIZE]]) {
+        assert_eq!(messages.len(), out.len(), "output length mismatch");
+        let (state, offset, head) = base.midstate();
+        self.run(out, |i| Job {
+            state,
+            offset,
+            head,
+            body: messages[i],
+        });
+    }
+
+    /// 调度：通道空闲时换入下一条消息，直到全部完成
+    fn run<'a>(&self, out: &mut [[u8; DIGEST_SIZE]], job: impl Fn(usize) -> Job<'a>) {
+        if self.backend == Backend::Scalar || out.len() == 1 {
+            for (i, digest) in out.iter_mut().enumerate() {
+                *digest = job(i).hash_scalar();
+            }
+            return;
+        }
+
+        let mut lanes: [Option<Lane<'a>>; LANES] = Default::default();
+        let mut states = [[0u32; 8]; LANES];
+        let mut blocks = [[0u8; BLOCK_SIZE]; LANES];
+        let mut next = 0;
+
+        loop {
+            let mut active = 0;
+            for (l, slot) in lanes.iter_mut().enumerate() {
+                if slot.is_none() && next < out.len() {
+                    let new_job = job(next);
+                    states[l] = new_job.state;
+                    *slot = Some(Lane {
+                        job: new_job,
+                        index: next,
+                        block: 0,
+                        blocks: new_job.blocks(),
+                    });
+                    next += 1;
+                }
+                if let Some(lane) = slot {
+                    lane.job.fill_block(lane.block, &mut blocks[l]);
+                    active += 1;
+                }
+            }
+            if active == 0 {
+                break;
+            }
+
+            // Reason: 只剩一两条长消息时，8 路压缩的大部分通道是空转，逐条标量压缩更快
+            if active < 3 {
+                for (l, slot) in lanes.iter().enumerate() {
+                    if slot.is_some() {
+                        compress(&mut states[l], &blocks[l]);
+                    }
+                }
+            } else {
+                self.compress_lanes(&mut states, &blocks);
+            }
+
+            for (l, slot) in lanes.iter_mut().enumerate() {
+                if let Some(lane) = slot {
+                    lane.block += 1;
+                    if lane.block == lane.blocks {
+                        out[lane.index] = state_to_bytes(&states[l]);
+                        *slot = None;
+                    }
+                }
+            }
+        }
+    }
+
+    fn compress_lanes(&self, states: &mut [[u32; 8]; LANES], blocks: &[[u8; BLOCK_SIZE]; LANES]) {
+        match self.backend {
+            // SAFETY: Backend::Avx2 只在运行时检测到 AVX2 后才会被选中
+            #[cfg(target_arch = "x86_64")]
+            Backend::Avx2 => unsafe { avx2::compress8(states, blocks) },
+            _ => {
+                for (state, block) in states.iter_mut().zip(blocks) {
+                    compress(state, block);
+                }
+            }
+        }
+    }
+}
+
+impl Default for MultiSm3 {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+/// 分别计算每条消息的 SM3 摘要（自动选择实现）
+pub fn hash_many(messages: &[&[u8]]) -> Vec<[u8; DIGEST_SIZE]> {
+    MultiSm3::new().hash(messages)
+}
+
+/// 一条待计算的消息：从中间状态 `state` 出发，剩余数据为 head || body
+#[derive(Clone, Copy)]
+struct Job<'a> {
+    state: [u32; 8],
+    /// `state` 之前已压缩的字节数
+    offset: u64,
+    head: &'a [u8],
+    body: &'a [u8],
+}
+
+impl Job<'_> {
+    fn len(&self) -> usize {
+        self.head.len() + self.body.len()
+    }
+
+    /// 含填充在内还需压缩的分组数
+    fn blocks(&self) -> usize {
+        (self.len() + 9).div_ceil(BLOCK_SIZE)
+    }
+
+    /// 生成第 `index` 个分组，末尾分组按 SM3 规则就地填充
+    fn fill_block(&self, index: usize, out: &mut [u8; BLOCK_SIZE]) {
+        let len = self.len();
+        let start = index * BLOCK_SIZE;
+        if start + BLOCK_SIZE <= len {
+            self.copy_from(start, out);
+            return;
+        }
+
+        out.fill(0);
+        if start <= len {
+            self.copy_from(start, &mut out[..len - start]);
+            out[len - start] = 0x80;
+        }
+        if index + 1 == self.blocks() {
+            let bit_len = (self.offset + len as u64).wrapping_mul(8);
+            out[BLOCK_SIZE - 8..].copy_from_slice(&bit_len.to_be_bytes());
+        }
+    }
+
+    /// 从 head || body 的 `start` 处拷贝 `dst.len()` 字节
+    fn copy_from(&self, start: usize, dst: &mut [u8]) {
+        let mut dst = dst;
+        let mut pos = start;
+        if pos < self.head.len() {
+            let n = (self.head.len() - pos).min(dst.len());
+            dst[..n].copy_from_slice(&self.head[pos..pos + n]);
+            dst = &mut dst[n..];
+            if dst.is_empty() {
+                return;
+            }
+            pos += n;
+        }
+        let pos = pos - self.head.len();
+        dst.copy_from_slice(&self.body[pos..pos + dst.len()]);
+    }
+
+    fn hash_scalar(&self) -> [u8; DIGEST_SIZE] {
+        let mut state = self.state;
+        let mut block = [0u8; BLOCK_SIZE];
+        for index in 0..self.blocks() {
+            self.fill_block(index, &mut block);
+            compress(&mut state, &block);
+        }
+        state_to_bytes(&state)
+    }
+}
+
+struct Lane<'a> {
+    job: Job<'a>,
+    /// 消息在输入中的下标
+    index: usize,
+    /// 下一个待压缩的分组
+    block: usize,
+    blocks: usize,
+}
+
+fn state_to_bytes(state: &[u32; 8]) -> [u8; DIGEST_SIZE] {
+    let mut out = [0u8; DIGEST_SIZE];
+    for (chunk, word) in out.chunks_exact_mut(4).zip(state) {
+        chunk.copy_from_slice(&word.to_be_bytes());
+    }
+    out
+}
+
+#[cfg(target_arch = "x86_64")]
+mod avx2 {
+    //! 8 路 AVX2 压缩函数：每个 32 位通道对应一条消息
+
+    use super::LANES;
+    use crate::sm3::BLOCK_SIZE;
+    use std::arch::x86_64::*;
+
+    /// 预先展开的 T_j <<< (j mod 32)
+    const T_ROT: [u32; 64] = {
+        let mut t = [0u32; 64];
+        let mut j = 0;
+        while j < 64 {
+            let base: u32 = if j < 16 { 0x79cc_4519 } else { 0x7a87_9d8a };
+            t[j] = base.rotate_left((j % 32) as u32);
+            j += 1;
+        }
+        t
+    };
+
+    macro_rules! rotl {
+        ($x:expr, $n:literal) => {{
+            let x = $x;
+            _mm256_or_si256(_mm256_slli_epi32::<$n>(x), _mm256_srli_epi32::<{ 32 - $n }>(x))
+        }};
+    }
+
+    macro_rules! xor3 {
+        ($a:expr, $b:expr, $c:expr) => {
+            _mm256_xor_si256(_mm256_xor_si256($a, $b), $c)
+        };
+    }
+
+    /// 把各通道的第 i 个字转置为向量
+    #[inline]
+    #[target_feature(enable = "avx2")]
+    unsafe fn gather(words: &[u32; LANES]) -> __m256i {
+        _mm256_loadu_si256(words.as_ptr().cast())
+    }
+
+    #[inline]
+    #[target_feature(enable = "avx2")]
+    unsafe fn scatter(v: __m256i) -> [u32; LANES] {
+        let mut words = [0u32; LANES];
+        _mm256_storeu_si256(words.as_mut_ptr().cast(), v);
+        words
+    }
+
+    /// 压缩函数 CF，8 条消息各压缩一个分组
+    #[target_feature(enable = "avx2")]
+    pub(super) unsafe fn compress8(states: &mut [[u32; 8]; LANES], blocks: &[[u8; BLOCK_SIZE]; LANES]) {
+        let mut w = [_mm256_setzero_si256(); 68];
+        for i in 0..16 {
+            let mut words = [0u32; LANES];
+            for (word, block) in words.iter_mut().zip(blocks) {
+                *word = u32::from_be_bytes([block[i * 4], block[i * 4 + 1], block[i * 4 + 2], block[i * 4 + 3]]);
+            }
+            w[i] = gather(&words);
+        }
+        for j in 16..68 {
+            let x = xor3!(w[j - 16], w[j - 9], rotl!(w[j - 3], 15));
+            let p1 = xor3!(x, rotl!(x, 15), rotl!(x, 23));
+            w[j] = xor3!(p1, rotl!(w[j - 13], 7), w[j - 6]);
+        }
+
+        let mut v = [_mm256_setzero_si256(); 8];
+        for (i, slot) in v.iter_mut().enumerate() {
+            let mut words = [0u32; LANES];
+            for (word, state) in words.iter_mut().zip(states.iter()) {
+                *word = state[i];
+            }
+            *slot = gather(&words);
+        }
+
+        let [mut a, mut b, mut c, mut d, mut e, mut f, mut g, mut h] = v;
+        macro_rules! round {
+            ($j:expr, $ff:expr, $gg:expr) => {{
+                let j = $j;
+                let a12 = rotl!(a, 12);
+                let t = _mm256_set1_epi32(T_ROT[j] as i32);
+                let ss1 = rotl!(_mm256_add_epi32(_mm256_add_epi32(a12, e), t), 7);
+                let ss2 = _mm256_xor_si256(ss1, a12);
+                let ff = $ff;
+                let gg = $gg;
+                let tt1 = _mm256_add_epi32(
+                    _mm256_add_epi32(ff, d),
+                    _mm256_add_epi32(ss2, _mm256_xor_si256(w[j], w[j + 4])),
+                );
+                let tt2 = _mm256_add_epi32(_mm256_add_epi32(gg, h), _mm256_add_epi32(ss1, w[j]));
+                d = c;
+                c = rotl!(b, 9);
+                b = a;
+                a = tt1;
+                h = g;
+                g = rotl!(f, 19);
+                f = e;
+                e = xor3!(tt2, rotl!(tt2, 9), rotl!(tt2, 17));
+            }};
+        }
+
+        for j in 0..16 {
+            round!(j, xor3!(a, b, c), xor3!(e, f, g));
+        }
+        for j in 16..64 {
+            round!(
+                j,
+                // (a & b) | (a & c) | (b & c) = (a & b) | ((a | b) & c)
+                _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(_mm256_or_si256(a, b), c)),
+                _mm256_or_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g))
+            );
+        }
+
+        for (i, x) in [a, b, c, d, e, f, g, h].into_iter().enumerate() {
+            let words = scatter(_mm256_xor_si256(x, v[i]));
+            for (state, word) in states.iter_mut().zip(words) {
+                state[i] = word;
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn messages() -> Vec<Vec<u8>> {
+        // 覆盖填充边界附近的长度，数量不是 LANES 的整数倍
+        [0usize, 1, 3, 55, 56, 63, 64, 65, 119, 120, 128, 200, 1000, 4096, 17, 33, 500, 64 * 9]
+            .iter()
+            .map(|&len| (0..len).map(|i| (i * 131 + len) as u8).collect())
+            .collect()
+    }
+
+    #[test]
+    fn test_hash_matches_single() {
+        let messages = messages();
+        let refs: Vec<&[u8]> = messages.iter().map(Vec::as_slice).collect();
+        for backend in [Backend::Scalar, Backend::Avx2] {
+            let engine = MultiSm3::with_backend(backend);
+            let digests = engine.hash(&refs);
+            for (message, digest) in messages.iter().zip(&digests) {
+                assert_eq!(*digest, Sm3::digest(message), "backend={:?} len={}", engine.backend(), message.len());
+            }
+        }
+    }
+
+    #[test]
+    fn test_finalize_matches_clone() {
+        let messages = messages();
+        let refs: Vec<&[u8]> = messages.iter().map(Vec::as_slice).collect();
+        for prefix in [0usize, 4, 32, 64, 100] {
+            let mut base = Sm3::new();
+            base.update(&vec![0xa5u8; prefix]);
+            for backend in [Backend::Scalar, Backend::Avx2] {
+                let mut out = vec![[0u8; DIGEST_SIZE]; refs.len()];
+                MultiSm3::with_backend(backend).finalize_into(&base, &refs, &mut out);
+                for (message, digest) in refs.iter().zip(&out) {
+                    let mut hasher = base.clone();
+                    hasher.update(message);
+                    assert_eq!(*digest, hasher.finalize(), "prefix={} len={}", prefix, message.len());
+                }
+            }
+        }
+    }
+
+    #[cfg(target_arch = "x86_64")]
+    #[test]
+    fn test_avx2_compress_matches_scalar() {
+        if Backend::detect() != Backend::Avx2 {
+            return;
+        }
+        let mut states = [[0u32; 8]; LANES];
+        let mut blocks = [[0u8; BLOCK_SIZE]; LANES];
+        for l in 0..LANES {
+            for i in 0..8 {
+                states[l][i] = IV[i].wrapping_mul(l as u32 + 1) ^ (i as u32);
+            }
+            for (i, byte) in blocks[l].iter_mut().enumerate() {
+                *byte = (i * 7 + l * 13) as u8;
+            }
+        }
+
+        let mut expected = states;
+        for (state, block) in expected.iter_mut().zip(&blocks) {
+            compress(state, block);
+        }
+        unsafe { avx2::compress8(&mut states, &blocks) };
+        assert_eq!(states, expected);
+    }
+}
@@ -1,7 +1,15 @@
 //! 数据类型定义
 
+use crate::secure::SecretScalar;
+use crate::sm3::Sm3;
 use serde::{Deserialize, Serialize};
 
+/// 定长标量（32 字节大端序，如 d1、k1、r、s）
+pub type ScalarBytes = [u8; 32];
+
+/// 定长椭圆曲线点（64 字节，x||y，无 04 前缀）
+pub type PointBytes = [u8; 64];
+
 /// 用户信息
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct UserInfo {
@@ -15,7 +23,7 @@ pub struct UserInfo {
 }
 
 /// 会话信息
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct Session {
     pub token: String,
     pub user_id: String,
@@ -23,14 +31,20 @@ pub struct Session {
 }
 
 /// 密钥对（客户端持有的 D1 分量）
+///
+/// D1 与 d1⁻¹ 存放在安全内存池中（见 `secure`），克隆会各占新的槽位。
 #[derive(Debug, Clone)]
 pub struct KeyPair {
-    /// 客户端私钥分量 D1
-    pub d1: Vec<u8>,
+    /// 客户端私钥分量 D1（32 字节）
+    pub d1: SecretScalar,
+    /// D1 的模逆 d1⁻¹ mod n（32 字节），创建密钥对时预先计算，避免每次签名求逆
+    pub d1_inv: SecretScalar,
     /// 协同公钥 Pa
     pub public_key: Vec<u8>,
     /// 用户 ID
     pub user_id: String,
+    /// 已吸收 Z 值的 SM3 中间状态，每次签名克隆一份后只需哈希消息本身
+    pub z_hasher: Sm3,
 }
 
 /// 签名结果
@@ -84,6 +98,41 @@ pub struct SignResponse {
     pub s3: String,
 }
 
+/// 预提交响应数据，`items` 与请求中的 Q1 一一对应
+#[derive(Debug, Clone, Deserialize)]
+pub struct PrecommitResponse {
+    pub items: Vec<PrecommitItem>,
+}
+
+/// 一个预提交随机数的一次性编号
+#[derive(Debug, Clone, Deserialize)]
+pub struct PrecommitItem {
+    pub id: String,
+    /// 过期时间，空表示由服务端自行回收
+    #[serde(default)]
+    pub expires_at: String,
+}
+
+/// 批量签名响应数据
+#[derive(Debug, Clone, Deserialize)]
+pub struct SignBatchResponse {
+    pub items: Vec<SignBatchItem>,
+}
+
+/// 批量签名响应中的单项结果
+///
+/// `code` 为 0 时 r/s2/s3 有效，否则 `message` 给出该项的失败原因。
+#[derive(Debug, Clone, Deserialize)]
+pub struct SignBatchItem {
+    #[serde(default)]
+    pub code: i32,
+    #[serde(default)]
+    pub message: String,
+    pub r: Option<String>,
+    pub s2: Option<String>,
+    pub s3: Option<String>,
+}
+
 /// 解密响应数据
 #[derive(Debug, Clone, Deserialize)]
 pub struct DecryptResponse {
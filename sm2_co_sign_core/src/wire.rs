@@ -0,0 +1,177 @@
+//! 签名/解密接口的线上编码
+//!
+//! - `Json`：默认格式，二进制字段 base64 编码后放入 JSON 请求体
+//! - `Binary`：`application/x-sm2-cosign`，字段为原始字节，每个字段前加 4 字节大端长度
+//!
+//! Binary 报文布局：
+//!
+//! ```text
+//! 请求 = field*
+//! 响应 = code (i32 大端，4 字节) || field*      code 非 0 时只有一个字段：UTF-8 错误信息
+//!
+//! /api/sign        请求 user_id, q1, e           响应 r, s2, s3
+//! /api/sign/batch  请求 user_id, (q1, e)*        响应 (item_code, r, s2, s3 | item_code, message)*
+//! /api/decrypt     请求 user_id, t1              响应 t2
+//! ```
+//!
+//! 批量响应中 item_code 为 4 字节字段（i32 大端），为 0 时后跟 r/s2/s3，否则后跟错误信息。
+//! 服务端不支持 Binary 时返回 415/406，客户端回退为 JSON。
+
+use crate::error::{Error, Result};
+
+/// Binary 格式的 Content-Type
+pub const BINARY_CONTENT_TYPE: &str = "application/x-sm2-cosign";
+
+/// 签名/解密请求的线上编码
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum WireFormat {
+    /// JSON + base64（所有服务端均支持）
+    #[default]
+    Json,
+    /// 长度前缀的原始字节，服务端不支持时自动回退为 JSON
+    Binary,
+}
+
+/// 按长度前缀拼接字段
+pub fn encode_fields(fields: &[&[u8]]) -> Vec<u8> {
+    let total = fields.iter().map(|f| 4 + f.len()).sum();
+    let mut out = Vec::with_capacity(total);
+    for field in fields {
+        push_field(&mut out, field);
+    }
+    out
+}
+
+/// 追加一个长度前缀字段
+pub fn push_field(out: &mut Vec<u8>, field: &[u8]) {
+    out.extend_from_slice(&(field.len() as u32).to_be_bytes());
+    out.extend_from_slice(field);
+}
+
+/// 编码响应（服务端或测试桩使用）
+pub fn encode_response(code: i32, fields: &[&[u8]]) -> Vec<u8> {
+    let mut out = code.to_be_bytes().to_vec();
+    out.extend_from_slice(&encode_fields(fields));
+    out
+}
+
+/// 解析响应头部的 code，非 0 时返回 `Error::Api`，否则返回后续字段的读取器
+pub fn decode_response(body: &[u8]) -> Result<FieldReader<'_>> {
+    if body.len() < 4 {
+        return Err(Error::Encoding("Binary response too short".to_string()));
+    }
+    let code = i32::from_be_bytes(body[..4].try_into().unwrap());
+    let mut reader = FieldReader::new(&body[4..]);
+    if code != 0 {
+        let message = String::from_utf8_lossy(reader.next_field()?).into_owned();
+        return Err(Error::Api { code, message });
+    }
+    Ok(reader)
+}
+
+/// 逐个读取长度前缀字段
+#[derive(Debug)]
+pub struct FieldReader<'a> {
+    data: &'a [u8],
+}
+
+impl<'a> FieldReader<'a> {
+    /// 从报文创建读取器
+    pub fn new(data: &'a [u8]) -> Self {
+        Self { data }
+    }
+
+    /// 读取下一个字段
+    pub fn next_field(&mut self) -> Result<&'a [u8]> {
+        if self.data.len() < 4 {
+            return Err(Error::Encoding("Truncated binary field header".to_string()));
+        }
+        let len = u32::from_be_bytes(self.data[..4].try_into().unwrap()) as usize;
+        let rest = &self.data[4..];
+        if rest.len() < len {
+            return Err(Error::Encoding(format!(
+                "Binary field needs {} bytes, {} remaining",
+                len,
+                rest.len()
+            )));
+        }
+        let (field, rest) = rest.split_at(len);
+        self.data = rest;
+        Ok(field)
+    }
+
+    /// 读取一个 4 字节字段并解析为 i32（大端）
+    pub fn next_i32(&mut self) -> Result<i32> {
+        let field = self.next_field()?;
+        let bytes: [u8; 4] = field
+            .try_into()
+            .map_err(|_| Error::Encoding(format!("Expected 4-byte code field, got {} bytes", field.len())))?;
+        Ok(i32::from_be_bytes(bytes))
+    }
+
+    /// 是否已读完
+    pub fn is_empty(&self) -> bool {
+        self.data.is_empty()
+    }
+
+    /// 确认没有多余数据
+    pub fn finish(self) -> Result<()> {
+        if self.data.is_empty() {
+            Ok(())
+        } else {
+            Err(Error::Encoding(format!("{} trailing bytes in binary message", self.data.len())))
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_fields_roundtrip() {
+        let encoded = encode_fields(&[b"user", &[], &[7u8; 64]]);
+        assert_eq!(encoded.len(), 3 * 4 + 4 + 64);
+
+        let mut reader = FieldReader::new(&encoded);
+        assert_eq!(reader.next_field().unwrap(), b"user");
+        assert_eq!(reader.next_field().unwrap(), b"");
+        assert_eq!(reader.next_field().unwrap(), &[7u8; 64][..]);
+        assert!(reader.is_empty());
+        reader.finish().unwrap();
+    }
+
+    #[test]
+    fn test_response_code() {
+        let ok = encode_response(0, &[b"t2"]);
+        let mut reader = decode_response(&ok).unwrap();
+        assert_eq!(reader.next_field().unwrap(), b"t2");
+
+        let err = encode_response(1003, &[b"token expired"]);
+        match decode_response(&err) {
+            Err(Error::Api { code, message }) => {
+                assert_eq!(code, 1003);
+                assert_eq!(message, "token expired");
+            }
+            other => panic!("unexpected {:?}", other),
+        }
+    }
+
+    #[test]
+    fn test_malformed_input() {
+        assert!(decode_response(&[0, 0]).is_err());
+        // 声明长度超过剩余数据
+        let mut reader = FieldReader::new(&[0, 0, 0, 9, 1, 2]);
+        assert!(matches!(reader.next_field(), Err(Error::Encoding(_))));
+        // 多余数据
+        let encoded = encode_fields(&[b"a"]);
+        let mut data = encoded.clone();
+        data.push(0);
+        let mut reader = FieldReader::new(&data);
+        reader.next_field().unwrap();
+        assert!(reader.finish().is_err());
+        // code 字段长度不为 4
+        let mut reader = FieldReader::new(&encoded);
+        assert!(reader.next_i32().is_err());
+    }
+}
@@ -7,6 +7,7 @@ fn get_client() -> CoSignClient {
         server_url: "http://127.0.0.1:8080".to_string(),
         timeout: 30,
         verify_tls: false,
+        ..ClientConfig::default()
     };
     CoSignClient::new(config).expect("Failed to create client")
 }
@@ -21,16 +21,94 @@ extern "C" {
 #define COSIGN_ERR_CRYPTO       -3
 #define COSIGN_ERR_NETWORK      -4
 #define COSIGN_ERR_ENCODING     -5
+#define COSIGN_ERR_POOL_EMPTY   -6
+#define COSIGN_ERR_API          -7
+#define COSIGN_ERR_NOT_AUTHENTICATED -8
+#define COSIGN_ERR_BUFFER_TOO_SMALL -9
+#define COSIGN_ERR_INVALID_STATE -10
 
-/* 协议上下文（不透明指针） */
+/*
+ * 变长输出约定（cosign_sm2_encrypt / cosign_sm2_decrypt / cosign_complete_decryption /
+ * cosign_base64_encode / cosign_base64_decode / cosign_metrics_snapshot）：
+ *   - 调用前 *out_len 为输出缓冲区容量，返回时为所需（成功时为实际写入）长度
+ *   - 输出缓冲区为 NULL 时只查询所需长度，返回 COSIGN_OK
+ *   - 容量不足时返回 COSIGN_ERR_BUFFER_TOO_SMALL，*out_len 为所需长度
+ * 结果直接写入调用方缓冲区，库内不做中间拷贝。
+ */
+
+/*
+ * 协议上下文（不透明指针）
+ * 线程安全：创建后只读，同一上下文可被任意多个线程同时使用，无需每线程各建一个。
+ * 随机数发生器与 Z 缓存按线程保存，调用之间不加锁；导入的 D1 表由读写锁保护，
+ * 签名、解密只取读锁。仅 cosign_context_free 须在所有线程停止使用后调用。
+ */
 typedef struct CoSignContext CoSignContext;
 
+/* 预生成 (k1, Q1) 随机数池（不透明指针） */
+typedef struct CoSignNoncePool CoSignNoncePool;
+
+/* 增量 SM3 上下文（不透明指针） */
+typedef struct CoSignSm3Ctx CoSignSm3Ctx;
+
+/* 流式解密上下文（不透明指针） */
+typedef struct CoSignDecryptCtx CoSignDecryptCtx;
+
+/* 联网客户端（不透明指针，内部持有多线程异步运行时） */
+typedef struct CoSignClientHandle CoSignClientHandle;
+
+/* 联网客户端配置 */
+typedef struct CoSignClientConfig {
+    const char *server_url;         /* 服务器 URL（必填） */
+    unsigned long timeout_secs;     /* 请求超时（秒），0 使用默认值 30 */
+    int verify_tls;                 /* 是否验证 TLS 证书（非 0 为是） */
+    unsigned long nonce_pool_size;  /* 预生成随机数池容量，0 不启用 */
+    unsigned int worker_threads;    /* 运行时工作线程数，0 与 CPU 核数相同 */
+    int binary_wire;                /* 是否使用二进制线上编码（非 0 为是） */
+} CoSignClientConfig;
+
+/**
+ * 异步结果回调
+ * 在运行时工作线程上调用；回调中调用阻塞接口（login/set_session/set_key_pair）
+ * 返回 COSIGN_ERR_INVALID_STATE。
+ * @param user_data 提交时传入的用户数据
+ * @param status 错误码，COSIGN_OK 表示成功
+ * @param data 成功时为结果（签名 r||s 或明文），失败时为 NULL；仅在回调期间有效
+ * @param data_len 结果长度
+ */
+typedef void (*cosign_result_cb)(void *user_data,
+                                 int status,
+                                 const unsigned char *data,
+                                 unsigned long data_len);
+
+/**
+ * 批量签名回调
+ * 调用线程与限制同 cosign_result_cb。
+ * @param user_data 提交时传入的用户数据
+ * @param status 全部成功为 COSIGN_OK，否则为第一个失败项的错误码
+ * @param signatures count 个 64 字节签名 r||s（失败项全零）；仅在回调期间有效
+ * @param item_status 每一项的错误码；仅在回调期间有效
+ * @param count 签名数量，与提交时相同
+ */
+typedef void (*cosign_batch_cb)(void *user_data,
+                                int status,
+                                const unsigned char *signatures,
+                                const int *item_status,
+                                unsigned long count);
+
 /**
  * 创建协议上下文
  * @return 协议上下文指针，失败返回 NULL
  */
 CoSignContext *cosign_context_new(void);
 
+/**
+ * 创建协议上下文，并指定生成元预计算表的窗口宽度
+ * @param window_bits 0 表示不建表（通用点乘）；1~8 表示窗口宽度，
+ *                    越大点乘越快、占用内存越多（4 约 90KB，8 约 780KB）
+ * @return 协议上下文指针，参数非法或失败返回 NULL
+ */
+CoSignContext *cosign_context_new_with_window(unsigned int window_bits);
+
 /**
  * 销毁协议上下文
  * @param ctx 协议上下文指针
@@ -44,7 +122,7 @@ void cosign_context_free(CoSignContext *ctx);
  * @param out_len 输出长度
  * @return 错误码
  */
-int cosign_generate_d1(CoSignContext *ctx, unsigned char *out_d1, unsigned long *out_len);
+int cosign_generate_d1(const CoSignContext *ctx, unsigned char *out_d1, unsigned long *out_len);
 
 /**
  * 计算 P1 = d1 * G
@@ -77,11 +155,57 @@ int cosign_sign_prepare(const CoSignContext *ctx,
                         unsigned long *q1_len);
 
 /**
- * 计算消息哈希
+ * 创建随机数池（创建后为空，需调用 cosign_nonce_pool_fill 填充）
+ * @param capacity 池容量（必须大于 0）
+ * @return 随机数池指针，失败返回 NULL
+ */
+CoSignNoncePool *cosign_nonce_pool_new(unsigned long capacity);
+
+/**
+ * 销毁随机数池，剩余的随机数会被清零
+ * @param pool 随机数池指针
+ */
+void cosign_nonce_pool_free(CoSignNoncePool *pool);
+
+/**
+ * 在调用线程中把随机数池补满（可在空闲线程中周期性调用）
+ * @param ctx 协议上下文指针
+ * @param pool 随机数池指针
+ * @param out_filled 本次新增数量（可为 NULL）
+ * @return 错误码
+ */
+int cosign_nonce_pool_fill(const CoSignContext *ctx,
+                           const CoSignNoncePool *pool,
+                           unsigned long *out_filled);
+
+/**
+ * 从随机数池取出一对 (k1, Q1)，每对只会被取出一次，可替代 cosign_sign_prepare
+ * @param pool 随机数池指针
+ * @param out_k1 输出缓冲区（至少32字节）
+ * @param k1_len 输出长度
+ * @param out_q1 输出缓冲区（至少64字节）
+ * @param q1_len 输出长度
+ * @return 错误码，池为空时返回 COSIGN_ERR_POOL_EMPTY
+ */
+int cosign_nonce_pool_take(const CoSignNoncePool *pool,
+                           unsigned char *out_k1,
+                           unsigned long *k1_len,
+                           unsigned char *out_q1,
+                           unsigned long *q1_len);
+
+/**
+ * 随机数池当前可用数量，可用于池饥饿告警
+ * @param pool 随机数池指针
+ * @return 可用数量
+ */
+unsigned long cosign_nonce_pool_available(const CoSignNoncePool *pool);
+
+/**
+ * 计算消息哈希 E = SM3(Z || M)，上下文会缓存最近一次使用的公钥的 Z 值
  * @param ctx 协议上下文指针
  * @param message 消息数据
  * @param message_len 消息长度
- * @param public_key 公钥（可选）
+ * @param public_key 公钥（64字节 x||y 或 65字节 04||x||y；为 NULL 时 E = SM3(M)）
  * @param public_key_len 公钥长度
  * @param out_hash 输出缓冲区（至少32字节）
  * @param out_len 输出长度
@@ -130,12 +254,35 @@ int cosign_complete_signature(const CoSignContext *ctx,
                               unsigned char *out_s,
                               unsigned long *out_s_len);
 
+/**
+ * 批量完成签名计算（同一 D1 下的多个签名共用一次 d1 求逆）
+ * 用于 C 侧自行发送 /api/sign/batch 请求后的本地计算，单项失败不影响其他项
+ * @param ctx 协议上下文指针
+ * @param d1 私钥分量 D1
+ * @param d1_len D1 长度
+ * @param k1s count 个 32 字节 K1 顺序拼接（不足 32 字节左侧补零）
+ * @param shares count 个 96 字节 r||s2||s3 顺序拼接（各 32 字节）
+ * @param count 签名数量
+ * @param out_signatures 输出 count 个 64 字节签名 r||s（至少 count*64 字节）
+ * @param out_status 输出每一项的错误码（至少 count 个）
+ * @return 全部成功返回 COSIGN_OK，否则返回 COSIGN_ERR_CRYPTO，具体见 out_status；
+ *         count 过大导致缓冲区长度溢出时返回 COSIGN_ERR_INVALID_PARAM
+ */
+int cosign_complete_signature_batch(const CoSignContext *ctx,
+                                    const unsigned char *d1,
+                                    unsigned long d1_len,
+                                    const unsigned char *k1s,
+                                    const unsigned char *shares,
+                                    unsigned long count,
+                                    unsigned char *out_signatures,
+                                    int *out_status);
+
 /**
  * 解密预处理：计算 T1 = d1 * C1
  * @param ctx 协议上下文指针
  * @param d1 私钥分量 D1
  * @param d1_len D1 长度
- * @param c1 密文分量 C1
+ * @param c1 密文分量 C1（64字节 x||y，或带 04 前缀的 65 字节）
  * @param c1_len C1 长度
  * @param out_t1 输出缓冲区（至少64字节）
  * @param out_len 输出长度
@@ -149,22 +296,103 @@ int cosign_decrypt_prepare(const CoSignContext *ctx,
                            unsigned char *out_t1,
                            unsigned long *out_len);
 
+/**
+ * 把 D1 导入上下文，存放在安全内存池中（mlock 锁定不换出，释放时清零），同时预先计算 d1⁻¹
+ * 导入成功后调用方即可清零自己持有的 D1 副本，之后用 *_with_key 接口签名、解密
+ * @param ctx 协议上下文指针
+ * @param d1 私钥分量 D1（不超过 32 字节）
+ * @param d1_len D1 长度
+ * @param out_key_id 输出非零密钥编号（上下文内单调分配、从不复用）
+ * @return 错误码，D1 超长或为 0 时返回 COSIGN_ERR_INVALID_PARAM，编号用尽时返回 COSIGN_ERR_INVALID_STATE
+ */
+int cosign_context_import_d1(const CoSignContext *ctx,
+                             const unsigned char *d1,
+                             unsigned long d1_len,
+                             unsigned int *out_key_id);
+
+/**
+ * 释放导入的 D1：清零并归还安全内存池，编号随即失效，之后导入的密钥不会再使用该编号
+ * @param ctx 协议上下文指针
+ * @param key_id 密钥编号
+ * @return 错误码，编号无效或已释放时返回 COSIGN_ERR_INVALID_PARAM
+ */
+int cosign_context_release_d1(const CoSignContext *ctx, unsigned int key_id);
+
+/**
+ * 用导入的 D1 完成签名计算（复用预先计算的 d1⁻¹）
+ * @param ctx 协议上下文指针
+ * @param key_id 密钥编号
+ * @param k1 随机数 k1
+ * @param k1_len k1 长度
+ * @param r 服务端返回的 r
+ * @param r_len r 长度
+ * @param s2 服务端返回的 s2
+ * @param s2_len s2 长度
+ * @param s3 服务端返回的 s3
+ * @param s3_len s3 长度
+ * @param out_signature 输出缓冲区（64 字节 r||s）
+ * @return 错误码，编号无效时返回 COSIGN_ERR_INVALID_PARAM
+ */
+int cosign_complete_signature_with_key(const CoSignContext *ctx,
+                                       unsigned int key_id,
+                                       const unsigned char *k1,
+                                       unsigned long k1_len,
+                                       const unsigned char *r,
+                                       unsigned long r_len,
+                                       const unsigned char *s2,
+                                       unsigned long s2_len,
+                                       const unsigned char *s3,
+                                       unsigned long s3_len,
+                                       unsigned char *out_signature);
+
+/**
+ * 用导入的 D1 做解密预处理：计算 T1 = d1 * C1
+ * @param ctx 协议上下文指针
+ * @param key_id 密钥编号
+ * @param c1 密文分量 C1（64字节 x||y，或带 04 前缀的 65 字节）
+ * @param c1_len C1 长度
+ * @param out_t1 输出缓冲区（至少64字节）
+ * @param out_len 输出长度
+ * @return 错误码，编号无效时返回 COSIGN_ERR_INVALID_PARAM
+ */
+int cosign_decrypt_prepare_with_key(const CoSignContext *ctx,
+                                    unsigned int key_id,
+                                    const unsigned char *c1,
+                                    unsigned long c1_len,
+                                    unsigned char *out_t1,
+                                    unsigned long *out_len);
+
+/**
+ * 查询安全内存池使用情况（进程内所有上下文与客户端共用）
+ * @param out_capacity 输出已申请的 32 字节槽位总数
+ * @param out_in_use 输出已分发的槽位数（使用中的，加上各线程本地缓存的至多 64 个空闲槽位）
+ * @param out_locked 输出 1 表示全部锁定在物理内存中；0 表示 mlock 失败（如超出 RLIMIT_MEMLOCK）或平台不支持
+ * @return 错误码
+ */
+int cosign_secure_stats(unsigned long *out_capacity,
+                        unsigned long *out_in_use,
+                        int *out_locked);
+
 /**
  * 完成解密计算
  * @param ctx 协议上下文指针
  * @param t2 服务端返回的 T2
  * @param t2_len T2 长度
+ * @param c1 密文分量 C1（64 字节，或带 04 前缀的 65 字节）
+ * @param c1_len C1 长度
  * @param c3 密文分量 C3
  * @param c3_len C3 长度
  * @param c2 密文分量 C2
  * @param c2_len C2 长度
- * @param out_plaintext 输出明文缓冲区
- * @param out_len 输出长度
+ * @param out_plaintext 输出明文缓冲区（长度 c2_len），NULL 时只查询长度
+ * @param out_len 输入缓冲区容量，输出明文长度
  * @return 错误码
  */
 int cosign_complete_decryption(const CoSignContext *ctx,
                                const unsigned char *t2,
                                unsigned long t2_len,
+                               const unsigned char *c1,
+                               unsigned long c1_len,
                                const unsigned char *c3,
                                unsigned long c3_len,
                                const unsigned char *c2,
@@ -172,6 +400,52 @@ int cosign_complete_decryption(const CoSignContext *ctx,
                                unsigned char *out_plaintext,
                                unsigned long *out_len);
 
+/**
+ * 开始流式完成解密（init/update/final），C2 可分块处理，不必整体读入内存
+ * @param ctx 协议上下文指针
+ * @param t2 服务端返回的 T2
+ * @param t2_len T2 长度
+ * @param c1 密文分量 C1（64 字节，或带 04 前缀的 65 字节）
+ * @param c1_len C1 长度
+ * @param c3 密文分量 C3（32 字节）
+ * @param c3_len C3 长度
+ * @return 上下文指针，失败返回 NULL
+ */
+CoSignDecryptCtx *cosign_decrypt_stream_init(const CoSignContext *ctx,
+                                             const unsigned char *t2,
+                                             unsigned long t2_len,
+                                             const unsigned char *c1,
+                                             unsigned long c1_len,
+                                             const unsigned char *c3,
+                                             unsigned long c3_len);
+
+/**
+ * 解密下一段 C2
+ * 注意：输出的明文在 cosign_decrypt_stream_final 返回 COSIGN_OK 之前都未经 C3 校验
+ * @param dctx 流式解密上下文指针
+ * @param c2 C2 分块（c2_len 为 0 时可为 NULL）
+ * @param c2_len 分块长度
+ * @param out_plaintext 输出明文缓冲区（至少 c2_len 字节），可与 c2 相同以原地解密
+ * @return 错误码（final 之后调用返回 COSIGN_ERR_INVALID_PARAM）
+ */
+int cosign_decrypt_stream_update(CoSignDecryptCtx *dctx,
+                                 const unsigned char *c2,
+                                 unsigned long c2_len,
+                                 unsigned char *out_plaintext);
+
+/**
+ * C2 全部送入后校验 C3，之后上下文只能传给 cosign_decrypt_stream_free
+ * @param dctx 流式解密上下文指针
+ * @return 校验通过返回 COSIGN_OK；返回 COSIGN_ERR_CRYPTO 时此前输出的明文必须全部丢弃
+ */
+int cosign_decrypt_stream_final(CoSignDecryptCtx *dctx);
+
+/**
+ * 销毁流式解密上下文
+ * @param dctx 流式解密上下文指针
+ */
+void cosign_decrypt_stream_free(CoSignDecryptCtx *dctx);
+
 /**
  * 计算 SM3 哈希
  * @param data 输入数据
@@ -185,6 +459,64 @@ int cosign_sm3_hash(const unsigned char *data,
                     unsigned char *out_hash,
                     unsigned long *out_len);
 
+/**
+ * 批量计算 SM3 哈希（多路并行，运行时选择 AVX2 或标量实现）
+ * @param messages count 条消息的指针（长度为 0 的消息可为 NULL）
+ * @param lens count 条消息的长度
+ * @param count 消息条数
+ * @param out_hashes 输出缓冲区（至少 count*32 字节），按输入顺序存放摘要
+ * @return 错误码，count 对应的缓冲区大小溢出时返回 COSIGN_ERR_INVALID_PARAM
+ */
+int cosign_sm3_hash_many(const unsigned char *const *messages,
+                         const unsigned long *lens,
+                         unsigned long count,
+                         unsigned char *out_hashes);
+
+/**
+ * 创建增量 SM3 上下文，用于分块哈希大消息
+ * @return 上下文指针，失败返回 NULL
+ */
+CoSignSm3Ctx *cosign_sm3_ctx_new(void);
+
+/**
+ * 创建消息哈希 E 的增量上下文，final 结果与 cosign_hash_message 相同
+ * @param ctx 协议上下文指针
+ * @param public_key 公钥（可选）
+ * @param public_key_len 公钥长度
+ * @return 上下文指针，失败返回 NULL
+ */
+CoSignSm3Ctx *cosign_message_hash_ctx_new(const CoSignContext *ctx,
+                                          const unsigned char *public_key,
+                                          unsigned long public_key_len);
+
+/**
+ * 向增量 SM3 上下文追加数据
+ * @param sm3 增量 SM3 上下文指针
+ * @param data 数据分块（data_len 为 0 时可为 NULL）
+ * @param data_len 分块长度
+ * @return 错误码
+ */
+int cosign_sm3_ctx_update(CoSignSm3Ctx *sm3,
+                          const unsigned char *data,
+                          unsigned long data_len);
+
+/**
+ * 输出摘要，之后上下文恢复为创建时的状态，可继续用于下一条消息
+ * @param sm3 增量 SM3 上下文指针
+ * @param out_hash 输出缓冲区（至少32字节）
+ * @param out_len 输出长度
+ * @return 错误码
+ */
+int cosign_sm3_ctx_final(CoSignSm3Ctx *sm3,
+                         unsigned char *out_hash,
+                         unsigned long *out_len);
+
+/**
+ * 销毁增量 SM3 上下文
+ * @param sm3 增量 SM3 上下文指针
+ */
+void cosign_sm3_ctx_free(CoSignSm3Ctx *sm3);
+
 /**
  * SM2 签名（标准签名）
  * @param private_key 私钥
@@ -219,15 +551,36 @@ int cosign_sm2_verify(const unsigned char *public_key,
                       const unsigned char *signature,
                       unsigned long signature_len);
 
+/**
+ * 批量 SM2 验签（标准验签，多核并行）
+ * 每个签名用交错双标量点乘验证，批内重复的公钥共用预计算表，单项失败不影响其他项
+ * @param ctx 协议上下文指针
+ * @param public_keys count 个 64 字节公钥 x||y 顺序拼接
+ * @param messages count 条消息的指针（长度为 0 的消息可为 NULL）
+ * @param message_lens count 条消息的长度
+ * @param signatures count 个 64 字节签名 r||s 顺序拼接
+ * @param count 签名数量
+ * @param out_status 输出每一项的结果（至少 count 个），COSIGN_OK 为有效，COSIGN_ERR_CRYPTO 为无效
+ * @return 全部有效返回 COSIGN_OK，否则返回 COSIGN_ERR_CRYPTO，具体见 out_status；
+ *         count 过大导致缓冲区长度溢出时返回 COSIGN_ERR_INVALID_PARAM
+ */
+int cosign_sm2_verify_batch(const CoSignContext *ctx,
+                            const unsigned char *public_keys,
+                            const unsigned char *const *messages,
+                            const unsigned long *message_lens,
+                            const unsigned char *signatures,
+                            unsigned long count,
+                            int *out_status);
+
 /**
  * SM2 加密（标准加密）
  * @param public_key 公钥（64字节）
  * @param public_key_len 公钥长度
  * @param message 明文
  * @param message_len 明文长度
- * @param out_ciphertext 输出密文缓冲区
- * @param out_len 输出长度
- * @return 错误码
+ * @param out_ciphertext 输出密文缓冲区（长度 97 + message_len），NULL 时只查询长度
+ * @param out_len 输入缓冲区容量，输出密文长度
+ * @return 错误码，97 + message_len 溢出时返回 COSIGN_ERR_INVALID_PARAM
  */
 int cosign_sm2_encrypt(const unsigned char *public_key,
                        unsigned long public_key_len,
@@ -242,8 +595,8 @@ int cosign_sm2_encrypt(const unsigned char *public_key,
  * @param private_key_len 私钥长度
  * @param ciphertext 密文
  * @param ciphertext_len 密文长度
- * @param out_plaintext 输出明文缓冲区
- * @param out_len 输出长度
+ * @param out_plaintext 输出明文缓冲区（长度 ciphertext_len - 97），NULL 时只查询长度
+ * @param out_len 输入缓冲区容量，输出明文长度
  * @return 错误码
  */
 int cosign_sm2_decrypt(const unsigned char *private_key,
@@ -257,8 +610,8 @@ int cosign_sm2_decrypt(const unsigned char *private_key,
  * Base64 编码
  * @param data 输入数据
  * @param data_len 数据长度
- * @param out_str 输出字符串缓冲区
- * @param out_len 输出长度
+ * @param out_str 输出字符串缓冲区（含结尾 NUL），NULL 时只查询长度
+ * @param out_len 输入缓冲区容量；查询或容量不足时返回所需容量（含 NUL），成功时返回字符串长度（不含 NUL）
  * @return 错误码
  */
 int cosign_base64_encode(const unsigned char *data,
@@ -267,16 +620,137 @@ int cosign_base64_encode(const unsigned char *data,
                          unsigned long *out_len);
 
 /**
- * Base64 解码
+ * Base64 解码（标准字母表，要求填充）
  * @param str Base64 字符串
- * @param out_data 输出数据缓冲区
- * @param out_len 输出长度
- * @return 错误码
+ * @param out_data 输出数据缓冲区，NULL 时只查询长度
+ * @param out_len 输入缓冲区容量；查询或容量不足时返回所需长度，成功时返回写入长度
+ * @return 错误码（非法字符或长度返回 COSIGN_ERR_ENCODING）
  */
 int cosign_base64_decode(const char *str,
                          unsigned char *out_data,
                          unsigned long *out_len);
 
+/* ========== 联网异步客户端 ========== */
+
+/**
+ * 创建联网客户端
+ * @param config 客户端配置
+ * @return 客户端句柄，失败返回 NULL
+ */
+CoSignClientHandle *cosign_client_new(const CoSignClientConfig *config);
+
+/**
+ * 销毁联网客户端
+ * 尚未完成的异步请求被取消，其回调不再被调用；正在执行的回调返回后本函数才返回，
+ * 此后可安全释放 user_data。
+ * 在回调中调用时立即返回：不再开始新的回调，但其他工作线程上已在执行的回调可能仍在运行，
+ * 运行时在它们返回后于后台关闭。需要立即释放 user_data 时应在回调之外调用。
+ * @param client 客户端句柄
+ */
+void cosign_client_free(CoSignClientHandle *client);
+
+/**
+ * 登录（阻塞至完成）
+ * @param client 客户端句柄
+ * @param username 用户名
+ * @param password 密码
+ * @return 错误码；在回调中调用返回 COSIGN_ERR_INVALID_STATE
+ */
+int cosign_client_login(const CoSignClientHandle *client,
+                        const char *username,
+                        const char *password);
+
+/**
+ * 设置会话（从已保存的 token 恢复，阻塞至完成）
+ * @param client 客户端句柄
+ * @param token 会话 token
+ * @param user_id 用户 ID
+ * @return 错误码；在回调中调用返回 COSIGN_ERR_INVALID_STATE
+ */
+int cosign_client_set_session(const CoSignClientHandle *client,
+                              const char *token,
+                              const char *user_id);
+
+/**
+ * 设置密钥对
+ * @param client 客户端句柄
+ * @param d1 客户端私钥分量 D1
+ * @param d1_len D1 长度（32）
+ * @param public_key 协同公钥（64 字节 x||y）
+ * @param public_key_len 公钥长度
+ * @param user_id 用户 ID
+ * @return 错误码；在回调中调用返回 COSIGN_ERR_INVALID_STATE
+ */
+int cosign_client_set_key_pair(const CoSignClientHandle *client,
+                               const unsigned char *d1,
+                               unsigned long d1_len,
+                               const unsigned char *public_key,
+                               unsigned long public_key_len,
+                               const char *user_id);
+
+/**
+ * 异步协同签名
+ * 消息在返回前被复制；完成时回调收到 64 字节 r||s。
+ * @param client 客户端句柄
+ * @param message 待签名消息
+ * @param message_len 消息长度
+ * @param callback 完成回调
+ * @param user_data 透传给回调的用户数据（可能在其他线程上使用）
+ * @return 提交成功返回 COSIGN_OK，签名结果通过回调返回
+ */
+int cosign_client_sign_async(const CoSignClientHandle *client,
+                             const unsigned char *message,
+                             unsigned long message_len,
+                             cosign_result_cb callback,
+                             void *user_data);
+
+/**
+ * 异步批量协同签名
+ * 所有消息通过一次 /api/sign/batch 往返完成，单项失败不影响其他项。
+ * 消息在返回前被复制；完成时回调收到 count 个签名及每一项的错误码。
+ * @param client 客户端句柄
+ * @param messages count 条消息的指针（长度为 0 的消息可为 NULL）
+ * @param message_lens count 条消息的长度
+ * @param count 消息数量（可为 0，此时回调收到空结果）
+ * @param callback 完成回调
+ * @param user_data 透传给回调的用户数据（可能在其他线程上使用）
+ * @return 提交成功返回 COSIGN_OK，count 过大返回 COSIGN_ERR_INVALID_PARAM，签名结果通过回调返回
+ */
+int cosign_client_sign_batch_async(const CoSignClientHandle *client,
+                                   const unsigned char *const *messages,
+                                   const unsigned long *message_lens,
+                                   unsigned long count,
+                                   cosign_batch_cb callback,
+                                   void *user_data);
+
+/**
+ * 异步协同解密
+ * 密文在返回前被复制；完成时回调收到明文。
+ * @param client 客户端句柄
+ * @param ciphertext 密文（04 || C1 || C3 || C2）
+ * @param ciphertext_len 密文长度
+ * @param callback 完成回调
+ * @param user_data 透传给回调的用户数据（可能在其他线程上使用）
+ * @return 提交成功返回 COSIGN_OK，解密结果通过回调返回
+ */
+int cosign_client_decrypt_async(const CoSignClientHandle *client,
+                                const unsigned char *ciphertext,
+                                unsigned long ciphertext_len,
+                                cosign_result_cb callback,
+                                void *user_data);
+
+/* ========== 埋点指标 ========== */
+
+/**
+ * 导出埋点指标快照（Prometheus 文本格式：分阶段延迟分位数、线上字节数、重试与错误计数）
+ * 库需以 metrics feature 构建（cargo build --features metrics），否则输出空字符串。
+ * 查询与读取之间指标可能继续增长，分配缓冲区时宜预留余量。
+ * @param out_text 输出字符串缓冲区（含结尾 NUL），NULL 时只查询长度
+ * @param out_len 输入缓冲区容量；查询或容量不足时返回所需容量（含 NUL），成功时返回字符串长度（不含 NUL）
+ * @return 错误码
+ */
+int cosign_metrics_snapshot(char *out_text, unsigned long *out_len);
+
 #ifdef __cplusplus
 }
 #endif
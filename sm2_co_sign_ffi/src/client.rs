@@ -0,0 +1,679 @@
+//! 联网协同签名/解密的异步 C 接口
+//!
+//! 客户端句柄持有一个多线程 tokio 运行时，`*_async` 接口把请求投递到运行时后立即返回，
+//! 完成时在运行时工作线程上调用回调。少量工作线程即可同时维持大量在途请求。
+//!
+//! 所有回调都经过句柄上的回调闸门：销毁句柄时先关闭闸门、等待正在执行的回调返回，
+//! 再关闭运行时，`cosign_client_free` 返回后不会再有回调访问 user_data。
+
+use std::ffi::{c_char, c_int, c_uchar, c_uint, c_ulong, c_void, CStr};
+use std::ptr;
+use std::slice;
+use std::sync::{Arc, Condvar, Mutex, PoisonError};
+use std::time::Duration;
+
+use sm2_co_sign_core::{ClientConfig, CoSignClient, Error, Signature, WireFormat};
+use tokio::runtime::Runtime;
+
+use crate::{
+    array_len, COSIGN_ERR_API, COSIGN_ERR_CRYPTO, COSIGN_ERR_ENCODING, COSIGN_ERR_INVALID_PARAM,
+    COSIGN_ERR_INVALID_STATE, COSIGN_ERR_NETWORK, COSIGN_ERR_NOT_AUTHENTICATED, COSIGN_ERR_NULL_PTR, COSIGN_OK,
+};
+
+/// 销毁句柄时等待运行时工作线程退出的上限
+const SHUTDOWN_TIMEOUT: Duration = Duration::from_secs(5);
+
+/// 客户端配置（C 布局）
+#[repr(C)]
+pub struct CoSignClientConfig {
+    /// 服务器 URL（必填，NUL 结尾）
+    pub server_url: *const c_char,
+    /// 请求超时（秒），0 表示使用默认值
+    pub timeout_secs: c_ulong,
+    /// 是否验证 TLS 证书（非 0 为是）
+    pub verify_tls: c_int,
+    /// 预生成随机数池容量，0 表示不启用
+    pub nonce_pool_size: c_ulong,
+    /// 运行时工作线程数，0 表示与 CPU 核数相同
+    pub worker_threads: c_uint,
+    /// 是否使用二进制线上编码（非 0 为是）
+    pub binary_wire: c_int,
+}
+
+/// 联网客户端句柄
+pub struct CoSignClientHandle {
+    runtime: Runtime,
+    client: Arc<CoSignClient>,
+    gate: Arc<CallbackGate>,
+}
+
+/// 异步结果回调
+///
+/// status 为错误码；成功时 data/data_len 为结果（签名 r||s 或明文），仅在回调期间有效。
+pub type CoSignResultCallback =
+    Option<extern "C" fn(user_data: *mut c_void, status: c_int, data: *const c_uchar, data_len: c_ulong)>;
+
+/// 批量签名回调
+///
+/// signatures 为 count 个 64 字节 r||s，item_status 为每一项的错误码，均仅在回调期间有效；
+/// status 在全部成功时为 `COSIGN_OK`，否则为第一个失败项的错误码。
+pub type CoSignBatchCallback = Option<
+    extern "C" fn(user_data: *mut c_void, status: c_int, signatures: *const c_uchar, item_status: *const c_int, count: c_ulong),
+>;
+
+type ResultFn = extern "C" fn(*mut c_void, c_int, *const c_uchar, c_ulong);
+type BatchFn = extern "C" fn(*mut c_void, c_int, *const c_uchar, *const c_int, c_ulong);
+
+/// 回调闸门：关闭后不再开始新的回调，并可等待正在执行的回调返回
+#[derive(Default)]
+struct CallbackGate {
+    state: Mutex<GateState>,
+    idle: Condvar,
+}
+
+#[derive(Default)]
+struct GateState {
+    closed: bool,
+    /// 正在执行的回调数
+    running: usize,
+}
+
+impl CallbackGate {
+    /// 进入回调；闸门已关闭时返回 `None`，调用方应丢弃结果
+    fn enter(&self) -> Option<GateGuard<'_>> {
+        let mut state = self.state.lock().unwrap_or_else(PoisonError::into_inner);
+        if state.closed {
+            return None;
+        }
+        state.running += 1;
+        Some(GateGuard { gate: self })
+    }
+
+    fn close(&self) {
+        self.state.lock().unwrap_or_else(PoisonError::into_inner).closed = true;
+    }
+
+    /// 阻塞到没有正在执行的回调
+    fn wait_idle(&self) {
+        let state = self.state.lock().unwrap_or_else(PoisonError::into_inner);
+        let _state = self
+            .idle
+            .wait_while(state, |state| state.running > 0)
+            .unwrap_or_else(PoisonError::into_inner);
+    }
+}
+
+struct GateGuard<'a> {
+    gate: &'a CallbackGate,
+}
+
+impl Drop for GateGuard<'_> {
+    fn drop(&mut self) {
+        let mut state = self.gate.state.lock().unwrap_or_else(PoisonError::into_inner);
+        state.running -= 1;
+        if state.running == 0 {
+            self.gate.idle.notify_all();
+        }
+    }
+}
+
+/// 回调及其 user_data，随任务移动到工作线程
+struct Completion<F> {
+    callback: F,
+    user_data: *mut c_void,
+    gate: Arc<CallbackGate>,
+}
+
+// SAFETY: 头文件约定 user_data 可在任意线程上使用，由调用方保证；回调本身是函数指针
+unsafe impl<F: Send> Send for Completion<F> {}
+
+impl Completion<ResultFn> {
+    fn finish(self, result: sm2_co_sign_core::Result<&[u8]>) {
+        let Some(_guard) = self.gate.enter() else {
+            return;
+        };
+        match result {
+            Ok(data) => (self.callback)(self.user_data, COSIGN_OK, data.as_ptr(), data.len() as c_ulong),
+            Err(err) => (self.callback)(self.user_data, error_code(&err), ptr::null(), 0),
+        }
+    }
+}
+
+impl Completion<BatchFn> {
+    fn finish_batch(self, results: Vec<sm2_co_sign_core::Result<Signature>>) {
+        let mut signatures = vec![0u8; results.len() * 64];
+        let mut item_status = vec![COSIGN_OK; results.len()];
+        let mut status = COSIGN_OK;
+        for (i, result) in results.iter().enumerate() {
+            match result {
+                Ok(signature) => write_signature(signature, &mut signatures[i * 64..(i + 1) * 64]),
+                Err(err) => {
+                    item_status[i] = error_code(err);
+                    if status == COSIGN_OK {
+                        status = item_status[i];
+                    }
+                }
+            }
+        }
+
+        let Some(_guard) = self.gate.enter() else {
+            return;
+        };
+        (self.callback)(
+            self.user_data,
+            status,
+            signatures.as_ptr(),
+            item_status.as_ptr(),
+            results.len() as c_ulong,
+        );
+    }
+}
+
+/// 把签名写成 64 字节 r||s（各 32 字节，左侧补零）
+fn write_signature(signature: &Signature, out: &mut [u8]) {
+    out[32 - signature.r.len()..32].copy_from_slice(&signature.r);
+    out[64 - signature.s.len()..64].copy_from_slice(&signature.s);
+}
+
+/// 当前线程是否处在 tokio 运行时中（回调即在运行时工作线程上执行）
+///
+/// 此时 `block_on` 会 panic，在 `panic = "abort"` 下直接终止进程。
+fn on_runtime_thread() -> bool {
+    tokio::runtime::Handle::try_current().is_ok()
+}
+
+/// 核心库错误到 C 错误码的映射
+fn error_code(err: &Error) -> c_int {
+    match err {
+        Error::Network(_) | Error::Io(_) => COSIGN_ERR_NETWORK,
+        Error::Api { .. } => COSIGN_ERR_API,
+        Error::NotAuthenticated => COSIGN_ERR_NOT_AUTHENTICATED,
+        Error::InvalidParam(_) => COSIGN_ERR_INVALID_PARAM,
+        Error::Encoding(_) => COSIGN_ERR_ENCODING,
+        _ => COSIGN_ERR_CRYPTO,
+    }
+}
+
+unsafe fn c_str<'a>(s: *const c_char) -> Option<&'a str> {
+    if s.is_null() {
+        return None;
+    }
+    CStr::from_ptr(s).to_str().ok()
+}
+
+/// 创建联网客户端
+#[no_mangle]
+pub extern "C" fn cosign_client_new(config: *const CoSignClientConfig) -> *mut CoSignClientHandle {
+    if config.is_null() {
+        return ptr::null_mut();
+    }
+    let config = unsafe { &*config };
+    let server_url = match unsafe { c_str(config.server_url) } {
+        Some(url) => url.to_string(),
+        None => return ptr::null_mut(),
+    };
+
+    let mut builder = tokio::runtime::Builder::new_multi_thread();
+    builder.enable_all().thread_name("cosign-ffi");
+    if config.worker_threads > 0 {
+        builder.worker_threads(config.worker_threads as usize);
+    }
+    let runtime = match builder.build() {
+        Ok(runtime) => runtime,
+        Err(_) => return ptr::null_mut(),
+    };
+
+    let defaults = ClientConfig::default();
+    let client_config = ClientConfig {
+        server_url,
+        timeout: if config.timeout_secs > 0 { config.timeout_secs as u64 } else { defaults.timeout },
+        verify_tls: config.verify_tls != 0,
+        nonce_pool_size: config.nonce_pool_size as usize,
+        wire_format: if config.binary_wire != 0 { WireFormat::Binary } else { WireFormat::Json },
+        ..defaults
+    };
+
+    let client = {
+        let _guard = runtime.enter();
+        match CoSignClient::new(client_config) {
+            Ok(client) => Arc::new(client),
+            Err(_) => return ptr::null_mut(),
+        }
+    };
+
+    Box::into_raw(Box::new(CoSignClientHandle {
+        runtime,
+        client,
+        gate: Arc::default(),
+    }))
+}
+
+/// 销毁联网客户端
+///
+/// 尚未完成的异步请求被取消，其回调不再被调用；正在执行的回调返回后本函数才返回。
+/// 在回调中调用时无法阻塞等待：此后不再开始新的回调，但其他工作线程上已在执行的回调
+/// 可能仍在运行，运行时在它们返回后由后台线程关闭。
+#[no_mangle]
+pub extern "C" fn cosign_client_free(client: *mut CoSignClientHandle) {
+    if client.is_null() {
+        return;
+    }
+    let handle = unsafe { Box::from_raw(client) };
+    handle.gate.close();
+
+    let teardown = move || {
+        handle.gate.wait_idle();
+        handle.runtime.shutdown_timeout(SHUTDOWN_TIMEOUT);
+    };
+    if on_runtime_thread() {
+        // Reason: 运行时工作线程上不能阻塞，也不能关闭运行时（会 panic），
+        // 而调用本函数的回调自身也计入闸门，必须等它返回后才能完成关闭
+        std::thread::spawn(teardown);
+    } else {
+        teardown();
+    }
+}
+
+/// 登录（阻塞）
+///
+/// 以下阻塞接口在回调（运行时工作线程）中调用时返回 `COSIGN_ERR_INVALID_STATE`。
+#[no_mangle]
+pub extern "C" fn cosign_client_login(
+    client: *const CoSignClientHandle,
+    username: *const c_char,
+    password: *const c_char,
+) -> c_int {
+    if client.is_null() || username.is_null() || password.is_null() {
+        return COSIGN_ERR_NULL_PTR;
+    }
+    if on_runtime_thread() {
+        return COSIGN_ERR_INVALID_STATE;
+    }
+    let handle = unsafe { &*client };
+    let (username, password) = match unsafe { (c_str(username), c_str(password)) } {
+        (Some(u), Some(p)) => (u, p),
+        _ => return COSIGN_ERR_INVALID_PARAM,
+    };
+
+    match handle.runtime.block_on(handle.client.login(username, password)) {
+        Ok(_) => COSIGN_OK,
+        Err(err) => error_code(&err),
+    }
+}
+
+/// 设置会话（从已保存的 token 恢复）
+#[no_mangle]
+pub extern "C" fn cosign_client_set_session(
+    client: *const CoSignClientHandle,
+    token: *const c_char,
+    user_id: *const c_char,
+) -> c_int {
+    if client.is_null() || token.is_null() || user_id.is_null() {
+        return COSIGN_ERR_NULL_PTR;
+    }
+    if on_runtime_thread() {
+        return COSIGN_ERR_INVALID_STATE;
+    }
+    let handle = unsafe { &*client };
+    let (token, user_id) = match unsafe { (c_str(token), c_str(user_id)) } {
+        (Some(t), Some(u)) => (t.to_string(), u.to_string()),
+        _ => return COSIGN_ERR_INVALID_PARAM,
+    };
+
+    match handle.runtime.block_on(handle.client.set_session(token, user_id)) {
+        Ok(()) => COSIGN_OK,
+        Err(err) => error_code(&err),
+    }
+}
+
+/// 设置密钥对（D1 与协同公钥）
+#[no_mangle]
+pub extern "C" fn cosign_client_set_key_pair(
+    client: *const CoSignClientHandle,
+    d1: *const c_uchar,
+    d1_len: c_ulong,
+    public_key: *const c_uchar,
+    public_key_len: c_ulong,
+    user_id: *const c_char,
+) -> c_int {
+    if client.is_null() || d1.is_null() || public_key.is_null() || user_id.is_null() {
+        return COSIGN_ERR_NULL_PTR;
+    }
+    if on_runtime_thread() {
+        return COSIGN_ERR_INVALID_STATE;
+    }
+    let handle = unsafe { &*client };
+    let d1 = unsafe { slice::from_raw_parts(d1, d1_len as usize) }.to_vec();
+    let public_key = unsafe { slice::from_raw_parts(public_key, public_key_len as usize) }.to_vec();
+    let user_id = match unsafe { c_str(user_id) } {
+        Some(u) => u.to_string(),
+        None => return COSIGN_ERR_INVALID_PARAM,
+    };
+
+    match handle.runtime.block_on(handle.client.set_key_pair(d1, public_key, user_id)) {
+        Ok(()) => COSIGN_OK,
+        Err(err) => error_code(&err),
+    }
+}
+
+/// 异步协同签名
+///
+/// 消息在返回前被复制，调用方可立即释放。完成时回调收到 64 字节 r||s。
+#[no_mangle]
+pub extern "C" fn cosign_client_sign_async(
+    client: *const CoSignClientHandle,
+    message: *const c_uchar,
+    message_len: c_ulong,
+    callback: CoSignResultCallback,
+    user_data: *mut c_void,
+) -> c_int {
+    let callback = match callback {
+        Some(callback) => callback,
+        None => return COSIGN_ERR_NULL_PTR,
+    };
+    if client.is_null() || (message.is_null() && message_len != 0) {
+        return COSIGN_ERR_NULL_PTR;
+    }
+    let handle = unsafe { &*client };
+    let message = if message_len == 0 {
+        Vec::new()
+    } else {
+        unsafe { slice::from_raw_parts(message, message_len as usize) }.to_vec()
+    };
+    let completion = Completion {
+        callback: callback as ResultFn,
+        user_data,
+        gate: Arc::clone(&handle.gate),
+    };
+    let client = Arc::clone(&handle.client);
+
+    handle.runtime.spawn(async move {
+        match client.sign(&message).await {
+            Ok(signature) => {
+                let mut out = [0u8; 64];
+                write_signature(&signature, &mut out);
+                completion.finish(Ok(&out));
+            }
+            Err(err) => completion.finish(Err(err)),
+        }
+    });
+    COSIGN_OK
+}
+
+/// 异步批量协同签名
+///
+/// 所有消息通过一次 `/api/sign/batch` 往返完成（`CoSignClient::sign_batch`），单项失败不影响其他项。
+/// 消息在返回前被复制；完成时回调收到 count 个 64 字节 r||s 及每一项的错误码。
+#[no_mangle]
+pub extern "C" fn cosign_client_sign_batch_async(
+    client: *const CoSignClientHandle,
+    messages: *const *const c_uchar,
+    message_lens: *const c_ulong,
+    count: c_ulong,
+    callback: CoSignBatchCallback,
+    user_data: *mut c_void,
+) -> c_int {
+    let callback = match callback {
+        Some(callback) => callback,
+        None => return COSIGN_ERR_NULL_PTR,
+    };
+    let count = count as usize;
+    if client.is_null() || (count != 0 && (messages.is_null() || message_lens.is_null())) {
+        return COSIGN_ERR_NULL_PTR;
+    }
+    if array_len(count, 64).is_none() || array_len(count, std::mem::size_of::<*const c_uchar>()).is_none() {
+        return COSIGN_ERR_INVALID_PARAM;
+    }
+    let handle = unsafe { &*client };
+
+    let mut owned: Vec<Vec<u8>> = Vec::with_capacity(count);
+    if count != 0 {
+        let ptrs = unsafe { slice::from_raw_parts(messages, count) };
+        let lens = unsafe { slice::from_raw_parts(message_lens, count) };
+        for (&data, &len) in ptrs.iter().zip(lens) {
+            owned.push(if len == 0 {
+                Vec::new()
+            } else if data.is_null() {
+                return COSIGN_ERR_NULL_PTR;
+            } else {
+                unsafe { slice::from_raw_parts(data, len as usize) }.to_vec()
+            });
+        }
+    }
+    let completion = Completion {
+        callback: callback as BatchFn,
+        user_data,
+        gate: Arc::clone(&handle.gate),
+    };
+    let client = Arc::clone(&handle.client);
+
+    handle.runtime.spawn(async move {
+        let messages: Vec<&[u8]> = owned.iter().map(Vec::as_slice).collect();
+        completion.finish_batch(client.sign_batch(&messages).await);
+    });
+    COSIGN_OK
+}
+
+/// 异步协同解密
+///
+/// 密文（04 || C1 || C3 || C2）在返回前被复制。完成时回调收到明文。
+#[no_mangle]
+pub extern "C" fn cosign_client_decrypt_async(
+    client: *const CoSignClientHandle,
+    ciphertext: *const c_uchar,
+    ciphertext_len: c_ulong,
+    callback: CoSignResultCallback,
+    user_data: *mut c_void,
+) -> c_int {
+    let callback = match callback {
+        Some(callback) => callback,
+        None => return COSIGN_ERR_NULL_PTR,
+    };
+    if client.is_null() || ciphertext.is_null() {
+        return COSIGN_ERR_NULL_PTR;
+    }
+    let handle = unsafe { &*client };
+    let ciphertext = unsafe { slice::from_raw_parts(ciphertext, ciphertext_len as usize) }.to_vec();
+    let completion = Completion {
+        callback: callback as ResultFn,
+        user_data,
+        gate: Arc::clone(&handle.gate),
+    };
+    let client = Arc::clone(&handle.client);
+
+    handle.runtime.spawn(async move {
+        match client.decrypt(&ciphertext).await {
+            Ok(plaintext) => completion.finish(Ok(&plaintext)),
+            Err(err) => completion.finish(Err(err)),
+        }
+    });
+    COSIGN_OK
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::ffi::CString;
+    use std::sync::atomic::{AtomicUsize, Ordering};
+    use std::sync::mpsc;
+
+    extern "C" fn record(user_data: *mut c_void, status: c_int, _data: *const c_uchar, data_len: c_ulong) {
+        // Reason: 接收方收到结果后测试函数即返回、栈上的 tx 随之失效，
+        // 必须先克隆再发送，send 返回前不能再访问 user_data 指向的内存
+        let tx = unsafe { &*(user_data as *const mpsc::Sender<(c_int, c_ulong)>) }.clone();
+        tx.send((status, data_len)).unwrap();
+    }
+
+    fn new_client(url: &CString) -> *mut CoSignClientHandle {
+        let config = CoSignClientConfig {
+            server_url: url.as_ptr(),
+            timeout_secs: 1,
+            verify_tls: 1,
+            nonce_pool_size: 0,
+            worker_threads: 2,
+            binary_wire: 0,
+        };
+        cosign_client_new(&config)
+    }
+
+    #[test]
+    fn test_client_new_free() {
+        assert!(cosign_client_new(ptr::null()).is_null());
+        let url = CString::new("http://127.0.0.1:1").unwrap();
+        let client = new_client(&url);
+        assert!(!client.is_null());
+        cosign_client_free(client);
+    }
+
+    #[test]
+    fn test_async_requires_session() {
+        let url = CString::new("http://127.0.0.1:1").unwrap();
+        let client = new_client(&url);
+        let (tx, rx) = mpsc::channel::<(c_int, c_ulong)>();
+        let user_data = &tx as *const _ as *mut c_void;
+
+        for _ in 0..8 {
+            assert_eq!(cosign_client_sign_async(client, b"msg".as_ptr(), 3, Some(record), user_data), COSIGN_OK);
+        }
+        let ciphertext = [0x04u8; 120];
+        assert_eq!(
+            cosign_client_decrypt_async(client, ciphertext.as_ptr(), 120, Some(record), user_data),
+            COSIGN_OK
+        );
+        for _ in 0..9 {
+            let (status, len) = rx.recv_timeout(std::time::Duration::from_secs(5)).unwrap();
+            assert_eq!(status, COSIGN_ERR_NOT_AUTHENTICATED);
+            assert_eq!(len, 0);
+        }
+
+        assert_eq!(cosign_client_sign_async(client, b"msg".as_ptr(), 3, None, user_data), COSIGN_ERR_NULL_PTR);
+        cosign_client_free(client);
+    }
+
+    #[test]
+    fn test_network_error_reported() {
+        let url = CString::new("http://127.0.0.1:1").unwrap();
+        let client = new_client(&url);
+        let token = CString::new("token").unwrap();
+        let user = CString::new("u1").unwrap();
+        assert_eq!(cosign_client_set_session(client, token.as_ptr(), user.as_ptr()), COSIGN_OK);
+
+        let d1 = [1u8; 32];
+        let public_key = sm2_co_sign_core::CoSignProtocol::new().unwrap().calculate_p1(&d1).unwrap();
+        assert_eq!(
+            cosign_client_set_key_pair(client, d1.as_ptr(), 32, public_key.as_ptr(), 64, user.as_ptr()),
+            COSIGN_OK
+        );
+
+        let (tx, rx) = mpsc::channel::<(c_int, c_ulong)>();
+        let user_data = &tx as *const _ as *mut c_void;
+        cosign_client_sign_async(client, b"msg".as_ptr(), 3, Some(record), user_data);
+        let (status, _) = rx.recv_timeout(std::time::Duration::from_secs(10)).unwrap();
+        assert_eq!(status, COSIGN_ERR_NETWORK);
+        cosign_client_free(client);
+    }
+
+    static SLOW_STARTED: AtomicUsize = AtomicUsize::new(0);
+    static SLOW_FINISHED: AtomicUsize = AtomicUsize::new(0);
+
+    extern "C" fn slow(_user_data: *mut c_void, _status: c_int, _data: *const c_uchar, _data_len: c_ulong) {
+        SLOW_STARTED.fetch_add(1, Ordering::SeqCst);
+        std::thread::sleep(std::time::Duration::from_millis(100));
+        SLOW_FINISHED.fetch_add(1, Ordering::SeqCst);
+    }
+
+    #[test]
+    fn test_free_waits_for_running_callbacks() {
+        let url = CString::new("http://127.0.0.1:1").unwrap();
+        let client = new_client(&url);
+        for _ in 0..64 {
+            cosign_client_sign_async(client, b"msg".as_ptr(), 3, Some(slow), ptr::null_mut());
+        }
+        while SLOW_STARTED.load(Ordering::SeqCst) == 0 {
+            std::thread::yield_now();
+        }
+        cosign_client_free(client);
+
+        // free 返回时没有回调仍在执行，之后也不再开始新的回调
+        let started = SLOW_STARTED.load(Ordering::SeqCst);
+        assert_eq!(SLOW_FINISHED.load(Ordering::SeqCst), started);
+        assert!(started < 64);
+        std::thread::sleep(std::time::Duration::from_millis(200));
+        assert_eq!(SLOW_STARTED.load(Ordering::SeqCst), started);
+    }
+
+    struct Reentrant {
+        client: *mut CoSignClientHandle,
+        tx: mpsc::Sender<c_int>,
+    }
+
+    extern "C" fn reenter(user_data: *mut c_void, _status: c_int, _data: *const c_uchar, _data_len: c_ulong) {
+        let state = unsafe { &*(user_data as *const Reentrant) };
+        let (client, tx) = (state.client, state.tx.clone());
+        let user = CString::new("u1").unwrap();
+        let status = cosign_client_set_session(client, user.as_ptr(), user.as_ptr());
+        // 回调中销毁句柄：不阻塞、不 panic，关闭交给后台线程
+        cosign_client_free(client);
+        tx.send(status).unwrap();
+    }
+
+    #[test]
+    fn test_blocking_call_and_free_from_callback() {
+        let url = CString::new("http://127.0.0.1:1").unwrap();
+        let client = new_client(&url);
+        let (tx, rx) = mpsc::channel();
+        let state = Reentrant { client, tx };
+        let user_data = &state as *const _ as *mut c_void;
+
+        assert_eq!(cosign_client_sign_async(client, b"msg".as_ptr(), 3, Some(reenter), user_data), COSIGN_OK);
+        let status = rx.recv_timeout(std::time::Duration::from_secs(5)).unwrap();
+        assert_eq!(status, COSIGN_ERR_INVALID_STATE);
+    }
+
+    extern "C" fn record_batch(
+        user_data: *mut c_void,
+        status: c_int,
+        _signatures: *const c_uchar,
+        item_status: *const c_int,
+        count: c_ulong,
+    ) {
+        let tx = unsafe { &*(user_data as *const mpsc::Sender<(c_int, Vec<c_int>)>) }.clone();
+        let items = if count == 0 {
+            Vec::new()
+        } else {
+            unsafe { slice::from_raw_parts(item_status, count as usize) }.to_vec()
+        };
+        tx.send((status, items)).unwrap();
+    }
+
+    #[test]
+    fn test_sign_batch_async_reports_per_item_status() {
+        let url = CString::new("http://127.0.0.1:1").unwrap();
+        let client = new_client(&url);
+        let (tx, rx) = mpsc::channel::<(c_int, Vec<c_int>)>();
+        let user_data = &tx as *const _ as *mut c_void;
+
+        let messages: [&[u8]; 3] = [b"first", b"second", b""];
+        let ptrs: Vec<*const c_uchar> = vec![messages[0].as_ptr(), messages[1].as_ptr(), ptr::null()];
+        let lens: Vec<c_ulong> = messages.iter().map(|m| m.len() as c_ulong).collect();
+        assert_eq!(
+            cosign_client_sign_batch_async(client, ptrs.as_ptr(), lens.as_ptr(), 3, Some(record_batch), user_data),
+            COSIGN_OK
+        );
+        let (status, items) = rx.recv_timeout(std::time::Duration::from_secs(5)).unwrap();
+        assert_eq!(status, COSIGN_ERR_NOT_AUTHENTICATED);
+        assert_eq!(items, vec![COSIGN_ERR_NOT_AUTHENTICATED; 3]);
+
+        assert_eq!(
+            cosign_client_sign_batch_async(client, ptr::null(), ptr::null(), 0, Some(record_batch), user_data),
+            COSIGN_OK
+        );
+        assert_eq!(rx.recv_timeout(std::time::Duration::from_secs(5)).unwrap(), (COSIGN_OK, Vec::new()));
+
+        assert_eq!(
+            cosign_client_sign_batch_async(client, ptrs.as_ptr(), ptr::null(), 3, Some(record_batch), user_data),
+            COSIGN_ERR_NULL_PTR
+        );
+        cosign_client_free(client);
+    }
+}
@@ -2,11 +2,17 @@
 //!
 //! 提供 C ABI 兼容的接口，供其他语言调用
 
-use std::ffi::{c_char, c_int, c_uchar, c_ulong, CStr, CString};
+use std::ffi::{c_char, c_int, c_uchar, c_uint, c_ulong, CStr};
 use std::ptr;
 use std::slice;
+use std::cell::RefCell;
+use std::collections::HashMap;
+use std::sync::{Arc, PoisonError, RwLock};
 
-use sm2_co_sign_core::CoSignProtocol;
+use sm2_co_sign_core::nonce_pool::NoncePool;
+use sm2_co_sign_core::{secure, CoSignProtocol, DecryptStream, FixedBase, MultiSm3, SecretScalar, SignShares, Sm3, VerifyItem};
+
+pub mod client;
 
 /// 错误码定义
 pub const COSIGN_OK: c_int = 0;
@@ -15,20 +21,134 @@ pub const COSIGN_ERR_INVALID_PARAM: c_int = -2;
 pub const COSIGN_ERR_CRYPTO: c_int = -3;
 pub const COSIGN_ERR_NETWORK: c_int = -4;
 pub const COSIGN_ERR_ENCODING: c_int = -5;
+pub const COSIGN_ERR_POOL_EMPTY: c_int = -6;
+pub const COSIGN_ERR_API: c_int = -7;
+pub const COSIGN_ERR_NOT_AUTHENTICATED: c_int = -8;
+pub const COSIGN_ERR_BUFFER_TOO_SMALL: c_int = -9;
+pub const COSIGN_ERR_INVALID_STATE: c_int = -10;
+
+/// 变长输出缓冲区约定：`*out_len` 传入容量，返回所需（成功时为写入）长度
+///
+/// - `out` 为 NULL：只写回所需长度，调用方返回 `COSIGN_OK`（返回 `Ok(None)`）
+/// - 容量不足：写回所需长度，返回 `COSIGN_ERR_BUFFER_TOO_SMALL`
+/// - 否则返回长度恰为 `required` 的输出切片，供核心库直接写入
+unsafe fn output_buffer<'a>(
+    out: *mut c_uchar,
+    out_len: *mut c_ulong,
+    required: usize,
+) -> Result<Option<&'a mut [u8]>, c_int> {
+    let capacity = *out_len as usize;
+    *out_len = required as c_ulong;
+    if out.is_null() {
+        return Ok(None);
+    }
+    if capacity < required {
+        return Err(COSIGN_ERR_BUFFER_TOO_SMALL);
+    }
+    Ok(Some(if required == 0 {
+        &mut []
+    } else {
+        slice::from_raw_parts_mut(out, required)
+    }))
+}
+
+/// 批量接口中 count 个定长元素的总字节数，溢出或超出 `slice::from_raw_parts` 上限时返回 `None`
+fn array_len(count: usize, item_size: usize) -> Option<usize> {
+    count.checked_mul(item_size).filter(|&len| len <= isize::MAX as usize)
+}
 
-/// 协议上下文
+/// 协议上下文（持有曲线参数、生成元预计算表和导入的 D1）
+///
+/// 除导入的 D1 表（读写锁保护，签名时只取读锁）外，上下文创建后只读，
+/// 可在任意多个线程间共享同一实例（`Send + Sync`）；
+/// 随机数发生器和 Z 缓存等可变状态都按线程保存，调用之间不加锁。
 pub struct CoSignContext {
     protocol: CoSignProtocol,
+    /// 经 `cosign_context_import_d1` 导入的密钥
+    keys: RwLock<KeyTable>,
+}
+
+/// 导入密钥表：编号单调递增、从不复用，释放后的旧编号不会指向之后导入的密钥
+struct KeyTable {
+    /// 下一个分配的编号，0 表示编号已用尽
+    next_id: c_uint,
+    keys: HashMap<c_uint, Arc<ContextKey>>,
+}
+
+/// 导入上下文的 D1 及预先计算的 d1⁻¹，均存放在安全内存池中
+struct ContextKey {
+    d1: SecretScalar,
+    d1_inv: SecretScalar,
+}
+
+// Reason: C 侧依赖上下文可跨线程共享，内部字段若失去 Sync 必须在编译期发现
+const _: fn() = || {
+    fn assert_send_sync<T: Send + Sync>() {}
+    assert_send_sync::<CoSignContext>();
+};
+
+thread_local! {
+    /// 本线程最近一次使用的公钥及其已吸收 Z 的 SM3 中间状态
+    ///
+    /// Z 只取决于公钥和默认用户标识，与上下文无关，不同上下文可共用此缓存。
+    static Z_CACHE: RefCell<Option<(Vec<u8>, Sm3)>> = const { RefCell::new(None) };
+}
+
+impl CoSignContext {
+    fn boxed(protocol: CoSignProtocol) -> *mut CoSignContext {
+        Box::into_raw(Box::new(CoSignContext {
+            protocol,
+            keys: RwLock::new(KeyTable { next_id: 1, keys: HashMap::new() }),
+        }))
+    }
+
+    /// 按编号取导入的密钥，持有 `Arc` 期间并发释放也不会清零正在使用的槽位
+    fn key(&self, key_id: c_uint) -> Option<Arc<ContextKey>> {
+        let table = self.keys.read().unwrap_or_else(PoisonError::into_inner);
+        table.keys.get(&key_id).cloned()
+    }
+
+    /// 取公钥对应的消息哈希上下文，同一线程内同一公钥重复签名时复用缓存的 Z
+    fn message_hasher(&self, public_key: &[u8]) -> sm2_co_sign_core::Result<Sm3> {
+        if public_key.is_empty() {
+            return self.protocol.message_hasher(public_key);
+        }
+        Z_CACHE.with(|cache| {
+            let mut cache = cache.borrow_mut();
+            if let Some((cached_key, hasher)) = cache.as_ref() {
+                if cached_key.as_slice() == public_key {
+                    return Ok(hasher.clone());
+                }
+            }
+            let hasher = self.protocol.message_hasher(public_key)?;
+            *cache = Some((public_key.to_vec(), hasher.clone()));
+            Ok(hasher)
+        })
+    }
 }
 
 /// 创建协议上下文
 #[no_mangle]
 pub extern "C" fn cosign_context_new() -> *mut CoSignContext {
     match CoSignProtocol::new() {
-        Ok(protocol) => {
-            let ctx = Box::new(CoSignContext { protocol });
-            Box::into_raw(ctx)
-        }
+        Ok(protocol) => CoSignContext::boxed(protocol),
+        Err(_) => ptr::null_mut(),
+    }
+}
+
+/// 创建协议上下文，并指定生成元预计算表的窗口宽度
+///
+/// window_bits 为 0 时不建表，使用通用点乘；1..=8 时建表，越大越快、内存越多。
+#[no_mangle]
+pub extern "C" fn cosign_context_new_with_window(window_bits: c_uint) -> *mut CoSignContext {
+    let fixed_base = match window_bits {
+        0 => FixedBase::Generic,
+        w if w <= u8::MAX as c_uint => FixedBase::Window(w as u8),
+        _ => return ptr::null_mut(),
+    };
+
+    match CoSignProtocol::with_fixed_base(fixed_base) {
+        Ok(protocol) => CoSignContext::boxed(protocol),
         Err(_) => ptr::null_mut(),
     }
 }
@@ -46,7 +166,7 @@ pub extern "C" fn cosign_context_free(ctx: *mut CoSignContext) {
 /// 生成客户端私钥分量 D1
 #[no_mangle]
 pub extern "C" fn cosign_generate_d1(
-    ctx: *mut CoSignContext,
+    ctx: *const CoSignContext,
     out_d1: *mut c_uchar,
     out_len: *mut c_ulong,
 ) -> c_int {
@@ -54,9 +174,9 @@ pub extern "C" fn cosign_generate_d1(
         return COSIGN_ERR_NULL_PTR;
     }
 
-    let ctx = unsafe { &mut *ctx };
+    let ctx = unsafe { &*ctx };
 
-    match ctx.protocol.generate_d1() {
+    match ctx.protocol.generate_d1_array() {
         Ok(d1) => {
             let len = d1.len();
             unsafe {
@@ -85,7 +205,7 @@ pub extern "C" fn cosign_calculate_p1(
     let ctx = unsafe { &*ctx };
     let d1_slice = unsafe { slice::from_raw_parts(d1, d1_len as usize) };
 
-    match ctx.protocol.calculate_p1(d1_slice) {
+    match ctx.protocol.calculate_p1_array(d1_slice) {
         Ok(p1) => {
             let len = p1.len();
             unsafe {
@@ -113,7 +233,7 @@ pub extern "C" fn cosign_sign_prepare(
 
     let ctx = unsafe { &*ctx };
 
-    match ctx.protocol.sign_prepare() {
+    match ctx.protocol.sign_prepare_array() {
         Ok((k1, q1)) => {
             unsafe {
                 ptr::copy_nonoverlapping(k1.as_ptr(), out_k1, k1.len());
@@ -127,6 +247,99 @@ pub extern "C" fn cosign_sign_prepare(
     }
 }
 
+/// 预生成 (k1, Q1) 随机数池
+pub struct CoSignNoncePool {
+    pool: NoncePool,
+}
+
+/// 创建随机数池（创建后为空，需调用 cosign_nonce_pool_fill 填充）
+#[no_mangle]
+pub extern "C" fn cosign_nonce_pool_new(capacity: c_ulong) -> *mut CoSignNoncePool {
+    if capacity == 0 {
+        return ptr::null_mut();
+    }
+    let pool = Box::new(CoSignNoncePool {
+        pool: NoncePool::new(capacity as usize),
+    });
+    Box::into_raw(pool)
+}
+
+/// 销毁随机数池（剩余随机数会被清零）
+#[no_mangle]
+pub extern "C" fn cosign_nonce_pool_free(pool: *mut CoSignNoncePool) {
+    if !pool.is_null() {
+        unsafe {
+            drop(Box::from_raw(pool));
+        }
+    }
+}
+
+/// 在调用线程中把随机数池补满
+#[no_mangle]
+pub extern "C" fn cosign_nonce_pool_fill(
+    ctx: *const CoSignContext,
+    pool: *const CoSignNoncePool,
+    out_filled: *mut c_ulong,
+) -> c_int {
+    if ctx.is_null() || pool.is_null() {
+        return COSIGN_ERR_NULL_PTR;
+    }
+
+    let ctx = unsafe { &*ctx };
+    let pool = unsafe { &*pool };
+
+    match pool.pool.fill(&ctx.protocol) {
+        Ok(filled) => {
+            if !out_filled.is_null() {
+                unsafe {
+                    *out_filled = filled as c_ulong;
+                }
+            }
+            COSIGN_OK
+        }
+        Err(_) => COSIGN_ERR_CRYPTO,
+    }
+}
+
+/// 从随机数池取出一对 (k1, Q1)，每对只会被取出一次
+#[no_mangle]
+pub extern "C" fn cosign_nonce_pool_take(
+    pool: *const CoSignNoncePool,
+    out_k1: *mut c_uchar,
+    k1_len: *mut c_ulong,
+    out_q1: *mut c_uchar,
+    q1_len: *mut c_ulong,
+) -> c_int {
+    if pool.is_null() || out_k1.is_null() || k1_len.is_null() || out_q1.is_null() || q1_len.is_null() {
+        return COSIGN_ERR_NULL_PTR;
+    }
+
+    let pool = unsafe { &*pool };
+
+    match pool.pool.take() {
+        Some(pair) => {
+            unsafe {
+                ptr::copy_nonoverlapping(pair.k1().as_ptr(), out_k1, pair.k1().len());
+                *k1_len = pair.k1().len() as c_ulong;
+                ptr::copy_nonoverlapping(pair.q1().as_ptr(), out_q1, pair.q1().len());
+                *q1_len = pair.q1().len() as c_ulong;
+            }
+            COSIGN_OK
+        }
+        None => COSIGN_ERR_POOL_EMPTY,
+    }
+}
+
+/// 随机数池当前可用数量
+#[no_mangle]
+pub extern "C" fn cosign_nonce_pool_available(pool: *const CoSignNoncePool) -> c_ulong {
+    if pool.is_null() {
+        return 0;
+    }
+    let pool = unsafe { &*pool };
+    pool.pool.len() as c_ulong
+}
+
 /// 计算消息哈希
 #[no_mangle]
 pub extern "C" fn cosign_hash_message(
@@ -150,7 +363,11 @@ pub extern "C" fn cosign_hash_message(
         unsafe { slice::from_raw_parts(public_key, public_key_len as usize) }
     };
 
-    match ctx.protocol.calculate_message_hash(message_slice, pk_slice) {
+    let hash = ctx.message_hasher(pk_slice).map(|mut hasher| {
+        hasher.update(message_slice);
+        hasher.finalize()
+    });
+    match hash {
         Ok(hash) => {
             let len = hash.len();
             unsafe {
@@ -209,6 +426,74 @@ pub extern "C" fn cosign_complete_signature(
     }
 }
 
+/// 批量完成签名计算（同一 D1 下的多个签名共用一次 d1⁻¹）
+///
+/// k1s 为 count 个 32 字节 k1（左侧补零），shares 为 count 个 96 字节 r||s2||s3，
+/// out_signatures 输出 count 个 64 字节 r||s，out_status 输出每一项的错误码。
+#[no_mangle]
+pub extern "C" fn cosign_complete_signature_batch(
+    ctx: *const CoSignContext,
+    d1: *const c_uchar,
+    d1_len: c_ulong,
+    k1s: *const c_uchar,
+    shares: *const c_uchar,
+    count: c_ulong,
+    out_signatures: *mut c_uchar,
+    out_status: *mut c_int,
+) -> c_int {
+    if ctx.is_null() || d1.is_null() || k1s.is_null() || shares.is_null() || out_signatures.is_null() || out_status.is_null() {
+        return COSIGN_ERR_NULL_PTR;
+    }
+
+    let ctx = unsafe { &*ctx };
+    let count = count as usize;
+    let (Some(k1s_len), Some(shares_len), Some(sigs_len), Some(_)) = (
+        array_len(count, 32),
+        array_len(count, 96),
+        array_len(count, 64),
+        array_len(count, std::mem::size_of::<c_int>()),
+    ) else {
+        return COSIGN_ERR_INVALID_PARAM;
+    };
+    let d1_slice = unsafe { slice::from_raw_parts(d1, d1_len as usize) };
+    let k1_slice = unsafe { slice::from_raw_parts(k1s, k1s_len) };
+    let shares_slice = unsafe { slice::from_raw_parts(shares, shares_len) };
+    let out_sig_slice = unsafe { slice::from_raw_parts_mut(out_signatures, sigs_len) };
+    let out_status_slice = unsafe { slice::from_raw_parts_mut(out_status, count) };
+
+    let items: Vec<SignShares> = k1_slice
+        .chunks_exact(32)
+        .zip(shares_slice.chunks_exact(96))
+        .map(|(k1, share)| SignShares {
+            k1,
+            r: &share[0..32],
+            s2: &share[32..64],
+            s3: &share[64..96],
+        })
+        .collect();
+
+    let mut result = COSIGN_OK;
+    let signatures = ctx.protocol.complete_signature_batch(d1_slice, &items);
+    for (i, signature) in signatures.into_iter().enumerate() {
+        let out = &mut out_sig_slice[i * 64..(i + 1) * 64];
+        match signature {
+            Ok((r_out, s_out)) if r_out.len() <= 32 && s_out.len() <= 32 => {
+                out.fill(0);
+                out[32 - r_out.len()..32].copy_from_slice(&r_out);
+                out[64 - s_out.len()..64].copy_from_slice(&s_out);
+                out_status_slice[i] = COSIGN_OK;
+            }
+            _ => {
+                out.fill(0);
+                out_status_slice[i] = COSIGN_ERR_CRYPTO;
+                result = COSIGN_ERR_CRYPTO;
+            }
+        }
+    }
+
+    result
+}
+
 /// 解密预处理：计算 T1 = d1 * C1
 #[no_mangle]
 pub extern "C" fn cosign_decrypt_prepare(
@@ -228,7 +513,133 @@ pub extern "C" fn cosign_decrypt_prepare(
     let d1_slice = unsafe { slice::from_raw_parts(d1, d1_len as usize) };
     let c1_slice = unsafe { slice::from_raw_parts(c1, c1_len as usize) };
 
-    match ctx.protocol.decrypt_prepare(d1_slice, c1_slice) {
+    match ctx.protocol.decrypt_prepare_array(d1_slice, c1_slice) {
+        Ok(t1) => {
+            let len = t1.len();
+            unsafe {
+                ptr::copy_nonoverlapping(t1.as_ptr(), out_t1, len);
+                *out_len = len as c_ulong;
+            }
+            COSIGN_OK
+        }
+        Err(_) => COSIGN_ERR_CRYPTO,
+    }
+}
+
+/// 把 D1 导入上下文，存放在安全内存池中（锁定不换出，释放时清零）
+///
+/// 同时预先计算 d1⁻¹。成功后 `*out_key_id` 为非零密钥编号，调用方即可清零自己的 D1 副本，
+/// 之后用 `cosign_complete_signature_with_key` / `cosign_decrypt_prepare_with_key` 签名、解密。
+/// 编号在上下文内单调分配、从不复用；约 2³² 次导入用尽后返回 `COSIGN_ERR_INVALID_STATE`。
+#[no_mangle]
+pub extern "C" fn cosign_context_import_d1(
+    ctx: *const CoSignContext,
+    d1: *const c_uchar,
+    d1_len: c_ulong,
+    out_key_id: *mut c_uint,
+) -> c_int {
+    if ctx.is_null() || d1.is_null() || out_key_id.is_null() {
+        return COSIGN_ERR_NULL_PTR;
+    }
+
+    let ctx = unsafe { &*ctx };
+    let d1_slice = unsafe { slice::from_raw_parts(d1, d1_len as usize) };
+    let key = match SecretScalar::from_slice(d1_slice) {
+        Ok(d1) => match ctx.protocol.invert_d1_secret(&d1) {
+            Ok(d1_inv) => Arc::new(ContextKey { d1, d1_inv }),
+            Err(_) => return COSIGN_ERR_INVALID_PARAM,
+        },
+        Err(_) => return COSIGN_ERR_INVALID_PARAM,
+    };
+
+    let mut table = ctx.keys.write().unwrap_or_else(PoisonError::into_inner);
+    let key_id = table.next_id;
+    if key_id == 0 {
+        return COSIGN_ERR_INVALID_STATE;
+    }
+    // Reason: 回绕到 0 即停止分配，复用编号会让持有旧编号的调用方误用新导入的密钥
+    table.next_id = key_id.wrapping_add(1);
+    table.keys.insert(key_id, key);
+    unsafe {
+        *out_key_id = key_id;
+    }
+    COSIGN_OK
+}
+
+/// 释放导入的 D1：槽位清零并归还安全内存池，编号随即失效且不会再分配
+#[no_mangle]
+pub extern "C" fn cosign_context_release_d1(ctx: *const CoSignContext, key_id: c_uint) -> c_int {
+    if ctx.is_null() {
+        return COSIGN_ERR_NULL_PTR;
+    }
+
+    let ctx = unsafe { &*ctx };
+    let mut table = ctx.keys.write().unwrap_or_else(PoisonError::into_inner);
+    match table.keys.remove(&key_id) {
+        Some(_) => COSIGN_OK,
+        None => COSIGN_ERR_INVALID_PARAM,
+    }
+}
+
+/// 用导入的 D1 完成签名计算，out_signature 输出 64 字节 r||s
+#[no_mangle]
+pub extern "C" fn cosign_complete_signature_with_key(
+    ctx: *const CoSignContext,
+    key_id: c_uint,
+    k1: *const c_uchar,
+    k1_len: c_ulong,
+    r: *const c_uchar,
+    r_len: c_ulong,
+    s2: *const c_uchar,
+    s2_len: c_ulong,
+    s3: *const c_uchar,
+    s3_len: c_ulong,
+    out_signature: *mut c_uchar,
+) -> c_int {
+    if ctx.is_null() || k1.is_null() || r.is_null() || s2.is_null() || s3.is_null() || out_signature.is_null() {
+        return COSIGN_ERR_NULL_PTR;
+    }
+
+    let ctx = unsafe { &*ctx };
+    let Some(key) = ctx.key(key_id) else {
+        return COSIGN_ERR_INVALID_PARAM;
+    };
+    let k1_slice = unsafe { slice::from_raw_parts(k1, k1_len as usize) };
+    let r_slice = unsafe { slice::from_raw_parts(r, r_len as usize) };
+    let s2_slice = unsafe { slice::from_raw_parts(s2, s2_len as usize) };
+    let s3_slice = unsafe { slice::from_raw_parts(s3, s3_len as usize) };
+    let out = unsafe { &mut *(out_signature as *mut [u8; 64]) };
+
+    match ctx
+        .protocol
+        .complete_signature_into(k1_slice, &key.d1, &key.d1_inv, r_slice, s2_slice, s3_slice, out)
+    {
+        Ok(()) => COSIGN_OK,
+        Err(_) => COSIGN_ERR_CRYPTO,
+    }
+}
+
+/// 用导入的 D1 做解密预处理：计算 T1 = d1 * C1
+#[no_mangle]
+pub extern "C" fn cosign_decrypt_prepare_with_key(
+    ctx: *const CoSignContext,
+    key_id: c_uint,
+    c1: *const c_uchar,
+    c1_len: c_ulong,
+    out_t1: *mut c_uchar,
+    out_len: *mut c_ulong,
+) -> c_int {
+    if ctx.is_null() || c1.is_null() || out_t1.is_null() || out_len.is_null() {
+        return COSIGN_ERR_NULL_PTR;
+    }
+
+    let ctx = unsafe { &*ctx };
+    let Some(key) = ctx.key(key_id) else {
+        return COSIGN_ERR_INVALID_PARAM;
+    };
+    let c1_slice = unsafe { slice::from_raw_parts(c1, c1_len as usize) };
+
+    match ctx.protocol.decrypt_prepare_array(&key.d1, c1_slice) {
         Ok(t1) => {
             let len = t1.len();
             unsafe {
@@ -241,7 +652,29 @@ pub extern "C" fn cosign_decrypt_prepare(
     }
 }
 
+/// 查询安全内存池使用情况：槽位总数、已分发的槽位数（含各线程本地缓存）、是否全部锁定在物理内存中（1/0）
+#[no_mangle]
+pub extern "C" fn cosign_secure_stats(
+    out_capacity: *mut c_ulong,
+    out_in_use: *mut c_ulong,
+    out_locked: *mut c_int,
+) -> c_int {
+    if out_capacity.is_null() || out_in_use.is_null() || out_locked.is_null() {
+        return COSIGN_ERR_NULL_PTR;
+    }
+
+    let stats = secure::stats();
+    unsafe {
+        *out_capacity = stats.capacity as c_ulong;
+        *out_in_use = stats.in_use as c_ulong;
+        *out_locked = stats.locked as c_int;
+    }
+    COSIGN_OK
+}
+
 /// 完成解密计算
+///
+/// 输出缓冲区遵循 `output_buffer` 约定，明文长度等于 C2 长度，直接写入调用方缓冲区。
 #[no_mangle]
 pub extern "C" fn cosign_complete_decryption(
     ctx: *const CoSignContext,
@@ -256,29 +689,119 @@ pub extern "C" fn cosign_complete_decryption(
     out_plaintext: *mut c_uchar,
     out_len: *mut c_ulong,
 ) -> c_int {
-    if ctx.is_null() || t2.is_null() || c1.is_null() || c3.is_null() || c2.is_null() || out_plaintext.is_null() || out_len.is_null() {
+    if ctx.is_null() || t2.is_null() || c1.is_null() || c3.is_null() || c2.is_null() || out_len.is_null() {
         return COSIGN_ERR_NULL_PTR;
     }
 
+    let out = match unsafe { output_buffer(out_plaintext, out_len, c2_len as usize) } {
+        Ok(Some(out)) => out,
+        Ok(None) => return COSIGN_OK,
+        Err(code) => return code,
+    };
+
     let ctx = unsafe { &*ctx };
     let t2_slice = unsafe { slice::from_raw_parts(t2, t2_len as usize) };
     let c1_slice = unsafe { slice::from_raw_parts(c1, c1_len as usize) };
     let c3_slice = unsafe { slice::from_raw_parts(c3, c3_len as usize) };
     let c2_slice = unsafe { slice::from_raw_parts(c2, c2_len as usize) };
 
-    match ctx.protocol.complete_decryption(t2_slice, c1_slice, c3_slice, c2_slice) {
-        Ok(plaintext) => {
-            let len = plaintext.len();
-            unsafe {
-                ptr::copy_nonoverlapping(plaintext.as_ptr(), out_plaintext, len);
-                *out_len = len as c_ulong;
-            }
-            COSIGN_OK
-        }
+    match ctx.protocol.complete_decryption_into(t2_slice, c1_slice, c3_slice, c2_slice, out) {
+        Ok(()) => COSIGN_OK,
         Err(_) => COSIGN_ERR_CRYPTO,
     }
 }
 
+/// 流式解密上下文（C2 分块解密）
+pub struct CoSignDecryptCtx {
+    /// final 之后为 None
+    stream: Option<DecryptStream>,
+}
+
+/// 开始流式完成解密，C2 随后分块送入 `cosign_decrypt_stream_update`
+#[no_mangle]
+pub extern "C" fn cosign_decrypt_stream_init(
+    ctx: *const CoSignContext,
+    t2: *const c_uchar,
+    t2_len: c_ulong,
+    c1: *const c_uchar,
+    c1_len: c_ulong,
+    c3: *const c_uchar,
+    c3_len: c_ulong,
+) -> *mut CoSignDecryptCtx {
+    if ctx.is_null() || t2.is_null() || c1.is_null() || c3.is_null() {
+        return ptr::null_mut();
+    }
+
+    let ctx = unsafe { &*ctx };
+    let t2_slice = unsafe { slice::from_raw_parts(t2, t2_len as usize) };
+    let c1_slice = unsafe { slice::from_raw_parts(c1, c1_len as usize) };
+    let c3_slice = unsafe { slice::from_raw_parts(c3, c3_len as usize) };
+
+    match ctx.protocol.decrypt_stream(t2_slice, c1_slice, c3_slice) {
+        Ok(stream) => Box::into_raw(Box::new(CoSignDecryptCtx { stream: Some(stream) })),
+        Err(_) => ptr::null_mut(),
+    }
+}
+
+/// 解密下一段 C2，明文写入 out_plaintext（与 c2 等长，可与 c2 为同一缓冲区）
+///
+/// 输出的明文在 `cosign_decrypt_stream_final` 返回 COSIGN_OK 之前都未经 C3 校验。
+#[no_mangle]
+pub extern "C" fn cosign_decrypt_stream_update(
+    dctx: *mut CoSignDecryptCtx,
+    c2: *const c_uchar,
+    c2_len: c_ulong,
+    out_plaintext: *mut c_uchar,
+) -> c_int {
+    if dctx.is_null() || ((c2.is_null() || out_plaintext.is_null()) && c2_len != 0) {
+        return COSIGN_ERR_NULL_PTR;
+    }
+    let dctx = unsafe { &mut *dctx };
+    let Some(stream) = dctx.stream.as_mut() else {
+        return COSIGN_ERR_INVALID_PARAM;
+    };
+    if c2_len == 0 {
+        return COSIGN_OK;
+    }
+
+    let len = c2_len as usize;
+    // Reason: 原地解密时 c2 与 out 指向同一内存，不能同时构造只读和可变切片
+    if !ptr::eq(c2, out_plaintext) {
+        unsafe { ptr::copy(c2, out_plaintext, len) };
+    }
+    let out = unsafe { slice::from_raw_parts_mut(out_plaintext, len) };
+    stream.update(out);
+    COSIGN_OK
+}
+
+/// C2 全部送入后校验 C3；校验失败返回 COSIGN_ERR_CRYPTO，此前输出的明文必须丢弃
+///
+/// 无论结果如何，上下文此后只能传给 `cosign_decrypt_stream_free`。
+#[no_mangle]
+pub extern "C" fn cosign_decrypt_stream_final(dctx: *mut CoSignDecryptCtx) -> c_int {
+    if dctx.is_null() {
+        return COSIGN_ERR_NULL_PTR;
+    }
+    let dctx = unsafe { &mut *dctx };
+    match dctx.stream.take() {
+        Some(stream) => match stream.finalize() {
+            Ok(()) => COSIGN_OK,
+            Err(_) => COSIGN_ERR_CRYPTO,
+        },
+        None => COSIGN_ERR_INVALID_PARAM,
+    }
+}
+
+/// 销毁流式解密上下文
+#[no_mangle]
+pub extern "C" fn cosign_decrypt_stream_free(dctx: *mut CoSignDecryptCtx) {
+    if !dctx.is_null() {
+        unsafe {
+            drop(Box::from_raw(dctx));
+        }
+    }
+}
+
 /// 计算 SM3 哈希
 #[no_mangle]
 pub extern "C" fn cosign_sm3_hash(
@@ -302,6 +825,150 @@ pub extern "C" fn cosign_sm3_hash(
     COSIGN_OK
 }
 
+/// 批量计算 SM3 哈希（多路并行）
+///
+/// messages/lens 为 count 条消息的指针和长度，out_hashes 输出 count 个 32 字节摘要。
+#[no_mangle]
+pub extern "C" fn cosign_sm3_hash_many(
+    messages: *const *const c_uchar,
+    lens: *const c_ulong,
+    count: c_ulong,
+    out_hashes: *mut c_uchar,
+) -> c_int {
+    if count == 0 {
+        return COSIGN_OK;
+    }
+    if messages.is_null() || lens.is_null() || out_hashes.is_null() {
+        return COSIGN_ERR_NULL_PTR;
+    }
+
+    let count = count as usize;
+    let (Some(_), Some(_), Some(_)) = (
+        array_len(count, 32),
+        array_len(count, std::mem::size_of::<*const c_uchar>()),
+        array_len(count, std::mem::size_of::<c_ulong>()),
+    ) else {
+        return COSIGN_ERR_INVALID_PARAM;
+    };
+    let ptrs = unsafe { slice::from_raw_parts(messages, count) };
+    let lens = unsafe { slice::from_raw_parts(lens, count) };
+    let mut inputs: Vec<&[u8]> = Vec::with_capacity(count);
+    for (&data, &len) in ptrs.iter().zip(lens) {
+        if data.is_null() {
+            if len != 0 {
+                return COSIGN_ERR_NULL_PTR;
+            }
+            inputs.push(&[]);
+        } else {
+            inputs.push(unsafe { slice::from_raw_parts(data, len as usize) });
+        }
+    }
+
+    let out = unsafe { slice::from_raw_parts_mut(out_hashes.cast::<[u8; 32]>(), count) };
+    MultiSm3::new().hash_into(&inputs, out);
+
+    COSIGN_OK
+}
+
+/// 增量 SM3 上下文（大消息分块哈希）
+pub struct CoSignSm3Ctx {
+    hasher: Sm3,
+    /// final 后恢复到的初始状态（消息哈希上下文包含公钥相关前缀）
+    initial: Sm3,
+}
+
+impl CoSignSm3Ctx {
+    fn boxed(initial: Sm3) -> *mut CoSignSm3Ctx {
+        Box::into_raw(Box::new(CoSignSm3Ctx {
+            hasher: initial.clone(),
+            initial,
+        }))
+    }
+}
+
+/// 创建增量 SM3 上下文
+#[no_mangle]
+pub extern "C" fn cosign_sm3_ctx_new() -> *mut CoSignSm3Ctx {
+    CoSignSm3Ctx::boxed(Sm3::new())
+}
+
+/// 创建消息哈希 E 的增量上下文，final 结果与 cosign_hash_message 相同
+#[no_mangle]
+pub extern "C" fn cosign_message_hash_ctx_new(
+    ctx: *const CoSignContext,
+    public_key: *const c_uchar,
+    public_key_len: c_ulong,
+) -> *mut CoSignSm3Ctx {
+    if ctx.is_null() {
+        return ptr::null_mut();
+    }
+
+    let ctx = unsafe { &*ctx };
+    let pk_slice = if public_key.is_null() || public_key_len == 0 {
+        &[]
+    } else {
+        unsafe { slice::from_raw_parts(public_key, public_key_len as usize) }
+    };
+
+    match ctx.message_hasher(pk_slice) {
+        Ok(hasher) => CoSignSm3Ctx::boxed(hasher),
+        Err(_) => ptr::null_mut(),
+    }
+}
+
+/// 向增量 SM3 上下文追加数据
+#[no_mangle]
+pub extern "C" fn cosign_sm3_ctx_update(
+    sm3: *mut CoSignSm3Ctx,
+    data: *const c_uchar,
+    data_len: c_ulong,
+) -> c_int {
+    if sm3.is_null() || (data.is_null() && data_len != 0) {
+        return COSIGN_ERR_NULL_PTR;
+    }
+    if data_len == 0 {
+        return COSIGN_OK;
+    }
+
+    let sm3 = unsafe { &mut *sm3 };
+    let data_slice = unsafe { slice::from_raw_parts(data, data_len as usize) };
+    sm3.hasher.update(data_slice);
+    COSIGN_OK
+}
+
+/// 输出摘要，之后上下文恢复为创建时的状态，可继续用于下一条消息
+#[no_mangle]
+pub extern "C" fn cosign_sm3_ctx_final(
+    sm3: *mut CoSignSm3Ctx,
+    out_hash: *mut c_uchar,
+    out_len: *mut c_ulong,
+) -> c_int {
+    if sm3.is_null() || out_hash.is_null() || out_len.is_null() {
+        return COSIGN_ERR_NULL_PTR;
+    }
+
+    let sm3 = unsafe { &mut *sm3 };
+    let hasher = std::mem::replace(&mut sm3.hasher, sm3.initial.clone());
+    let hash = hasher.finalize();
+
+    unsafe {
+        ptr::copy_nonoverlapping(hash.as_ptr(), out_hash, hash.len());
+        *out_len = hash.len() as c_ulong;
+    }
+
+    COSIGN_OK
+}
+
+/// 销毁增量 SM3 上下文
+#[no_mangle]
+pub extern "C" fn cosign_sm3_ctx_free(sm3: *mut CoSignSm3Ctx) {
+    if !sm3.is_null() {
+        unsafe {
+            drop(Box::from_raw(sm3));
+        }
+    }
+}
+
 /// SM2 签名（标准签名）
 #[no_mangle]
 pub extern "C" fn cosign_sm2_sign(
@@ -356,7 +1023,72 @@ pub extern "C" fn cosign_sm2_verify(
     }
 }
 
+/// 批量 SM2 验签（标准验签）
+///
+/// public_keys 为 count 个 64 字节 x||y，messages/message_lens 为 count 条消息的指针和长度，
+/// signatures 为 count 个 64 字节 r||s，out_status 输出每一项的结果。
+#[no_mangle]
+pub extern "C" fn cosign_sm2_verify_batch(
+    ctx: *const CoSignContext,
+    public_keys: *const c_uchar,
+    messages: *const *const c_uchar,
+    message_lens: *const c_ulong,
+    signatures: *const c_uchar,
+    count: c_ulong,
+    out_status: *mut c_int,
+) -> c_int {
+    if count == 0 {
+        return COSIGN_OK;
+    }
+    if ctx.is_null() || public_keys.is_null() || messages.is_null() || message_lens.is_null() || signatures.is_null() || out_status.is_null() {
+        return COSIGN_ERR_NULL_PTR;
+    }
+
+    let ctx = unsafe { &*ctx };
+    let count = count as usize;
+    let (Some(items_len), Some(_), Some(_)) = (
+        array_len(count, 64),
+        array_len(count, std::mem::size_of::<*const c_uchar>()),
+        array_len(count, std::mem::size_of::<c_int>()),
+    ) else {
+        return COSIGN_ERR_INVALID_PARAM;
+    };
+    let keys_slice = unsafe { slice::from_raw_parts(public_keys, items_len) };
+    let sig_slice = unsafe { slice::from_raw_parts(signatures, items_len) };
+    let ptrs = unsafe { slice::from_raw_parts(messages, count) };
+    let lens = unsafe { slice::from_raw_parts(message_lens, count) };
+    let out_status_slice = unsafe { slice::from_raw_parts_mut(out_status, count) };
+
+    let mut items: Vec<VerifyItem> = Vec::with_capacity(count);
+    for (i, (&data, &len)) in ptrs.iter().zip(lens).enumerate() {
+        let message: &[u8] = if data.is_null() {
+            if len != 0 {
+                return COSIGN_ERR_NULL_PTR;
+            }
+            &[]
+        } else {
+            unsafe { slice::from_raw_parts(data, len as usize) }
+        };
+        items.push(VerifyItem {
+            public_key: &keys_slice[i * 64..(i + 1) * 64],
+            message,
+            signature: &sig_slice[i * 64..(i + 1) * 64],
+        });
+    }
+
+    let mut result = COSIGN_OK;
+    for (status, valid) in out_status_slice.iter_mut().zip(ctx.protocol.verify_batch(&items)) {
+        *status = if valid { COSIGN_OK } else { COSIGN_ERR_CRYPTO };
+        if !valid {
+            result = COSIGN_ERR_CRYPTO;
+        }
+    }
+    result
+}
+
 /// SM2 加密（标准加密）
+///
+/// 输出缓冲区遵循 `output_buffer` 约定，密文长度为 97 + message_len。
 #[no_mangle]
 pub extern "C" fn cosign_sm2_encrypt(
     public_key: *const c_uchar,
@@ -366,26 +1098,31 @@ pub extern "C" fn cosign_sm2_encrypt(
     out_ciphertext: *mut c_uchar,
     out_len: *mut c_ulong,
 ) -> c_int {
-    if public_key.is_null() || message.is_null() || out_ciphertext.is_null() || out_len.is_null() {
+    if public_key.is_null() || message.is_null() || out_len.is_null() {
         return COSIGN_ERR_NULL_PTR;
     }
 
+    let Some(required) = sm2_co_sign_core::protocol::ciphertext_len_checked(message_len as usize) else {
+        return COSIGN_ERR_INVALID_PARAM;
+    };
+    let out = match unsafe { output_buffer(out_ciphertext, out_len, required) } {
+        Ok(Some(out)) => out,
+        Ok(None) => return COSIGN_OK,
+        Err(code) => return code,
+    };
+
     let public_key_slice = unsafe { slice::from_raw_parts(public_key, public_key_len as usize) };
     let message_slice = unsafe { slice::from_raw_parts(message, message_len as usize) };
 
-    match CoSignProtocol::encrypt(public_key_slice, message_slice) {
-        Ok(ciphertext) => {
-            unsafe {
-                ptr::copy_nonoverlapping(ciphertext.as_ptr(), out_ciphertext, ciphertext.len());
-                *out_len = ciphertext.len() as c_ulong;
-            }
-            COSIGN_OK
-        }
+    match CoSignProtocol::encrypt_into(public_key_slice, message_slice, out) {
+        Ok(()) => COSIGN_OK,
         Err(_) => COSIGN_ERR_CRYPTO,
     }
 }
 
 /// SM2 解密（标准解密）
+///
+/// 输出缓冲区遵循 `output_buffer` 约定，明文长度为 ciphertext_len - 97。
 #[no_mangle]
 pub extern "C" fn cosign_sm2_decrypt(
     private_key: *const c_uchar,
@@ -395,27 +1132,34 @@ pub extern "C" fn cosign_sm2_decrypt(
     out_plaintext: *mut c_uchar,
     out_len: *mut c_ulong,
 ) -> c_int {
-    if private_key.is_null() || ciphertext.is_null() || out_plaintext.is_null() || out_len.is_null() {
+    if private_key.is_null() || ciphertext.is_null() || out_len.is_null() {
         return COSIGN_ERR_NULL_PTR;
     }
 
+    let required = match sm2_co_sign_core::protocol::plaintext_len(ciphertext_len as usize) {
+        Some(len) => len,
+        None => return COSIGN_ERR_CRYPTO,
+    };
+    let out = match unsafe { output_buffer(out_plaintext, out_len, required) } {
+        Ok(Some(out)) => out,
+        Ok(None) => return COSIGN_OK,
+        Err(code) => return code,
+    };
+
     let private_key_slice = unsafe { slice::from_raw_parts(private_key, private_key_len as usize) };
     let ciphertext_slice = unsafe { slice::from_raw_parts(ciphertext, ciphertext_len as usize) };
 
-    match CoSignProtocol::decrypt(private_key_slice, ciphertext_slice) {
-        Ok(Some(plaintext)) => {
-            unsafe {
-                ptr::copy_nonoverlapping(plaintext.as_ptr(), out_plaintext, plaintext.len());
-                *out_len = plaintext.len() as c_ulong;
-            }
-            COSIGN_OK
-        }
-        Ok(None) => COSIGN_ERR_CRYPTO,
+    match CoSignProtocol::decrypt_into(private_key_slice, ciphertext_slice, out) {
+        Ok(true) => COSIGN_OK,
+        Ok(false) => COSIGN_ERR_CRYPTO,
         Err(_) => COSIGN_ERR_CRYPTO,
     }
 }
 
 /// Base64 编码
+///
+/// 输出缓冲区遵循 `output_buffer` 约定，所需长度包含结尾 NUL；
+/// 成功时 `*out_len` 为字符串长度（不含 NUL）。
 #[no_mangle]
 pub extern "C" fn cosign_base64_encode(
     data: *const c_uchar,
@@ -423,19 +1167,23 @@ pub extern "C" fn cosign_base64_encode(
     out_str: *mut c_char,
     out_len: *mut c_ulong,
 ) -> c_int {
-    if data.is_null() || out_str.is_null() || out_len.is_null() {
+    if data.is_null() || out_len.is_null() {
         return COSIGN_ERR_NULL_PTR;
     }
 
-    let data_slice = unsafe { slice::from_raw_parts(data, data_len as usize) };
-    let encoded = sm2_co_sign_core::protocol::base64_encode(data_slice);
+    let encoded_len = sm2_co_sign_core::protocol::base64_encoded_len(data_len as usize);
+    let out = match unsafe { output_buffer(out_str as *mut c_uchar, out_len, encoded_len + 1) } {
+        Ok(Some(out)) => out,
+        Ok(None) => return COSIGN_OK,
+        Err(code) => return code,
+    };
 
-    match CString::new(encoded) {
-        Ok(c_str) => {
-            let bytes = c_str.as_bytes_with_nul();
+    let data_slice = unsafe { slice::from_raw_parts(data, data_len as usize) };
+    match sm2_co_sign_core::protocol::base64_encode_into(data_slice, out) {
+        Ok(written) => {
+            out[written] = 0;
             unsafe {
-                ptr::copy_nonoverlapping(bytes.as_ptr(), out_str as *mut u8, bytes.len());
-                *out_len = (bytes.len() - 1) as c_ulong;
+                *out_len = written as c_ulong;
             }
             COSIGN_OK
         }
@@ -444,13 +1192,15 @@ pub extern "C" fn cosign_base64_encode(
 }
 
 /// Base64 解码
+///
+/// 输出缓冲区遵循 `output_buffer` 约定：`out_data` 为 NULL 时只写回解码后的长度。
 #[no_mangle]
 pub extern "C" fn cosign_base64_decode(
     str: *const c_char,
     out_data: *mut c_uchar,
     out_len: *mut c_ulong,
 ) -> c_int {
-    if str.is_null() || out_data.is_null() || out_len.is_null() {
+    if str.is_null() || out_len.is_null() {
         return COSIGN_ERR_NULL_PTR;
     }
 
@@ -460,11 +1210,20 @@ pub extern "C" fn cosign_base64_decode(
         Err(_) => return COSIGN_ERR_ENCODING,
     };
 
-    match sm2_co_sign_core::protocol::base64_decode(str_slice) {
-        Ok(data) => {
+    let decoded_len = match sm2_co_sign_core::protocol::base64_decoded_len(str_slice) {
+        Ok(len) => len,
+        Err(_) => return COSIGN_ERR_ENCODING,
+    };
+    let out = match unsafe { output_buffer(out_data, out_len, decoded_len) } {
+        Ok(Some(out)) => out,
+        Ok(None) => return COSIGN_OK,
+        Err(code) => return code,
+    };
+
+    match sm2_co_sign_core::protocol::base64_decode_into(str_slice, out) {
+        Ok(written) => {
             unsafe {
-                ptr::copy_nonoverlapping(data.as_ptr(), out_data, data.len());
-                *out_len = data.len() as c_ulong;
+                *out_len = written as c_ulong;
             }
             COSIGN_OK
         }
@@ -472,10 +1231,37 @@ pub extern "C" fn cosign_base64_decode(
     }
 }
 
+/// 导出埋点指标（Prometheus 文本格式）
+///
+/// 输出缓冲区遵循 `output_buffer` 约定，所需长度包含结尾 NUL；
+/// 成功时 `*out_len` 为字符串长度（不含 NUL）。未开启 `metrics` feature 时输出空字符串。
+#[no_mangle]
+pub extern "C" fn cosign_metrics_snapshot(out_text: *mut c_char, out_len: *mut c_ulong) -> c_int {
+    if out_len.is_null() {
+        return COSIGN_ERR_NULL_PTR;
+    }
+
+    #[cfg(feature = "metrics")]
+    let text = sm2_co_sign_core::metrics::snapshot().to_prometheus();
+    #[cfg(not(feature = "metrics"))]
+    let text = String::new();
+
+    let out = match unsafe { output_buffer(out_text as *mut c_uchar, out_len, text.len() + 1) } {
+        Ok(Some(out)) => out,
+        Ok(None) => return COSIGN_OK,
+        Err(code) => return code,
+    };
+    out[..text.len()].copy_from_slice(text.as_bytes());
+    out[text.len()] = 0;
+    unsafe {
+        *out_len = text.len() as c_ulong;
+    }
+    COSIGN_OK
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
-    use std::ffi::CString;
 
     #[test]
     fn test_context_new_free() {
@@ -484,6 +1270,104 @@ mod tests {
         cosign_context_free(ctx);
     }
 
+    #[test]
+    fn test_context_new_with_window() {
+        let ctx = cosign_context_new_with_window(0);
+        assert!(!ctx.is_null());
+        cosign_context_free(ctx);
+
+        let ctx = cosign_context_new_with_window(6);
+        assert!(!ctx.is_null());
+        cosign_context_free(ctx);
+
+        assert!(cosign_context_new_with_window(9).is_null());
+    }
+
+    #[test]
+    fn test_context_shared_across_threads() {
+        let ctx = cosign_context_new();
+        let public_key = CoSignProtocol::new().unwrap().calculate_p1(&[7u8; 32]).unwrap();
+        let mut expected = [0u8; 32];
+        let mut len: c_ulong = 0;
+        cosign_hash_message(ctx, b"abc".as_ptr(), 3, public_key.as_ptr(), 64, expected.as_mut_ptr(), &mut len);
+
+        // Reason: 裸指针不是 Send，以地址形式传入线程，模拟 C 侧共享同一上下文
+        let addr = ctx as usize;
+        std::thread::scope(|scope| {
+            for _ in 0..4 {
+                let public_key = &public_key;
+                scope.spawn(move || {
+                    let ctx = addr as *const CoSignContext;
+                    for _ in 0..20 {
+                        let mut d1 = [0u8; 32];
+                        let mut len: c_ulong = 0;
+                        assert_eq!(cosign_generate_d1(ctx, d1.as_mut_ptr(), &mut len), COSIGN_OK);
+                        let mut e = [0u8; 32];
+                        let result = cosign_hash_message(ctx, b"abc".as_ptr(), 3, public_key.as_ptr(), 64, e.as_mut_ptr(), &mut len);
+                        assert_eq!(result, COSIGN_OK);
+                        assert_eq!(e, expected);
+                    }
+                });
+            }
+        });
+        cosign_context_free(ctx);
+    }
+
+    #[test]
+    fn test_context_key_sign_and_decrypt() {
+        let ctx = cosign_context_new();
+        let protocol = CoSignProtocol::new().unwrap();
+        let d1 = protocol.generate_d1_array().unwrap();
+        let (k1, _) = protocol.sign_prepare_array().unwrap();
+        let (r, s2, s3) = ([3u8; 32], [4u8; 32], [5u8; 32]);
+
+        let mut key_id: c_uint = 0;
+        assert_eq!(cosign_context_import_d1(ctx, d1.as_ptr(), 32, &mut key_id), COSIGN_OK);
+        assert_ne!(key_id, 0);
+
+        let mut signature = [0u8; 64];
+        assert_eq!(
+            cosign_complete_signature_with_key(
+                ctx, key_id, k1.as_ptr(), 32, r.as_ptr(), 32, s2.as_ptr(), 32, s3.as_ptr(), 32, signature.as_mut_ptr()
+            ),
+            COSIGN_OK
+        );
+        let expected = protocol.complete_signature(&k1, &d1, &r, &s2, &s3).unwrap();
+        assert_eq!(signature[..32], expected.0[..]);
+        assert_eq!(signature[32..], expected.1[..]);
+
+        let c1 = protocol.calculate_p1_array(&[9u8; 32]).unwrap();
+        let mut t1 = [0u8; 64];
+        let mut len: c_ulong = 0;
+        assert_eq!(cosign_decrypt_prepare_with_key(ctx, key_id, c1.as_ptr(), 64, t1.as_mut_ptr(), &mut len), COSIGN_OK);
+        assert_eq!(t1[..len as usize], protocol.decrypt_prepare_array(&d1, &c1).unwrap()[..]);
+
+        let (mut capacity, mut in_use, mut locked): (c_ulong, c_ulong, c_int) = (0, 0, -1);
+        assert_eq!(cosign_secure_stats(&mut capacity, &mut in_use, &mut locked), COSIGN_OK);
+        assert!(capacity > 0 && in_use >= 2 && (locked == 0 || locked == 1));
+
+        // 释放后编号失效，重新导入分配新编号，旧编号仍然无效
+        assert_eq!(cosign_context_release_d1(ctx, key_id), COSIGN_OK);
+        assert_eq!(cosign_context_release_d1(ctx, key_id), COSIGN_ERR_INVALID_PARAM);
+        assert_eq!(
+            cosign_decrypt_prepare_with_key(ctx, key_id, c1.as_ptr(), 64, t1.as_mut_ptr(), &mut len),
+            COSIGN_ERR_INVALID_PARAM
+        );
+        let mut reused: c_uint = 0;
+        assert_eq!(cosign_context_import_d1(ctx, d1.as_ptr(), 32, &mut reused), COSIGN_OK);
+        assert_ne!(reused, key_id);
+        assert_eq!(
+            cosign_decrypt_prepare_with_key(ctx, key_id, c1.as_ptr(), 64, t1.as_mut_ptr(), &mut len),
+            COSIGN_ERR_INVALID_PARAM
+        );
+        assert_eq!(cosign_decrypt_prepare_with_key(ctx, reused, c1.as_ptr(), 64, t1.as_mut_ptr(), &mut len), COSIGN_OK);
+        assert_eq!(cosign_context_release_d1(ctx, key_id), COSIGN_ERR_INVALID_PARAM);
+        assert_eq!(cosign_context_import_d1(ctx, [0u8; 32].as_ptr(), 32, &mut reused), COSIGN_ERR_INVALID_PARAM);
+        assert_eq!(cosign_context_release_d1(ctx, 0), COSIGN_ERR_INVALID_PARAM);
+
+        cosign_context_free(ctx);
+    }
+
     #[test]
     fn test_generate_d1() {
         let ctx = cosign_context_new();
@@ -497,6 +1381,88 @@ mod tests {
         cosign_context_free(ctx);
     }
 
+    #[test]
+    fn test_nonce_pool() {
+        assert!(cosign_nonce_pool_new(0).is_null());
+
+        let ctx = cosign_context_new();
+        let pool = cosign_nonce_pool_new(2);
+        assert!(!pool.is_null());
+
+        let mut filled: c_ulong = 0;
+        assert_eq!(cosign_nonce_pool_fill(ctx, pool, &mut filled), COSIGN_OK);
+        assert_eq!(filled, 2);
+        assert_eq!(cosign_nonce_pool_available(pool), 2);
+
+        let mut k1 = [0u8; 32];
+        let mut k1_len: c_ulong = 0;
+        let mut q1 = [0u8; 64];
+        let mut q1_len: c_ulong = 0;
+        for _ in 0..2 {
+            let result = cosign_nonce_pool_take(pool, k1.as_mut_ptr(), &mut k1_len, q1.as_mut_ptr(), &mut q1_len);
+            assert_eq!(result, COSIGN_OK);
+            assert_eq!(q1_len, 64);
+        }
+        let result = cosign_nonce_pool_take(pool, k1.as_mut_ptr(), &mut k1_len, q1.as_mut_ptr(), &mut q1_len);
+        assert_eq!(result, COSIGN_ERR_POOL_EMPTY);
+
+        cosign_nonce_pool_free(pool);
+        cosign_context_free(ctx);
+    }
+
+    #[test]
+    fn test_complete_signature_batch() {
+        let ctx = cosign_context_new();
+        let mut d1 = [0u8; 32];
+        let mut d1_len: c_ulong = 0;
+        cosign_generate_d1(ctx, d1.as_mut_ptr(), &mut d1_len);
+
+        let mut k1s = [0u8; 64];
+        let mut shares = [0x5au8; 192];
+        for i in 0..2 {
+            let mut k1 = [0u8; 32];
+            let mut k1_len: c_ulong = 0;
+            let mut q1 = [0u8; 64];
+            let mut q1_len: c_ulong = 0;
+            cosign_sign_prepare(ctx, k1.as_mut_ptr(), &mut k1_len, q1.as_mut_ptr(), &mut q1_len);
+            let k1_len = k1_len as usize;
+            k1s[i * 32 + 32 - k1_len..(i + 1) * 32].copy_from_slice(&k1[..k1_len]);
+            shares[i * 96] = i as u8;
+        }
+
+        let mut signatures = [0u8; 128];
+        let mut status = [-1 as c_int; 2];
+        let result = cosign_complete_signature_batch(
+            ctx, d1.as_ptr(), d1_len, k1s.as_ptr(), shares.as_ptr(), 2, signatures.as_mut_ptr(), status.as_mut_ptr(),
+        );
+        assert_eq!(result, COSIGN_OK);
+        assert_eq!(status, [COSIGN_OK, COSIGN_OK]);
+
+        for i in 0..2 {
+            let mut r = [0u8; 32];
+            let mut r_len: c_ulong = 0;
+            let mut s = [0u8; 32];
+            let mut s_len: c_ulong = 0;
+            let share = &shares[i * 96..(i + 1) * 96];
+            cosign_complete_signature(
+                ctx, k1s[i * 32..].as_ptr(), 32, d1.as_ptr(), d1_len,
+                share.as_ptr(), 32, share[32..].as_ptr(), 32, share[64..].as_ptr(), 32,
+                r.as_mut_ptr(), &mut r_len, s.as_mut_ptr(), &mut s_len,
+            );
+            let s_len = s_len as usize;
+            assert_eq!(&signatures[i * 64 + 64 - s_len..(i + 1) * 64], &s[..s_len]);
+        }
+
+        // count * 96 溢出时拒绝，不构造越界切片
+        let huge = (usize::MAX / 64) as c_ulong;
+        let result = cosign_complete_signature_batch(
+            ctx, d1.as_ptr(), d1_len, k1s.as_ptr(), shares.as_ptr(), huge, signatures.as_mut_ptr(), status.as_mut_ptr(),
+        );
+        assert_eq!(result, COSIGN_ERR_INVALID_PARAM);
+
+        cosign_context_free(ctx);
+    }
+
     #[test]
     fn test_sm3_hash() {
         let data = b"hello world";
@@ -508,6 +1474,102 @@ mod tests {
         assert_eq!(len, 32);
     }
 
+    #[test]
+    fn test_hash_message_with_public_key() {
+        let ctx = cosign_context_new();
+        let protocol = CoSignProtocol::new().unwrap();
+        let keys: Vec<Vec<u8>> = (0..2)
+            .map(|_| protocol.calculate_p1(&protocol.generate_d1().unwrap()).unwrap())
+            .collect();
+        let message = b"payload";
+
+        // 交替使用两个公钥，缓存命中与未命中结果都应与核心库一致
+        for pk in [&keys[0], &keys[0], &keys[1], &keys[0]] {
+            let mut hash = [0u8; 32];
+            let mut len: c_ulong = 0;
+            let result = cosign_hash_message(
+                ctx,
+                message.as_ptr(),
+                message.len() as c_ulong,
+                pk.as_ptr(),
+                pk.len() as c_ulong,
+                hash.as_mut_ptr(),
+                &mut len,
+            );
+            assert_eq!(result, COSIGN_OK);
+            assert_eq!(hash.to_vec(), protocol.calculate_message_hash(message, pk).unwrap());
+        }
+
+        let mut hash = [0u8; 32];
+        let mut len: c_ulong = 0;
+        let bad_pk = [0u8; 10];
+        let result = cosign_hash_message(ctx, message.as_ptr(), 7, bad_pk.as_ptr(), 10, hash.as_mut_ptr(), &mut len);
+        assert_eq!(result, COSIGN_ERR_CRYPTO);
+        cosign_context_free(ctx);
+    }
+
+    #[test]
+    fn test_sm3_ctx_streaming() {
+        let data = vec![0x61u8; 1000];
+        let mut expected = [0u8; 32];
+        let mut len: c_ulong = 0;
+        cosign_sm3_hash(data.as_ptr(), data.len() as c_ulong, expected.as_mut_ptr(), &mut len);
+
+        let sm3 = cosign_sm3_ctx_new();
+        assert!(!sm3.is_null());
+        for chunk in data.chunks(333) {
+            assert_eq!(cosign_sm3_ctx_update(sm3, chunk.as_ptr(), chunk.len() as c_ulong), COSIGN_OK);
+        }
+        let mut hash = [0u8; 32];
+        assert_eq!(cosign_sm3_ctx_final(sm3, hash.as_mut_ptr(), &mut len), COSIGN_OK);
+        assert_eq!(len, 32);
+        assert_eq!(hash, expected);
+
+        // final 后可复用
+        cosign_sm3_ctx_update(sm3, data.as_ptr(), data.len() as c_ulong);
+        cosign_sm3_ctx_final(sm3, hash.as_mut_ptr(), &mut len);
+        assert_eq!(hash, expected);
+        assert_eq!(cosign_sm3_ctx_update(sm3, ptr::null(), 1), COSIGN_ERR_NULL_PTR);
+        cosign_sm3_ctx_free(sm3);
+
+        // 消息哈希上下文与 cosign_hash_message 结果一致
+        let ctx = cosign_context_new();
+        let mut e = [0u8; 32];
+        cosign_hash_message(ctx, data.as_ptr(), data.len() as c_ulong, ptr::null(), 0, e.as_mut_ptr(), &mut len);
+        let msg_ctx = cosign_message_hash_ctx_new(ctx, ptr::null(), 0);
+        assert!(!msg_ctx.is_null());
+        cosign_sm3_ctx_update(msg_ctx, data.as_ptr(), data.len() as c_ulong);
+        cosign_sm3_ctx_final(msg_ctx, hash.as_mut_ptr(), &mut len);
+        assert_eq!(hash, e);
+        cosign_sm3_ctx_free(msg_ctx);
+        cosign_context_free(ctx);
+    }
+
+    #[test]
+    fn test_sm3_hash_many() {
+        let messages: Vec<Vec<u8>> = (0..13usize).map(|i| vec![i as u8; i * 37]).collect();
+        let mut ptrs: Vec<*const c_uchar> = messages.iter().map(|m| m.as_ptr()).collect();
+        let lens: Vec<c_ulong> = messages.iter().map(|m| m.len() as c_ulong).collect();
+        let mut out = vec![0u8; messages.len() * 32];
+        assert_eq!(
+            cosign_sm3_hash_many(ptrs.as_ptr(), lens.as_ptr(), messages.len() as c_ulong, out.as_mut_ptr()),
+            COSIGN_OK
+        );
+        for (message, hash) in messages.iter().zip(out.chunks_exact(32)) {
+            assert_eq!(hash, CoSignProtocol::sm3_hash(message).as_slice());
+        }
+
+        // 空消息可以传 NULL，非空消息不行
+        ptrs[0] = ptr::null();
+        assert_eq!(cosign_sm3_hash_many(ptrs.as_ptr(), lens.as_ptr(), 2, out.as_mut_ptr()), COSIGN_OK);
+        ptrs[1] = ptr::null();
+        assert_eq!(cosign_sm3_hash_many(ptrs.as_ptr(), lens.as_ptr(), 2, out.as_mut_ptr()), COSIGN_ERR_NULL_PTR);
+
+        // count 对应的缓冲区字节数溢出时拒绝，不构造切片
+        let huge = (usize::MAX / 16) as c_ulong;
+        assert_eq!(cosign_sm3_hash_many(ptrs.as_ptr(), lens.as_ptr(), huge, out.as_mut_ptr()), COSIGN_ERR_INVALID_PARAM);
+    }
+
     #[test]
     fn test_sm2_sign_verify() {
         let ctx = cosign_context_new();
@@ -533,6 +1595,84 @@ mod tests {
         cosign_context_free(ctx);
     }
 
+    #[test]
+    fn test_decrypt_stream() {
+        let ctx = cosign_context_new();
+        let protocol = CoSignProtocol::new().unwrap();
+        let d1 = protocol.generate_d1_array().unwrap();
+        // Reason: 取 d2 = 1，则公钥 Pa = (d1 - 1)·G、T2 = T1，不需要服务端即可构造协同解密的输入
+        let d = (sm2_co_sign_core::Scalar::from_be_array(&d1) - sm2_co_sign_core::Scalar::ONE).to_bytes_be();
+        let public_key = protocol.calculate_p1_array(&d).unwrap();
+        let message: Vec<u8> = (0..10_000u32).map(|i| i as u8).collect();
+        let ciphertext = CoSignProtocol::encrypt(&public_key, &message).unwrap();
+        let (c1, c3, c2) = (&ciphertext[1..65], &ciphertext[65..97], &ciphertext[97..]);
+        let t2 = protocol.decrypt_prepare_array(&d1, c1).unwrap();
+
+        let dctx = cosign_decrypt_stream_init(ctx, t2.as_ptr(), 64, c1.as_ptr(), 64, c3.as_ptr(), 32);
+        assert!(!dctx.is_null());
+        let mut plaintext = vec![0u8; c2.len()];
+        for (c, m) in c2.chunks(3000).zip(plaintext.chunks_mut(3000)) {
+            assert_eq!(cosign_decrypt_stream_update(dctx, c.as_ptr(), c.len() as c_ulong, m.as_mut_ptr()), COSIGN_OK);
+        }
+        assert_eq!(cosign_decrypt_stream_final(dctx), COSIGN_OK);
+        assert_eq!(plaintext, message);
+        // final 之后不能继续使用
+        assert_eq!(cosign_decrypt_stream_final(dctx), COSIGN_ERR_INVALID_PARAM);
+        cosign_decrypt_stream_free(dctx);
+
+        // 原地解密被篡改的 C2：final 报告校验失败
+        let mut tampered = c2.to_vec();
+        tampered[9999] ^= 1;
+        let dctx = cosign_decrypt_stream_init(ctx, t2.as_ptr(), 64, c1.as_ptr(), 64, c3.as_ptr(), 32);
+        let buf = tampered.as_mut_ptr();
+        assert_eq!(cosign_decrypt_stream_update(dctx, buf, tampered.len() as c_ulong, buf), COSIGN_OK);
+        assert_eq!(cosign_decrypt_stream_final(dctx), COSIGN_ERR_CRYPTO);
+        cosign_decrypt_stream_free(dctx);
+
+        assert!(cosign_decrypt_stream_init(ctx, t2.as_ptr(), 64, c1.as_ptr(), 64, c3.as_ptr(), 31).is_null());
+        cosign_context_free(ctx);
+    }
+
+    #[test]
+    fn test_sm2_verify_batch() {
+        let ctx = cosign_context_new();
+        let mut d1 = [0u8; 32];
+        let mut d1_len: c_ulong = 0;
+        cosign_generate_d1(ctx, d1.as_mut_ptr(), &mut d1_len);
+        let mut p1 = [0u8; 64];
+        let mut p1_len: c_ulong = 0;
+        cosign_calculate_p1(ctx, d1.as_ptr(), d1_len, p1.as_mut_ptr(), &mut p1_len);
+
+        let messages: [&[u8]; 3] = [b"first", b"second", b""];
+        let mut public_keys = Vec::new();
+        let mut signatures = Vec::new();
+        for message in messages {
+            let mut signature = [0u8; 64];
+            let mut sig_len: c_ulong = 0;
+            cosign_sm2_sign(d1.as_ptr(), d1_len, message.as_ptr(), message.len() as c_ulong, signature.as_mut_ptr(), &mut sig_len);
+            public_keys.extend_from_slice(&p1);
+            signatures.extend_from_slice(&signature);
+        }
+        let ptrs: Vec<*const c_uchar> = vec![messages[0].as_ptr(), messages[1].as_ptr(), ptr::null()];
+        let lens: Vec<c_ulong> = messages.iter().map(|m| m.len() as c_ulong).collect();
+        let mut status = [-1 as c_int; 3];
+
+        let verify = |signatures: &[u8], status: &mut [c_int; 3]| {
+            cosign_sm2_verify_batch(ctx, public_keys.as_ptr(), ptrs.as_ptr(), lens.as_ptr(), signatures.as_ptr(), 3, status.as_mut_ptr())
+        };
+        assert_eq!(verify(&signatures, &mut status), COSIGN_OK);
+        assert_eq!(status, [COSIGN_OK; 3]);
+
+        signatures[64 + 40] ^= 1;
+        assert_eq!(verify(&signatures, &mut status), COSIGN_ERR_CRYPTO);
+        assert_eq!(status, [COSIGN_OK, COSIGN_ERR_CRYPTO, COSIGN_OK]);
+
+        assert_eq!(cosign_sm2_verify_batch(ctx, ptr::null(), ptrs.as_ptr(), lens.as_ptr(), signatures.as_ptr(), 3, status.as_mut_ptr()), COSIGN_ERR_NULL_PTR);
+        let huge = (usize::MAX / 32) as c_ulong;
+        assert_eq!(cosign_sm2_verify_batch(ctx, public_keys.as_ptr(), ptrs.as_ptr(), lens.as_ptr(), signatures.as_ptr(), huge, status.as_mut_ptr()), COSIGN_ERR_INVALID_PARAM);
+        cosign_context_free(ctx);
+    }
+
     #[test]
     fn test_sm2_encrypt_decrypt() {
         let ctx = cosign_context_new();
@@ -546,13 +1686,13 @@ mod tests {
 
         let message = b"hello world";
         let mut ciphertext = [0u8; 256];
-        let mut cipher_len: c_ulong = 0;
+        let mut cipher_len = ciphertext.len() as c_ulong;
 
         let result = cosign_sm2_encrypt(p1.as_ptr(), p1_len, message.as_ptr(), message.len() as c_ulong, ciphertext.as_mut_ptr(), &mut cipher_len);
         assert_eq!(result, COSIGN_OK);
 
         let mut plaintext = [0u8; 256];
-        let mut plain_len: c_ulong = 0;
+        let mut plain_len = plaintext.len() as c_ulong;
 
         let result = cosign_sm2_decrypt(d1.as_ptr(), d1_len, ciphertext.as_ptr(), cipher_len, plaintext.as_mut_ptr(), &mut plain_len);
         assert_eq!(result, COSIGN_OK);
@@ -564,8 +1704,8 @@ mod tests {
     #[test]
     fn test_base64() {
         let data = b"hello world";
-        let mut out_str = [0i8; 64];
-        let mut len: c_ulong = 0;
+        let mut out_str = [0 as c_char; 64];
+        let mut len = out_str.len() as c_ulong;
 
         let result = cosign_base64_encode(data.as_ptr(), data.len() as c_ulong, out_str.as_mut_ptr(), &mut len);
         assert_eq!(result, COSIGN_OK);
@@ -573,10 +1713,108 @@ mod tests {
         let encoded = unsafe { CStr::from_ptr(out_str.as_ptr()) };
         assert!(!encoded.to_bytes().is_empty());
 
-        let mut decoded = [0u8; 64];
+        // 查询解码长度
         let mut decoded_len: c_ulong = 0;
+        let result = cosign_base64_decode(out_str.as_ptr(), ptr::null_mut(), &mut decoded_len);
+        assert_eq!(result, COSIGN_OK);
+        assert_eq!(decoded_len as usize, data.len());
+
+        let mut decoded = [0u8; 64];
+        let mut decoded_len = decoded.len() as c_ulong;
         let result = cosign_base64_decode(out_str.as_ptr(), decoded.as_mut_ptr(), &mut decoded_len);
         assert_eq!(result, COSIGN_OK);
         assert_eq!(&decoded[..decoded_len as usize], data);
+
+        // 容量不足
+        let mut decoded_len = (data.len() - 1) as c_ulong;
+        let result = cosign_base64_decode(out_str.as_ptr(), decoded.as_mut_ptr(), &mut decoded_len);
+        assert_eq!(result, COSIGN_ERR_BUFFER_TOO_SMALL);
+        assert_eq!(decoded_len as usize, data.len());
+
+        let invalid = b"aGVsbG8*\0";
+        let mut decoded_len = decoded.len() as c_ulong;
+        assert_eq!(
+            cosign_base64_decode(invalid.as_ptr() as *const c_char, decoded.as_mut_ptr(), &mut decoded_len),
+            COSIGN_ERR_ENCODING
+        );
+    }
+
+    #[test]
+    fn test_metrics_snapshot() {
+        let mut len: c_ulong = 0;
+        assert_eq!(cosign_metrics_snapshot(ptr::null_mut(), &mut len), COSIGN_OK);
+        let mut text = vec![0 as c_char; len as usize + 256];
+        let mut len = text.len() as c_ulong;
+        assert_eq!(cosign_metrics_snapshot(text.as_mut_ptr(), &mut len), COSIGN_OK);
+        let text = unsafe { CStr::from_ptr(text.as_ptr()) }.to_str().unwrap();
+        assert_eq!(text.len(), len as usize);
+        #[cfg(feature = "metrics")]
+        assert!(text.contains("sm2_cosign_phase_seconds"));
+        assert_eq!(cosign_metrics_snapshot(ptr::null_mut(), ptr::null_mut()), COSIGN_ERR_NULL_PTR);
+    }
+
+    #[test]
+    fn test_output_size_query() {
+        let ctx = cosign_context_new();
+        let mut d1 = [0u8; 32];
+        let mut d1_len: c_ulong = 0;
+        cosign_generate_d1(ctx, d1.as_mut_ptr(), &mut d1_len);
+        let mut p1 = [0u8; 64];
+        let mut p1_len: c_ulong = 0;
+        cosign_calculate_p1(ctx, d1.as_ptr(), d1_len, p1.as_mut_ptr(), &mut p1_len);
+        let message = vec![0x5au8; 1000];
+
+        // NULL 输出只返回所需长度
+        let mut cipher_len: c_ulong = 0;
+        let result = cosign_sm2_encrypt(p1.as_ptr(), 64, message.as_ptr(), 1000, ptr::null_mut(), &mut cipher_len);
+        assert_eq!(result, COSIGN_OK);
+        assert_eq!(cipher_len, 1097);
+
+        // 明文长度加上密文开销溢出时拒绝，不报告回绕后的长度
+        let mut huge_len: c_ulong = 0;
+        let result = cosign_sm2_encrypt(p1.as_ptr(), 64, message.as_ptr(), c_ulong::MAX - 10, ptr::null_mut(), &mut huge_len);
+        assert_eq!(result, COSIGN_ERR_INVALID_PARAM);
+        assert_eq!(huge_len, 0);
+
+        // 容量不足时报错并写回所需长度
+        let mut ciphertext = vec![0u8; cipher_len as usize];
+        let mut small = 100 as c_ulong;
+        let result = cosign_sm2_encrypt(p1.as_ptr(), 64, message.as_ptr(), 1000, ciphertext.as_mut_ptr(), &mut small);
+        assert_eq!(result, COSIGN_ERR_BUFFER_TOO_SMALL);
+        assert_eq!(small, 1097);
+
+        let result = cosign_sm2_encrypt(p1.as_ptr(), 64, message.as_ptr(), 1000, ciphertext.as_mut_ptr(), &mut cipher_len);
+        assert_eq!(result, COSIGN_OK);
+
+        let mut plain_len: c_ulong = 0;
+        let result = cosign_sm2_decrypt(d1.as_ptr(), 32, ciphertext.as_ptr(), cipher_len, ptr::null_mut(), &mut plain_len);
+        assert_eq!(result, COSIGN_OK);
+        assert_eq!(plain_len, 1000);
+        let mut plaintext = vec![0u8; plain_len as usize];
+        let result = cosign_sm2_decrypt(d1.as_ptr(), 32, ciphertext.as_ptr(), cipher_len, plaintext.as_mut_ptr(), &mut plain_len);
+        assert_eq!(result, COSIGN_OK);
+        assert_eq!(plaintext, message);
+
+        // 协同解密完成阶段：明文长度等于 C2 长度
+        let mut len: c_ulong = 0;
+        let c2 = &ciphertext[97..];
+        let result = cosign_complete_decryption(
+            ctx, p1.as_ptr(), 64, ciphertext[1..65].as_ptr(), 64, ciphertext[65..97].as_ptr(), 32,
+            c2.as_ptr(), c2.len() as c_ulong, ptr::null_mut(), &mut len,
+        );
+        assert_eq!(result, COSIGN_OK);
+        assert_eq!(len, 1000);
+
+        let mut len: c_ulong = 0;
+        let result = cosign_base64_encode(message.as_ptr(), 1000, ptr::null_mut(), &mut len);
+        assert_eq!(result, COSIGN_OK);
+        assert_eq!(len, 1337);
+        let mut encoded = vec![0 as c_char; len as usize];
+        let result = cosign_base64_encode(message.as_ptr(), 1000, encoded.as_mut_ptr(), &mut len);
+        assert_eq!(result, COSIGN_OK);
+        assert_eq!(len, 1336);
+        assert_eq!(encoded[1336], 0);
+
+        cosign_context_free(ctx);
     }
 }
@@ -2,10 +2,11 @@
  * SM2 协同签名 FFI 测试程序
  * 
  * 测试内容：
- * 1. SM3 哈希计算
+ * 1. SM3 哈希计算（一次性与分块）
  * 2. SM2 签名和验签
  * 3. SM2 加密和解密
  * 4. Base64 编解码
+ * 5. 导入上下文安全内存池的 D1
  */
 
 #include <stdio.h>
@@ -42,6 +43,43 @@ int test_sm3_hash() {
     return 0;
 }
 
+// 测试增量 SM3 哈希（分块结果应与一次性哈希一致）
+int test_sm3_streaming() {
+    printf("\n=== 测试增量 SM3 哈希 ===\n");
+
+    unsigned char data[1000];
+    memset(data, 'a', sizeof(data));
+
+    unsigned char expected[32];
+    unsigned long expected_len = 0;
+    cosign_sm3_hash(data, sizeof(data), expected, &expected_len);
+
+    CoSignSm3Ctx *sm3 = cosign_sm3_ctx_new();
+    if (sm3 == NULL) {
+        printf("创建 SM3 上下文失败\n");
+        return -1;
+    }
+
+    for (unsigned long offset = 0; offset < sizeof(data); offset += 333) {
+        unsigned long chunk = sizeof(data) - offset < 333 ? sizeof(data) - offset : 333;
+        cosign_sm3_ctx_update(sm3, data + offset, chunk);
+    }
+
+    unsigned char hash[32];
+    unsigned long hash_len = 0;
+    int result = cosign_sm3_ctx_final(sm3, hash, &hash_len);
+    cosign_sm3_ctx_free(sm3);
+
+    if (result != COSIGN_OK || hash_len != 32 || memcmp(hash, expected, 32) != 0) {
+        printf("错误：分块哈希结果不匹配！\n");
+        return -1;
+    }
+
+    print_hex("SM3 哈希值", hash, hash_len);
+    printf("增量 SM3 哈希测试通过！\n");
+    return 0;
+}
+
 // 测试 SM2 签名和验签
 int test_sm2_sign_verify() {
     printf("\n=== 测试 SM2 签名和验签 ===\n");
@@ -154,8 +192,15 @@ int test_sm2_encrypt_decrypt() {
     printf("明文: %s\n", plaintext);
     
     // SM2 加密
-    unsigned char ciphertext[256];
+    // 先查询密文长度（NULL 输出），再按容量写入
     unsigned long cipher_len = 0;
+    result = cosign_sm2_encrypt(p1, p1_len, (const unsigned char *)plaintext, plaintext_len, NULL, &cipher_len);
+    if (result != COSIGN_OK || cipher_len != plaintext_len + 97) {
+        printf("查询密文长度失败: %d, %lu\n", result, cipher_len);
+        cosign_context_free(ctx);
+        return -1;
+    }
+    unsigned char ciphertext[256];
     result = cosign_sm2_encrypt(p1, p1_len, (const unsigned char *)plaintext, plaintext_len, ciphertext, &cipher_len);
     if (result != COSIGN_OK) {
         printf("SM2 加密失败: %d\n", result);
@@ -166,7 +211,14 @@ int test_sm2_encrypt_decrypt() {
     
     // SM2 解密
     unsigned char decrypted[256];
-    unsigned long decrypted_len = 0;
+    unsigned long decrypted_len = 4;
+    result = cosign_sm2_decrypt(d1, d1_len, ciphertext, cipher_len, decrypted, &decrypted_len);
+    if (result != COSIGN_ERR_BUFFER_TOO_SMALL || decrypted_len != plaintext_len) {
+        printf("容量不足未正确报错: %d, %lu\n", result, decrypted_len);
+        cosign_context_free(ctx);
+        return -1;
+    }
+    decrypted_len = sizeof(decrypted) - 1;
     result = cosign_sm2_decrypt(d1, d1_len, ciphertext, cipher_len, decrypted, &decrypted_len);
     if (result != COSIGN_OK) {
         printf("SM2 解密失败: %d\n", result);
@@ -187,6 +239,7 @@ int test_sm2_encrypt_decrypt() {
     
     // 测试错误密文解密
     ciphertext[10] ^= 0xff;  // 篡改密文
+    decrypted_len = sizeof(decrypted) - 1;
     result = cosign_sm2_decrypt(d1, d1_len, ciphertext, cipher_len, decrypted, &decrypted_len);
     if (result == COSIGN_OK) {
         printf("警告：篡改后的密文解密成功（可能需要检查解密验证）\n");
@@ -207,19 +260,18 @@ int test_base64() {
     
     // Base64 编码
     char encoded[64];
-    unsigned long encoded_len = 0;
+    unsigned long encoded_len = sizeof(encoded);
     int result = cosign_base64_encode((const unsigned char *)data, data_len, encoded, &encoded_len);
     if (result != COSIGN_OK) {
         printf("Base64 编码失败: %d\n", result);
         return -1;
     }
-    encoded[encoded_len] = '\0';
     printf("原始数据: %s\n", data);
     printf("Base64 编码: %s\n", encoded);
     
     // Base64 解码
     unsigned char decoded[64];
-    unsigned long decoded_len = 0;
+    unsigned long decoded_len = sizeof(decoded);
     result = cosign_base64_decode(encoded, decoded, &decoded_len);
     if (result != COSIGN_OK) {
         printf("Base64 解码失败: %d\n", result);
@@ -238,6 +290,68 @@ int test_base64() {
     return 0;
 }
 
+int test_context_key() {
+    printf("\n=== 测试导入 D1 到安全内存池 ===\n");
+
+    CoSignContext *ctx = cosign_context_new();
+    if (ctx == NULL) {
+        printf("创建上下文失败\n");
+        return -1;
+    }
+
+    unsigned char d1[32], k1[32], q1[64];
+    unsigned long d1_len = sizeof(d1), k1_len = sizeof(k1), q1_len = sizeof(q1);
+    unsigned char r[32], s2[32], s3[32];
+    memset(r, 3, sizeof(r));
+    memset(s2, 4, sizeof(s2));
+    memset(s3, 5, sizeof(s3));
+    if (cosign_generate_d1(ctx, d1, &d1_len) != COSIGN_OK
+        || cosign_sign_prepare(ctx, k1, &k1_len, q1, &q1_len) != COSIGN_OK) {
+        printf("生成 D1 / k1 失败\n");
+        cosign_context_free(ctx);
+        return -1;
+    }
+
+    // 传 D1 的普通接口作为对照
+    unsigned char expected_r[32], expected_s[32];
+    unsigned long r_len = sizeof(expected_r), s_len = sizeof(expected_s);
+    int result = cosign_complete_signature(ctx, k1, k1_len, d1, d1_len, r, 32, s2, 32, s3, 32,
+                                           expected_r, &r_len, expected_s, &s_len);
+
+    unsigned int key_id = 0;
+    if (result == COSIGN_OK) {
+        result = cosign_context_import_d1(ctx, d1, d1_len, &key_id);
+    }
+    // 导入后即可清零本地副本
+    memset(d1, 0, sizeof(d1));
+
+    unsigned char signature[64];
+    if (result == COSIGN_OK) {
+        result = cosign_complete_signature_with_key(ctx, key_id, k1, k1_len, r, 32, s2, 32, s3, 32, signature);
+    }
+    if (result != COSIGN_OK || memcmp(signature, expected_r, 32) != 0 || memcmp(signature + 32, expected_s, 32) != 0) {
+        printf("错误：导入密钥签名结果不一致: %d\n", result);
+        cosign_context_free(ctx);
+        return -1;
+    }
+
+    unsigned long capacity = 0, in_use = 0;
+    int locked = 0;
+    cosign_secure_stats(&capacity, &in_use, &locked);
+    printf("安全内存池: 槽位 %lu，使用中 %lu，%s\n", capacity, in_use, locked ? "已锁定" : "未锁定");
+
+    if (cosign_context_release_d1(ctx, key_id) != COSIGN_OK
+        || cosign_context_release_d1(ctx, key_id) != COSIGN_ERR_INVALID_PARAM) {
+        printf("错误：释放密钥结果不符合预期\n");
+        cosign_context_free(ctx);
+        return -1;
+    }
+
+    cosign_context_free(ctx);
+    printf("导入 D1 测试通过！\n");
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     printf("========================================\n");
     printf("  SM2 协同签名 FFI 测试程序\n");
@@ -249,6 +363,11 @@ int main(int argc, char *argv[]) {
     if (test_sm3_hash() != 0) {
         failed++;
     }
+
+    // 测试增量 SM3 哈希
+    if (test_sm3_streaming() != 0) {
+        failed++;
+    }
     
     // 测试 SM2 签名和验签
     if (test_sm2_sign_verify() != 0) {
@@ -264,6 +383,11 @@ int main(int argc, char *argv[]) {
     if (test_base64() != 0) {
         failed++;
     }
+
+    // 测试导入 D1 到安全内存池
+    if (test_context_key() != 0) {
+        failed++;
+    }
     
     printf("\n========================================\n");
     if (failed == 0) {
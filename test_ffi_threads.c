@@ -0,0 +1,164 @@
+/**
+ * SM2 协同签名 FFI 多线程压力测试
+ *
+ * 所有线程共享同一个 CoSignContext，同时执行：
+ * 1. 生成 D1 / 计算 P1
+ * 2. 签名预处理（校验 Q1 = k1 * G）
+ * 3. 交替使用两个公钥计算消息哈希 E（结果须与单线程计算一致）
+ * 4. 协同解密完整流程（d2 = 1，加密公钥为 (d1 - 1) * G）
+ *
+ * 编译运行：
+ *   cargo build --release -p sm2_co_sign_ffi
+ *   gcc -O2 -I. test_ffi_threads.c target/release/libsm2_co_sign_ffi.a -lpthread -ldl -lm -o test_ffi_threads
+ *   ./test_ffi_threads
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sm2_co_sign_ffi.h"
+
+#define THREADS    8
+#define ITERATIONS 50
+
+static const CoSignContext *g_ctx;
+static unsigned char g_public_keys[2][64];
+static unsigned char g_expected_e[2][32];
+static const char *g_message = "shared context stress test";
+
+// 大端字节串减 1，结果为 0 时返回 -1
+static int sub_one(const unsigned char *in, unsigned char *out) {
+    int nonzero = 0;
+    int borrow = 1;
+    for (int i = 31; i >= 0; i--) {
+        int v = in[i] - borrow;
+        borrow = v < 0;
+        out[i] = (unsigned char)(v & 0xff);
+        nonzero |= out[i];
+    }
+    return nonzero ? 0 : -1;
+}
+
+static int check(int ok, int id, const char *step) {
+    if (!ok) {
+        printf("线程 %d: %s 失败\n", id, step);
+    }
+    return ok ? 0 : -1;
+}
+
+static void *worker(void *arg) {
+    int id = (int)(long)arg;
+    const unsigned char *message = (const unsigned char *)g_message;
+    unsigned long message_len = strlen(g_message);
+
+    for (int iter = 0; iter < ITERATIONS; iter++) {
+        unsigned char d1[32], d[32], p1[64], pa[64];
+        unsigned long len = 0;
+
+        // 1. 生成 D1，计算 P1 与加密公钥 Pa = (d1 - 1) * G
+        if (check(cosign_generate_d1(g_ctx, d1, &len) == COSIGN_OK && len == 32, id, "生成 D1")) {
+            return (void *)1;
+        }
+        if (sub_one(d1, d) != 0) {
+            continue;
+        }
+        if (check(cosign_calculate_p1(g_ctx, d1, 32, p1, &len) == COSIGN_OK, id, "计算 P1") ||
+            check(cosign_calculate_p1(g_ctx, d, 32, pa, &len) == COSIGN_OK, id, "计算 Pa")) {
+            return (void *)1;
+        }
+
+        // 2. 签名预处理：Q1 须等于 k1 * G
+        unsigned char k1[32], q1[64], q1_check[64];
+        unsigned long k1_len = 0, q1_len = 0;
+        if (check(cosign_sign_prepare(g_ctx, k1, &k1_len, q1, &q1_len) == COSIGN_OK, id, "签名预处理") ||
+            check(cosign_calculate_p1(g_ctx, k1, k1_len, q1_check, &len) == COSIGN_OK &&
+                      memcmp(q1, q1_check, 64) == 0,
+                  id, "校验 Q1")) {
+            return (void *)1;
+        }
+
+        // 3. 交替公钥计算 E，逐次与主线程结果比对
+        unsigned char e[32];
+        int key = (iter + id) & 1;
+        if (check(cosign_hash_message(g_ctx, message, message_len, g_public_keys[key], 64, e, &len) == COSIGN_OK &&
+                      memcmp(e, g_expected_e[key], 32) == 0,
+                  id, "消息哈希")) {
+            return (void *)1;
+        }
+
+        // 4. 协同解密：T1 = d1 * C1，d2 = 1 时 T2 = T1
+        unsigned char plaintext_in[64];
+        unsigned long plain_in_len = 16 + (unsigned long)((iter * 7 + id) % 48);
+        memset(plaintext_in, 'a' + id, plain_in_len);
+
+        unsigned char ciphertext[256];
+        unsigned long cipher_len = sizeof(ciphertext);
+        if (check(cosign_sm2_encrypt(pa, 64, plaintext_in, plain_in_len, ciphertext, &cipher_len) == COSIGN_OK,
+                  id, "加密")) {
+            return (void *)1;
+        }
+
+        unsigned char t1[64];
+        if (check(cosign_decrypt_prepare(g_ctx, d1, 32, ciphertext + 1, 64, t1, &len) == COSIGN_OK, id,
+                  "解密预处理")) {
+            return (void *)1;
+        }
+
+        unsigned char plaintext[64];
+        unsigned long plain_len = sizeof(plaintext);
+        int result = cosign_complete_decryption(g_ctx, t1, 64, ciphertext + 1, 64, ciphertext + 65, 32,
+                                                ciphertext + 97, cipher_len - 97, plaintext, &plain_len);
+        if (check(result == COSIGN_OK && plain_len == plain_in_len && memcmp(plaintext, plaintext_in, plain_len) == 0,
+                  id, "协同解密")) {
+            return (void *)1;
+        }
+    }
+    return NULL;
+}
+
+int main(void) {
+    printf("========================================\n");
+    printf("  SM2 协同签名 FFI 多线程压力测试\n");
+    printf("========================================\n");
+
+    CoSignContext *ctx = cosign_context_new();
+    if (ctx == NULL) {
+        printf("创建上下文失败\n");
+        return 1;
+    }
+    g_ctx = ctx;
+
+    // 主线程预先计算两个公钥及其消息哈希，作为各线程的期望值
+    for (int i = 0; i < 2; i++) {
+        unsigned char d1[32];
+        unsigned long len = 0;
+        cosign_generate_d1(ctx, d1, &len);
+        cosign_calculate_p1(ctx, d1, 32, g_public_keys[i], &len);
+        cosign_hash_message(ctx, (const unsigned char *)g_message, strlen(g_message), g_public_keys[i], 64,
+                            g_expected_e[i], &len);
+    }
+
+    pthread_t threads[THREADS];
+    for (long i = 0; i < THREADS; i++) {
+        if (pthread_create(&threads[i], NULL, worker, (void *)i) != 0) {
+            printf("创建线程失败\n");
+            return 1;
+        }
+    }
+
+    int failed = 0;
+    for (int i = 0; i < THREADS; i++) {
+        void *ret = NULL;
+        pthread_join(threads[i], &ret);
+        failed |= ret != NULL;
+    }
+    cosign_context_free(ctx);
+
+    if (failed) {
+        printf("\n多线程压力测试失败！\n");
+        return 1;
+    }
+    printf("\n%d 个线程 x %d 轮共享同一上下文，全部通过！\n", THREADS, ITERATIONS);
+    return 0;
+}